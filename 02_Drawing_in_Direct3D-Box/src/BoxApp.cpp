@@ -1,3 +1,4 @@
+#include "AssetPack.h"
 #include "D3DApp.h"
 #include "MathHelper.h"
 #include "UploadBuffer.h"
@@ -433,13 +434,25 @@ void BoxApp::BuildShadersAndInputLayout()
 {
     HRESULT hr = S_OK;
 
-    // 运行时编译 Shader
-    mvsByteCode = d3dUtil::CompileShader(L"Shaders\\color.hlsl", nullptr, "VS", "vs_5_0");
-    mpsByteCode = d3dUtil::CompileShader(L"Shaders\\color.hlsl", nullptr, "PS", "ps_5_0");
+    // 优先从资源包（构建时用 fxc 编译 color.hlsl，再由 AssetPackBuilder 打包而成）中加载离线编译的 Shader 字节码，
+    // 节省编译时间+提前发现编译错误，也只需打开一个文件
+    AssetPack pack;
+    if (pack.Open(L"Shaders.pack"))
+    {
+        mvsByteCode = d3dUtil::LoadBinary(pack, "color_vs.cso");
+        mpsByteCode = d3dUtil::LoadBinary(pack, "color_ps.cso");
+    }
+    else
+    {
+        OutputDebugStringA(("Shaders.pack: " + pack.Error() + "\n").c_str());
+    }
 
-    // 加载离线编译的 Shader 字节码，节省编译时间+提前发现编译错误
-    //    mvsByteCode = d3dUtil::LoadBinary(L"Shaders\\color_vs.cso");
-    //    mpsByteCode = d3dUtil::LoadBinary(L"Shaders\\color_ps.cso");
+    // 没有资源包（或包中缺少字节码）时，运行时编译散放的 Shader 源文件
+    if (mvsByteCode == nullptr || mpsByteCode == nullptr)
+    {
+        mvsByteCode = d3dUtil::CompileShader(L"Shaders\\color.hlsl", nullptr, "VS", "vs_5_0");
+        mpsByteCode = d3dUtil::CompileShader(L"Shaders\\color.hlsl", nullptr, "PS", "ps_5_0");
+    }
 
     mInputLayout = {{"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
                     {"COLOR", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}};
@@ -494,12 +507,6 @@ void BoxApp::BuildBoxGeometry()
     mBoxGeo = std::make_unique<MeshGeometry>();
     mBoxGeo->Name = "boxGeo";
 
-    ThrowIfFailed(D3DCreateBlob(vbByteSize, &mBoxGeo->VertexBufferCPU));
-    CopyMemory(mBoxGeo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-    ThrowIfFailed(D3DCreateBlob(ibByteSize, &mBoxGeo->IndexBufferCPU));
-    CopyMemory(mBoxGeo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
-
     // 我们无须为顶点缓冲区视图创建描述符堆。
     mBoxGeo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), vertices.data(),
                                                             vbByteSize, mBoxGeo->VertexBufferUploader);
@@ -1,6 +1,8 @@
 #include "D3DApp.h"
 #include "FrameResource.h"
 #include "GeometryGenerator.h"
+#include "MeshGeometryBuilder.h"
+#include "MeshSimplifier.h"
 
 using namespace DirectX;
 using namespace DirectX::PackedVector;
@@ -38,6 +40,11 @@ struct RenderItem
     UINT IndexCount = 0;
     UINT StartIndexLocation = 0;
     int BaseVertexLocation = 0;
+
+    // 可选的 LOD 链：Lods[0] 为原始网格，LodErrors 为各级的几何误差。为空则始终按上面的参数绘制
+    std::vector<SubmeshGeometry> Lods;
+    std::vector<float> LodErrors;
+    UINT CurrentLod = 0;
 };
 
 class ShapesApp : public D3DApp
@@ -63,6 +70,7 @@ class ShapesApp : public D3DApp
     void UpdateCamera(const GameTimer &gt);
     void UpdateObjectCBs(const GameTimer &gt);
     void UpdateMainPassCB(const GameTimer &gt);
+    void UpdateLods();
 
     void BuildDescriptorHeaps();
     void BuildConstantBufferViews();
@@ -72,6 +80,7 @@ class ShapesApp : public D3DApp
     void BuildPSOs();
     void BuildFrameResources();
     void BuildRenderItems();
+    void SetRenderItemLods(RenderItem *ri, const std::string &drawArg);
     void DrawRenderItems(ID3D12GraphicsCommandList *cmdList, const std::vector<RenderItem *> &ritems);
 
   private:
@@ -81,7 +90,11 @@ class ShapesApp : public D3DApp
     int mCurrFrameResourceIndex = 0;
 
     ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
-    ComPtr<ID3D12DescriptorHeap> mCbvHeap = nullptr;
+
+    // 初始化阶段所有默认缓冲区的上传都经由它合并为一批
+    std::unique_ptr<UploadBatch> mUploadBatch;
+    // 物体 CBV 是常驻描述符；渲染过程 CBV 每帧从临时区间分配，以帧资源的围栏值回收
+    std::unique_ptr<DescriptorHeap> mCbvHeap;
 
     ComPtr<ID3D12DescriptorHeap> mSrvDescriptorHeap = nullptr;
 
@@ -89,6 +102,9 @@ class ShapesApp : public D3DApp
     std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
     std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
 
+    // 各子网格 LOD 链的几何误差，Key 与 DrawArgs 中的原始子网格同名
+    std::unordered_map<std::string, std::vector<float>> mLodErrors;
+
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
 
     // 存有所有渲染项的向量
@@ -100,7 +116,8 @@ class ShapesApp : public D3DApp
 
     PassConstants mMainPassCB;
 
-    UINT mPassCbvOffset = 0;
+    // 所有帧资源的物体 CBV 在描述符堆中的起始索引
+    UINT mObjectCbvIndex = 0;
 
     bool mIsWireframe = false;
 
@@ -155,6 +172,8 @@ bool ShapesApp::Initialize()
     // 重置命令列表为执行初始化命令做好准备工作
     ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
+    mUploadBatch = std::make_unique<UploadBatch>(md3dDevice.Get());
+
     BuildRootSignature();
     BuildShadersAndInputLayout();
     BuildShapeGeometry();
@@ -164,14 +183,17 @@ bool ShapesApp::Initialize()
     BuildConstantBufferViews();
     BuildPSOs();
 
+    // 一次性记录全部上传命令
+    mUploadBatch->Record(mCommandList.Get());
+
     // 执行初始化命令
     ThrowIfFailed(mCommandList->Close());
     // 将待执行的命令列表加入命令队列
     ID3D12CommandList *cmdsLists[] = {mCommandList.Get()};
     mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
-    // 等待初始化完成
-    FlushCommandQueue();
+    // 不必等待初始化完成：暂存空间会在 GPU 执行到这个围栏点之后，由 Update 中的 ReleaseCompleted 回收
+    mUploadBatch->Submit(SignalFence());
     return true;
 }
 
@@ -188,6 +210,7 @@ void ShapesApp::Update(const GameTimer &gt)
 {
     OnKeyboardInput(gt);
     UpdateCamera(gt);
+    UpdateLods();
 
     // Cycle through the circular frame resource array.
     mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
@@ -204,6 +227,9 @@ void ShapesApp::Update(const GameTimer &gt)
         CloseHandle(eventHandle);
     }
 
+    mUploadBatch->ReleaseCompleted(mFence->GetCompletedValue());
+    mCbvHeap->ReleaseCompleted(mFence->GetCompletedValue());
+
     UpdateObjectCBs(gt);
     UpdateMainPassCB(gt);
 }
@@ -279,16 +305,20 @@ void ShapesApp::Draw(const GameTimer &gt)
         // 指向一个 DSV 的指针，用于指定我们希望绑定到渲染流水线上的深度/模板缓冲区。
         &depthStencilView);
 
-    ID3D12DescriptorHeap *descriptorHeaps[] = {mCbvHeap.Get()};
+    ID3D12DescriptorHeap *descriptorHeaps[] = {mCbvHeap->Heap()};
     mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
 
     mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
 
-    int passCbvIndex = mPassCbvOffset + mCurrFrameResourceIndex;
-    auto passCbvHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(mCbvHeap->GetGPUDescriptorHandleForHeapStart());
-    passCbvHandle.Offset(passCbvIndex, mCbvSrvUavDescriptorSize);
+    // 渲染过程 CBV 只在这一帧中使用，从临时描述符中分配，GPU 执行完这一帧之后自动回收
+    UINT passCbvIndex = mCbvHeap->AllocateTransient();
+    D3D12_CONSTANT_BUFFER_VIEW_DESC passCbvDesc;
+    passCbvDesc.BufferLocation = mCurrFrameResource->PassCB->Resource()->GetGPUVirtualAddress();
+    passCbvDesc.SizeInBytes = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
+    md3dDevice->CreateConstantBufferView(&passCbvDesc, mCbvHeap->CpuHandle(passCbvIndex));
+
     // 令描述符表与渲染流水线相绑定。
-    mCommandList->SetGraphicsRootDescriptorTable(1, passCbvHandle);
+    mCommandList->SetGraphicsRootDescriptorTable(1, mCbvHeap->GpuHandle(passCbvIndex));
     DrawRenderItems(mCommandList.Get(), mOpaqueRitems);
 
     // 按照资源的用途指示其状态的转变，将资源从渲染目标状态转换回呈现状态
@@ -309,6 +339,8 @@ void ShapesApp::Draw(const GameTimer &gt)
 
     // 增加围栏值，将之前的命令标记到此围栏点上
     mCurrFrameResource->Fence = ++mCurrentFence;
+    // 本帧分配的临时描述符在 GPU 到达这个围栏点之后回收
+    mCbvHeap->RetireFrame(mCurrFrameResource->Fence);
 
     // 向命令队列添加一条指令，以设置新的围栏点 GPU 还在执行我们此前向命令队列中传入的命令，
     // 所以，GPU 不会立即设置新的围栏点，这要等到它处理完 Signal() 函数之前的所有命令
@@ -360,37 +392,32 @@ void ShapesApp::OnMouseMove(WPARAM btnState, int x, int y)
 
 // 利用描述符将常量缓冲区绑定至渲染流水线上
 // 如果有 3 个帧资源与 n 个渲染项，那么就应存在 3n 个物体常量缓冲区（object constant buffer）
-// 以及 3 个渲染过程常量缓冲区（pass constant buffer）。因此，我们也就需要创建 3(n+1) 个常量缓冲区视图（CBV）。
-// 这样一来，我们还要修改 CBV 堆以容纳额外的描述符：
+// 以及 3 个渲染过程常量缓冲区（pass constant buffer）。物体 CBV 在初始化时一次性创建，是常驻描述符；
+// 渲染过程 CBV 则在每帧绘制时从临时描述符中分配，所以描述符堆中还要为它们留出临时区间：
 void ShapesApp::BuildDescriptorHeaps()
 {
     UINT objCount = (UINT)mOpaqueRitems.size();
 
     // 我们需要为每个帧资源中的每一个物体都创建一个 CBV 描述符，obj CBV
-    // 为了容纳每个帧资源中的渲染过程 CBV 而 +1。pass CBV
-    UINT numDescriptors = (objCount + 1) * gNumFrameResources;
-
-    // 保存渲染过程 CBV 的起始偏移量。在本程序中，这是排在最后面的 3 个描述符
-    // n frame ObjCBVs | n+1 frame ObjCBVs | n+2 frame ObjCBVs | n frame passCBV | n+1 frame passCBV | n+2 frame passCBV
-    mPassCbvOffset = objCount * gNumFrameResources;
+    UINT objectCbvCount = objCount * gNumFrameResources;
+    // 每帧一个渲染过程 CBV，最多有 gNumFrameResources 帧同时在 GPU 上排队。环形区间回绕时会浪费一部分空间，
+    // 所以多留一些余量
+    UINT transientCount = gNumFrameResources * 4;
 
     // 常量缓冲区描述符要存放在以 D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV 类型所建的描述符堆里。
     // 这种堆内可以混合存储常量缓冲区描述符、着色器资源描述符和无序访问（unordered access）描述符。
-    D3D12_DESCRIPTOR_HEAP_DESC cbvHeapDesc;
-    cbvHeapDesc.NumDescriptors = numDescriptors;
-    cbvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV;
-    cbvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
-    cbvHeapDesc.NodeMask = 0;
+    // 与之前创建渲染目标和深度/模板缓冲区这两种资源描述符堆的过程相比，一个重要的区别是，
+    // 在创建供着色器程序访问资源的描述符时，我们要把堆指定为着色器可见（DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE）。
+    mCbvHeap = std::make_unique<DescriptorHeap>(md3dDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV,
+                                                objectCbvCount + transientCount, transientCount, true);
 
-    // 这段代码与我们之前创建渲染目标和深度/模板缓冲区这两种资源描述符堆的过程很相似。然而，其中却有着一个重要的区别，
-    // 那就是在创建供着色器程序访问资源的描述符时，我们要把标志 Flags 指定为 DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE。
-
-    ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&cbvHeapDesc, IID_PPV_ARGS(&mCbvHeap)));
+    // n frame ObjCBVs | n+1 frame ObjCBVs | n+2 frame ObjCBVs 连续存放
+    mObjectCbvIndex = mCbvHeap->Allocate(objectCbvCount);
 }
 
 // 现在，我们就可以用下列代码来填充 CBV 堆，其中描述符 0 至描述符 n−1 包含了第 0 个帧资源的物体 CBV，
 // 描述符 n 至描述符 2n−1 容纳了第 1 个帧资源的物体 CBV，以此类推，描述符 2n 至描述符 3n−1 包含了
-// 第 2 个帧资源的物体 CBV。最后，3n、3n+1 以及 3n+2 分别存有第 0 个、第 1 个和第 2 个帧资源的渲染过程 CBV：
+// 第 2 个帧资源的物体 CBV（均相对于 mObjectCbvIndex）。渲染过程 CBV 在 Draw 中逐帧创建。
 void ShapesApp::BuildConstantBufferViews()
 {
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
@@ -407,9 +434,21 @@ void ShapesApp::BuildConstantBufferViews()
             cbAddress += i * objCBByteSize;
 
             // 偏移到该物体在描述符堆中的 CBV
-            int heapIndex = frameIndex * objCount + i;
-            auto handle = CD3DX12_CPU_DESCRIPTOR_HANDLE(mCbvHeap->GetCPUDescriptorHandleForHeapStart());
-            handle.Offset(heapIndex, mCbvSrvUavDescriptorSize);
+            UINT heapIndex = mObjectCbvIndex + frameIndex * objCount + i;
+
+            // 通过调用 ID3D12DescriptorHeap::GetCPUDescriptorHandleForHeapStart 方法，
+            // 我们可以获得堆中第一个描述符的句柄。然而，我们当前堆内所存放的描述符已不止一个，
+            // 所以仅使用此方法并不能找到其他描述符的句柄。此时，我们希望能够偏移到堆内的其他描述符处，
+            // 为此需要了解到达堆内下一个相邻描述符的增量。这个增量的大小其实是由硬件来确定的，
+            // 所以我们必须从设备上查询相关的信息。此外，该增量还依赖于堆的具体类型。这里增量为： mCbvSrvUavDescriptorSize
+            // 只要知道了相邻描述符之间的增量大小，就能通过两种 CD3DX12_CPU_DESCRIPTOR_HANDLE::Offset 方法之一偏
+            // 移到第 n 个描述符的句柄处：
+            //        handle.Offset(n * mCbvSrvUavDescriptorSize);
+            // 或者用另一个等价实现，先指定要偏移到第几个描述符，再给出描述符的增量大小
+            //        handle.Offset(n, mCbvSrvUavDescriptorSize);
+            // DescriptorHeap::CpuHandle 在内部做的正是这件事：它在创建时查询了增量大小与堆中第一个描述符的句柄，
+            // 指定要偏移到的目标描述符的编号，将它与相邻描述符之间的增量相乘，以此来找到第 n 个描述符的句柄
+            auto handle = mCbvHeap->CpuHandle(heapIndex);
 
             // 如果常量缓冲区存储了一个内有 n 个物体常量数据的常量数组，那么我们就可以通过 BufferLocation 和
             // SizeInBytes 参数来获取第 i 个物体的常量数据。考虑到硬件的需求（即硬件的最小分配空间），
@@ -422,41 +461,6 @@ void ShapesApp::BuildConstantBufferViews()
             md3dDevice->CreateConstantBufferView(&cbvDesc, handle);
         }
     }
-
-    UINT passCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(PassConstants));
-
-    // 最后 3 个描述符依次是每个帧资源的渲染过程 CBV
-    // n frame ObjCBVs | n+1 frame ObjCBVs | n+2 frame ObjCBVs | n frame passCBV | n+1 frame passCBV | n+2 frame passCBV
-    for (int frameIndex = 0; frameIndex < gNumFrameResources; ++frameIndex)
-    {
-        auto passCB = mFrameResources[frameIndex]->PassCB->Resource();
-
-        // 每个帧资源的渲染过程缓冲区中只存有一个常量缓冲区
-        D3D12_GPU_VIRTUAL_ADDRESS cbAddress = passCB->GetGPUVirtualAddress();
-
-        // 偏移到描述符堆中对应的渲染过程 CBV
-        int heapIndex = mPassCbvOffset + frameIndex;
-
-        // 通过调用 ID3D12DescriptorHeap::GetCPUDescriptorHandleForHeapStart 方法，
-        // 我们可以获得堆中第一个描述符的句柄。然而，我们当前堆内所存放的描述符已不止一个，
-        // 所以仅使用此方法并不能找到其他描述符的句柄。此时，我们希望能够偏移到堆内的其他描述符处，
-        // 为此需要了解到达堆内下一个相邻描述符的增量。这个增量的大小其实是由硬件来确定的，
-        // 所以我们必须从设备上查询相关的信息。此外，该增量还依赖于堆的具体类型。这里增量为： mCbvSrvUavDescriptorSize
-        // 只要知道了相邻描述符之间的增量大小，就能通过两种 CD3DX12_CPU_DESCRIPTOR_HANDLE::Offset 方法之一偏
-        // 移到第 n 个描述符的句柄处：
-
-        // 指定要偏移到的目标描述符的编号，将它与相邻描述符之间的增量相乘，以此来找到第 n 个描述符的句柄
-        auto handle = CD3DX12_CPU_DESCRIPTOR_HANDLE(mCbvHeap->GetCPUDescriptorHandleForHeapStart());
-        //        handle.Offset(n * mCbvSrvDescriptorSize);
-        // 或者用另一个等价实现，先指定要偏移到第几个描述符，再给出描述符的增量大小
-        handle.Offset(heapIndex, mCbvSrvUavDescriptorSize);
-
-        D3D12_CONSTANT_BUFFER_VIEW_DESC cbvDesc;
-        cbvDesc.BufferLocation = cbAddress;
-        cbvDesc.SizeInBytes = passCBByteSize;
-
-        md3dDevice->CreateConstantBufferView(&cbvDesc, handle);
-    }
 }
 
 // 如果我们把着色器程序当作一个函数，而将输入资源看作着色器的函数参数，那么根签名
@@ -557,110 +561,48 @@ void ShapesApp::BuildShapeGeometry()
     GeometryGenerator::MeshData cylinder = geoGen.CreateCylinder(0.5f, 0.3f, 3.0f, 20, 20);
     //
     // 将所有的几何体数据都合并到一对大的顶点/索引缓冲区中
-    // 以此来定义每个子网格数据在缓冲区中所占的范围
+    // 每个子网格在缓冲区中所占的范围由 MeshGeometryBuilder 计算
     //
 
-    // 对合并顶点缓冲区中每个物体的顶点偏移量进行缓存
-    UINT boxVertexOffset = 0;
-    UINT gridVertexOffset = (UINT)box.Vertices.size();
-    UINT sphereVertexOffset = gridVertexOffset + (UINT)grid.Vertices.size();
-    UINT cylinderVertexOffset = sphereVertexOffset + (UINT)sphere.Vertices.size();
-
-    // 对合并索引缓冲区中每个物体的起始索引进行缓存
-    UINT boxIndexOffset = 0;
-    UINT gridIndexOffset = (UINT)box.Indices32.size();
-    UINT sphereIndexOffset = gridIndexOffset + (UINT)grid.Indices32.size();
-    UINT cylinderIndexOffset = sphereIndexOffset + (UINT)sphere.Indices32.size();
-
-    // 定义的多个 SubmeshGeometry 结构体中包含了顶点/索引缓冲区内不同几何体的子网格数据
-
-    SubmeshGeometry boxSubmesh;
-    boxSubmesh.IndexCount = (UINT)box.Indices32.size();
-    boxSubmesh.StartIndexLocation = boxIndexOffset;
-    boxSubmesh.BaseVertexLocation = boxVertexOffset;
-
-    SubmeshGeometry gridSubmesh;
-    gridSubmesh.IndexCount = (UINT)grid.Indices32.size();
-    gridSubmesh.StartIndexLocation = gridIndexOffset;
-    gridSubmesh.BaseVertexLocation = gridVertexOffset;
-
-    SubmeshGeometry sphereSubmesh;
-    sphereSubmesh.IndexCount = (UINT)sphere.Indices32.size();
-    sphereSubmesh.StartIndexLocation = sphereIndexOffset;
-    sphereSubmesh.BaseVertexLocation = sphereVertexOffset;
-
-    SubmeshGeometry cylinderSubmesh;
-    cylinderSubmesh.IndexCount = (UINT)cylinder.Indices32.size();
-    cylinderSubmesh.StartIndexLocation = cylinderIndexOffset;
-    cylinderSubmesh.BaseVertexLocation = cylinderVertexOffset;
+    MeshGeometryBuilder builder(sizeof(Vertex));
+    builder.Reserve(box.Vertices.size() + grid.Vertices.size() + sphere.Vertices.size() + cylinder.Vertices.size(),
+                    box.Indices32.size() + grid.Indices32.size() + sphere.Indices32.size() +
+                        cylinder.Indices32.size());
+
+    // 提取出所需的顶点元素，并为每种几何体指定颜色
+    auto withColor = [](XMVECTORF32 color) {
+        return [color](const GeometryGenerator::Vertex &v) {
+            Vertex vertex;
+            vertex.Pos = v.Position;
+            vertex.Color = XMFLOAT4(color);
+            return vertex;
+        };
+    };
+    builder.AddMesh<Vertex>("box", box, withColor(DirectX::Colors::DarkGreen));
+    builder.AddMesh<Vertex>("grid", grid, withColor(DirectX::Colors::ForestGreen));
+    builder.AddMesh<Vertex>("sphere", sphere, withColor(DirectX::Colors::Crimson));
+    builder.AddMesh<Vertex>("cylinder", cylinder, withColor(DirectX::Colors::SteelBlue));
 
     //
-    // 提取出所需的顶点元素，再将所有网格的顶点装进一个顶点缓冲区
+    // 为球体与柱体生成 LOD 链。各级 LOD 与原始网格共用顶点，只需追加简化后的索引
     //
 
-    auto totalVertexCount =
-        box.Vertices.size() + grid.Vertices.size() + sphere.Vertices.size() + cylinder.Vertices.size();
-
-    std::vector<Vertex> vertices(totalVertexCount);
-
-    UINT k = 0;
-    for (size_t i = 0; i < box.Vertices.size(); ++i, ++k)
-    {
-        vertices[k].Pos = box.Vertices[i].Position;
-        vertices[k].Color = XMFLOAT4(DirectX::Colors::DarkGreen);
-    }
-
-    for (size_t i = 0; i < grid.Vertices.size(); ++i, ++k)
-    {
-        vertices[k].Pos = grid.Vertices[i].Position;
-        vertices[k].Color = XMFLOAT4(DirectX::Colors::ForestGreen);
-    }
-
-    for (size_t i = 0; i < sphere.Vertices.size(); ++i, ++k)
-    {
-        vertices[k].Pos = sphere.Vertices[i].Position;
-        vertices[k].Color = XMFLOAT4(DirectX::Colors::Crimson);
-    }
-
-    for (size_t i = 0; i < cylinder.Vertices.size(); ++i, ++k)
-    {
-        vertices[k].Pos = cylinder.Vertices[i].Position;
-        vertices[k].Color = XMFLOAT4(DirectX::Colors::SteelBlue);
-    }
-
-    std::vector<std::uint16_t> indices;
-    indices.insert(indices.end(), std::begin(box.GetIndices16()), std::end(box.GetIndices16()));
-    indices.insert(indices.end(), std::begin(grid.GetIndices16()), std::end(grid.GetIndices16()));
-    indices.insert(indices.end(), std::begin(sphere.GetIndices16()), std::end(sphere.GetIndices16()));
-    indices.insert(indices.end(), std::begin(cylinder.GetIndices16()), std::end(cylinder.GetIndices16()));
-
-    const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
-    const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
-
-    auto geo = std::make_unique<MeshGeometry>();
-    geo->Name = "shapeGeo";
-
-    ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-    CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-    ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-    CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
-
-    geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), vertices.data(),
-                                                        vbByteSize, geo->VertexBufferUploader);
+    auto appendLods = [&](const std::string &name, const GeometryGenerator::MeshData &meshData) {
+        MeshLodChain chain = MeshSimplifier::BuildLodChain(meshData, 4);
 
-    geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), indices.data(), ibByteSize,
-                                                       geo->IndexBufferUploader);
-
-    geo->VertexByteStride = sizeof(Vertex);
-    geo->VertexBufferByteSize = vbByteSize;
-    geo->IndexFormat = DXGI_FORMAT_R16_UINT;
-    geo->IndexBufferByteSize = ibByteSize;
+        auto &errors = mLodErrors[name];
+        errors.push_back(0.0f);
+        for (size_t level = 1; level < chain.Levels.size(); ++level)
+        {
+            const MeshLod &lod = chain.Levels[level];
+            builder.AddIndices(name + "_lod" + std::to_string(level), name, lod.Indices.data(), lod.Indices.size());
+            errors.push_back(lod.Error);
+        }
+    };
+    appendLods("sphere", sphere);
+    appendLods("cylinder", cylinder);
 
-    geo->DrawArgs["box"] = boxSubmesh;
-    geo->DrawArgs["grid"] = gridSubmesh;
-    geo->DrawArgs["sphere"] = sphereSubmesh;
-    geo->DrawArgs["cylinder"] = cylinderSubmesh;
+    auto geo = builder.Build(*mUploadBatch, "shapeGeo");
 
     mGeometries[geo->Name] = std::move(geo);
 }
@@ -792,6 +734,34 @@ void ShapesApp::UpdateMainPassCB(const GameTimer &gt)
     currPassCB->CopyData(0, mMainPassCB);
 }
 
+// 按屏幕空间误差为每个渲染项选择 LOD：几何误差投影到屏幕上不超过 1 个像素时，即可改用更粗糙的一级
+void ShapesApp::UpdateLods()
+{
+    const float pixelThreshold = 1.0f;
+    float projectionScale = LodSelector::ProjectionScale(0.25f * MathHelper::Pi, static_cast<float>(mClientHeight));
+
+    XMVECTOR eyePos = XMLoadFloat3(&mEyePos);
+    for (auto &e : mAllRitems)
+    {
+        RenderItem *ri = e.get();
+        if (ri->Lods.empty())
+            continue;
+
+        // 渲染项的世界矩阵只含平移，以物体原点到观察点的距离近似包围球的距离即可
+        XMVECTOR center = XMVectorSet(ri->World._41, ri->World._42, ri->World._43, 1.0f);
+        float distance = XMVectorGetX(XMVector3Length(center - eyePos));
+
+        ri->CurrentLod = LodSelector::SelectLevel(ri->LodErrors.data(), static_cast<std::uint32_t>(ri->LodErrors.size()),
+                                                  distance, projectionScale, pixelThreshold);
+
+        // 绘制参数只在 CPU 端录制命令时读取，不需要像常量缓冲区那样按帧资源区分
+        const SubmeshGeometry &submesh = ri->Lods[ri->CurrentLod];
+        ri->IndexCount = submesh.IndexCount;
+        ri->StartIndexLocation = submesh.StartIndexLocation;
+        ri->BaseVertexLocation = submesh.BaseVertexLocation;
+    }
+}
+
 void ShapesApp::BuildRenderItems()
 {
     auto boxRitem = std::make_unique<RenderItem>();
@@ -836,6 +806,7 @@ void ShapesApp::BuildRenderItems()
         leftCylRitem->IndexCount = leftCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
         leftCylRitem->StartIndexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
         leftCylRitem->BaseVertexLocation = leftCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
+        SetRenderItemLods(leftCylRitem.get(), "cylinder");
 
         XMStoreFloat4x4(&rightCylRitem->World, leftCylWorld);
         rightCylRitem->ObjCBIndex = objCBIndex++;
@@ -844,6 +815,7 @@ void ShapesApp::BuildRenderItems()
         rightCylRitem->IndexCount = rightCylRitem->Geo->DrawArgs["cylinder"].IndexCount;
         rightCylRitem->StartIndexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].StartIndexLocation;
         rightCylRitem->BaseVertexLocation = rightCylRitem->Geo->DrawArgs["cylinder"].BaseVertexLocation;
+        SetRenderItemLods(rightCylRitem.get(), "cylinder");
 
         XMStoreFloat4x4(&leftSphereRitem->World, leftSphereWorld);
         leftSphereRitem->ObjCBIndex = objCBIndex++;
@@ -852,6 +824,7 @@ void ShapesApp::BuildRenderItems()
         leftSphereRitem->IndexCount = leftSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
         leftSphereRitem->StartIndexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
         leftSphereRitem->BaseVertexLocation = leftSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
+        SetRenderItemLods(leftSphereRitem.get(), "sphere");
 
         XMStoreFloat4x4(&rightSphereRitem->World, rightSphereWorld);
         rightSphereRitem->ObjCBIndex = objCBIndex++;
@@ -860,6 +833,7 @@ void ShapesApp::BuildRenderItems()
         rightSphereRitem->IndexCount = rightSphereRitem->Geo->DrawArgs["sphere"].IndexCount;
         rightSphereRitem->StartIndexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].StartIndexLocation;
         rightSphereRitem->BaseVertexLocation = rightSphereRitem->Geo->DrawArgs["sphere"].BaseVertexLocation;
+        SetRenderItemLods(rightSphereRitem.get(), "sphere");
 
         mAllRitems.push_back(std::move(leftCylRitem));
         mAllRitems.push_back(std::move(rightCylRitem));
@@ -870,6 +844,17 @@ void ShapesApp::BuildRenderItems()
     for (auto &e : mAllRitems)
         mOpaqueRitems.push_back(e.get());
 }
+
+void ShapesApp::SetRenderItemLods(RenderItem *ri, const std::string &drawArg)
+{
+    const auto &errors = mLodErrors[drawArg];
+    ri->LodErrors = errors;
+    ri->Lods.resize(errors.size());
+    ri->Lods[0] = ri->Geo->DrawArgs[drawArg];
+    for (size_t level = 1; level < errors.size(); ++level)
+        ri->Lods[level] = ri->Geo->DrawArgs[drawArg + "_lod" + std::to_string(level)];
+}
+
 void ShapesApp::DrawRenderItems(ID3D12GraphicsCommandList *cmdList, const std::vector<RenderItem *> &ritems)
 {
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
@@ -886,9 +871,8 @@ void ShapesApp::DrawRenderItems(ID3D12GraphicsCommandList *cmdList, const std::v
         cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
 
         // 为了绘制当前的帧资源和当前物体，偏移到描述符堆中对应的 CBV 处
-        UINT cbvIndex = mCurrFrameResourceIndex * (UINT)mOpaqueRitems.size() + ri->ObjCBIndex;
-        auto cbvHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(mCbvHeap->GetGPUDescriptorHandleForHeapStart());
-        cbvHandle.Offset(cbvIndex, mCbvSrvUavDescriptorSize);
+        UINT cbvIndex = mObjectCbvIndex + mCurrFrameResourceIndex * (UINT)mOpaqueRitems.size() + ri->ObjCBIndex;
+        auto cbvHandle = mCbvHeap->GpuHandle(cbvIndex);
 
         // 令描述符表与渲染流水线相绑定
         cmdList->SetGraphicsRootDescriptorTable(0, cbvHandle);
@@ -919,6 +903,8 @@ void ShapesApp::UpdateCamera(const GameTimer &gt)
     float z = mRadius * sinf(mPhi) * sinf(mTheta);
     float y = mRadius * cosf(mPhi);
     // 构建观察矩阵
+    mEyePos = XMFLOAT3(x, y, z);
+
     XMVECTOR pos = XMVectorSet(x, y, z, 1.0f);
     XMVECTOR target = XMVectorZero();
     XMVECTOR up = XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f);
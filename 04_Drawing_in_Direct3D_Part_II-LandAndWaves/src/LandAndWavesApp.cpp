@@ -1,6 +1,10 @@
 #include "D3DApp.h"
 #include "FrameResource.h"
 #include "GeometryGenerator.h"
+#include "HeightField.h"
+#include "IndexBufferBuilder.h"
+#include "ThreadPool.h"
+#include "UploadBatch.h"
 #include "Waves.h"
 
 using namespace DirectX;
@@ -92,6 +96,9 @@ class LandAndWavesApp : public D3DApp
 
     ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
 
+    // 初始化阶段所有默认缓冲区的上传都经由它合并为一批
+    std::unique_ptr<UploadBatch> mUploadBatch;
+
     std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
     std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
     std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
@@ -110,6 +117,9 @@ class LandAndWavesApp : public D3DApp
 
     std::unique_ptr<Waves> mWaves;
 
+    // 陆地的高度函数
+    HillsHeightField mHillsHeightField;
+
     PassConstants mMainPassCB;
 
     bool mIsWireframe = false;
@@ -168,6 +178,8 @@ bool LandAndWavesApp::Initialize()
     // 重置命令列表为执行初始化命令做好准备工作
     ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
+    mUploadBatch = std::make_unique<UploadBatch>(md3dDevice.Get());
+
     mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
 
     BuildRootSignature();
@@ -178,14 +190,17 @@ bool LandAndWavesApp::Initialize()
     BuildFrameResources();
     BuildPSOs();
 
+    // 一次性记录全部上传命令
+    mUploadBatch->Record(mCommandList.Get());
+
     // 执行初始化命令
     ThrowIfFailed(mCommandList->Close());
     // 将待执行的命令列表加入命令队列
     ID3D12CommandList *cmdsLists[] = {mCommandList.Get()};
     mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
-    // 等待初始化完成
-    FlushCommandQueue();
+    // 不必等待初始化完成：暂存空间会在 GPU 执行到这个围栏点之后，由 Update 中的 ReleaseCompleted 回收
+    mUploadBatch->Submit(SignalFence());
     return true;
 }
 
@@ -218,6 +233,8 @@ void LandAndWavesApp::Update(const GameTimer &gt)
         CloseHandle(eventHandle);
     }
 
+    mUploadBatch->ReleaseCompleted(mFence->GetCompletedValue());
+
     UpdateObjectCBs(gt);
     UpdateMainPassCB(gt);
     UpdateWaves(gt);
@@ -462,11 +479,13 @@ void LandAndWavesApp::BuildShadersAndInputLayout()
 
 void LandAndWavesApp::BuildLandGeometry()
 {
+    // 栅格按行并行生成，生成时即已利用高度函数计算出每个顶点的高度值
     GeometryGenerator geoGen;
-    GeometryGenerator::MeshData grid = geoGen.CreateGrid(160.0f, 160.0f, 50, 50);
+    GeometryGenerator::MeshData grid =
+        geoGen.CreateGrid(160.0f, 160.0f, 50, 50, &mHillsHeightField, &ThreadPool::Default());
 
     //
-    // 获取我们所需要的顶点元素，并利用高度函数计算每个顶点的高度值
+    // 获取我们所需要的顶点元素
     // 另外，顶点的颜色要基于它们的高度而定
     // 所以，图像中才会有看起来如沙质的沙滩、山腰处的植被以及山峰处的积雪
     //
@@ -476,7 +495,6 @@ void LandAndWavesApp::BuildLandGeometry()
     {
         auto &p = grid.Vertices[i].Position;
         vertices[i].Pos = p;
-        vertices[i].Pos.y = GetHillsHeight(p.x, p.z);
 
         // 基于顶点高度为它上色
         if (vertices[i].Pos.y < -10.0f)
@@ -508,33 +526,29 @@ void LandAndWavesApp::BuildLandGeometry()
 
     const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 
-    std::vector<std::uint16_t> indices = grid.GetIndices16();
-    const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+    // 由 IndexBufferBuilder 决定索引宽度：栅格的顶点数超过 65536 时改用 32 位索引，而不是截断为 16 位
+    IndexBufferBuilder indexBuilder(false);
+    indexBuilder.AddSubmesh(grid.Indices32);
+    indexBuilder.Build();
+    const UINT ibByteSize = (UINT)indexBuilder.DataByteSize();
 
     auto geo = std::make_unique<MeshGeometry>();
     geo->Name = "landGeo";
 
-    ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-    CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-    ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-    CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
-
-    geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), vertices.data(),
-                                                        vbByteSize, geo->VertexBufferUploader);
+    geo->VertexBufferGPU = mUploadBatch->CreateDefaultBuffer(vertices.data(), vbByteSize);
 
-    geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), indices.data(), ibByteSize,
-                                                       geo->IndexBufferUploader);
+    geo->IndexBufferGPU = mUploadBatch->CreateDefaultBuffer(indexBuilder.Data(), ibByteSize);
 
     geo->VertexByteStride = sizeof(Vertex);
     geo->VertexBufferByteSize = vbByteSize;
-    geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+    geo->IndexFormat = indexBuilder.IndexByteSize() == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
     geo->IndexBufferByteSize = ibByteSize;
 
+    const IndexBufferBuilder::Range &range = indexBuilder.Ranges()[0];
     SubmeshGeometry submesh;
-    submesh.IndexCount = (UINT)indices.size();
-    submesh.StartIndexLocation = 0;
-    submesh.BaseVertexLocation = 0;
+    submesh.IndexCount = range.IndexCount;
+    submesh.StartIndexLocation = range.StartIndexLocation;
+    submesh.BaseVertexLocation = range.BaseVertexLocation;
 
     geo->DrawArgs["grid"] = submesh;
 
@@ -576,11 +590,7 @@ void LandAndWavesApp::BuildWavesGeometryBuffers()
     geo->VertexBufferCPU = nullptr;
     geo->VertexBufferGPU = nullptr;
 
-    ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-    CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
-
-    geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), indices.data(), ibByteSize,
-                                                       geo->IndexBufferUploader);
+    geo->IndexBufferGPU = mUploadBatch->CreateDefaultBuffer(indices.data(), ibByteSize);
 
     geo->VertexByteStride = sizeof(Vertex);
     geo->VertexBufferByteSize = vbByteSize;
@@ -816,19 +826,12 @@ void LandAndWavesApp::UpdateCamera(const GameTimer &gt)
 
 float LandAndWavesApp::GetHillsHeight(float x, float z) const
 {
-    return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
+    return mHillsHeightField.Height(x, z);
 }
 
 XMFLOAT3 LandAndWavesApp::GetHillsNormal(float x, float z) const
 {
-    // n = (-df/dx, 1, -df/dz)
-    XMFLOAT3 n(-0.03f * z * cosf(0.1f * x) - 0.3f * cosf(0.1f * z), 1.0f,
-               -0.3f * sinf(0.1f * x) + 0.03f * x * sinf(0.1f * z));
-
-    XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
-    XMStoreFloat3(&n, unitNormal);
-
-    return n;
+    return mHillsHeightField.Normal(x, z);
 }
 
 // 模拟波浪并更新顶点缓冲区
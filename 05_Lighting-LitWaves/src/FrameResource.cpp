@@ -1,13 +1,12 @@
 #include "FrameResource.h"
 
-FrameResource::FrameResource(ID3D12Device *device, UINT passCount, UINT objectCount, UINT waveVertCount)
+FrameResource::FrameResource(ID3D12Device *device, GpuHeapAllocator *allocator, UINT passCount, UINT objectCount,
+                             UINT waveVertCount)
 {
-    ThrowIfFailed(
-        device->CreateCommandAllocator(D3D12_COMMAND_LIST_TYPE_DIRECT, IID_PPV_ARGS(CmdListAlloc.GetAddressOf())));
-    PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true);
-    ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true);
+    PassCB = std::make_unique<UploadBuffer<PassConstants>>(device, passCount, true, allocator);
+    ObjectCB = std::make_unique<UploadBuffer<ObjectConstants>>(device, objectCount, true, allocator);
 
-    WavesVB = std::make_unique<UploadBuffer<Vertex>>(device, waveVertCount, false);
+    WavesVB = std::make_unique<UploadBuffer<Vertex>>(device, waveVertCount, false, allocator);
 }
 
 FrameResource::~FrameResource() = default;
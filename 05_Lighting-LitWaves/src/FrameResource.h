@@ -53,14 +53,14 @@ struct MaterialConstants
 struct FrameResource
 {
   public:
-    FrameResource(ID3D12Device *device, UINT passCount, UINT objectCount, UINT waveVertCount);
+    // 各个上传缓冲区从 allocator 管理的上传堆中分配
+    FrameResource(ID3D12Device *device, GpuHeapAllocator *allocator, UINT passCount, UINT objectCount,
+                  UINT waveVertCount);
     FrameResource(const FrameResource &rhs) = delete;
     FrameResource &operator=(const FrameResource &rhs) = delete;
     ~FrameResource();
 
-    // 在 GPU 处理完与此命令分配器相关的命令之前，我们不能对它进行重置。
-    // 所以每一帧都要有它们自己的命令分配器
-    ComPtr<ID3D12CommandAllocator> CmdListAlloc;
+    // 命令分配器由 D3DApp::mCommandListPool 按围栏值统一回收，不再属于某个帧资源
 
     // 在 GPU 执行完引用此常量缓冲区的命令之前，我们不能对它进行更新。
     // 因此每一帧都要有它们自己的常量缓冲区
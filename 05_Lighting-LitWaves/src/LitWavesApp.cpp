@@ -1,7 +1,18 @@
+#include "CommandStream.h"
+#include "D3D12CommandReplay.h"
 #include "D3DApp.h"
 #include "FrameResource.h"
 #include "GeometryGenerator.h"
+#include "HeightField.h"
+#include "IndexBufferBuilder.h"
+#include "ParallelRecorder.h"
+#include "RenderGraph.h"
+#include "ThreadPool.h"
+#include "UploadBatch.h"
 #include "Waves.h"
+#include <cstdio>
+#include <exception>
+#include <filesystem>
 
 using namespace DirectX;
 using namespace DirectX::PackedVector;
@@ -13,6 +24,11 @@ using namespace DirectX::PackedVector;
 // 3 个帧资源元素
 const int gNumFrameResources = 3;
 
+// 每个命令列表至少记录的绘制项数量。绘制项较少时，多一个命令列表的开销比并行记录节省的时间更多，
+// 实际的场景中应取几百（可以用 Tests/ParallelRecorderTest 在目标机器上测量）。
+// 本例只有波浪与地形两个绘制项，取 1 让它们分别记录到两个命令列表中，以演示多个命令列表的记录与按顺序提交
+const size_t gMinDrawsPerCommandList = 1;
+
 // 存储绘制图形所需参数的轻量级结构体。它会随着不同的应用程序而有所差别
 struct RenderItem
 {
@@ -61,6 +77,7 @@ class LitWavesApp : public D3DApp
 
   private:
     void OnResize() override;
+    void PrepareUpdate(const GameTimer &gt) override;
     void Update(const GameTimer &gt) override;
     void Draw(const GameTimer &gt) override;
 
@@ -83,24 +100,48 @@ class LitWavesApp : public D3DApp
     void BuildFrameResources();
     void BuildMaterials();
     void BuildRenderItems();
-    void DrawRenderItems(ID3D12GraphicsCommandList *cmdList, const std::vector<RenderItem *> &ritems);
+    void BuildFrameGraph();
+    // 把 ritems 中 [begin, end) 范围内的渲染项编码到 stream 中，可以在多个线程中同时调用（各自使用不同的 stream）
+    void DrawRenderItems(CommandStream &stream, const std::vector<RenderItem *> &ritems, size_t begin, size_t end);
 
     float GetHillsHeight(float x, float z) const;
     XMFLOAT3 GetHillsNormal(float x, float z) const;
 
   private:
-    // 实例化一个由 3 个帧资源元素所构成的向量，并留有特定的成员变量来记录当前的帧资源
+    // 实例化一个由 3 个帧资源元素所构成的向量，并留有特定的成员变量来记录当前的帧资源。
+    // 帧资源环同时也是帧流水线的槽位：模拟线程在 Update 中写入下一帧的帧资源时，主线程在 Draw 中记录本帧
     std::vector<std::unique_ptr<FrameResource>> mFrameResources;
-    FrameResource *mCurrFrameResource = nullptr;
-    int mCurrFrameResourceIndex = 0;
+    // Update 正在写入的帧资源，只由 Update 及其调用的函数访问
+    FrameResource *mSimFrameResource = nullptr;
+    // Draw 正在记录的帧资源，只由 Draw 及其调用的函数访问
+    FrameResource *mRenderFrameResource = nullptr;
 
     ComPtr<ID3D12RootSignature> mRootSignature = nullptr;
+    // 根签名序列化数据的哈希值，参与 PSO 缓存键的计算
+    UINT64 mRootSignatureHash = 0;
+
+    // 初始化阶段所有默认缓冲区的上传都经由它合并为一批
+    std::unique_ptr<UploadBatch> mUploadBatch;
+
+    // 每个命令列表对应一个命令流，跨帧复用以免每帧重新分配内存
+    std::vector<CommandStream> mCommandStreams;
+
+    // 帧图负责推导后台缓冲区与深度缓冲区的状态转换。结构固定，只在初始化时编译一次
+    RenderGraph mFrameGraph;
+    RenderGraph::ResourceHandle mBackBufferHandle;
+    RenderGraph::ResourceHandle mDepthStencilHandle;
+    RenderGraph::PassHandle mOpaquePass;
 
     std::unordered_map<std::string, std::unique_ptr<MeshGeometry>> mGeometries;
     std::unordered_map<std::string, std::unique_ptr<Material>> mMaterials;
 //    std::unordered_map<std::string, std::unique_ptr<Texture>> mTextures;
     std::unordered_map<std::string, ComPtr<ID3DBlob>> mShaders;
     std::unordered_map<std::string, ComPtr<ID3D12PipelineState>> mPSOs;
+    // 线框模式的 PSO 在后台创建，每帧按键从 PSO 缓存中查找
+    UINT64 mOpaqueWireframePsoKey = 0;
+    // 着色器在 mShaderReload 中的序号，修改 color.hlsl 后用它们重新创建 PSO
+    ShaderHotReload::uint32 mStandardVSId = 0;
+    ShaderHotReload::uint32 mOpaquePSId = 0;
 
     std::vector<D3D12_INPUT_ELEMENT_DESC> mInputLayout;
 
@@ -116,6 +157,9 @@ class LitWavesApp : public D3DApp
 
     std::unique_ptr<Waves> mWaves;
 
+    // 陆地的高度函数
+    HillsHeightField mHillsHeightField;
+
     PassConstants mMainPassCB;
 
     bool mIsWireframe = false;
@@ -141,19 +185,52 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE prevInstance, PSTR cmdLine, in
     _CrtSetDbgFlag(_CRTDBG_ALLOC_MEM_DF | _CRTDBG_LEAK_CHECK_DF);
 #endif
 
+    // 以 --headless 启动时不创建窗口，按固定或录制的时间差运行指定的帧数并记录每帧的 CPU 耗时，
+    // 例如：05_Lighting-LitWaves --headless --frames 2000 --warmup 60 --timings timings.csv
+    HeadlessFrameLoop::Options headless;
+    std::string error;
+
+    // 无人值守的运行不能停在对话框上，也可能没有调试器：信息同时输出到标准错误，供测试机的日志收集
+    auto report = [](const std::string &text) {
+        OutputDebugStringA((text + "\n").c_str());
+        std::fprintf(stderr, "%s\n", text.c_str());
+    };
+
+    if (!HeadlessFrameLoop::ParseArguments(D3DApp::CommandLineArguments(), headless, error))
+    {
+        // 参数只会在命令行中给出，不弹出对话框
+        report(error);
+        return 1;
+    }
+
     try
     {
         LitWavesApp theApp(hInstance);
+        theApp.SetHeadless(headless.Enabled);
         if (!theApp.Initialize())
             return 0;
 
-        return theApp.Run();
+        return headless.Enabled ? theApp.RunHeadless(headless) : theApp.Run();
     }
     catch (DxException &e)
     {
+        if (headless.Enabled)
+        {
+            const auto text = std::filesystem::path(e.ToString()).u8string();
+            report(std::string(text.begin(), text.end()));
+            return 1;
+        }
         MessageBox(nullptr, e.ToString().c_str(), L"HR Failed", MB_OK);
         return 0;
     }
+    catch (const std::exception &e)
+    {
+        // 窗口模式下保持原来的行为
+        if (!headless.Enabled)
+            throw;
+        report(std::string("unhandled exception: ") + e.what());
+        return 1;
+    }
 }
 
 LitWavesApp::LitWavesApp(HINSTANCE hInstance) : D3DApp(hInstance)
@@ -162,6 +239,14 @@ LitWavesApp::LitWavesApp(HINSTANCE hInstance) : D3DApp(hInstance)
 
 LitWavesApp::~LitWavesApp()
 {
+    // 模拟线程上的 Update 会访问本类的成员
+    if (mFramePipeline != nullptr)
+        mFramePipeline->WaitIdle();
+
+    // 后台重新创建 PSO 的任务会访问本类的成员
+    if (mShaderReload != nullptr)
+        mShaderReload->WaitIdle();
+
     if (md3dDevice != nullptr)
         FlushCommandQueue();
 }
@@ -174,6 +259,8 @@ bool LitWavesApp::Initialize()
     // 重置命令列表为执行初始化命令做好准备工作
     ThrowIfFailed(mCommandList->Reset(mDirectCmdListAlloc.Get(), nullptr));
 
+    mUploadBatch = std::make_unique<UploadBatch>(md3dDevice.Get());
+
     mWaves = std::make_unique<Waves>(128, 128, 1.0f, 0.03f, 4.0f, 0.2f);
 
     BuildRootSignature();
@@ -183,6 +270,13 @@ bool LitWavesApp::Initialize()
     BuildRenderItems();
     BuildFrameResources();
     BuildPSOs();
+    BuildFrameGraph();
+
+    // 波浪的模拟与常量缓冲区的更新在模拟线程上进行，与上一帧的命令记录重叠
+    EnableFramePipeline(gNumFrameResources);
+
+    // 一次性记录全部上传命令
+    mUploadBatch->Record(mCommandList.Get());
 
     // 执行初始化命令
     ThrowIfFailed(mCommandList->Close());
@@ -190,8 +284,8 @@ bool LitWavesApp::Initialize()
     ID3D12CommandList *cmdsLists[] = {mCommandList.Get()};
     mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
-    // 等待初始化完成
-    FlushCommandQueue();
+    // 不必等待初始化完成：暂存空间会在 GPU 执行到这个围栏点之后，由 Update 中的 ReleaseCompleted 回收
+    mUploadBatch->Submit(SignalFence());
     return true;
 }
 
@@ -204,26 +298,33 @@ void LitWavesApp::OnResize()
     XMStoreFloat4x4(&mProj, P);
 }
 
-void LitWavesApp::Update(const GameTimer &gt)
+void LitWavesApp::PrepareUpdate(const GameTimer &gt)
 {
-    OnKeyboardInput(gt);
+    // 输入与摄像机在主线程上处理：鼠标消息会修改摄像机参数，而这时模拟线程可能正在运行。
+    // 无窗口运行时忽略键盘，保证每次运行的帧序列相同
+    if (!IsHeadless())
+        OnKeyboardInput(gt);
     UpdateCamera(gt);
+}
 
-    // Cycle through the circular frame resource array.
-    mCurrFrameResourceIndex = (mCurrFrameResourceIndex + 1) % gNumFrameResources;
-    mCurrFrameResource = mFrameResources[mCurrFrameResourceIndex].get();
+void LitWavesApp::Update(const GameTimer &gt)
+{
+    // 帧流水线把环中的下一个帧资源交给了本次 Update
+    mSimFrameResource = mFrameResources[mSimulationSlot].get();
 
     // Has the GPU finished processing the commands of the current frame resource?
     // If not, wait until the GPU has completed commands up to this fence point.
     // 在 CPU 端等待 GPU，直到后者执行完这个围栏点之前的所有命令
-    if (mCurrFrameResource->Fence != 0 && mFence->GetCompletedValue() < mCurrFrameResource->Fence)
+    if (mSimFrameResource->Fence != 0 && mFence->GetCompletedValue() < mSimFrameResource->Fence)
     {
         HANDLE eventHandle = CreateEventEx(nullptr, nullptr, false, EVENT_ALL_ACCESS);
-        ThrowIfFailed(mFence->SetEventOnCompletion(mCurrFrameResource->Fence, eventHandle));
+        ThrowIfFailed(mFence->SetEventOnCompletion(mSimFrameResource->Fence, eventHandle));
         WaitForSingleObject(eventHandle, INFINITE);
         CloseHandle(eventHandle);
     }
 
+    mUploadBatch->ReleaseCompleted(mFence->GetCompletedValue());
+
     UpdateObjectCBs(gt);
     UpdateMainPassCB(gt);
     UpdateWaves(gt);
@@ -231,114 +332,120 @@ void LitWavesApp::Update(const GameTimer &gt)
 
 void LitWavesApp::Draw(const GameTimer &gt)
 {
-    auto cmdListAlloc = mCurrFrameResource->CmdListAlloc;
-    // 重复使用记录命令的相关内存
-    // 只有当与 GPU 关联的命令列表执行完成时，我们才能将其重置
-    ThrowIfFailed(cmdListAlloc->Reset());
-
-    // 在通过 ExecuteCommandList 方法将某个命令列表加入命令队列后，我们便可以重置该命令列表。以
-    // 此来复用命令列表及其内存
-    // 重置命令列表并指定初始 PSO
-    if (mIsWireframe)
-    {
-        ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque_wireframe"].Get()));
-    }
-    else
-    {
-        ThrowIfFailed(mCommandList->Reset(cmdListAlloc.Get(), mPSOs["opaque"].Get()));
-    }
+    // 本帧的帧资源已经由模拟线程准备好，所有权交给了 Draw
+    mRenderFrameResource = mFrameResources[mRenderSlot].get();
+
+    // 将波浪渲染项的动态顶点缓冲区设置到本帧的顶点缓冲区。
+    // 渲染项由模拟与渲染共享，所以这一步不在 UpdateWaves 中进行
+    mWavesRitem->Geo->VertexBufferGPU = mRenderFrameResource->WavesVB->Resource();
+
+    // 命令分配器与命令列表从命令列表池中取出。只有当与 GPU 关联的命令列表执行完成时，我们才能重置命令分配器，
+    // 池会替我们检查这一点并完成重置，同时以初始 PSO 重置命令列表
+    // 线框 PSO 尚未创建完成时暂用不透明 PSO
+    auto pso = mIsWireframe ? mPipelineCache->FindGraphicsPipeline(mOpaqueWireframePsoKey, mPSOs["opaque"].Get())
+                            : mPSOs["opaque"].Get();
+    const UINT64 completedFence = mFence->GetCompletedValue();
+
+    // 不透明物体的绘制项按顺序拆分到多个命令列表中，由线程池中的各个线程并行记录
+    const std::vector<RenderItem *> &opaqueRitems = mRitemLayer[(int)RenderLayer::Opaque];
+    ThreadPool &threadPool = ThreadPool::Default();
+    std::vector<RecordRange> ranges =
+        ParallelRecorder::Partition(opaqueRitems.size(), threadPool.ThreadCount() + 1, gMinDrawsPerCommandList);
+    std::vector<CommandListPool::CommandList *> commandLists(ranges.size());
+    if (mCommandStreams.size() < ranges.size())
+        mCommandStreams.resize(ranges.size());
+
+    // 后台缓冲区与深度缓冲区每帧（或每次调整窗口大小后）都可能不同
+    mFrameGraph.SetPhysicalResource(mBackBufferHandle, CurrentBackBuffer());
+    mFrameGraph.SetPhysicalResource(mDepthStencilHandle, mDepthStencilBuffer.Get());
+
+    ParallelRecorder::Record(threadPool, ranges, [&](size_t listIndex, const RecordRange &range) {
+        // 先把命令编码到与图形 API 无关的命令流中，再回放到命令列表。命令流只在首次使用时分配内存，之后每帧复用
+        CommandStream &stream = mCommandStreams[listIndex];
+        stream.Reset();
+
+        // 设置视口和裁剪矩形。它们需要随着命令列表的重置而重置，并且不会在命令列表之间继承，
+        // 所以每个命令列表都要重新设置这些状态
+        stream.SetViewport(mScreenViewport.TopLeftX, mScreenViewport.TopLeftY, mScreenViewport.Width,
+                           mScreenViewport.Height, mScreenViewport.MinDepth, mScreenViewport.MaxDepth);
+        stream.SetScissorRect(mScissorRect.left, mScissorRect.top, mScissorRect.right, mScissorRect.bottom);
+
+        const std::uint64_t currentBackBufferView = ToCommandHandle(CurrentBackBufferView());
+        const std::uint64_t depthStencilView = ToCommandHandle(DepthStencilView());
+
+        // 只有第一个命令列表负责转换后台缓冲区的状态并清除它
+        if (listIndex == 0)
+        {
+            // 由帧图写入 Opaque 之前的状态转换：将后台缓冲区从呈现状态转换为渲染目标状态
+            mFrameGraph.RecordPassBarriers(stream, mOpaquePass);
 
-    // 设置视口和裁剪矩形。它们需要随着命令列表的重置而重置
-    mCommandList->RSSetViewports(1, &mScreenViewport);
-    mCommandList->RSSetScissorRects(1, &mScissorRect);
-
-    // 对资源的状态进行转换，将资源从呈现状态转换为渲染目标状态
-    auto resourceBarrier = CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_PRESENT,
-                                                                D3D12_RESOURCE_STATE_RENDER_TARGET);
-    mCommandList->ResourceBarrier(1, &resourceBarrier);
-
-    // 清除后台缓冲区和深度缓冲区
-    mCommandList->ClearRenderTargetView(
-        // 待清除的资源 RTV
-        CurrentBackBufferView(),
-        // 定义即将为渲染目标填充的颜色
-        Colors::LightSteelBlue,
-        // pRects 数组中的元素数量。此值可以为 0。
-        0,
-        // 一个 D3D12_RECT 类型的数组，指定了渲染目标将要被清除的多个矩形区域。
-        // 若设定此参数为 nullptr，则表示清除整个渲染目标。
-        nullptr);
-    mCommandList->ClearDepthStencilView(
-        // 待清除的深度/模板缓冲区 DSV
-        DepthStencilView(),
-        // 该标志用于指定即将清除的是深度缓冲区还是模板缓冲区。我们可以将此参数设置为 D3D12_CLEAR_FLAG_DEPTH
-        // 或 D3D12_CLEAR_FLAG_STENCIL，也可以用按位或运算符连接两者，表示同时清除这两种缓冲区。
-        D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL,
-        // 以此值来清除深度缓冲区
-        1.0f,
-        // 以此值来清除模板缓冲区
-        0,
-        // pRects 数组内的元素数量。可以将此值设置为 0。
-        0,
-        // 一个 D3D12_RECT 类型的数组，用以指定资源视图将要被清除的多个矩形区域。
-        // 将此值设置为 nullptr，则表示清除整个渲染目标。
-        nullptr);
-
-    auto currentBackBufferView = CurrentBackBufferView();
-    auto depthStencilView = DepthStencilView();
-
-    // 设置我们希望在渲染流水线上使用的渲染目标和深度/模板缓冲区
-    mCommandList->OMSetRenderTargets(
-        // 待绑定的 RTV 数量，即 pRenderTargetDescriptors 数组中的元素个数。
-        // 在使用多渲染目标这种高级技术时会涉及此参数。就目前来说，我们总是使用一个 RTV。
-        1,
-        // 指向 RTV 数组的指针，用于指定我们希望绑定到渲染流水线上的渲染目标。
-        &currentBackBufferView,
-        // 如果 pRenderTargetDescriptors 数组中的所有 RTV 对象在描述符堆中都是连续存放的，
-        // 就将此值设为 true，否则设为 false。
-        true,
-        // 指向一个 DSV 的指针，用于指定我们希望绑定到渲染流水线上的深度/模板缓冲区。
-        &depthStencilView);
-
-    // 现在根签名不用描述符堆了，改用根常量，直接绑定 CBV 了。
-    //    ID3D12DescriptorHeap *descriptorHeaps[] = {mCbvHeap.Get()};
-    //    mCommandList->SetDescriptorHeaps(_countof(descriptorHeaps), descriptorHeaps);
-    //    int passCbvIndex = mPassCbvOffset + mCurrFrameResourceIndex;
-    //    auto passCbvHandle = CD3DX12_GPU_DESCRIPTOR_HANDLE(mCbvHeap->GetGPUDescriptorHandleForHeapStart());
-    //    passCbvHandle.Offset(passCbvIndex, mCbvSrvUavDescriptorSize);
-    //
-    //    // 令描述符表与渲染流水线相绑定。
-    //    mCommandList->SetGraphicsRootDescriptorTable(1, passCbvHandle);
-    mCommandList->SetGraphicsRootSignature(mRootSignature.Get());
+            // 清除后台缓冲区和深度缓冲区（清除整个渲染目标，深度清除为 1.0，模板清除为 0）
+            stream.ClearRenderTargetView(currentBackBufferView, Colors::LightSteelBlue);
+            stream.ClearDepthStencilView(depthStencilView, D3D12_CLEAR_FLAG_DEPTH | D3D12_CLEAR_FLAG_STENCIL, 1.0f, 0);
+        }
 
-    // 绑定渲染过程中所用的常量缓冲区。在每个渲染过程中，这段代码只需执行一次
-    auto passCB = mCurrFrameResource->PassCB->Resource();
-    mCommandList->SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
+        // 设置我们希望在渲染流水线上使用的渲染目标和深度/模板缓冲区
+        stream.SetRenderTarget(currentBackBufferView, depthStencilView);
 
-    DrawRenderItems(mCommandList.Get(), mRitemLayer[(int)RenderLayer::Opaque]);
+        // 现在根签名不用描述符堆了，改用根常量，直接绑定 CBV 了。
+        stream.SetGraphicsRootSignature(mRootSignature.Get());
 
-    // 按照资源的用途指示其状态的转变，将资源从渲染目标状态转换回呈现状态
-    resourceBarrier = CD3DX12_RESOURCE_BARRIER::Transition(CurrentBackBuffer(), D3D12_RESOURCE_STATE_RENDER_TARGET,
-                                                           D3D12_RESOURCE_STATE_PRESENT);
-    mCommandList->ResourceBarrier(1, &resourceBarrier);
+        // 绑定渲染过程中所用的常量缓冲区。每个命令列表都要绑定一次
+        auto passCB = mRenderFrameResource->PassCB->Resource();
+        stream.SetGraphicsRootConstantBufferView(1, passCB->GetGPUVirtualAddress());
 
-    // 完成命令的记录
-    ThrowIfFailed(mCommandList->Close());
+        DrawRenderItems(stream, opaqueRitems, range.Begin, range.End);
 
-    // 将待执行的命令列表加入命令队列
-    ID3D12CommandList *cmdsLists[] = {mCommandList.Get()};
-    mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
+        // 由最后一个命令列表写入帧图的最终转换，把后台缓冲区从渲染目标状态转换回呈现状态
+        if (listIndex == ranges.size() - 1)
+            mFrameGraph.RecordFinalBarriers(stream);
+
+        // 无窗口运行时命令流在所有线程记录完之后按顺序交给 NullCommandBackend，不回放到命令列表
+        if (IsHeadless())
+            return;
+
+        CommandListPool::CommandList *commandList = mCommandListPool->Acquire(completedFence, pso);
+        commandLists[listIndex] = commandList;
+        ID3D12GraphicsCommandList *cmdList = commandList->List.Get();
+
+        ReplayCommandStream(stream, cmdList);
+
+        // 完成命令的记录
+        ThrowIfFailed(cmdList->Close());
+    });
+
+    if (IsHeadless())
+    {
+        for (size_t i = 0; i < ranges.size(); ++i)
+            mNullBackend->Execute(mCommandStreams[i]);
+        mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
+
+        // 队列中没有新的命令，围栏点仍然用来回收帧资源与延迟释放的对象
+        mRenderFrameResource->Fence = SignalFence();
+        return;
+    }
+
+    // 按绘制顺序把所有命令列表一次性加入命令队列
+    std::vector<ID3D12CommandList *> cmdsLists;
+    cmdsLists.reserve(commandLists.size());
+    for (auto *commandList : commandLists)
+        cmdsLists.push_back(commandList->List.Get());
+    mCommandQueue->ExecuteCommandLists((UINT)cmdsLists.size(), cmdsLists.data());
 
     // 交换后台缓冲区和前台缓冲区
     ThrowIfFailed(mSwapChain->Present(0, 0));
     mCurrBackBuffer = (mCurrBackBuffer + 1) % SwapChainBufferCount;
 
     // 增加围栏值，将之前的命令标记到此围栏点上
-    mCurrFrameResource->Fence = ++mCurrentFence;
+    mRenderFrameResource->Fence = ++mCurrentFence;
 
     // 向命令队列添加一条指令，以设置新的围栏点 GPU 还在执行我们此前向命令队列中传入的命令，
     // 所以，GPU 不会立即设置新的围栏点，这要等到它处理完 Signal() 函数之前的所有命令
     mCommandQueue->Signal(mFence.Get(), mCurrentFence);
+
+    // GPU 执行到这个围栏点之后，这些命令分配器与命令列表才可以再次使用
+    for (auto *commandList : commandLists)
+        mCommandListPool->Retire(commandList, mCurrentFence);
 }
 
 void LitWavesApp::OnMouseDown(WPARAM btnState, int x, int y)
@@ -446,6 +553,7 @@ void LitWavesApp::BuildRootSignature()
     }
     ThrowIfFailed(hr);
 
+    mRootSignatureHash = PipelineStateCache::HashRootSignature(serializedRootSig.Get());
     ThrowIfFailed(md3dDevice->CreateRootSignature(0, serializedRootSig->GetBufferPointer(),
                                                   serializedRootSig->GetBufferSize(), IID_PPV_ARGS(&mRootSignature)));
 }
@@ -455,8 +563,18 @@ void LitWavesApp::BuildShadersAndInputLayout()
     HRESULT hr = S_OK;
 
     // 运行时编译 Shader
-    mShaders["standardVS"] = d3dUtil::CompileShader(L"Shaders\\color.hlsl", nullptr, "VS", "vs_5_1");
-    mShaders["opaquePS"] = d3dUtil::CompileShader(L"Shaders\\color.hlsl", nullptr, "PS", "ps_5_1");
+    // 两个着色器互不相关，缓存未命中时并行编译
+    const std::vector<ShaderCompileRequest> requests = {
+        d3dUtil::MakeShaderRequest(L"Shaders\\color.hlsl", nullptr, "VS", "vs_5_1"),
+        d3dUtil::MakeShaderRequest(L"Shaders\\color.hlsl", nullptr, "PS", "ps_5_1")};
+    std::vector<ComPtr<ID3DBlob>> shaders = d3dUtil::CompileShaders(requests);
+    mShaders["standardVS"] = shaders[0];
+    mShaders["opaquePS"] = shaders[1];
+
+    // 监视 color.hlsl 及其包含的文件。刚刚编译过，这里的编译都会命中缓存
+    std::vector<ShaderHotReload::uint32> shaderIds = mShaderReload->AddShaders(requests);
+    mStandardVSId = shaderIds[0];
+    mOpaquePSId = shaderIds[1];
 
     // 加载离线编译的 Shader 字节码，节省编译时间+提前发现编译错误
     //    mShaders["standardVS"] = d3dUtil::LoadBinary(L"Shaders\\color_vs.cso");
@@ -468,11 +586,13 @@ void LitWavesApp::BuildShadersAndInputLayout()
 
 void LitWavesApp::BuildLandGeometry()
 {
+    // 栅格按行并行生成，生成时即已利用高度函数计算出每个顶点的高度值
     GeometryGenerator geoGen;
-    GeometryGenerator::MeshData grid = geoGen.CreateGrid(160.0f, 160.0f, 50, 50);
+    GeometryGenerator::MeshData grid =
+        geoGen.CreateGrid(160.0f, 160.0f, 50, 50, &mHillsHeightField, &ThreadPool::Default());
 
     //
-    // 获取我们所需要的顶点元素，并利用高度函数计算每个顶点的高度值
+    // 获取我们所需要的顶点元素
     // 另外，顶点的颜色要基于它们的高度而定
     // 所以，图像中才会有看起来如沙质的沙滩、山腰处的植被以及山峰处的积雪
     //
@@ -482,7 +602,6 @@ void LitWavesApp::BuildLandGeometry()
     {
         auto &p = grid.Vertices[i].Position;
         vertices[i].Pos = p;
-        vertices[i].Pos.y = GetHillsHeight(p.x, p.z);
 
         // 基于顶点高度为它上色
         if (vertices[i].Pos.y < -10.0f)
@@ -514,33 +633,29 @@ void LitWavesApp::BuildLandGeometry()
 
     const UINT vbByteSize = (UINT)vertices.size() * sizeof(Vertex);
 
-    std::vector<std::uint16_t> indices = grid.GetIndices16();
-    const UINT ibByteSize = (UINT)indices.size() * sizeof(std::uint16_t);
+    // 由 IndexBufferBuilder 决定索引宽度：栅格的顶点数超过 65536 时改用 32 位索引，而不是截断为 16 位
+    IndexBufferBuilder indexBuilder(false);
+    indexBuilder.AddSubmesh(grid.Indices32);
+    indexBuilder.Build();
+    const UINT ibByteSize = (UINT)indexBuilder.DataByteSize();
 
     auto geo = std::make_unique<MeshGeometry>();
     geo->Name = "landGeo";
 
-    ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
-    CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.data(), vbByteSize);
-
-    ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-    CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
+    geo->VertexBufferGPU = mUploadBatch->CreateDefaultBuffer(vertices.data(), vbByteSize);
 
-    geo->VertexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), vertices.data(),
-                                                        vbByteSize, geo->VertexBufferUploader);
-
-    geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), indices.data(), ibByteSize,
-                                                       geo->IndexBufferUploader);
+    geo->IndexBufferGPU = mUploadBatch->CreateDefaultBuffer(indexBuilder.Data(), ibByteSize);
 
     geo->VertexByteStride = sizeof(Vertex);
     geo->VertexBufferByteSize = vbByteSize;
-    geo->IndexFormat = DXGI_FORMAT_R16_UINT;
+    geo->IndexFormat = indexBuilder.IndexByteSize() == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
     geo->IndexBufferByteSize = ibByteSize;
 
+    const IndexBufferBuilder::Range &range = indexBuilder.Ranges()[0];
     SubmeshGeometry submesh;
-    submesh.IndexCount = (UINT)indices.size();
-    submesh.StartIndexLocation = 0;
-    submesh.BaseVertexLocation = 0;
+    submesh.IndexCount = range.IndexCount;
+    submesh.StartIndexLocation = range.StartIndexLocation;
+    submesh.BaseVertexLocation = range.BaseVertexLocation;
 
     geo->DrawArgs["grid"] = submesh;
 
@@ -582,11 +697,7 @@ void LitWavesApp::BuildWavesGeometryBuffers()
     geo->VertexBufferCPU = nullptr;
     geo->VertexBufferGPU = nullptr;
 
-    ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
-    CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.data(), ibByteSize);
-
-    geo->IndexBufferGPU = d3dUtil::CreateDefaultBuffer(md3dDevice.Get(), mCommandList.Get(), indices.data(), ibByteSize,
-                                                       geo->IndexBufferUploader);
+    geo->IndexBufferGPU = mUploadBatch->CreateDefaultBuffer(indices.data(), ibByteSize);
 
     geo->VertexByteStride = sizeof(Vertex);
     geo->VertexBufferByteSize = vbByteSize;
@@ -660,13 +771,44 @@ void LitWavesApp::BuildPSOs()
     // 并非所有的渲染状态都封装于 PSO 内，如视口（viewport）和裁剪矩形（scissor rectangle）等
     // 属性就独立于 PSO。由于将这些状态的设置与其他的流水线状态分隔开来会更有效，所以把它们
     // 强行集中在 PSO 内也并不会为之增添任何优势。
-    ThrowIfFailed(md3dDevice->CreateGraphicsPipelineState(&opaquePsoDesc, IID_PPV_ARGS(&mPSOs["opaque"])));
+    // PSO 经由缓存创建：以描述的哈希值为键，上次运行编译过的 PSO 直接从管线库中加载。
+    // 第一帧就要用到不透明 PSO，所以同步创建
+    mPSOs["opaque"] = mPipelineCache->GetGraphicsPipeline(
+        PipelineStateCache::HashGraphicsPipeline(opaquePsoDesc, mRootSignatureHash), opaquePsoDesc);
 
-    // 复制 opaquePsoDesc，修改为线框模式
+    // 复制 opaquePsoDesc，修改为线框模式。线框模式要等用户按键才用到，在后台创建即可
     D3D12_GRAPHICS_PIPELINE_STATE_DESC opaqueWireframePsoDesc = opaquePsoDesc;
     opaqueWireframePsoDesc.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME;
-    ThrowIfFailed(
-        md3dDevice->CreateGraphicsPipelineState(&opaqueWireframePsoDesc, IID_PPV_ARGS(&mPSOs["opaque_wireframe"])));
+    mOpaqueWireframePsoKey = PipelineStateCache::HashGraphicsPipeline(opaqueWireframePsoDesc, mRootSignatureHash);
+    mPipelineCache->RequestGraphicsPipeline(mOpaqueWireframePsoKey, opaqueWireframePsoDesc);
+
+    // 着色器热重载：color.hlsl 修改后，以新的字节码在后台线程中重新创建这两个 PSO，在帧边界上换入。
+    // 描述中其余的指针（输入布局、根签名）在程序运行期间一直有效
+    auto withShaders = [](D3D12_GRAPHICS_PIPELINE_STATE_DESC desc,
+                          const std::vector<ShaderHotReload::Bytecode> &shaders) {
+        desc.VS = {shaders[0]->data(), shaders[0]->size()};
+        desc.PS = {shaders[1]->data(), shaders[1]->size()};
+        return desc;
+    };
+
+    mShaderReload->AddPipeline({mStandardVSId, mOpaquePSId}, [this, withShaders, opaquePsoDesc](const auto &shaders) {
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = withShaders(opaquePsoDesc, shaders);
+        const UINT64 key = PipelineStateCache::HashGraphicsPipeline(desc, mRootSignatureHash);
+        ComPtr<ID3D12PipelineState> pso = mPipelineCache->GetGraphicsPipeline(key, desc);
+
+        // 缓存持有它创建过的每一个 PSO，已提交的帧仍在使用的旧 PSO 不会因为这里换掉引用而被释放
+        return ShaderHotReload::Commit([this, pso]() { mPSOs["opaque"] = pso; });
+    });
+
+    mShaderReload->AddPipeline(
+        {mStandardVSId, mOpaquePSId}, [this, withShaders, opaqueWireframePsoDesc](const auto &shaders) {
+            D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = withShaders(opaqueWireframePsoDesc, shaders);
+            const UINT64 key = PipelineStateCache::HashGraphicsPipeline(desc, mRootSignatureHash);
+            mPipelineCache->GetGraphicsPipeline(key, desc);
+
+            // 新的 PSO 已经在缓存中，Draw 按新的键找到它
+            return ShaderHotReload::Commit([this, key]() { mOpaqueWireframePsoKey = key; });
+        });
 }
 
 void LitWavesApp::BuildFrameResources()
@@ -674,7 +816,8 @@ void LitWavesApp::BuildFrameResources()
     for (int i = 0; i < gNumFrameResources; ++i)
     {
         mFrameResources.push_back(
-            std::make_unique<FrameResource>(md3dDevice.Get(), 1, (UINT)mAllRitems.size(), mWaves->VertexCount()));
+            std::make_unique<FrameResource>(md3dDevice.Get(), mHeapAllocator.get(), 1, (UINT)mAllRitems.size(),
+                                            mWaves->VertexCount()));
     }
 }
 
@@ -682,7 +825,7 @@ void LitWavesApp::BuildFrameResources()
 // 将物体世界坐标更新到当前 FrameResource 的常量缓冲里面。
 void LitWavesApp::UpdateObjectCBs(const GameTimer &gt)
 {
-    auto currObjectCB = mCurrFrameResource->ObjectCB.get();
+    auto currObjectCB = mSimFrameResource->ObjectCB.get();
     for (const auto &item : mAllRitems)
     {
         // 只要常量发生了改变就得更新常量缓冲区内的数据。而且要对每个帧资源都进行更新
@@ -733,10 +876,27 @@ void LitWavesApp::UpdateMainPassCB(const GameTimer &gt)
     mMainPassCB.FarZ = 1000.0f;
     mMainPassCB.TotalTime = gt.TotalTime();
     mMainPassCB.DeltaTime = gt.DeltaTime();
-    auto currPassCB = mCurrFrameResource->PassCB.get();
+    auto currPassCB = mSimFrameResource->PassCB.get();
     currPassCB->CopyData(0, mMainPassCB);
 }
 
+void LitWavesApp::BuildFrameGraph()
+{
+    mBackBufferHandle =
+        mFrameGraph.ImportResource("BackBuffer", D3D12_RESOURCE_STATE_PRESENT, D3D12_RESOURCE_STATE_PRESENT);
+    // D3DApp::OnResize 创建深度缓冲区后已将其转换为 DEPTH_WRITE，此后一直保持该状态
+    mDepthStencilHandle = mFrameGraph.ImportResource("DepthStencil", D3D12_RESOURCE_STATE_DEPTH_WRITE,
+                                                     D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+    // 不透明物体由 Draw 并行记录到多个命令列表中，所以 Pass 本身不记录命令，
+    // Draw 只从帧图中取出这个 Pass 之前的屏障与最终的屏障
+    mOpaquePass = mFrameGraph.AddPass("Opaque", nullptr);
+    mFrameGraph.Write(mOpaquePass, mBackBufferHandle, D3D12_RESOURCE_STATE_RENDER_TARGET);
+    mFrameGraph.Write(mOpaquePass, mDepthStencilHandle, D3D12_RESOURCE_STATE_DEPTH_WRITE);
+
+    mFrameGraph.Compile();
+}
+
 void LitWavesApp::BuildRenderItems()
 {
     auto wavesRitem = std::make_unique<RenderItem>();
@@ -767,31 +927,33 @@ void LitWavesApp::BuildRenderItems()
     mAllRitems.push_back(std::move(gridRitem));
 }
 
-void LitWavesApp::DrawRenderItems(ID3D12GraphicsCommandList *cmdList, const std::vector<RenderItem *> &ritems)
+void LitWavesApp::DrawRenderItems(CommandStream &stream, const std::vector<RenderItem *> &ritems, size_t begin,
+                                  size_t end)
 {
     UINT objCBByteSize = d3dUtil::CalcConstantBufferByteSize(sizeof(ObjectConstants));
-    auto objectCB = mCurrFrameResource->ObjectCB->Resource();
+    auto objectCB = mRenderFrameResource->ObjectCB->Resource();
     // 对于每个渲染项来说...
-    for (size_t i = 0; i < ritems.size(); ++i)
+    for (size_t i = begin; i < end; ++i)
     {
         auto ri = ritems[i];
 
         auto vertexBufferView = ri->Geo->VertexBufferView();
-        cmdList->IASetVertexBuffers(0, 1, &vertexBufferView);
+        stream.SetVertexBuffer(0, vertexBufferView.BufferLocation, vertexBufferView.SizeInBytes,
+                               vertexBufferView.StrideInBytes);
         auto indexBufferView = ri->Geo->IndexBufferView();
-        cmdList->IASetIndexBuffer(&indexBufferView);
-        cmdList->IASetPrimitiveTopology(ri->PrimitiveType);
+        stream.SetIndexBuffer(indexBufferView.BufferLocation, indexBufferView.SizeInBytes, indexBufferView.Format);
+        stream.SetPrimitiveTopology(ri->PrimitiveType);
 
         D3D12_GPU_VIRTUAL_ADDRESS objCBAddress = objectCB->GetGPUVirtualAddress();
         objCBAddress += ri->ObjCBIndex * objCBByteSize;
 
         // 以传递参数的方式将 CBV 与某个根描述符相绑定
-        cmdList->SetGraphicsRootConstantBufferView(
+        stream.SetGraphicsRootConstantBufferView(
             // RootParameterIndex：CBV 将要绑定到的根参数索引，即寄存器的槽位号。
             0,
             // BufferLocation：含有常量缓冲区数据资源的虚拟地址。
             objCBAddress);
-        cmdList->DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
+        stream.DrawIndexedInstanced(ri->IndexCount, 1, ri->StartIndexLocation, ri->BaseVertexLocation, 0);
     }
 }
 
@@ -828,19 +990,12 @@ void LitWavesApp::UpdateCamera(const GameTimer &gt)
 
 float LitWavesApp::GetHillsHeight(float x, float z) const
 {
-    return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
+    return mHillsHeightField.Height(x, z);
 }
 
 XMFLOAT3 LitWavesApp::GetHillsNormal(float x, float z) const
 {
-    // n = (-df/dx, 1, -df/dz)
-    XMFLOAT3 n(-0.03f * z * cosf(0.1f * x) - 0.3f * cosf(0.1f * z), 1.0f,
-               -0.3f * sinf(0.1f * x) + 0.03f * x * sinf(0.1f * z));
-
-    XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
-    XMStoreFloat3(&n, unitNormal);
-
-    return n;
+    return mHillsHeightField.Normal(x, z);
 }
 
 // 模拟波浪并更新顶点缓冲区
@@ -848,7 +1003,7 @@ void LitWavesApp::UpdateWaves(const GameTimer &gt)
 {
     // 每隔 1/4 秒就要生成一个随机波浪
     static float t_base = 0.0f;
-    if ((mTimer.TotalTime() - t_base) >= 0.25f)
+    if ((gt.TotalTime() - t_base) >= 0.25f)
     {
         t_base += 0.25f;
 
@@ -864,7 +1019,7 @@ void LitWavesApp::UpdateWaves(const GameTimer &gt)
     mWaves->Update(gt.DeltaTime());
 
     // 用波浪方程求出的新数据来更新波浪顶点缓冲区
-    auto currWavesVB = mCurrFrameResource->WavesVB.get();
+    auto currWavesVB = mSimFrameResource->WavesVB.get();
     for (int i = 0; i < mWaves->VertexCount(); ++i)
     {
         Vertex v;
@@ -874,9 +1029,6 @@ void LitWavesApp::UpdateWaves(const GameTimer &gt)
 
         currWavesVB->CopyData(i, v);
     }
-
-    // 将波浪渲染项的动态顶点缓冲区设置到当前帧的顶点缓冲区
-    mWavesRitem->Geo->VertexBufferGPU = currWavesVB->Resource();
 }
 
 void LitWavesApp::BuildMaterials()
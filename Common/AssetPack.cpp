@@ -0,0 +1,430 @@
+#include "AssetPack.h"
+#include "Hash.h"
+#include "Lz4Block.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace
+{
+std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// 检查 [offset, offset + size) 是否完全位于文件内（避免加法溢出）
+bool InRange(std::uint64_t offset, std::uint64_t size, std::uint64_t fileSize)
+{
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+// 从表中逐项读取。文件中的表不一定满足结构体的对齐要求，所以用 memcpy
+template <typename T>
+T ReadEntry(const std::uint8_t *base, std::uint64_t offset, std::uint32_t index)
+{
+    T entry;
+    std::memcpy(&entry, base + offset + static_cast<std::uint64_t>(index) * sizeof(T), sizeof(T));
+    return entry;
+}
+
+char NormalizeSeparator(char c)
+{
+    return c == '\\' ? '/' : c;
+}
+
+bool NamesEqual(std::string_view stored, std::string_view name)
+{
+    if (stored.size() != name.size())
+        return false;
+    for (size_t i = 0; i < name.size(); ++i)
+    {
+        if (stored[i] != NormalizeSeparator(name[i]))
+            return false;
+    }
+    return true;
+}
+
+// C++17 中 u8string 返回 std::string，C++20 中返回 std::u8string，逐字符复制两者都适用
+std::string ToUtf8(const std::filesystem::path &path)
+{
+    const auto text = path.generic_u8string();
+    return std::string(text.begin(), text.end());
+}
+
+std::uint64_t BlockCount(std::uint64_t size)
+{
+    return (size + AssetPack::BlockSize - 1) / AssetPack::BlockSize;
+}
+} // namespace
+
+//
+// AssetPack
+//
+
+bool AssetPack::Open(const std::wstring &filename)
+{
+    Close();
+
+    if (!mFile.Open(filename))
+        return Fail("cannot open or map the file: " + mFile.Error());
+
+    return Parse(mFile.Bytes());
+}
+
+bool AssetPack::Parse(Span<const std::uint8_t> bytes)
+{
+    mAssets.clear();
+    mNameHashes.clear();
+    mSlots = nullptr;
+    mSlotMask = 0;
+    mError.clear();
+
+    const std::uint8_t *base = bytes.data();
+    const std::uint64_t size = bytes.size();
+
+    if (size < sizeof(AssetPackHeader))
+        return Fail("file is smaller than the header");
+    if (reinterpret_cast<std::uintptr_t>(base) % DataAlignment != 0)
+        return Fail("file data is not 16-byte aligned");
+
+    AssetPackHeader header;
+    std::memcpy(&header, base, sizeof(header));
+
+    if (header.Magic != Magic)
+        return Fail("not an asset pack");
+    if (header.Version == 0 || header.Version > CurrentVersion)
+        return Fail("unsupported asset pack version " + std::to_string(header.Version));
+    if (header.HeaderSize < sizeof(AssetPackHeader) || header.FileSize != size ||
+        header.DataAlignment != DataAlignment || header.BlockSize != BlockSize)
+        return Fail("header is corrupt");
+    // 槽位数必须是 2 的幂，并且多于条目数，保证查找时总能遇到空槽位
+    if (header.SlotCount == 0 || (header.SlotCount & (header.SlotCount - 1)) != 0 ||
+        header.SlotCount <= header.EntryCount)
+        return Fail("index is corrupt");
+
+    const std::uint64_t entryTable = header.HeaderSize;
+    const std::uint64_t slotTable =
+        entryTable + static_cast<std::uint64_t>(header.EntryCount) * sizeof(AssetPackEntry);
+    const std::uint64_t stringTable = slotTable + static_cast<std::uint64_t>(header.SlotCount) * sizeof(uint32);
+
+    if (!InRange(stringTable, header.StringTableSize, size))
+        return Fail("tables extend past the end of the file");
+
+    const char *strings = reinterpret_cast<const char *>(base + stringTable);
+
+    mAssets.resize(header.EntryCount);
+    mNameHashes.resize(header.EntryCount);
+    for (uint32 i = 0; i < header.EntryCount; ++i)
+    {
+        auto entry = ReadEntry<AssetPackEntry>(base, entryTable, i);
+        Asset &asset = mAssets[i];
+        asset.Size = entry.Size;
+        asset.Method = static_cast<Compression>(entry.Compression);
+        mNameHashes[i] = entry.NameHash;
+
+        bool valid = InRange(entry.NameOffset, entry.NameLength, header.StringTableSize) &&
+                     entry.DataOffset % DataAlignment == 0 && InRange(entry.DataOffset, entry.StoredSize, size);
+        if (asset.Method == Compression::None)
+            valid = valid && entry.StoredSize == entry.Size;
+        else if (asset.Method == Compression::Lz4Blocks)
+            valid = valid && entry.StoredSize >= BlockCount(entry.Size) * sizeof(uint32);
+        else
+            valid = false;
+
+        if (!valid)
+            return Fail("entry " + std::to_string(i) + " is corrupt");
+
+        asset.Name = std::string_view(strings + entry.NameOffset, entry.NameLength);
+        asset.Data = Span<const std::uint8_t>(base + entry.DataOffset, static_cast<size_t>(entry.StoredSize));
+    }
+
+    // 槽位表在查找时直接从映射的内存中读取，这里只检查其中的序号
+    mSlots = base + slotTable;
+    mSlotMask = header.SlotCount - 1;
+    for (uint32 i = 0; i < header.SlotCount; ++i)
+    {
+        uint32 index = ReadEntry<uint32>(mSlots, 0, i);
+        if (index != EmptySlot && index >= header.EntryCount)
+            return Fail("index is corrupt");
+    }
+
+    return true;
+}
+
+void AssetPack::Close()
+{
+    mFile.Close();
+    mAssets.clear();
+    mNameHashes.clear();
+    mSlots = nullptr;
+    mSlotMask = 0;
+    mError.clear();
+}
+
+const AssetPack::Asset *AssetPack::Find(std::string_view name) const
+{
+    if (mSlots == nullptr)
+        return nullptr;
+
+    // 线性探测，遇到空槽位说明不存在。Parse 保证了至少有一个空槽位
+    const uint64 hash = HashName(name);
+    for (uint32 probe = 0, slot = static_cast<uint32>(hash) & mSlotMask; probe <= mSlotMask;
+         ++probe, slot = (slot + 1) & mSlotMask)
+    {
+        const uint32 index = ReadEntry<uint32>(mSlots, 0, slot);
+        if (index == EmptySlot)
+            return nullptr;
+        if (mNameHashes[index] == hash && NamesEqual(mAssets[index].Name, name))
+            return &mAssets[index];
+    }
+    return nullptr;
+}
+
+Span<const std::uint8_t> AssetPack::View(const Asset &asset) const
+{
+    if (asset.Method != Compression::None)
+        return Span<const std::uint8_t>();
+    return asset.Data;
+}
+
+bool AssetPack::Read(const Asset &asset, std::vector<std::uint8_t> &bytes) const
+{
+    if (asset.Method == Compression::None)
+    {
+        bytes.assign(asset.Data.begin(), asset.Data.end());
+        return true;
+    }
+
+    bytes.resize(static_cast<size_t>(asset.Size));
+
+    // 数据段开头是各块压缩后的大小，之后是依次排列的各块
+    const uint64 blockCount = BlockCount(asset.Size);
+    const std::uint8_t *table = asset.Data.data();
+    uint64 offset = blockCount * sizeof(uint32);
+    for (uint64 block = 0; block < blockCount; ++block)
+    {
+        const uint32 storedSize = ReadEntry<uint32>(table, 0, static_cast<uint32>(block));
+        const uint32 blockSize = static_cast<uint32>(
+            block + 1 < blockCount ? BlockSize : asset.Size - block * static_cast<uint64>(BlockSize));
+        const bool raw = (storedSize & RawBlockFlag) != 0;
+        const uint32 size = storedSize & ~RawBlockFlag;
+        if (!InRange(offset, size, asset.Data.size()))
+            return false;
+
+        std::uint8_t *dst = bytes.data() + block * BlockSize;
+        if (raw)
+        {
+            if (size != blockSize)
+                return false;
+            std::memcpy(dst, asset.Data.data() + offset, size);
+        }
+        else if (!Lz4Block::Decompress(asset.Data.data() + offset, size, dst, blockSize))
+        {
+            return false;
+        }
+        offset += size;
+    }
+    return offset == asset.Data.size();
+}
+
+void AssetPack::Prefetch(const Asset &asset) const
+{
+    // Parse 传入的内存不是映射的文件，不需要预取
+    if (!mFile.IsOpen() || asset.Data.empty())
+        return;
+    mFile.Prefetch(static_cast<size_t>(asset.Data.data() - mFile.Data()), asset.Data.size());
+}
+
+AssetPack::uint64 AssetPack::HashName(std::string_view name)
+{
+    Hasher hasher;
+    for (char c : name)
+        hasher.Update(NormalizeSeparator(c));
+    return hasher.Digest();
+}
+
+bool AssetPack::Fail(const std::string &message)
+{
+    mFile.Close();
+    mAssets.clear();
+    mNameHashes.clear();
+    mSlots = nullptr;
+    mSlotMask = 0;
+    mError = message;
+    return false;
+}
+
+//
+// AssetPackWriter
+//
+
+void AssetPackWriter::AddAsset(const std::string &name, const void *data, std::size_t size, bool compress)
+{
+    std::string key = name;
+    for (char &c : key)
+        c = NormalizeSeparator(c);
+
+    Asset asset;
+    asset.Size = size;
+    const auto *bytes = static_cast<const std::uint8_t *>(data);
+
+    if (compress && size > 0)
+    {
+        const size_t blockCount = static_cast<size_t>(BlockCount(size));
+        std::vector<std::uint8_t> &stored = asset.Stored;
+        stored.resize(blockCount * sizeof(uint32));
+
+        std::vector<std::uint8_t> buffer(AssetPack::BlockSize);
+        for (size_t block = 0; block < blockCount; ++block)
+        {
+            const std::uint8_t *src = bytes + block * AssetPack::BlockSize;
+            const size_t blockSize = block + 1 < blockCount ? AssetPack::BlockSize : size - block * AssetPack::BlockSize;
+
+            // 只接受比原始数据小的压缩结果，否则按原样保存该块
+            uint32 storedSize = static_cast<uint32>(Lz4Block::Compress(src, blockSize, buffer.data(), blockSize - 1));
+            const std::uint8_t *payload = buffer.data();
+            if (storedSize == 0)
+            {
+                storedSize = static_cast<uint32>(blockSize);
+                payload = src;
+            }
+
+            const uint32 tableValue = payload == src ? (storedSize | AssetPack::RawBlockFlag) : storedSize;
+            std::memcpy(stored.data() + block * sizeof(uint32), &tableValue, sizeof(uint32));
+            stored.insert(stored.end(), payload, payload + storedSize);
+        }
+
+        asset.Method = AssetPack::Compression::Lz4Blocks;
+        if (stored.size() >= size)
+        {
+            // 整体上没有变小（例如已经压缩过的纹理），保存原始数据以便零复制访问
+            stored.clear();
+            asset.Method = AssetPack::Compression::None;
+        }
+    }
+
+    if (asset.Method == AssetPack::Compression::None && size > 0)
+        asset.Stored.assign(bytes, bytes + size);
+
+    mAssets[key] = std::move(asset);
+}
+
+bool AssetPackWriter::AddDirectory(const std::wstring &directory, bool compress, std::string &error)
+{
+    namespace fs = std::filesystem;
+
+    std::error_code ec;
+    fs::recursive_directory_iterator it(directory, ec);
+    for (; !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        if (!it->is_regular_file(ec))
+            continue;
+
+        MappedFile file;
+        if (!file.Open(it->path().wstring()))
+        {
+            error = "cannot read " + ToUtf8(it->path()) + ": " + file.Error();
+            return false;
+        }
+
+        AddAsset(ToUtf8(it->path().lexically_relative(directory)), file.Data(), file.Size(), compress);
+    }
+
+    if (ec)
+    {
+        error = "cannot enumerate the directory: " + ec.message();
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::uint8_t> AssetPackWriter::Serialize() const
+{
+    const auto entryCount = static_cast<uint32>(mAssets.size());
+
+    // 槽位数取不小于条目数两倍的 2 的幂，探测长度很短
+    uint32 slotCount = 1;
+    while (slotCount <= entryCount * 2)
+        slotCount *= 2;
+
+    std::string strings;
+    std::vector<AssetPackEntry> entryTable(entryCount);
+    std::vector<uint32> slotTable(slotCount, AssetPack::EmptySlot);
+
+    uint32 index = 0;
+    for (const auto &[name, asset] : mAssets)
+    {
+        AssetPackEntry &entry = entryTable[index];
+        entry.NameHash = AssetPack::HashName(name);
+        entry.NameOffset = static_cast<uint32>(strings.size());
+        entry.NameLength = static_cast<uint32>(name.size());
+        entry.StoredSize = asset.Stored.size();
+        entry.Size = asset.Size;
+        entry.Compression = static_cast<uint32>(asset.Method);
+        strings.append(name);
+        strings.push_back('\0');
+
+        uint32 slot = static_cast<uint32>(entry.NameHash) & (slotCount - 1);
+        while (slotTable[slot] != AssetPack::EmptySlot)
+            slot = (slot + 1) & (slotCount - 1);
+        slotTable[slot] = index;
+        ++index;
+    }
+
+    AssetPackHeader header;
+    header.Magic = AssetPack::Magic;
+    header.Version = AssetPack::CurrentVersion;
+    header.HeaderSize = sizeof(AssetPackHeader);
+    header.EntryCount = entryCount;
+    header.SlotCount = slotCount;
+    header.StringTableSize = static_cast<uint32>(strings.size());
+    header.DataAlignment = AssetPack::DataAlignment;
+    header.BlockSize = AssetPack::BlockSize;
+
+    // 依次为各资源的数据段分配对齐的位置
+    std::uint64_t offset = sizeof(AssetPackHeader) + entryTable.size() * sizeof(AssetPackEntry) +
+                           slotTable.size() * sizeof(uint32) + strings.size();
+    for (AssetPackEntry &entry : entryTable)
+    {
+        offset = AlignUp(offset, AssetPack::DataAlignment);
+        entry.DataOffset = offset;
+        offset += entry.StoredSize;
+    }
+    header.FileSize = offset;
+
+    // 对齐产生的空隙保持为 0
+    std::vector<std::uint8_t> bytes(static_cast<size_t>(offset), 0);
+    std::uint8_t *cursor = bytes.data();
+    auto write = [&cursor](const void *data, size_t size) {
+        if (size > 0)
+            std::memcpy(cursor, data, size);
+        cursor += size;
+    };
+
+    write(&header, sizeof(header));
+    write(entryTable.data(), entryTable.size() * sizeof(AssetPackEntry));
+    write(slotTable.data(), slotTable.size() * sizeof(uint32));
+    write(strings.data(), strings.size());
+
+    index = 0;
+    for (const auto &[name, asset] : mAssets)
+    {
+        if (!asset.Stored.empty())
+            std::memcpy(bytes.data() + entryTable[index].DataOffset, asset.Stored.data(), asset.Stored.size());
+        ++index;
+    }
+
+    return bytes;
+}
+
+bool AssetPackWriter::Write(const std::wstring &filename) const
+{
+    std::vector<std::uint8_t> bytes = Serialize();
+
+    std::ofstream fout(std::filesystem::path(filename), std::ios::binary | std::ios::trunc);
+    if (!fout)
+        return false;
+
+    fout.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(fout);
+}
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "Span.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 资源包（.pack）
+// 把一个目录下的资源文件（着色器源码、.mesh、纹理等）打包为一个文件。运行时只打开并映射一次，按名字在哈希索引中
+// 查到偏移量后直接访问映射的内存，不再为每个资源单独打开、读取文件；冷启动时文件系统的往返次数从资源数降为 1。
+//
+// 文件布局（小端序）：
+//   AssetPackHeader
+//   AssetPackEntry[EntryCount]（按名字排序）
+//   uint32_t 槽位表[SlotCount]（开放寻址的哈希表，值为条目序号，空槽位为 EmptySlot）
+//   字符串表（以 '\0' 结尾的资源名依次排列）
+//   各资源的数据（按 DataAlignment 对齐）
+//
+// 资源名是相对于打包目录的路径，以 '/' 分隔，区分大小写。查找时 '\\' 被视为 '/'，
+// 所以 L"Shaders\\color.hlsl" 这样的写法可以直接使用。
+//
+// 资源可以选择以 LZ4 块格式压缩：数据被切成 BlockSize 大小的块分别压缩，数据段开头是每个块压缩后的大小，
+// 最高位为 1 表示该块不可压缩、按原样保存。未压缩的资源可以零复制地直接访问，适合本身已经压缩过的纹理等数据。
+
+struct AssetPackHeader
+{
+    std::uint32_t Magic = 0;
+    std::uint32_t Version = 0;
+    std::uint32_t HeaderSize = 0;
+    std::uint32_t EntryCount = 0;
+    // 2 的幂，至少是 EntryCount 的两倍
+    std::uint32_t SlotCount = 0;
+    std::uint32_t StringTableSize = 0;
+    std::uint32_t DataAlignment = 0;
+    std::uint32_t BlockSize = 0;
+    std::uint64_t FileSize = 0;
+};
+
+struct AssetPackEntry
+{
+    // 资源名的 Hasher::Hash
+    std::uint64_t NameHash = 0;
+    std::uint32_t NameOffset = 0;
+    std::uint32_t NameLength = 0;
+    std::uint64_t DataOffset = 0;
+    // 数据段在文件中占用的字节数（压缩时包括块大小表）
+    std::uint64_t StoredSize = 0;
+    // 原始数据的字节数
+    std::uint64_t Size = 0;
+    std::uint32_t Compression = 0;
+    std::uint32_t Reserved = 0;
+};
+
+// 读取资源包。Asset 中的名字与 Data 指向映射的文件（或 Parse 传入的内存），在 Close/再次打开之前有效
+class AssetPack
+{
+  public:
+    using uint32 = std::uint32_t;
+    using uint64 = std::uint64_t;
+
+    static constexpr uint32 Magic = 0x50415844; // "DXAP"
+    static constexpr uint32 CurrentVersion = 1;
+    static constexpr uint32 DataAlignment = 16;
+    static constexpr uint32 BlockSize = 64 * 1024;
+    static constexpr uint32 EmptySlot = 0xffffffff;
+    static constexpr uint32 RawBlockFlag = 0x80000000;
+
+    enum class Compression : uint32
+    {
+        None = 0,
+        Lz4Blocks = 1,
+    };
+
+    struct Asset
+    {
+        std::string_view Name;
+        uint64 Size = 0;
+        Compression Method = Compression::None;
+        // 数据段在文件中的字节。未压缩时就是资源本身（16 字节对齐，可以交给 MeshFile::Parse 等直接解析）
+        Span<const std::uint8_t> Data;
+    };
+
+    AssetPack() = default;
+    AssetPack(const AssetPack &rhs) = delete;
+    AssetPack &operator=(const AssetPack &rhs) = delete;
+
+    // 映射并解析文件。失败时返回 false，原因见 Error()
+    bool Open(const std::wstring &filename);
+
+    // 解析已在内存中的文件内容，bytes 必须至少 16 字节对齐，并且在使用本对象期间保持有效
+    bool Parse(Span<const std::uint8_t> bytes);
+
+    void Close();
+
+    const std::string &Error() const
+    {
+        return mError;
+    }
+
+    const std::vector<Asset> &Assets() const
+    {
+        return mAssets;
+    }
+
+    // 找不到时返回 nullptr
+    const Asset *Find(std::string_view name) const;
+
+    // 未压缩的资源直接返回映射内存中的视图；压缩的资源返回空视图，需要用 Read 解压
+    Span<const std::uint8_t> View(const Asset &asset) const;
+
+    // 把资源的内容（必要时解压）写入 bytes。数据损坏时返回 false
+    bool Read(const Asset &asset, std::vector<std::uint8_t> &bytes) const;
+
+    // 提示操作系统在后台调入资源所在的页。加载一批资源之前先对它们调用 Prefetch，可以让磁盘读取相互重叠
+    void Prefetch(const Asset &asset) const;
+
+    static uint64 HashName(std::string_view name);
+
+  private:
+    bool Fail(const std::string &message);
+
+  private:
+    MappedFile mFile;
+    std::vector<Asset> mAssets;
+    // 指向映射内存中的槽位表，槽位数为 2 的幂
+    const std::uint8_t *mSlots = nullptr;
+    uint32 mSlotMask = 0;
+    std::vector<uint64> mNameHashes;
+    std::string mError;
+};
+
+// 生成资源包。数据在 Add* 时被复制，调用者无需保持其有效
+class AssetPackWriter
+{
+  public:
+    using uint32 = std::uint32_t;
+
+    // 同名资源会替换之前加入的资源。compress 为 true 时尝试压缩，压缩后不能变小的资源仍按原样保存
+    void AddAsset(const std::string &name, const void *data, std::size_t size, bool compress);
+
+    // 递归加入目录下的所有文件，资源名为相对于 directory 的路径。失败时返回 false，原因见 error
+    bool AddDirectory(const std::wstring &directory, bool compress, std::string &error);
+
+    std::size_t AssetCount() const
+    {
+        return mAssets.size();
+    }
+
+    std::vector<std::uint8_t> Serialize() const;
+
+    // 失败时返回 false
+    bool Write(const std::wstring &filename) const;
+
+  private:
+    struct Asset
+    {
+        std::uint64_t Size = 0;
+        AssetPack::Compression Method = AssetPack::Compression::None;
+        // 已经是文件中数据段的格式（压缩时包括块大小表）
+        std::vector<std::uint8_t> Stored;
+    };
+
+  private:
+    // 以资源名为键，序列化时条目自然按名字排序，同样的输入总是生成同样的文件
+    std::map<std::string, Asset> mAssets;
+};
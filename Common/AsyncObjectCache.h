@@ -0,0 +1,284 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// 以 64 位内容哈希为键、可以在后台线程上创建对象的缓存
+// 创建 PSO 之类的对象可能要花几十毫秒。对同一个键只会创建一次：
+//   - GetOrCreate 在调用线程上同步创建，用于第一帧就必须就绪的对象；
+//   - GetOrCreateAsync 把创建工作提交到线程池并立即返回调用者给出的替代对象（fallback），
+//     对象就绪之后的调用才返回它本身，因此第一次使用不会卡住渲染线程。
+// 创建失败（create 抛出异常）的键会被记住，不会反复重试：异步请求一直返回替代对象，同步请求重新抛出该异常。
+// 同步请求遇到已经提交、但还没有开始执行的异步任务时，直接在调用线程上执行它，而不是等待线程池：
+// 在线程池的工作线程上同步请求时，这个任务可能正排在自己后面，等待它会造成死锁。
+// 缓存本身不依赖 Direct3D，Value 只需可以复制（例如 ComPtr 或 shared_ptr），由 PipelineStateCache 用于 PSO。
+template <typename Value>
+class AsyncObjectCache
+{
+  public:
+    using uint32 = std::uint32_t;
+    using uint64 = std::uint64_t;
+    using CreateFunc = std::function<Value()>;
+
+    enum class State
+    {
+        Missing,
+        Pending,
+        Ready,
+        Failed
+    };
+
+    struct Statistics
+    {
+        uint32 Requests = 0;
+        // 请求时对象已经就绪
+        uint32 Hits = 0;
+        // 请求时还没有这个键，因而开始创建
+        uint32 Misses = 0;
+        // 异步请求返回了替代对象
+        uint32 FallbackUses = 0;
+        uint32 Created = 0;
+        uint32 Failed = 0;
+    };
+
+    // threadPool 为空时，异步请求也在调用线程上同步创建
+    explicit AsyncObjectCache(ThreadPool *threadPool) : mThreadPool(threadPool)
+    {
+    }
+
+    AsyncObjectCache(const AsyncObjectCache &rhs) = delete;
+    AsyncObjectCache &operator=(const AsyncObjectCache &rhs) = delete;
+
+    // 后台任务引用了缓存本身，必须等它们全部结束
+    ~AsyncObjectCache()
+    {
+        WaitIdle();
+    }
+
+    // 返回 key 对应的对象，没有时在调用线程上创建。异步任务还没有开始时在调用线程上执行它，
+    // 另一个线程正在创建同一个键时等待它完成
+    Value GetOrCreate(uint64 key, const CreateFunc &create)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        ++mStats.Requests;
+
+        auto it = mEntries.find(key);
+        if (it == mEntries.end())
+        {
+            ++mStats.Misses;
+            std::shared_ptr<std::promise<void>> promise = BeginCreate(key);
+            lock.unlock();
+            Run(key, create, promise);
+            lock.lock();
+            it = mEntries.find(key);
+        }
+        else if (it->second.Status == State::Ready)
+        {
+            ++mStats.Hits;
+        }
+
+        if (it->second.Status == State::Pending)
+        {
+            std::shared_ptr<QueuedTask> task = Claim(it->second);
+            std::shared_future<void> done = it->second.Done;
+            lock.unlock();
+            if (task)
+                Run(key, task->Create, task->Promise);
+            else
+                done.wait();
+            lock.lock();
+            it = mEntries.find(key);
+        }
+
+        if (it->second.Status == State::Failed)
+            std::rethrow_exception(it->second.Error);
+        return it->second.Object;
+    }
+
+    // 对象已经就绪时返回它，否则返回 fallback；还没有这个键时在后台开始创建
+    Value GetOrCreateAsync(uint64 key, CreateFunc create, const Value &fallback)
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        ++mStats.Requests;
+
+        auto it = mEntries.find(key);
+        if (it != mEntries.end())
+        {
+            if (it->second.Status == State::Ready)
+            {
+                ++mStats.Hits;
+                return it->second.Object;
+            }
+            ++mStats.FallbackUses;
+            return fallback;
+        }
+
+        ++mStats.Misses;
+        std::shared_ptr<std::promise<void>> promise = BeginCreate(key);
+
+        if (mThreadPool == nullptr)
+        {
+            lock.unlock();
+            return Run(key, create, promise) ? Find(key, fallback) : fallback;
+        }
+
+        auto task = std::make_shared<QueuedTask>();
+        task->Create = std::move(create);
+        task->Promise = std::move(promise);
+        mEntries[key].Queued = task;
+        ++mStats.FallbackUses;
+        lock.unlock();
+
+        // 任务被同步请求抢先执行之后，不再访问缓存本身：缓存此时可能已经析构
+        mThreadPool->Submit([this, key, task]() {
+            if (!task->Claimed.exchange(true))
+                Run(key, task->Create, task->Promise);
+        });
+        return fallback;
+    }
+
+    // 只查询，不创建：对象就绪时返回它，否则返回 fallback。每帧调用的开销只是一次加锁与哈希表查找
+    Value Find(uint64 key, const Value &fallback) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mEntries.find(key);
+        return it != mEntries.end() && it->second.Status == State::Ready ? it->second.Object : fallback;
+    }
+
+    State GetState(uint64 key) const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mEntries.find(key);
+        return it != mEntries.end() ? it->second.Status : State::Missing;
+    }
+
+    // 等待所有正在创建的对象完成。还没有开始的异步任务在调用线程上执行
+    void WaitIdle()
+    {
+        for (;;)
+        {
+            std::vector<std::pair<uint64, std::shared_ptr<QueuedTask>>> queued;
+            std::vector<std::shared_future<void>> pending;
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                for (auto &entry : mEntries)
+                {
+                    if (entry.second.Status != State::Pending)
+                        continue;
+                    if (std::shared_ptr<QueuedTask> task = Claim(entry.second))
+                        queued.emplace_back(entry.first, std::move(task));
+                    else
+                        pending.push_back(entry.second.Done);
+                }
+            }
+            if (queued.empty() && pending.empty())
+                return;
+            for (const auto &task : queued)
+                Run(task.first, task.second->Create, task.second->Promise);
+            for (const std::shared_future<void> &done : pending)
+                done.wait();
+        }
+    }
+
+    size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mEntries.size();
+    }
+
+    Statistics GetStatistics() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mStats;
+    }
+
+  private:
+    // 已经提交到线程池的创建任务。由先把 Claimed 置为 true 的一方（工作线程或同步请求）执行
+    struct QueuedTask
+    {
+        std::atomic<bool> Claimed{false};
+        CreateFunc Create;
+        std::shared_ptr<std::promise<void>> Promise;
+    };
+
+    struct Entry
+    {
+        State Status = State::Pending;
+        Value Object = Value();
+        std::exception_ptr Error;
+        // 创建完成（无论成功与否）时就绪
+        std::shared_future<void> Done;
+        // 已提交但可能还没有开始的异步任务
+        std::shared_ptr<QueuedTask> Queued;
+    };
+
+    // 调用者持有锁。异步任务还没有开始时取走它，返回空表示已经有线程在执行
+    static std::shared_ptr<QueuedTask> Claim(Entry &entry)
+    {
+        std::shared_ptr<QueuedTask> task = std::move(entry.Queued);
+        if (task && !task->Claimed.exchange(true))
+            return task;
+        return nullptr;
+    }
+
+    // 调用者持有锁
+    std::shared_ptr<std::promise<void>> BeginCreate(uint64 key)
+    {
+        auto promise = std::make_shared<std::promise<void>>();
+        Entry &entry = mEntries[key];
+        entry.Done = promise->get_future().share();
+        return promise;
+    }
+
+    // 创建对象并记录结果，返回是否成功
+    bool Run(uint64 key, const CreateFunc &create, const std::shared_ptr<std::promise<void>> &promise)
+    {
+        Value object = Value();
+        std::exception_ptr error;
+        try
+        {
+            object = create();
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            Entry &entry = mEntries[key];
+            assert(entry.Status == State::Pending);
+            entry.Queued.reset();
+            if (error)
+            {
+                entry.Status = State::Failed;
+                entry.Error = error;
+                ++mStats.Failed;
+            }
+            else
+            {
+                entry.Status = State::Ready;
+                entry.Object = std::move(object);
+                ++mStats.Created;
+            }
+        }
+        promise->set_value();
+        return !error;
+    }
+
+  private:
+    ThreadPool *mThreadPool;
+
+    mutable std::mutex mMutex;
+    std::unordered_map<uint64, Entry> mEntries;
+    Statistics mStats;
+};
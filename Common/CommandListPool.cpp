@@ -0,0 +1,36 @@
+#include "CommandListPool.h"
+
+CommandListPool::CommandListPool(ID3D12Device *device, D3D12_COMMAND_LIST_TYPE type) : mDevice(device), mType(type)
+{
+    assert(device != nullptr);
+}
+
+CommandListPool::CommandList *CommandListPool::Acquire(UINT64 completedFenceValue, ID3D12PipelineState *initialState)
+{
+    auto create = [this, initialState]() {
+        auto commandList = std::make_unique<CommandList>();
+        ThrowIfFailed(mDevice->CreateCommandAllocator(mType, IID_PPV_ARGS(commandList->Allocator.GetAddressOf())));
+        // 新建的命令列表直接处于记录状态
+        ThrowIfFailed(mDevice->CreateCommandList(0, mType, commandList->Allocator.Get(), initialState,
+                                                 IID_PPV_ARGS(commandList->List.GetAddressOf())));
+        return commandList;
+    };
+
+    bool reused = false;
+    CommandList *commandList = mPool.Acquire(completedFenceValue, create, reused);
+
+    if (reused)
+    {
+        // GPU 已经执行完这个分配器中的命令，可以复用其内存
+        ThrowIfFailed(commandList->Allocator->Reset());
+        ThrowIfFailed(commandList->List->Reset(commandList->Allocator.Get(), initialState));
+    }
+
+    return commandList;
+}
+
+void CommandListPool::Retire(CommandList *commandList, UINT64 fenceValue)
+{
+    assert(commandList != nullptr);
+    mPool.Retire(commandList, fenceValue);
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "FencedPool.h"
+#include "d3dUtil.h"
+#include <memory>
+
+// 命令分配器与命令列表的对象池
+// 原先每个帧资源只有一个命令分配器，D3DApp 也只有一个命令列表，因此无法在多个线程上同时记录命令。
+// CommandListPool 把命令分配器与命令列表成对地交给调用者（每个线程每帧各取一对），提交之后以围栏值
+// 归还；GPU 执行完毕后，这一对会被重置并交给下一个调用者。池按需增长，可以通过 PeakInUse 观察峰值。
+class CommandListPool
+{
+  public:
+    struct CommandList
+    {
+        Microsoft::WRL::ComPtr<ID3D12CommandAllocator> Allocator;
+        Microsoft::WRL::ComPtr<ID3D12GraphicsCommandList> List;
+    };
+
+    CommandListPool(ID3D12Device *device, D3D12_COMMAND_LIST_TYPE type = D3D12_COMMAND_LIST_TYPE_DIRECT);
+    CommandListPool(const CommandListPool &rhs) = delete;
+    CommandListPool &operator=(const CommandListPool &rhs) = delete;
+
+    // 取出一对 GPU 已经用完的命令分配器与命令列表，返回时命令列表已以 initialState 重置，处于记录状态。
+    // 可以在任意线程中调用
+    CommandList *Acquire(UINT64 completedFenceValue, ID3D12PipelineState *initialState = nullptr);
+
+    // 命令列表已经关闭并提交，GPU 到达 fenceValue 之后可以复用
+    void Retire(CommandList *commandList, UINT64 fenceValue);
+
+    size_t Size() const
+    {
+        return mPool.Size();
+    }
+
+    size_t InUse() const
+    {
+        return mPool.InUse();
+    }
+
+    size_t PeakInUse() const
+    {
+        return mPool.PeakInUse();
+    }
+
+  private:
+    ID3D12Device *mDevice;
+    D3D12_COMMAND_LIST_TYPE mType;
+    FencedPool<CommandList> mPool;
+};
@@ -0,0 +1,144 @@
+#include "CommandStream.h"
+#include <algorithm>
+
+CommandStream::CommandStream(size_t reserveBytes)
+{
+    mData.resize(std::max<size_t>(reserveBytes, 256));
+}
+
+void CommandStream::Reset()
+{
+    mSize = 0;
+    mCommandCount = 0;
+}
+
+std::uint8_t *CommandStream::Allocate(size_t byteSize)
+{
+    if (mSize + byteSize > mData.size())
+        mData.resize(std::max(mData.size() * 2, mSize + byteSize));
+
+    std::uint8_t *data = mData.data() + mSize;
+    mSize += byteSize;
+    return data;
+}
+
+void CommandStream::SetViewport(float topLeftX, float topLeftY, float width, float height, float minDepth,
+                                float maxDepth)
+{
+    auto &cmd = Push<CmdSetViewport>(CommandType::SetViewport);
+    cmd.TopLeftX = topLeftX;
+    cmd.TopLeftY = topLeftY;
+    cmd.Width = width;
+    cmd.Height = height;
+    cmd.MinDepth = minDepth;
+    cmd.MaxDepth = maxDepth;
+}
+
+void CommandStream::SetScissorRect(std::int32_t left, std::int32_t top, std::int32_t right, std::int32_t bottom)
+{
+    auto &cmd = Push<CmdSetScissorRect>(CommandType::SetScissorRect);
+    cmd.Left = left;
+    cmd.Top = top;
+    cmd.Right = right;
+    cmd.Bottom = bottom;
+}
+
+void CommandStream::SetPipelineState(void *pipelineState)
+{
+    Push<CmdSetPipelineState>(CommandType::SetPipelineState).PipelineState = pipelineState;
+}
+
+void CommandStream::SetGraphicsRootSignature(void *rootSignature)
+{
+    Push<CmdSetGraphicsRootSignature>(CommandType::SetGraphicsRootSignature).RootSignature = rootSignature;
+}
+
+void CommandStream::SetGraphicsRootConstantBufferView(uint32 rootParameterIndex, uint64 bufferLocation)
+{
+    auto &cmd = Push<CmdSetGraphicsRootConstantBufferView>(CommandType::SetGraphicsRootConstantBufferView);
+    cmd.BufferLocation = bufferLocation;
+    cmd.RootParameterIndex = rootParameterIndex;
+}
+
+void CommandStream::SetVertexBuffer(uint32 slot, uint64 bufferLocation, uint32 sizeInBytes, uint32 strideInBytes)
+{
+    auto &cmd = Push<CmdSetVertexBuffer>(CommandType::SetVertexBuffer);
+    cmd.BufferLocation = bufferLocation;
+    cmd.SizeInBytes = sizeInBytes;
+    cmd.StrideInBytes = strideInBytes;
+    cmd.Slot = slot;
+}
+
+void CommandStream::SetIndexBuffer(uint64 bufferLocation, uint32 sizeInBytes, uint32 format)
+{
+    auto &cmd = Push<CmdSetIndexBuffer>(CommandType::SetIndexBuffer);
+    cmd.BufferLocation = bufferLocation;
+    cmd.SizeInBytes = sizeInBytes;
+    cmd.Format = format;
+}
+
+void CommandStream::SetPrimitiveTopology(uint32 topology)
+{
+    Push<CmdSetPrimitiveTopology>(CommandType::SetPrimitiveTopology).Topology = topology;
+}
+
+void CommandStream::SetRenderTarget(uint64 renderTargetView, uint64 depthStencilView)
+{
+    auto &cmd = Push<CmdSetRenderTarget>(CommandType::SetRenderTarget);
+    cmd.RenderTargetView = renderTargetView;
+    cmd.DepthStencilView = depthStencilView;
+}
+
+void CommandStream::ClearRenderTargetView(uint64 renderTargetView, const float color[4])
+{
+    auto &cmd = Push<CmdClearRenderTargetView>(CommandType::ClearRenderTargetView);
+    cmd.RenderTargetView = renderTargetView;
+    std::memcpy(cmd.Color, color, sizeof(cmd.Color));
+}
+
+void CommandStream::ClearDepthStencilView(uint64 depthStencilView, uint32 flags, float depth, std::uint8_t stencil)
+{
+    auto &cmd = Push<CmdClearDepthStencilView>(CommandType::ClearDepthStencilView);
+    cmd.DepthStencilView = depthStencilView;
+    cmd.Flags = flags;
+    cmd.Depth = depth;
+    cmd.Stencil = stencil;
+}
+
+void CommandStream::TransitionBarrier(void *resource, uint32 stateBefore, uint32 stateAfter, uint32 subresource)
+{
+    auto &cmd = Push<CmdTransitionBarrier>(CommandType::TransitionBarrier);
+    cmd.Resource = resource;
+    cmd.StateBefore = stateBefore;
+    cmd.StateAfter = stateAfter;
+    cmd.Subresource = subresource;
+}
+
+void CommandStream::AliasingBarrier(void *resourceBefore, void *resourceAfter)
+{
+    auto &cmd = Push<CmdAliasingBarrier>(CommandType::AliasingBarrier);
+    cmd.ResourceBefore = resourceBefore;
+    cmd.ResourceAfter = resourceAfter;
+}
+
+void CommandStream::CopyBufferRegion(void *destinationBuffer, uint64 destinationOffset, void *sourceBuffer,
+                                     uint64 sourceOffset, uint64 numBytes)
+{
+    auto &cmd = Push<CmdCopyBufferRegion>(CommandType::CopyBufferRegion);
+    cmd.DestinationBuffer = destinationBuffer;
+    cmd.SourceBuffer = sourceBuffer;
+    cmd.DestinationOffset = destinationOffset;
+    cmd.SourceOffset = sourceOffset;
+    cmd.NumBytes = numBytes;
+}
+
+void CommandStream::DrawIndexedInstanced(uint32 indexCountPerInstance, uint32 instanceCount, uint32 startIndexLocation,
+                                         std::int32_t baseVertexLocation, uint32 startInstanceLocation)
+{
+    auto &cmd = Push<CmdDrawIndexedInstanced>(CommandType::DrawIndexedInstanced);
+    cmd.IndexCountPerInstance = indexCountPerInstance;
+    cmd.InstanceCount = instanceCount;
+    cmd.StartIndexLocation = startIndexLocation;
+    cmd.BaseVertexLocation = baseVertexLocation;
+    cmd.StartInstanceLocation = startInstanceLocation;
+}
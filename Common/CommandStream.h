@@ -0,0 +1,249 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// 与图形 API 无关的命令流
+// Common 中的代码原本直接调用 ID3D12GraphicsCommandList，离开 Windows 就无法运行与测量每帧的 CPU 开销。
+// CommandStream 把命令编码为紧凑的二进制包，依次写入一块线性内存：每个包由 8 字节对齐的 CommandPacketHeader
+// 与紧随其后的参数组成。编码只是几次内存写入，没有虚函数调用；随后既可以由 ReplayCommandStream 回放到
+// Direct3D 12 命令列表中，也可以交给 NullCommandBackend 只做校验与计数。
+//
+// 命令流不包含 d3d12.h：资源、PSO 与根签名以不透明指针表示，GPU 虚拟地址与描述符句柄以 64 位整数表示，
+// 资源状态、图元拓扑、索引格式等枚举值则原样保存为 32 位整数，由回放端解释。
+
+enum class CommandType : std::uint16_t
+{
+    SetViewport,
+    SetScissorRect,
+    SetPipelineState,
+    SetGraphicsRootSignature,
+    SetGraphicsRootConstantBufferView,
+    SetVertexBuffer,
+    SetIndexBuffer,
+    SetPrimitiveTopology,
+    SetRenderTarget,
+    ClearRenderTargetView,
+    ClearDepthStencilView,
+    TransitionBarrier,
+    AliasingBarrier,
+    CopyBufferRegion,
+    DrawIndexedInstanced,
+    Count
+};
+
+struct CommandPacketHeader
+{
+    CommandType Type;
+    // 整个包（含包头）的字节数
+    std::uint16_t Size;
+    std::uint32_t Reserved;
+};
+
+//
+// 各命令的参数
+//
+
+struct CmdSetViewport
+{
+    float TopLeftX;
+    float TopLeftY;
+    float Width;
+    float Height;
+    float MinDepth;
+    float MaxDepth;
+};
+
+struct CmdSetScissorRect
+{
+    std::int32_t Left;
+    std::int32_t Top;
+    std::int32_t Right;
+    std::int32_t Bottom;
+};
+
+struct CmdSetPipelineState
+{
+    void *PipelineState;
+};
+
+struct CmdSetGraphicsRootSignature
+{
+    void *RootSignature;
+};
+
+struct CmdSetGraphicsRootConstantBufferView
+{
+    std::uint64_t BufferLocation;
+    std::uint32_t RootParameterIndex;
+};
+
+struct CmdSetVertexBuffer
+{
+    std::uint64_t BufferLocation;
+    std::uint32_t SizeInBytes;
+    std::uint32_t StrideInBytes;
+    std::uint32_t Slot;
+};
+
+struct CmdSetIndexBuffer
+{
+    std::uint64_t BufferLocation;
+    std::uint32_t SizeInBytes;
+    std::uint32_t Format;
+};
+
+struct CmdSetPrimitiveTopology
+{
+    std::uint32_t Topology;
+};
+
+struct CmdSetRenderTarget
+{
+    std::uint64_t RenderTargetView;
+    // 为 0 表示不绑定深度/模板缓冲区
+    std::uint64_t DepthStencilView;
+};
+
+struct CmdClearRenderTargetView
+{
+    std::uint64_t RenderTargetView;
+    float Color[4];
+};
+
+struct CmdClearDepthStencilView
+{
+    std::uint64_t DepthStencilView;
+    std::uint32_t Flags;
+    float Depth;
+    std::uint8_t Stencil;
+};
+
+struct CmdTransitionBarrier
+{
+    void *Resource;
+    std::uint32_t StateBefore;
+    std::uint32_t StateAfter;
+    std::uint32_t Subresource;
+};
+
+struct CmdAliasingBarrier
+{
+    // 为空表示任何可能占用同一块内存的资源
+    void *ResourceBefore;
+    void *ResourceAfter;
+};
+
+struct CmdCopyBufferRegion
+{
+    void *DestinationBuffer;
+    void *SourceBuffer;
+    std::uint64_t DestinationOffset;
+    std::uint64_t SourceOffset;
+    std::uint64_t NumBytes;
+};
+
+struct CmdDrawIndexedInstanced
+{
+    std::uint32_t IndexCountPerInstance;
+    std::uint32_t InstanceCount;
+    std::uint32_t StartIndexLocation;
+    std::int32_t BaseVertexLocation;
+    std::uint32_t StartInstanceLocation;
+};
+
+class CommandStream
+{
+  public:
+    using uint32 = std::uint32_t;
+    using uint64 = std::uint64_t;
+
+    static const size_t PacketAlignment = 8;
+    // 与 D3D12_RESOURCE_BARRIER_ALL_SUBRESOURCES 相同
+    static constexpr uint32 AllSubresources = 0xffffffff;
+    // 回放时连续的资源屏障合并为一次 ResourceBarrier 调用，每次调用最多包含的屏障数
+    static constexpr uint32 MaxBarriersPerBatch = 16;
+
+    explicit CommandStream(size_t reserveBytes = 64 * 1024);
+
+    // 清空命令但保留已分配的内存，以便下一帧复用
+    void Reset();
+
+    void SetViewport(float topLeftX, float topLeftY, float width, float height, float minDepth, float maxDepth);
+    void SetScissorRect(std::int32_t left, std::int32_t top, std::int32_t right, std::int32_t bottom);
+    void SetPipelineState(void *pipelineState);
+    void SetGraphicsRootSignature(void *rootSignature);
+    void SetGraphicsRootConstantBufferView(uint32 rootParameterIndex, uint64 bufferLocation);
+    void SetVertexBuffer(uint32 slot, uint64 bufferLocation, uint32 sizeInBytes, uint32 strideInBytes);
+    void SetIndexBuffer(uint64 bufferLocation, uint32 sizeInBytes, uint32 format);
+    void SetPrimitiveTopology(uint32 topology);
+    void SetRenderTarget(uint64 renderTargetView, uint64 depthStencilView);
+    void ClearRenderTargetView(uint64 renderTargetView, const float color[4]);
+    void ClearDepthStencilView(uint64 depthStencilView, uint32 flags, float depth, std::uint8_t stencil);
+    void TransitionBarrier(void *resource, uint32 stateBefore, uint32 stateAfter,
+                           uint32 subresource = AllSubresources);
+    void AliasingBarrier(void *resourceBefore, void *resourceAfter);
+    void CopyBufferRegion(void *destinationBuffer, uint64 destinationOffset, void *sourceBuffer, uint64 sourceOffset,
+                          uint64 numBytes);
+    void DrawIndexedInstanced(uint32 indexCountPerInstance, uint32 instanceCount, uint32 startIndexLocation,
+                              std::int32_t baseVertexLocation, uint32 startInstanceLocation);
+
+    const std::uint8_t *Data() const
+    {
+        return mData.data();
+    }
+
+    size_t ByteSize() const
+    {
+        return mSize;
+    }
+
+    uint32 CommandCount() const
+    {
+        return mCommandCount;
+    }
+
+    // 依次访问每个包：visitor(CommandType, const void *payload)
+    template <typename Visitor>
+    void ForEach(Visitor &&visitor) const
+    {
+        size_t offset = 0;
+        while (offset < mSize)
+        {
+            const auto *header = reinterpret_cast<const CommandPacketHeader *>(mData.data() + offset);
+            visitor(header->Type, static_cast<const void *>(header + 1));
+            offset += header->Size;
+        }
+    }
+
+  private:
+    template <typename T>
+    T &Push(CommandType type)
+    {
+        static_assert(sizeof(CommandPacketHeader) % PacketAlignment == 0, "header must keep payload aligned");
+        static_assert(alignof(T) <= PacketAlignment, "payload alignment exceeds packet alignment");
+
+        const size_t packetSize =
+            (sizeof(CommandPacketHeader) + sizeof(T) + PacketAlignment - 1) & ~(PacketAlignment - 1);
+        std::uint8_t *packet = Allocate(packetSize);
+
+        auto *header = reinterpret_cast<CommandPacketHeader *>(packet);
+        header->Type = type;
+        header->Size = static_cast<std::uint16_t>(packetSize);
+        header->Reserved = 0;
+        ++mCommandCount;
+
+        return *reinterpret_cast<T *>(packet + sizeof(CommandPacketHeader));
+    }
+
+    std::uint8_t *Allocate(size_t byteSize);
+
+  private:
+    // std::vector 分配的内存至少按 alignof(std::max_align_t) 对齐，而每个包的偏移量都是 8 的倍数。
+    // mData 只增不减，mSize 为已写入的字节数
+    std::vector<std::uint8_t> mData;
+    size_t mSize = 0;
+    uint32 mCommandCount = 0;
+};
@@ -0,0 +1,156 @@
+#include "D3D12CommandReplay.h"
+
+namespace
+{
+// 缓存尚未提交的转换屏障与别名屏障，遇到其他命令或回放结束时一次性提交。
+// 屏障放在栈上的定长数组中，回放时不分配内存；连续的屏障超过 MaxBarriers 个时先提交已满的一批
+class BarrierBatch
+{
+  public:
+    static const UINT MaxBarriers = CommandStream::MaxBarriersPerBatch;
+
+    explicit BarrierBatch(ID3D12GraphicsCommandList *cmdList) : mCmdList(cmdList)
+    {
+    }
+
+    void Add(const CmdTransitionBarrier &cmd)
+    {
+        Push(CD3DX12_RESOURCE_BARRIER::Transition(
+            static_cast<ID3D12Resource *>(cmd.Resource), static_cast<D3D12_RESOURCE_STATES>(cmd.StateBefore),
+            static_cast<D3D12_RESOURCE_STATES>(cmd.StateAfter), cmd.Subresource));
+    }
+
+    void Add(const CmdAliasingBarrier &cmd)
+    {
+        Push(CD3DX12_RESOURCE_BARRIER::Aliasing(static_cast<ID3D12Resource *>(cmd.ResourceBefore),
+                                                static_cast<ID3D12Resource *>(cmd.ResourceAfter)));
+    }
+
+    void Flush()
+    {
+        if (mCount == 0)
+            return;
+        mCmdList->ResourceBarrier(mCount, mBarriers);
+        mCount = 0;
+    }
+
+  private:
+    void Push(const D3D12_RESOURCE_BARRIER &barrier)
+    {
+        if (mCount == MaxBarriers)
+            Flush();
+        mBarriers[mCount++] = barrier;
+    }
+
+  private:
+    ID3D12GraphicsCommandList *mCmdList;
+    D3D12_RESOURCE_BARRIER mBarriers[MaxBarriers];
+    UINT mCount = 0;
+};
+} // namespace
+
+void ReplayCommandStream(const CommandStream &stream, ID3D12GraphicsCommandList *cmdList)
+{
+    assert(cmdList != nullptr);
+
+    BarrierBatch barriers(cmdList);
+
+    stream.ForEach([cmdList, &barriers](CommandType type, const void *payload) {
+        if (type == CommandType::TransitionBarrier)
+        {
+            barriers.Add(*static_cast<const CmdTransitionBarrier *>(payload));
+            return;
+        }
+        if (type == CommandType::AliasingBarrier)
+        {
+            barriers.Add(*static_cast<const CmdAliasingBarrier *>(payload));
+            return;
+        }
+        barriers.Flush();
+
+        switch (type)
+        {
+        case CommandType::SetViewport: {
+            const auto *cmd = static_cast<const CmdSetViewport *>(payload);
+            D3D12_VIEWPORT viewport = {cmd->TopLeftX, cmd->TopLeftY, cmd->Width,
+                                       cmd->Height,   cmd->MinDepth, cmd->MaxDepth};
+            cmdList->RSSetViewports(1, &viewport);
+            break;
+        }
+        case CommandType::SetScissorRect: {
+            const auto *cmd = static_cast<const CmdSetScissorRect *>(payload);
+            D3D12_RECT rect = {cmd->Left, cmd->Top, cmd->Right, cmd->Bottom};
+            cmdList->RSSetScissorRects(1, &rect);
+            break;
+        }
+        case CommandType::SetPipelineState:
+            cmdList->SetPipelineState(
+                static_cast<ID3D12PipelineState *>(static_cast<const CmdSetPipelineState *>(payload)->PipelineState));
+            break;
+        case CommandType::SetGraphicsRootSignature:
+            cmdList->SetGraphicsRootSignature(static_cast<ID3D12RootSignature *>(
+                static_cast<const CmdSetGraphicsRootSignature *>(payload)->RootSignature));
+            break;
+        case CommandType::SetGraphicsRootConstantBufferView: {
+            const auto *cmd = static_cast<const CmdSetGraphicsRootConstantBufferView *>(payload);
+            cmdList->SetGraphicsRootConstantBufferView(cmd->RootParameterIndex, cmd->BufferLocation);
+            break;
+        }
+        case CommandType::SetVertexBuffer: {
+            const auto *cmd = static_cast<const CmdSetVertexBuffer *>(payload);
+            D3D12_VERTEX_BUFFER_VIEW view = {cmd->BufferLocation, cmd->SizeInBytes, cmd->StrideInBytes};
+            cmdList->IASetVertexBuffers(cmd->Slot, 1, &view);
+            break;
+        }
+        case CommandType::SetIndexBuffer: {
+            const auto *cmd = static_cast<const CmdSetIndexBuffer *>(payload);
+            D3D12_INDEX_BUFFER_VIEW view = {cmd->BufferLocation, cmd->SizeInBytes,
+                                            static_cast<DXGI_FORMAT>(cmd->Format)};
+            cmdList->IASetIndexBuffer(&view);
+            break;
+        }
+        case CommandType::SetPrimitiveTopology:
+            cmdList->IASetPrimitiveTopology(
+                static_cast<D3D12_PRIMITIVE_TOPOLOGY>(static_cast<const CmdSetPrimitiveTopology *>(payload)->Topology));
+            break;
+        case CommandType::SetRenderTarget: {
+            const auto *cmd = static_cast<const CmdSetRenderTarget *>(payload);
+            D3D12_CPU_DESCRIPTOR_HANDLE rtv = {static_cast<SIZE_T>(cmd->RenderTargetView)};
+            D3D12_CPU_DESCRIPTOR_HANDLE dsv = {static_cast<SIZE_T>(cmd->DepthStencilView)};
+            cmdList->OMSetRenderTargets(1, &rtv, true, cmd->DepthStencilView != 0 ? &dsv : nullptr);
+            break;
+        }
+        case CommandType::ClearRenderTargetView: {
+            const auto *cmd = static_cast<const CmdClearRenderTargetView *>(payload);
+            D3D12_CPU_DESCRIPTOR_HANDLE rtv = {static_cast<SIZE_T>(cmd->RenderTargetView)};
+            cmdList->ClearRenderTargetView(rtv, cmd->Color, 0, nullptr);
+            break;
+        }
+        case CommandType::ClearDepthStencilView: {
+            const auto *cmd = static_cast<const CmdClearDepthStencilView *>(payload);
+            D3D12_CPU_DESCRIPTOR_HANDLE dsv = {static_cast<SIZE_T>(cmd->DepthStencilView)};
+            cmdList->ClearDepthStencilView(dsv, static_cast<D3D12_CLEAR_FLAGS>(cmd->Flags), cmd->Depth, cmd->Stencil,
+                                           0, nullptr);
+            break;
+        }
+        case CommandType::CopyBufferRegion: {
+            const auto *cmd = static_cast<const CmdCopyBufferRegion *>(payload);
+            cmdList->CopyBufferRegion(static_cast<ID3D12Resource *>(cmd->DestinationBuffer), cmd->DestinationOffset,
+                                      static_cast<ID3D12Resource *>(cmd->SourceBuffer), cmd->SourceOffset,
+                                      cmd->NumBytes);
+            break;
+        }
+        case CommandType::DrawIndexedInstanced: {
+            const auto *cmd = static_cast<const CmdDrawIndexedInstanced *>(payload);
+            cmdList->DrawIndexedInstanced(cmd->IndexCountPerInstance, cmd->InstanceCount, cmd->StartIndexLocation,
+                                          cmd->BaseVertexLocation, cmd->StartInstanceLocation);
+            break;
+        }
+        default:
+            assert(false && "unknown command type");
+            break;
+        }
+    });
+
+    barriers.Flush();
+}
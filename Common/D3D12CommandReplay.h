@@ -0,0 +1,15 @@
+#pragma once
+
+#include "CommandStream.h"
+#include "d3dUtil.h"
+
+// 把 CommandStream 中的命令按顺序回放到 Direct3D 12 命令列表中
+// 命令列表需要处于记录状态；函数不会 Close 命令列表。连续的多个资源屏障会合并为一次 ResourceBarrier 调用，
+// 每次最多 CommandStream::MaxBarriersPerBatch 个
+void ReplayCommandStream(const CommandStream &stream, ID3D12GraphicsCommandList *cmdList);
+
+// 以下辅助函数把 D3D12 的类型转换为命令流使用的不透明表示
+inline std::uint64_t ToCommandHandle(D3D12_CPU_DESCRIPTOR_HANDLE handle)
+{
+    return static_cast<std::uint64_t>(handle.ptr);
+}
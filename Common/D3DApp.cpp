@@ -1,9 +1,14 @@
 
 #include "D3DApp.h"
 #include <cassert>
+#include <cstdio>
+#include <shellapi.h>
 #include <vector>
 #include <windowsx.h>
 
+// CommandLineToArgvW
+#pragma comment(lib, "Shell32.lib")
+
 D3DApp *D3DApp::mApp = nullptr;
 D3DApp *D3DApp::GetApp()
 {
@@ -21,6 +26,13 @@ D3DApp::~D3DApp()
 {
     if (md3dDevice != nullptr)
         FlushCommandQueue();
+
+    // GPU 已经空闲，所有延迟释放的对象都可以释放了
+    mDeferredReleases.ReleaseAll();
+
+    // 放置资源要先于它所在的堆释放
+    if (mHeapAllocator != nullptr)
+        mHeapAllocator->Free(mDepthStencilBuffer);
 }
 
 HINSTANCE D3DApp::AppInst() const
@@ -50,14 +62,36 @@ void D3DApp::Set4xMsaaState(bool value)
         m4xMsaaState = value;
 
         // Recreate the swapchain and buffers with new multisample settings.
-        CreateSwapChain();
+        if (!mHeadless)
+            CreateSwapChain();
         OnResize();
     }
 }
 
+void D3DApp::SetHeadless(bool headless)
+{
+    // 设备与交换链创建之后不能再切换
+    assert(md3dDevice == nullptr);
+    mHeadless = headless;
+}
+
+std::vector<std::wstring> D3DApp::CommandLineArguments()
+{
+    std::vector<std::wstring> arguments;
+    int count = 0;
+    LPWSTR *argv = CommandLineToArgvW(GetCommandLineW(), &count);
+    if (argv == nullptr)
+        return arguments;
+
+    for (int i = 1; i < count; ++i)
+        arguments.push_back(argv[i]);
+    LocalFree(argv);
+    return arguments;
+}
+
 bool D3DApp::Initialize()
 {
-    if (!InitMainWindow())
+    if (!mHeadless && !InitMainWindow())
         return false;
 
     if (!InitDirect3D())
@@ -71,19 +105,12 @@ bool D3DApp::Initialize()
 
 void D3DApp::CreateRtvAndDsvDescriptorHeaps()
 {
-    D3D12_DESCRIPTOR_HEAP_DESC rtvHeapDesc;
-    rtvHeapDesc.NumDescriptors = SwapChainBufferCount;
-    rtvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_RTV;
-    rtvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-    rtvHeapDesc.NodeMask = 0;
-    ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&rtvHeapDesc, IID_PPV_ARGS(mRtvHeap.GetAddressOf())));
+    // 描述符堆按需分配描述符，这里只为交换链缓冲区与深度/模板缓冲区各预留视图，多出的容量留给派生类
+    mRtvHeap = std::make_unique<DescriptorHeap>(md3dDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_RTV, 64);
+    mSwapChainRtvIndex = mRtvHeap->Allocate(SwapChainBufferCount);
 
-    D3D12_DESCRIPTOR_HEAP_DESC dsvHeapDesc;
-    dsvHeapDesc.NumDescriptors = 1;
-    dsvHeapDesc.Type = D3D12_DESCRIPTOR_HEAP_TYPE_DSV;
-    dsvHeapDesc.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
-    dsvHeapDesc.NodeMask = 0;
-    ThrowIfFailed(md3dDevice->CreateDescriptorHeap(&dsvHeapDesc, IID_PPV_ARGS(mDsvHeap.GetAddressOf())));
+    mDsvHeap = std::make_unique<DescriptorHeap>(md3dDevice.Get(), D3D12_DESCRIPTOR_HEAP_TYPE_DSV, 16);
+    mDepthStencilDsvIndex = mDsvHeap->Allocate();
 }
 
 // 1.  用 D3D12CreateDevice 函数创建  ID3D12Device 接口实例。
@@ -147,11 +174,23 @@ bool D3DApp::InitDirect3D()
     LogAdapters();
 #endif
 
+    // --------- 创建放置资源所用的堆分配器
+    mHeapAllocator = std::make_unique<GpuHeapAllocator>(md3dDevice.Get());
+
+    // --------- 创建 PSO 缓存，上次运行编译过的 PSO 从工作目录中的管线库加载
+    mPipelineCache = std::make_unique<PipelineStateCache>(md3dDevice.Get(), L"PipelineLibrary.bin");
+
+    // --------- 监视着色器源文件，修改后经由着色器缓存重新编译
+    mShaderReload = std::make_unique<ShaderHotReload>(d3dUtil::GetShaderCache(), ThreadPool::Default());
+
     // --------- 创建命令队列和命令列表
     CreateCommandObjects();
 
-    // --------- 描述并创建交换链
-    CreateSwapChain();
+    // --------- 描述并创建交换链，无窗口运行时由 NullCommandBackend 代替 GPU 执行命令流
+    if (mHeadless)
+        mNullBackend = std::make_unique<NullCommandBackend>();
+    else
+        CreateSwapChain();
 
     // --------- 创建应用程序所需的描述符堆
     CreateRtvAndDsvDescriptorHeaps();
@@ -197,6 +236,30 @@ void D3DApp::CreateSwapChain()
     ThrowIfFailed(mdxgiFactory->CreateSwapChain(mCommandQueue.Get(), &sd, mSwapChain.GetAddressOf()));
 }
 
+void D3DApp::CreateHeadlessBackBuffers()
+{
+    D3D12_RESOURCE_DESC desc = {};
+    desc.Dimension = D3D12_RESOURCE_DIMENSION_TEXTURE2D;
+    desc.Width = mClientWidth;
+    desc.Height = mClientHeight;
+    desc.DepthOrArraySize = 1;
+    desc.MipLevels = 1;
+    desc.Format = mBackBufferFormat;
+    desc.SampleDesc.Count = m4xMsaaState ? 4 : 1;
+    desc.SampleDesc.Quality = m4xMsaaState ? (m4xMsaaQuality - 1) : 0;
+    desc.Layout = D3D12_TEXTURE_LAYOUT_UNKNOWN;
+    desc.Flags = D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET;
+
+    // 与交换链缓冲区一样以呈现状态开始，帧图推导出的屏障不必区分两种情况
+    auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    for (int i = 0; i < SwapChainBufferCount; ++i)
+    {
+        ThrowIfFailed(md3dDevice->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &desc,
+                                                          D3D12_RESOURCE_STATE_PRESENT, nullptr,
+                                                          IID_PPV_ARGS(&mSwapChainBuffer[i])));
+    }
+}
+
 void D3DApp::CreateCommandObjects()
 {
     D3D12_COMMAND_QUEUE_DESC queueDesc = {};
@@ -212,19 +275,14 @@ void D3DApp::CreateCommandObjects()
         IID_PPV_ARGS(mCommandList.GetAddressOf())));
     // 首先要将命令列表置于关闭状态。这是因为在第一次引用命令列表时，我们要对它进行重置，而在调用重置方法之前又需先将其关闭
     mCommandList->Close();
+
+    // 每帧绘制所用的命令分配器与命令列表按需创建
+    mCommandListPool = std::make_unique<CommandListPool>(md3dDevice.Get());
 }
 
 void D3DApp::FlushCommandQueue()
 {
-    // 增加围栏值，接下来将命令标记到此围栏点
-    mCurrentFence++;
-
-    // 向命令队列中添加一条用来设置新围栏点的命令
-    // 由于这条命令要交由 GPU 处理（即由 GPU 端来修改围栏值），所以在 GPU 处理完命令队列中此 Signal()
-    // 以前的所有命令之前，它并不会设置新的围栏点
-
-    // ID3D12CommandQueue::Signal 方法从 GPU 端设置围栏值，而 ID3D12Fence::Signal 方法则从 CPU 端设置围栏值。
-    ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), mCurrentFence));
+    SignalFence();
 
     // 在 CPU 端等待 GPU，直到后者执行完这个围栏点之前的所有命令
     if (mFence->GetCompletedValue() < mCurrentFence)
@@ -305,11 +363,58 @@ bool D3DApp::InitMainWindow()
     return true;
 }
 
+UINT64 D3DApp::SignalFence()
+{
+    // 增加围栏值，接下来将命令标记到此围栏点
+    mCurrentFence++;
+
+    // 向命令队列中添加一条用来设置新围栏点的命令
+    // 由于这条命令要交由 GPU 处理（即由 GPU 端来修改围栏值），所以在 GPU 处理完命令队列中此 Signal()
+    // 以前的所有命令之前，它并不会设置新的围栏点
+
+    // ID3D12CommandQueue::Signal 方法从 GPU 端设置围栏值，而 ID3D12Fence::Signal 方法则从 CPU 端设置围栏值。
+    ThrowIfFailed(mCommandQueue->Signal(mFence.Get(), mCurrentFence));
+    return mCurrentFence;
+}
+
+void D3DApp::DeferRelease(Microsoft::WRL::ComPtr<IUnknown> object)
+{
+    if (object == nullptr)
+        return;
+
+    // 已提交的命令都排在下一个围栏点之前，GPU 到达它时就不会再引用 object
+    mDeferredReleases.Enqueue(mCurrentFence + 1, [object]() {});
+}
+
+void D3DApp::DeferFree(GpuHeapAllocator::Allocation &allocation)
+{
+    if (!allocation.IsValid())
+        return;
+
+    GpuHeapAllocator *allocator = mHeapAllocator.get();
+    mDeferredReleases.Enqueue(mCurrentFence + 1, [allocator, allocation]() mutable { allocator->Free(allocation); });
+    allocation = GpuHeapAllocator::Allocation();
+}
+
+void D3DApp::DeferRelease(std::function<void()> release)
+{
+    mDeferredReleases.Enqueue(mCurrentFence + 1, std::move(release));
+}
+
+void D3DApp::ReleaseCompletedResources()
+{
+    if (!mDeferredReleases.Empty())
+        mDeferredReleases.Release(mFence->GetCompletedValue());
+}
+
 int D3DApp::Run()
 {
     MSG msg = {0};
 
     mTimer.Reset();
+    // 第一帧的模拟在循环之前开始，Tick 一次使它看到的时间差为 0 而不是未初始化的值
+    mTimer.Tick();
+    StartFramePipeline();
     // 在获取 WM_QUIT消息之前，该函数会一直保持循环。GetMessage 函数只有在收到 WM_QUIT 消
     // 息时才会返回 0（false），这会造成循环终止；而若发生错误，它便会返回-1。还需注意的一点
     // 是，在未有信息到来之时，GetMessage 函数会令此应用程序线程进入休眠状态
@@ -326,11 +431,18 @@ int D3DApp::Run()
         {
             mTimer.Tick();
 
+            ReleaseCompletedResources();
+
+            // 帧边界：换入后台重新创建好的 PSO，并检查着色器源文件是否被修改
+            mShaderReload->Update();
+            for (const std::string &error : mShaderReload->TakeErrors())
+                OutputDebugStringA((error + "\n").c_str());
+
             if (!mAppPaused)
             {
                 CalculateFrameStats();
-                Update(mTimer);
-                Draw(mTimer);
+                RunUpdateStage();
+                RunDrawStage();
             }
             else
             {
@@ -339,9 +451,124 @@ int D3DApp::Run()
         }
     }
 
+    // 下一帧的模拟可能仍在进行，派生类的成员随后就会被销毁
+    if (mFramePipeline != nullptr)
+        mFramePipeline->WaitIdle();
+
     return (int)msg.wParam;
 }
 
+void D3DApp::EnableFramePipeline(UINT slotCount)
+{
+    mFramePipeline = std::make_unique<FramePipeline>(slotCount);
+}
+
+void D3DApp::RunUpdateStage()
+{
+    if (mFramePipeline == nullptr)
+    {
+        PrepareUpdate(mTimer);
+        Update(mTimer);
+        return;
+    }
+
+    // 本帧的模拟在上一帧（第一帧则在 StartFramePipeline 中）就已开始，每一帧的模拟只开始一次
+    assert(mFramePipeline->PendingFrames() == 1 && "StartFramePipeline was not called before the frame loop");
+    mRenderSlot = mFramePipeline->AcquireForRender();
+    BeginSimulation();
+}
+
+void D3DApp::BeginSimulation()
+{
+    // PrepareUpdate 修改的状态由模拟线程读取，所以此时不能有模拟在进行。
+    // 模拟使用开始时计时器的副本，主线程随后的 Tick 不会影响它
+    assert(mFramePipeline->PendingFrames() == 0);
+    PrepareUpdate(mTimer);
+    const GameTimer timer = mTimer;
+    mFramePipeline->BeginSimulation([this, timer](FramePipeline::uint32 slot, FramePipeline::uint64) {
+        mSimulationSlot = slot;
+        Update(timer);
+    });
+}
+
+void D3DApp::StartFramePipeline()
+{
+    if (mFramePipeline != nullptr && mFramePipeline->PendingFrames() == 0)
+        BeginSimulation();
+}
+
+void D3DApp::RunDrawStage()
+{
+    Draw(mTimer);
+    if (mFramePipeline != nullptr)
+        mFramePipeline->ReleaseFromRender(mRenderSlot);
+}
+
+int D3DApp::RunHeadless(const HeadlessFrameLoop::Options &options)
+{
+    assert(mHeadless && mNullBackend != nullptr);
+
+    // 没有窗口时可能也没有调试器，信息同时输出到标准错误，供测试机的日志收集
+    auto report = [](const std::string &text) {
+        OutputDebugStringA((text + "\n").c_str());
+        std::fprintf(stderr, "%s\n", text.c_str());
+    };
+
+    FrameTimeSource timeSource(options.FixedDeltaTime);
+    std::string error;
+    if (!options.DeltaTimeFile.empty() && !timeSource.Load(options.DeltaTimeFile, error))
+    {
+        report("headless: " + error);
+        return 1;
+    }
+
+    HeadlessFrameLoop::Stages stages;
+    stages.BeginFrame = [this](double deltaTime) {
+        mTimer.Advance(deltaTime);
+        ReleaseCompletedResources();
+        // 只换入已经创建好的 PSO，不检查着色器文件，运行期间修改文件不会影响测量结果
+        mShaderReload->ApplyPendingChanges();
+    };
+    // 开启帧流水线时 Update 阶段的耗时是等待模拟完成的时间，即模拟比上一帧的 Draw 多用的时间
+    stages.Update = [this](double) { RunUpdateStage(); };
+    stages.Draw = [this](double) { RunDrawStage(); };
+
+    mTimer.Reset();
+    mTimer.Advance(0.0);
+    StartFramePipeline();
+    const FrameTimingLog log = HeadlessFrameLoop::Run(options, timeSource, stages);
+    if (mFramePipeline != nullptr)
+        mFramePipeline->WaitIdle();
+    FlushCommandQueue();
+
+    if (!options.TimingFile.empty() && !log.Write(options.TimingFile))
+    {
+        report("headless: cannot write the frame timings");
+        return 1;
+    }
+
+    const FrameTimingLog::Summary update = log.Summarize(&FrameTiming::UpdateMs);
+    const FrameTimingLog::Summary draw = log.Summarize(&FrameTiming::DrawMs);
+    const FrameTimingLog::Summary frame = log.Summarize(&FrameTiming::FrameMs);
+    const NullCommandBackend::Statistics &stats = mNullBackend->GetStatistics();
+    char text[512];
+    std::snprintf(text, sizeof(text),
+                  "headless: %u frames, update %.3f ms (p95 %.3f), draw %.3f ms (p95 %.3f), "
+                  "frame %.3f ms (p50 %.3f, p95 %.3f, p99 %.3f, max %.3f), %llu draws",
+                  options.FrameCount, update.Mean, update.P95, draw.Mean, draw.P95, frame.Mean, frame.Median,
+                  frame.P95, frame.P99, frame.Max, static_cast<unsigned long long>(stats.DrawCount));
+    report(text);
+
+    // 命令流中的错误在 GPU 上会成为调试层报错或未定义行为，这里作为失败返回
+    if (stats.ErrorCount != 0)
+    {
+        report("headless: " + std::to_string(stats.ErrorCount) + " invalid commands, first: " +
+               mNullBackend->GetFirstError());
+        return 1;
+    }
+    return 0;
+}
+
 void D3DApp::CalculateFrameStats()
 {
     // 这段代码计算了每秒的平均帧数，也计算了每帧的平均渲染时间
@@ -461,9 +688,13 @@ void D3DApp::LogOutputDisplayModes(IDXGIOutput *output, DXGI_FORMAT format)
 void D3DApp::OnResize()
 {
     assert(md3dDevice);
-    assert(mSwapChain);
+    assert(mSwapChain || mHeadless);
     assert(mDirectCmdListAlloc);
 
+    // 模拟线程会读取窗口大小与投影矩阵等状态，修改之前等待它完成
+    if (mFramePipeline != nullptr)
+        mFramePipeline->WaitIdle();
+
     // Flush before changing any resources.
     FlushCommandQueue();
 
@@ -474,26 +705,28 @@ void D3DApp::OnResize()
     // Release the previous resources we will be recreating.
     for (int i = 0; i < SwapChainBufferCount; ++i)
         mSwapChainBuffer[i].Reset();
-    mDepthStencilBuffer.Reset();
+    mHeapAllocator->Free(mDepthStencilBuffer);
 
     // Resize the swap chain.
-    ThrowIfFailed(mSwapChain->ResizeBuffers(SwapChainBufferCount, mClientWidth, mClientHeight, mBackBufferFormat,
-                                            DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH));
+    if (mHeadless)
+        CreateHeadlessBackBuffers();
+    else
+        ThrowIfFailed(mSwapChain->ResizeBuffers(SwapChainBufferCount, mClientWidth, mClientHeight, mBackBufferFormat,
+                                                DXGI_SWAP_CHAIN_FLAG_ALLOW_MODE_SWITCH));
 
     mCurrBackBuffer = 0;
 
     // --------- 调整后台缓冲区的大小，并为它创建渲染目标视图
 
-    CD3DX12_CPU_DESCRIPTOR_HANDLE rtvHeapHandle(mRtvHeap->GetCPUDescriptorHandleForHeapStart());
-
     for (UINT i = 0; i < SwapChainBufferCount; i++)
     {
         // 获得交换链内的第 i 个缓冲区
-        ThrowIfFailed(mSwapChain->GetBuffer(
-            // Buffer：希望获得的特定后台缓冲区的索引（有时后台缓冲区并不只一个，所以需要用索引来指明）。
-            i,
-            // ppSurface：返回一个指向 ID3D12Resource 接口的指针，这便是希望获得的后台缓冲区。
-            IID_PPV_ARGS(&mSwapChainBuffer[i])));
+        if (!mHeadless)
+            ThrowIfFailed(mSwapChain->GetBuffer(
+                // Buffer：希望获得的特定后台缓冲区的索引（有时后台缓冲区并不只一个，所以需要用索引来指明）。
+                i,
+                // ppSurface：返回一个指向 ID3D12Resource 接口的指针，这便是希望获得的后台缓冲区。
+                IID_PPV_ARGS(&mSwapChainBuffer[i])));
 
         // 为此缓冲区创建一个 RTV
         md3dDevice->CreateRenderTargetView(
@@ -506,17 +739,15 @@ void D3DApp::OnResize()
             // 层级（后台缓冲区只有一种 mipmap 层级，有关 mipmap 的内容将在第 9 章展开讨论）创建一个视图。
             // 由于已经指定了后台缓冲区的格式，因此就将这个参数设置为空指针。
             nullptr,
-            // DestDescriptor：引用所创建渲染目标视图的描述符句柄。
-            rtvHeapHandle);
-        // 偏移到描述符堆中的下一个缓冲区
-        rtvHeapHandle.Offset(1, mRtvDescriptorSize);
+            // DestDescriptor：引用所创建渲染目标视图的描述符句柄。交换链的 RTV 在描述符堆中是连续的
+            mRtvHeap->CpuHandle(mSwapChainRtvIndex + i));
     }
 
     // --------- 创建深度/模板缓冲区及与之关联的深度/模板视图
 
     // 深度缓冲区其实就是一种 2D 纹理，它存储着离观察者最近的可视对象的深度信息（如果使用了模板，还会附有模板信息）。
     // 纹理是一种 GPU 资源，因此我们要通过填写 D3D12_RESOURCE_DESC 结构体来描述纹理资源，
-    // 再用 ID3D12Device::CreateCommittedResource 方法来创建它。
+    // 再用 GpuHeapAllocator::CreateResource（内部调用 ID3D12Device::CreatePlacedResource）方法来创建它。
 
     // 创建深度/模板缓冲区及其视图
     D3D12_RESOURCE_DESC depthStencilDesc;
@@ -552,15 +783,14 @@ void D3DApp::OnResize()
 
     // 为了使性能达到最佳，通常应将资源放置于默认堆中。
     // 只有在需要使用上传堆或回读堆的特性之时，才选用其他类型的堆。
-    CD3DX12_HEAP_PROPERTIES headProperties(D3D12_HEAP_TYPE_DEFAULT);
-    ThrowIfFailed(md3dDevice->CreateCommittedResource(
-        // （资源欲提交至的）堆所具有的属性。有一些属性是针对高级用法而设。
-        &headProperties,
-        // 与（资源欲提交至的）堆有关的额外选项标志。
-        // 通常将它设为 D3D12_HEAP_FLAG_NONE。
-        D3D12_HEAP_FLAG_NONE,
+    // 深度/模板缓冲区作为放置资源创建在 mHeapAllocator 管理的堆中，窗口大小改变时不必再向系统申请一次显存。
+    // 它的参数与 ID3D12Device::CreateCommittedResource 基本一致，只是堆由分配器管理：
+    // 堆所具有的属性与额外选项标志（通常为 D3D12_HEAP_FLAG_NONE）在分配器创建堆时设置，这里只需给出堆的类型。
+    mDepthStencilBuffer = mHeapAllocator->CreateResource(
         // 指向一个 D3D12_RESOURCE_DESC 实例的指针，用它描述待建的资源。
-        &depthStencilDesc,
+        depthStencilDesc,
+        // （资源欲放置到的）堆的类型。
+        D3D12_HEAP_TYPE_DEFAULT,
         // 不管何时，每个资源都会处于一种特定的使用状态。
         // 在资源创建时，需要用此参数来设置它的初始状态。对于深度/模板缓冲区来说，
         // 通常将其初始状态设置为 D3D12_RESOURCE_STATE_COMMON，再利用
@@ -569,9 +799,8 @@ void D3DApp::OnResize()
         D3D12_RESOURCE_STATE_COMMON,
         // 指向一个 D3D12_CLEAR_VALUE 对象的指针，它描述了一个用于清除资源的优化值。选择适当的优化清除值，
         // 可提高清除操作的执行速度。若不希望指定优化清除值，可把此参数设为 nullptr。
-        &optClear,
-        // 返回一个指向 ID3D12Resource 的指针，即新建的资源
-        IID_PPV_ARGS(mDepthStencilBuffer.GetAddressOf())));
+        &optClear);
+    // 返回的 Allocation 中即是新建的 ID3D12Resource 以及它在堆中所占的空间
 
     // 利用此资源的格式，为整个资源的第 0 mip 层创建描述符
     // 第二个参数是指向 D3D12_DEPTH_STENCIL_VIEW_DESC 结构体的指针。
@@ -592,8 +821,9 @@ void D3DApp::OnResize()
     ID3D12CommandList *cmdsLists[] = {mCommandList.Get()};
     mCommandQueue->ExecuteCommandLists(_countof(cmdsLists), cmdsLists);
 
-    // Wait until resize is complete.
-    FlushCommandQueue();
+    // 不必等待这些命令执行完毕：之后提交的命令在队列中都排在它们后面，
+    // 而下一次 OnResize 开始时仍会等待 GPU 空闲，之后才会改动这些资源
+    SignalFence();
 
     // --------- 设置视口（viewport）
     mScreenViewport.TopLeftX = 0;
@@ -644,6 +874,9 @@ LRESULT D3DApp::MsgProc(HWND hwnd, UINT msg, WPARAM wParam, LPARAM lParam)
 
     // WM_SIZE is sent when the user resizes the window.
     case WM_SIZE:
+        // 模拟线程会读取工作区的大小
+        if (mFramePipeline != nullptr)
+            mFramePipeline->WaitIdle();
         // Save the new client area dimensions.
         mClientWidth = LOWORD(lParam);
         mClientHeight = HIWORD(lParam);
@@ -1,10 +1,20 @@
 #pragma once
 
+#include "CommandListPool.h"
+#include "DeferredReleaseQueue.h"
+#include "DescriptorHeap.h"
+#include "FramePipeline.h"
 #include "GameTimer.h"
+#include "GpuHeapAllocator.h"
+#include "HeadlessFrameLoop.h"
+#include "NullCommandBackend.h"
+#include "PipelineStateCache.h"
+#include "ShaderHotReload.h"
 #include "d3dUtil.h"
 #include "d3dx12.h"
 #include <d3d12.h>
 #include <dxgi1_4.h>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
@@ -36,6 +46,20 @@ class D3DApp
     // 它使用的是 Win32 的 PeekMessage 函数，当没有窗口消息到来时就会处理我们的游戏逻辑部分。
     int Run(); // 运行程序，进行游戏主循环
 
+    // 无窗口运行：不创建窗口与交换链，以固定或录制的时间差逐帧调用 Update/Draw，
+    // 派生类的 Draw 应把命令流交给 mNullBackend 校验而不是提交给 GPU。
+    // 必须在 Initialize 之前调用 SetHeadless(true)
+    void SetHeadless(bool headless);
+    bool IsHeadless() const
+    {
+        return mHeadless;
+    }
+    // 运行 options 指定的帧数并把逐帧的 CPU 耗时写入 options.TimingFile，成功时返回 0
+    int RunHeadless(const HeadlessFrameLoop::Options &options);
+
+    // 程序的命令行参数（不含程序名）
+    static std::vector<std::wstring> CommandLineArguments();
+
     virtual bool Initialize();
     // 该方法用于实现应用程序主窗口的窗口过程函数（procedure function）。一般来说，
     //如 果需要处理在 D3DApp::MsgProc 中没有得到处理（或者不能如我们所愿进行处理）的消息，
@@ -59,6 +83,11 @@ class D3DApp
     // （如投影矩阵，projection matrix）也要在此做相应的修改。
     // 由于在调整窗口大小时，客户端代码可能还需执行一些它自己的逻辑代码，因此该方法亦属于框架的一部分。
     virtual void OnResize();
+    // 每一帧在主线程上、Update 之前调用，用于读取输入等只应在主线程上访问的状态。
+    // 开启帧流水线之后 Update 在模拟线程上执行，它用到的这类状态应当在这里复制一份
+    virtual void PrepareUpdate(const GameTimer &gt)
+    {
+    }
     // 在绘制每一帧时都会调用该抽象方法，我们通过它来随着时间的推移而更新 3D 应用
     // 程序（如呈现动画、移动摄像机、做碰撞检测以及检查用户的输入等）。
     virtual void Update(const GameTimer &gt) = 0;
@@ -86,10 +115,40 @@ class D3DApp
     // 依 4.3.4 节中所述的流程创建命令队列、命令列表分配器和命令列表。
     void CreateCommandObjects();
     void CreateSwapChain(); // 创建交换链（参见 4.3.5 节）。
+    // 无窗口运行时没有交换链，创建同样大小与格式的纹理代替后台缓冲区
+    void CreateHeadlessBackBuffers();
 
     // 强制 CPU 等待 GPU，直到 GPU 处理完队列中所有的命令（详见 4.2.2 节）
     void FlushCommandQueue();
 
+    // 向命令队列中添加一个新的围栏点并返回其围栏值，CPU 并不等待
+    UINT64 SignalFence();
+
+    // 把对象的释放推迟到 GPU 执行完目前已提交的全部命令之后，从而不必为了释放资源而调用 FlushCommandQueue
+    void DeferRelease(Microsoft::WRL::ComPtr<IUnknown> object);
+    void DeferFree(GpuHeapAllocator::Allocation &allocation);
+    // 同上，GPU 用完之后调用 release 执行清理
+    void DeferRelease(std::function<void()> release);
+
+    // 释放 GPU 已经用完的延迟对象。Run 在每一帧开始时都会调用
+    void ReleaseCompletedResources();
+
+    // 开启帧流水线（见 FramePipeline）：Run 在模拟线程上调用 Update 准备第 N+1 帧，同时在主线程上调用 Draw 记录第 N 帧。
+    // slotCount 为帧资源的数量。Update 只能写入 mSimulationSlot 对应的帧资源，Draw 只能读取 mRenderSlot 对应的帧资源，
+    // 两者之间共享的其他可变状态需要经由 PrepareUpdate 在主线程上传递。派生类析构时应先等待流水线空闲。
+    // 应在 Initialize 中调用；第一帧的模拟由 Run/RunHeadless 在进入帧循环之前开始
+    void EnableFramePipeline(UINT slotCount);
+    // 每帧的两个阶段，Run 与 RunHeadless 依次调用：
+    // 未开启帧流水线时依次调用 PrepareUpdate 与 Update；开启后等待本帧的模拟完成并开始下一帧的模拟
+    void RunUpdateStage();
+    // 调用 Draw，开启帧流水线时随后把本帧的槽位归还
+    void RunDrawStage();
+    // 在主线程上调用 PrepareUpdate，再用计时器此刻的副本在模拟线程上开始下一帧的 Update
+    void BeginSimulation();
+    // 开启了帧流水线时开始第一帧的模拟。Run/RunHeadless 在计时器重置之后、进入帧循环之前调用一次：
+    // 此时派生类的 Initialize 已经结束，模拟线程上的 Update 不会与初始化争用成员
+    void StartFramePipeline();
+
     // 返回交换链中当前后台缓冲区的 ID3D12Resource
     ID3D12Resource *CurrentBackBuffer() const
     {
@@ -99,16 +158,14 @@ class D3DApp
     // 返回当前后台缓冲区的 RTV（渲染目标视图，render target view）
     D3D12_CPU_DESCRIPTOR_HANDLE CurrentBackBufferView() const
     {
-        // CD3DX12 构造函数根据给定的偏移量找到当前后台缓冲区的 RTV
-        return CD3DX12_CPU_DESCRIPTOR_HANDLE(mRtvHeap->GetCPUDescriptorHandleForHeapStart(), // 堆中的首个句柄
-                                             mCurrBackBuffer,     // 偏移至后台缓冲区描述符句柄的索引
-                                             mRtvDescriptorSize); // 描述符所占字节的大小
+        // 描述符堆根据描述符的索引与描述符所占字节的大小找到当前后台缓冲区的 RTV
+        return mRtvHeap->CpuHandle(mSwapChainRtvIndex + mCurrBackBuffer);
     }
 
     // 返回主深度/模板缓冲区的 DSV（深度/模板视图，depth/stencil view）
     D3D12_CPU_DESCRIPTOR_HANDLE DepthStencilView() const
     {
-        return mDsvHeap->GetCPUDescriptorHandleForHeapStart();
+        return mDsvHeap->CpuHandle(mDepthStencilDsvIndex);
     }
 
     // 计算每秒的平均帧数以及每帧平均的毫秒时长。实现方法将在 4.5.4 节中讨论。
@@ -130,6 +187,7 @@ class D3DApp
     bool mMaximized = false;       // 应用程序是否最大化
     bool mResizing = false;        // 大小调整栏是否受到拖拽
     bool mFullscreenState = false; // 是否开启全屏模式
+    bool mHeadless = false;        // 是否无窗口运行
 
     // 若将该选项设置为 true，则使用 4X MSAA 技术(参见 4.1.8 节)。默认值为 false
     bool m4xMsaaState = false; // 是否开启 4X MSAA
@@ -146,12 +204,37 @@ class D3DApp
     ComPtr<IDXGISwapChain> mSwapChain;
     ComPtr<ID3D12Device> md3dDevice;
 
+    // 深度/模板缓冲区等资源从它管理的大块堆中分配，而不是各自创建一个提交资源
+    std::unique_ptr<GpuHeapAllocator> mHeapAllocator;
+
+    // 以管线描述的哈希值为键缓存 PSO，并在退出时把新编译的 PSO 写入磁盘
+    std::unique_ptr<PipelineStateCache> mPipelineCache;
+
+    // 着色器源文件修改后在后台重新编译并重新创建 PSO，Run 在每一帧开始时换入。
+    // 派生类注册的管线创建函数通常会访问派生类的成员，派生类析构时应先调用 WaitIdle
+    std::unique_ptr<ShaderHotReload> mShaderReload;
+
+    // 无窗口运行时代替 GPU 执行命令流，只校验与统计命令
+    std::unique_ptr<NullCommandBackend> mNullBackend;
+
+    // 模拟与渲染两级流水线，未开启时为空
+    std::unique_ptr<FramePipeline> mFramePipeline;
+    // Update 正在准备的帧资源序号，只由执行 Update 的线程访问
+    UINT mSimulationSlot = 0;
+    // Draw 正在记录的帧资源序号
+    UINT mRenderSlot = 0;
+
+    // 等待 GPU 执行到相应围栏点之后才释放的对象
+    DeferredReleaseQueue<std::function<void()>> mDeferredReleases;
+
     ComPtr<ID3D12Fence> mFence;
     UINT64 mCurrentFence = 0;
 
     ComPtr<ID3D12CommandQueue> mCommandQueue;
     ComPtr<ID3D12CommandAllocator> mDirectCmdListAlloc;
     ComPtr<ID3D12GraphicsCommandList> mCommandList;
+    // 每帧绘制所用的命令分配器与命令列表从这里取出，可以在多个线程上同时记录
+    std::unique_ptr<CommandListPool> mCommandListPool;
 
     static const int SwapChainBufferCount = 2;
     // 用来记录当前后台缓冲区的索引（由于利用页面翻转技术来交换前台缓冲区和后台缓冲区，
@@ -160,10 +243,14 @@ class D3DApp
     // ID3D12Resource 接口将物理内存与堆资源抽象组织为可处理的数据数组与多维数据，从而使 CPU 与 GPU
     // 可以对这些资源进行读写。
     ComPtr<ID3D12Resource> mSwapChainBuffer[SwapChainBufferCount];
-    ComPtr<ID3D12Resource> mDepthStencilBuffer;
-
-    ComPtr<ID3D12DescriptorHeap> mRtvHeap;
-    ComPtr<ID3D12DescriptorHeap> mDsvHeap;
+    GpuHeapAllocator::Allocation mDepthStencilBuffer;
+
+    // RTV 与 DSV 描述符由分配器管理，派生类可以从中为自己的渲染目标再分配描述符
+    std::unique_ptr<DescriptorHeap> mRtvHeap;
+    std::unique_ptr<DescriptorHeap> mDsvHeap;
+    // 交换链各缓冲区的 RTV 是从 mSwapChainRtvIndex 开始的连续 SwapChainBufferCount 个描述符
+    UINT mSwapChainRtvIndex = 0;
+    UINT mDepthStencilDsvIndex = 0;
 
     D3D12_VIEWPORT mScreenViewport;
 
@@ -0,0 +1,127 @@
+#include "D3DShaderCompiler.h"
+#include "Hash.h"
+#include "d3dUtil.h"
+#include <filesystem>
+#include <list>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+bool ReadSource(const std::filesystem::path &path, std::string &source)
+{
+    std::ifstream fin(path, std::ios::binary);
+    if (!fin)
+        return false;
+    source.assign(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// 按文件所在目录解析 #include，并记录读取过的文件及交给编译器的内容的哈希
+class RecordingInclude : public ID3DInclude
+{
+  public:
+    RecordingInclude(const std::filesystem::path &mainFile, std::vector<ShaderDependency> &dependencies)
+        : mMainDirectory(mainFile.parent_path()), mDependencies(dependencies)
+    {
+    }
+
+    HRESULT __stdcall Open(D3D_INCLUDE_TYPE includeType, LPCSTR fileName, LPCVOID parentData, LPCVOID *data,
+                           UINT *bytes) override
+    {
+        // 从包含者所在的目录开始查找，顶层文件的包含者就是主文件
+        std::filesystem::path directory = mMainDirectory;
+        for (const File &file : mFiles)
+        {
+            if (file.Source.data() == parentData)
+            {
+                directory = file.Path.parent_path();
+                break;
+            }
+        }
+
+        File file;
+        file.Path = (directory / fileName).lexically_normal();
+        if (!ReadSource(file.Path, file.Source))
+            return E_FAIL;
+
+        mDependencies.push_back({file.Path.wstring(), Hasher::Hash(file.Source.data(), file.Source.size())});
+        // std::list 中的元素地址不变，编译器持有的指针一直有效
+        mFiles.push_back(std::move(file));
+        *data = mFiles.back().Source.data();
+        *bytes = static_cast<UINT>(mFiles.back().Source.size());
+        return S_OK;
+    }
+
+    HRESULT __stdcall Close(LPCVOID data) override
+    {
+        // 编译结束时统一释放
+        return S_OK;
+    }
+
+  private:
+    struct File
+    {
+        std::filesystem::path Path;
+        std::string Source;
+    };
+
+    std::filesystem::path mMainDirectory;
+    std::vector<ShaderDependency> &mDependencies;
+    std::list<File> mFiles;
+};
+} // namespace
+
+ShaderCompileResult D3DShaderCompiler::Compile(const ShaderCompileRequest &request)
+{
+    ShaderCompileResult result;
+
+    const std::filesystem::path path = std::filesystem::path(request.FileName).lexically_normal();
+    std::string source;
+    if (!ReadSource(path, source))
+    {
+        result.Errors = "cannot open shader source " + path.string();
+        return result;
+    }
+    result.Dependencies.push_back({path.wstring(), Hasher::Hash(source.data(), source.size())});
+
+    // D3D_SHADER_MACRO 数组以两个空指针结尾
+    std::vector<D3D_SHADER_MACRO> macros;
+    for (const auto &define : request.Defines)
+        macros.push_back({define.first.c_str(), define.second.c_str()});
+    macros.push_back({nullptr, nullptr});
+
+    RecordingInclude include(path, result.Dependencies);
+    ComPtr<ID3DBlob> byteCode;
+    ComPtr<ID3DBlob> errors;
+    HRESULT hr = D3DCompile(source.data(), source.size(), path.string().c_str(), macros.data(),
+                            // 代替 D3D_COMPILE_STANDARD_FILE_INCLUDE，额外记录被包含的文件
+                            &include,
+                            // 着色器的入口点函数名。一个.hlsl 文件可能存有多个着色器程序
+                            // （例如，一个顶点着色器和一个像素着色器），所以我们需要为待编译的着色器指定入口点。
+                            request.EntryPoint.c_str(),
+                            // 指定所用着色器类型和版本的字符串，例如 vs_5_1、ps_5_1。
+                            request.Target.c_str(),
+                            // 指示对着色器代码应当如何编译的标志，例如 D3DCOMPILE_DEBUG 与 D3DCOMPILE_SKIP_OPTIMIZATION。
+                            request.Flags,
+                            // 我们不会用到处理效果文件的高级编译选项
+                            0,
+                            // 编译好的着色器对象字节码，以及编译过程中的报错信息
+                            &byteCode, &errors);
+
+    if (errors != nullptr)
+        result.Errors.assign(static_cast<const char *>(errors->GetBufferPointer()), errors->GetBufferSize());
+    if (FAILED(hr))
+        return result;
+
+    const auto *bytes = static_cast<const std::uint8_t *>(byteCode->GetBufferPointer());
+    result.Bytecode.assign(bytes, bytes + byteCode->GetBufferSize());
+    result.Succeeded = true;
+    return result;
+}
+
+std::uint64_t D3DShaderCompiler::Version() const
+{
+    // 升级 d3dcompiler 之后旧的字节码全部失效
+    return D3D_COMPILER_VERSION;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "ShaderCache.h"
+
+// 用 D3DCompile 实现的 ShaderCompiler
+// 与 D3D_COMPILE_STANDARD_FILE_INCLUDE 一样，#include 的文件相对于包含它的文件所在的目录查找，
+// 同时记录下读取的每个文件及交给编译器的内容的哈希，供 ShaderCache 判断缓存是否过期
+class D3DShaderCompiler : public ShaderCompiler
+{
+  public:
+    ShaderCompileResult Compile(const ShaderCompileRequest &request) override;
+
+    std::uint64_t Version() const override;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <type_traits>
+#include <utility>
+
+// 以围栏值延迟释放对象的队列
+// GPU 可能仍在使用的资源不能立即释放。与其调用 FlushCommandQueue 让 CPU 等待 GPU 空闲，不如把资源连同
+// 一个围栏值放入队列：GPU 执行到该围栏点之后，Release 才会销毁它们。
+// 队列本身不依赖 Direct3D，T 可以是 ComPtr、GpuHeapAllocator::Allocation 之类的任意可移动类型；
+// 若 T 可以调用（例如 std::function<void()>），释放时会先调用它，便于执行需要额外上下文的清理操作。
+template <typename T>
+class DeferredReleaseQueue
+{
+  public:
+    using uint64 = std::uint64_t;
+
+    DeferredReleaseQueue() = default;
+    DeferredReleaseQueue(const DeferredReleaseQueue &rhs) = delete;
+    DeferredReleaseQueue &operator=(const DeferredReleaseQueue &rhs) = delete;
+
+    // 围栏值必须单调不减
+    void Enqueue(uint64 fenceValue, T item)
+    {
+        assert(mEntries.empty() || mEntries.back().FenceValue <= fenceValue);
+        mEntries.push_back(Entry{fenceValue, std::move(item)});
+    }
+
+    // 释放所有围栏值不大于 completedFenceValue 的对象，返回释放的数量
+    size_t Release(uint64 completedFenceValue)
+    {
+        size_t count = 0;
+        while (!mEntries.empty() && mEntries.front().FenceValue <= completedFenceValue)
+        {
+            // 先移出队列再释放，释放过程中可以安全地向队列追加新的对象
+            T item = std::move(mEntries.front().Item);
+            mEntries.pop_front();
+            Destroy(item);
+            ++count;
+        }
+        return count;
+    }
+
+    // 不论围栏值，释放全部对象。调用者要保证 GPU 已经空闲
+    size_t ReleaseAll()
+    {
+        size_t count = 0;
+        while (!mEntries.empty())
+        {
+            T item = std::move(mEntries.front().Item);
+            mEntries.pop_front();
+            Destroy(item);
+            ++count;
+        }
+        return count;
+    }
+
+    size_t Size() const
+    {
+        return mEntries.size();
+    }
+
+    bool Empty() const
+    {
+        return mEntries.empty();
+    }
+
+    // 队列中最早的围栏值，队列为空时返回 0
+    uint64 OldestFenceValue() const
+    {
+        return mEntries.empty() ? 0 : mEntries.front().FenceValue;
+    }
+
+  private:
+    struct Entry
+    {
+        uint64 FenceValue;
+        T Item;
+    };
+
+    static void Destroy(T &item)
+    {
+        if constexpr (std::is_invocable_v<T &>)
+        {
+            if constexpr (std::is_constructible_v<bool, T &>)
+            {
+                if (!item)
+                    return;
+            }
+            item();
+        }
+    }
+
+  private:
+    std::deque<Entry> mEntries;
+};
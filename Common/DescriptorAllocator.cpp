@@ -0,0 +1,161 @@
+#include "DescriptorAllocator.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+std::uint32_t LowestBit(std::uint64_t value)
+{
+    assert(value != 0);
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<std::uint32_t>(index);
+#else
+    return static_cast<std::uint32_t>(__builtin_ctzll(value));
+#endif
+}
+} // namespace
+
+DescriptorAllocator::DescriptorAllocator(uint32 capacity, uint32 transientCapacity)
+    : mCapacity(capacity), mTransient(std::max<uint32>(transientCapacity, 1))
+{
+    assert(transientCapacity <= capacity);
+
+    mStats.PersistentCapacity = capacity - transientCapacity;
+    mStats.TransientCapacity = transientCapacity;
+
+    uint32 persistentCapacity = mStats.PersistentCapacity;
+    mBitmap.assign((persistentCapacity + 63) / 64, 0);
+    // 最后一个字中超出容量的位标记为已占用，查找时就不必再检查边界
+    if (persistentCapacity % 64 != 0)
+        mBitmap.back() = ~0ull << (persistentCapacity % 64);
+}
+
+DescriptorAllocator::uint32 DescriptorAllocator::FindFreeRun(uint32 count) const
+{
+    const uint32 wordCount = (uint32)mBitmap.size();
+
+    // mSearchHint 之前的字都已占满，从它开始首次适配
+    uint32 runStart = 0;
+    uint32 runLength = 0;
+    for (uint32 w = mSearchHint; w < wordCount; ++w)
+    {
+        const uint64 used = mBitmap[w];
+        if (used == ~0ull)
+        {
+            runLength = 0;
+            continue;
+        }
+
+        // 依次取出这个字中的每一段连续空闲位，第 0 位开始的空闲段可以接上前一个字末尾的空闲段
+        uint32 bit = 0;
+        while (bit < 64)
+        {
+            const uint64 freeBits = ~used >> bit;
+            if (freeBits == 0)
+            {
+                runLength = 0;
+                break;
+            }
+
+            const uint32 start = bit + LowestBit(freeBits);
+            if (start != bit)
+                runLength = 0;
+            const uint64 usedAfter = used >> start;
+            const uint32 length = usedAfter == 0 ? 64 - start : LowestBit(usedAfter);
+
+            if (runLength == 0)
+                runStart = w * 64 + start;
+            runLength += length;
+            if (runLength >= count)
+                return runStart;
+
+            bit = start + length;
+        }
+    }
+    return InvalidIndex;
+}
+
+void DescriptorAllocator::SetBits(uint32 index, uint32 count, bool used)
+{
+    uint32 end = index + count;
+    while (index < end)
+    {
+        uint32 w = index / 64;
+        uint32 bit = index % 64;
+        uint32 bits = std::min(64 - bit, end - index);
+        uint64 mask = (bits == 64 ? ~0ull : ((1ull << bits) - 1)) << bit;
+
+        assert(used ? (mBitmap[w] & mask) == 0 : (mBitmap[w] & mask) == mask);
+        if (used)
+            mBitmap[w] |= mask;
+        else
+            mBitmap[w] &= ~mask;
+        index += bits;
+    }
+}
+
+DescriptorAllocator::uint32 DescriptorAllocator::Allocate(uint32 count)
+{
+    assert(count > 0);
+
+    uint32 index = FindFreeRun(count);
+    if (index == InvalidIndex)
+    {
+        ++mStats.FailedAllocations;
+        return InvalidIndex;
+    }
+
+    SetBits(index, count, true);
+    // 单个描述符总是分配在第一个未满的字中，它之前的字都已占满
+    if (count == 1)
+        mSearchHint = index / 64;
+
+    mStats.PersistentUsed += count;
+    mStats.PersistentPeak = std::max(mStats.PersistentPeak, mStats.PersistentUsed);
+    return index;
+}
+
+void DescriptorAllocator::Free(uint32 index, uint32 count, uint64 fenceValue)
+{
+    assert(index + count <= mStats.PersistentCapacity);
+    mStats.PendingFree += count;
+    mPendingFrees.Enqueue(fenceValue, PendingFree{this, index, count});
+}
+
+void DescriptorAllocator::FreeNow(uint32 index, uint32 count)
+{
+    SetBits(index, count, false);
+    mSearchHint = std::min(mSearchHint, index / 64);
+    mStats.PendingFree -= count;
+    mStats.PersistentUsed -= count;
+}
+
+DescriptorAllocator::uint32 DescriptorAllocator::AllocateTransient(uint32 count)
+{
+    assert(count > 0);
+
+    uint64 offset = mStats.TransientCapacity > 0 ? mTransient.Allocate(count, 1) : StagingArena::InvalidOffset;
+    if (offset == StagingArena::InvalidOffset)
+    {
+        ++mStats.FailedAllocations;
+        return InvalidIndex;
+    }
+
+    mStats.TransientUsed = static_cast<uint32>(mTransient.UsedBytes());
+    mStats.TransientPeak = std::max(mStats.TransientPeak, mStats.TransientUsed);
+    return mStats.PersistentCapacity + static_cast<uint32>(offset);
+}
+
+void DescriptorAllocator::RetireFrame(uint64 fenceValue)
+{
+    mTransient.Retire(fenceValue);
+}
+
+void DescriptorAllocator::ReleaseCompleted(uint64 completedFenceValue)
+{
+    mPendingFrees.Release(completedFenceValue);
+    mTransient.Release(completedFenceValue);
+    mStats.TransientUsed = static_cast<uint32>(mTransient.UsedBytes());
+}
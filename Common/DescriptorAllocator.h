@@ -0,0 +1,90 @@
+#pragma once
+
+#include "DeferredReleaseQueue.h"
+#include "StagingArena.h"
+#include <cstdint>
+#include <vector>
+
+// 描述符堆的分配器
+// 原先描述符堆的大小在创建时就固定下来，应用程序手工计算每个描述符的偏移量，无法动态地分配与释放描述符。
+// DescriptorAllocator 把一个描述符堆分为两部分：
+//   [0, persistentCapacity)          常驻描述符，用位图记录占用情况，可以分配任意长度的连续区间（描述符表）；
+//   [persistentCapacity, capacity)  临时描述符，每帧从环形区间中线性分配，整帧一起以围栏值回收。
+// 常驻描述符释放时同样要等 GPU 执行完引用它的命令，所以 Free 需要给出围栏值，由 ReleaseCompleted 统一回收。
+// 这里只管理索引，不涉及任何 Direct3D 对象，由 DescriptorHeap 把索引换算为描述符句柄。
+class DescriptorAllocator
+{
+  public:
+    using uint32 = std::uint32_t;
+    using uint64 = std::uint64_t;
+
+    static const uint32 InvalidIndex = ~0u;
+
+    struct Statistics
+    {
+        uint32 PersistentCapacity = 0;
+        uint32 PersistentUsed = 0;
+        uint32 PersistentPeak = 0;
+        // 已调用 Free 但围栏尚未完成的描述符数
+        uint32 PendingFree = 0;
+        uint32 TransientCapacity = 0;
+        uint32 TransientUsed = 0;
+        uint32 TransientPeak = 0;
+        uint32 FailedAllocations = 0;
+    };
+
+    DescriptorAllocator(uint32 capacity, uint32 transientCapacity);
+    DescriptorAllocator(const DescriptorAllocator &rhs) = delete;
+    DescriptorAllocator &operator=(const DescriptorAllocator &rhs) = delete;
+
+    // 分配 count 个连续的常驻描述符，返回第一个描述符的索引，空间不足时返回 InvalidIndex
+    uint32 Allocate(uint32 count = 1);
+    // GPU 到达 fenceValue 之后，[index, index + count) 可以重新分配
+    void Free(uint32 index, uint32 count, uint64 fenceValue);
+
+    // 为当前帧分配 count 个连续的临时描述符，空间不足时返回 InvalidIndex
+    uint32 AllocateTransient(uint32 count = 1);
+    // 当前帧分配的临时描述符将在 GPU 到达 fenceValue（即 FrameResource::Fence）之后回收
+    void RetireFrame(uint64 fenceValue);
+
+    // 回收围栏值不大于 completedFenceValue 的常驻描述符与临时描述符
+    void ReleaseCompleted(uint64 completedFenceValue);
+
+    uint32 Capacity() const
+    {
+        return mCapacity;
+    }
+
+    const Statistics &GetStatistics() const
+    {
+        return mStats;
+    }
+
+  private:
+    // 延迟释放的常驻描述符区间，释放时把位图中对应的位清零
+    struct PendingFree
+    {
+        DescriptorAllocator *Owner;
+        uint32 Index;
+        uint32 Count;
+
+        void operator()() const
+        {
+            Owner->FreeNow(Index, Count);
+        }
+    };
+
+    uint32 FindFreeRun(uint32 count) const;
+    void SetBits(uint32 index, uint32 count, bool used);
+    void FreeNow(uint32 index, uint32 count);
+
+  private:
+    uint32 mCapacity;
+    // 每一位对应一个常驻描述符，1 表示已占用；超出容量的位始终为 1
+    std::vector<uint64> mBitmap;
+    // 在这个字之前的字都已占满，查找从这里开始
+    uint32 mSearchHint = 0;
+    StagingArena mTransient;
+    DeferredReleaseQueue<PendingFree> mPendingFrees;
+    Statistics mStats;
+};
@@ -0,0 +1,53 @@
+#include "DescriptorHeap.h"
+
+DescriptorHeap::DescriptorHeap(ID3D12Device *device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32 capacity,
+                               uint32 transientCapacity, bool shaderVisible)
+    : mAllocator(capacity, transientCapacity), mShaderVisible(shaderVisible)
+{
+    assert(device != nullptr && capacity > 0);
+    // 只有 CBV/SRV/UAV 与采样器堆可以对着色器可见
+    assert(!shaderVisible || type == D3D12_DESCRIPTOR_HEAP_TYPE_CBV_SRV_UAV || type == D3D12_DESCRIPTOR_HEAP_TYPE_SAMPLER);
+
+    D3D12_DESCRIPTOR_HEAP_DESC heapDesc;
+    heapDesc.NumDescriptors = capacity;
+    heapDesc.Type = type;
+    heapDesc.Flags = shaderVisible ? D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE : D3D12_DESCRIPTOR_HEAP_FLAG_NONE;
+    heapDesc.NodeMask = 0;
+    ThrowIfFailed(device->CreateDescriptorHeap(&heapDesc, IID_PPV_ARGS(mHeap.GetAddressOf())));
+
+    mDescriptorSize = device->GetDescriptorHandleIncrementSize(type);
+    mCpuStart = mHeap->GetCPUDescriptorHandleForHeapStart();
+    if (shaderVisible)
+        mGpuStart = mHeap->GetGPUDescriptorHandleForHeapStart();
+}
+
+DescriptorHeap::uint32 DescriptorHeap::Allocate(uint32 count)
+{
+    uint32 index = mAllocator.Allocate(count);
+    if (index == DescriptorAllocator::InvalidIndex)
+        ThrowIfFailed(E_OUTOFMEMORY);
+    return index;
+}
+
+void DescriptorHeap::Free(uint32 index, uint32 count, UINT64 fenceValue)
+{
+    mAllocator.Free(index, count, fenceValue);
+}
+
+DescriptorHeap::uint32 DescriptorHeap::AllocateTransient(uint32 count)
+{
+    uint32 index = mAllocator.AllocateTransient(count);
+    if (index == DescriptorAllocator::InvalidIndex)
+        ThrowIfFailed(E_OUTOFMEMORY);
+    return index;
+}
+
+void DescriptorHeap::RetireFrame(UINT64 fenceValue)
+{
+    mAllocator.RetireFrame(fenceValue);
+}
+
+void DescriptorHeap::ReleaseCompleted(UINT64 completedFenceValue)
+{
+    mAllocator.ReleaseCompleted(completedFenceValue);
+}
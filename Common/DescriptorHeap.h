@@ -0,0 +1,56 @@
+#pragma once
+
+#include "DescriptorAllocator.h"
+#include "d3dUtil.h"
+
+// 由 DescriptorAllocator 管理的描述符堆
+// 把分配器返回的索引换算为 CPU/GPU 描述符句柄，应用程序不必再手工计算偏移量
+class DescriptorHeap
+{
+  public:
+    using uint32 = DescriptorAllocator::uint32;
+
+    // transientCapacity 个描述符留作每帧的临时描述符，其余为常驻描述符。
+    // 只有着色器可见的堆才能取得 GPU 句柄
+    DescriptorHeap(ID3D12Device *device, D3D12_DESCRIPTOR_HEAP_TYPE type, uint32 capacity,
+                   uint32 transientCapacity = 0, bool shaderVisible = false);
+    DescriptorHeap(const DescriptorHeap &rhs) = delete;
+    DescriptorHeap &operator=(const DescriptorHeap &rhs) = delete;
+
+    // 分配失败时抛出异常：描述符堆的容量应在创建时按需求给足
+    uint32 Allocate(uint32 count = 1);
+    void Free(uint32 index, uint32 count, UINT64 fenceValue);
+    uint32 AllocateTransient(uint32 count = 1);
+    void RetireFrame(UINT64 fenceValue);
+    void ReleaseCompleted(UINT64 completedFenceValue);
+
+    D3D12_CPU_DESCRIPTOR_HANDLE CpuHandle(uint32 index) const
+    {
+        assert(index < mAllocator.Capacity());
+        return CD3DX12_CPU_DESCRIPTOR_HANDLE(mCpuStart, (INT)index, mDescriptorSize);
+    }
+
+    D3D12_GPU_DESCRIPTOR_HANDLE GpuHandle(uint32 index) const
+    {
+        assert(mShaderVisible && index < mAllocator.Capacity());
+        return CD3DX12_GPU_DESCRIPTOR_HANDLE(mGpuStart, (INT)index, mDescriptorSize);
+    }
+
+    ID3D12DescriptorHeap *Heap() const
+    {
+        return mHeap.Get();
+    }
+
+    const DescriptorAllocator::Statistics &GetStatistics() const
+    {
+        return mAllocator.GetStatistics();
+    }
+
+  private:
+    Microsoft::WRL::ComPtr<ID3D12DescriptorHeap> mHeap;
+    DescriptorAllocator mAllocator;
+    D3D12_CPU_DESCRIPTOR_HANDLE mCpuStart = {};
+    D3D12_GPU_DESCRIPTOR_HANDLE mGpuStart = {};
+    UINT mDescriptorSize = 0;
+    bool mShaderVisible;
+};
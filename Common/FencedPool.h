@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// 以围栏值回收对象的对象池
+// 命令分配器之类的对象在 GPU 执行完相关命令之前不能复用。对象被 Retire 时记下其围栏值，之后的 Acquire
+// 只会取出围栏值已经完成的对象；没有可用的对象时调用 create 新建一个，因此池的大小会按需增长，而不受
+// 帧资源数量的限制。池本身不依赖 Direct3D（CommandListPool 在它之上管理命令分配器与命令列表），
+// 并且可以被多个线程同时使用。
+template <typename T>
+class FencedPool
+{
+  public:
+    using uint64 = std::uint64_t;
+
+    FencedPool() = default;
+    FencedPool(const FencedPool &rhs) = delete;
+    FencedPool &operator=(const FencedPool &rhs) = delete;
+
+    // 取出一个围栏值不大于 completedFenceValue 的对象；若没有，则以 create() 的返回值（std::unique_ptr<T>）新建一个。
+    // reused 表示取出的是否为复用的对象，调用者据此决定是否需要重置它
+    template <typename Create>
+    T *Acquire(uint64 completedFenceValue, Create &&create, bool &reused)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+
+            // 最早 Retire 的对象最可能已经完成，从前往后查找
+            for (size_t i = 0; i < mRetired.size(); ++i)
+            {
+                if (mRetired[i].FenceValue <= completedFenceValue)
+                {
+                    T *item = mRetired[i].Item;
+                    mRetired.erase(mRetired.begin() + i);
+                    OnAcquired();
+                    reused = true;
+                    return item;
+                }
+            }
+        }
+
+        // 新建对象可能比较耗时，不必持有锁
+        std::unique_ptr<T> created = create();
+        T *item = created.get();
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mItems.push_back(std::move(created));
+        OnAcquired();
+        reused = false;
+        return item;
+    }
+
+    // 归还对象，它将在 GPU 完成 fenceValue 之后才能再次被取出
+    void Retire(T *item, uint64 fenceValue)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        assert(mInUse > 0);
+        mRetired.push_back(RetiredItem{fenceValue, item});
+        --mInUse;
+    }
+
+    // 池中对象的总数
+    size_t Size() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mItems.size();
+    }
+
+    // 已取出且尚未归还的对象数
+    size_t InUse() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mInUse;
+    }
+
+    // 同时在用的对象数的峰值
+    size_t PeakInUse() const
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        return mPeakInUse;
+    }
+
+    // 清零峰值，例如在每次输出统计信息之后
+    void ResetPeak()
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mPeakInUse = mInUse;
+    }
+
+  private:
+    void OnAcquired()
+    {
+        ++mInUse;
+        if (mInUse > mPeakInUse)
+            mPeakInUse = mInUse;
+    }
+
+  private:
+    struct RetiredItem
+    {
+        uint64 FenceValue;
+        T *Item;
+    };
+
+    mutable std::mutex mMutex;
+    std::vector<std::unique_ptr<T>> mItems;
+    std::vector<RetiredItem> mRetired;
+    size_t mInUse = 0;
+    size_t mPeakInUse = 0;
+};
@@ -0,0 +1,43 @@
+#include "FileWatcher.h"
+
+void FileWatcher::Watch(const std::wstring &fileName)
+{
+    if (mFiles.find(fileName) == mFiles.end())
+        mFiles.emplace(fileName, Query(fileName));
+}
+
+void FileWatcher::Unwatch(const std::wstring &fileName)
+{
+    mFiles.erase(fileName);
+}
+
+std::vector<std::wstring> FileWatcher::Poll()
+{
+    std::vector<std::wstring> changed;
+    for (auto &item : mFiles)
+    {
+        Stamp stamp = Query(item.first);
+        if (!(stamp == item.second))
+        {
+            item.second = stamp;
+            changed.push_back(item.first);
+        }
+    }
+    return changed;
+}
+
+FileWatcher::Stamp FileWatcher::Query(const std::wstring &fileName)
+{
+    // 文件可能正被编辑器替换，查询失败按不存在处理，下次 Poll 时再次比较
+    Stamp stamp;
+    std::error_code error;
+    const std::filesystem::path path(fileName);
+    stamp.WriteTime = std::filesystem::last_write_time(path, error);
+    if (error)
+        return Stamp();
+    stamp.Size = std::filesystem::file_size(path, error);
+    if (error)
+        return Stamp();
+    stamp.Exists = true;
+    return stamp;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 轮询方式的文件监视
+// 记录每个文件的修改时间与大小，Poll 时逐个比较，返回发生变化（修改、创建或删除）的文件。
+// 监视的只是少量着色器源文件，每隔一段时间检查一次的开销可以忽略；与 ReadDirectoryChangesW 相比，
+// 它不需要额外的线程与窗口消息，也能在其他平台上使用。编辑器"写入临时文件再改名"的保存方式同样能被发现。
+class FileWatcher
+{
+  public:
+    // 开始监视文件并记录它当前的状态，文件可以暂时不存在。重复添加同一个文件不会重置它的状态
+    void Watch(const std::wstring &fileName);
+
+    void Unwatch(const std::wstring &fileName);
+
+    // 返回自上次 Poll（或开始监视）以来发生变化的文件，名字与 Watch 时的写法相同
+    std::vector<std::wstring> Poll();
+
+    size_t Size() const
+    {
+        return mFiles.size();
+    }
+
+  private:
+    struct Stamp
+    {
+        bool Exists = false;
+        std::filesystem::file_time_type WriteTime;
+        std::uintmax_t Size = 0;
+
+        bool operator==(const Stamp &rhs) const
+        {
+            return Exists == rhs.Exists && WriteTime == rhs.WriteTime && Size == rhs.Size;
+        }
+    };
+
+    static Stamp Query(const std::wstring &fileName);
+
+  private:
+    std::unordered_map<std::wstring, Stamp> mFiles;
+};
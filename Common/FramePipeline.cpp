@@ -0,0 +1,141 @@
+#include "FramePipeline.h"
+#include <cassert>
+#include <chrono>
+#include <utility>
+
+FramePipeline::FramePipeline(uint32 slotCount) : mSlots(slotCount)
+{
+    assert(slotCount > 0);
+    mThread = std::thread([this]() { ThreadLoop(); });
+}
+
+FramePipeline::~FramePipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mCondition.notify_all();
+    mThread.join();
+}
+
+void FramePipeline::BeginSimulation(Task task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        Slot &slot = mSlots[mNextSimulationSlot];
+        // 槽位还在渲染中（或尚未被渲染取走）时不能开始下一轮模拟，否则两方会同时访问同一个帧资源
+        assert(slot.State == Owner::Free && "the next frame slot has not been released by the renderer");
+
+        slot.State = Owner::Simulation;
+        slot.Frame = mNextFrame++;
+        slot.Work = std::move(task);
+        slot.Error = nullptr;
+        mQueue.push_back(mNextSimulationSlot);
+        mNextSimulationSlot = (mNextSimulationSlot + 1) % SlotCount();
+    }
+    mCondition.notify_all();
+}
+
+FramePipeline::uint32 FramePipeline::AcquireForRender()
+{
+    const auto waitBegin = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    const uint32 index = mNextRenderSlot;
+    Slot &slot = mSlots[index];
+    assert(slot.State == Owner::Simulation || slot.State == Owner::Ready);
+
+    mCondition.wait(lock, [&slot]() { return slot.State == Owner::Ready; });
+    mNextRenderSlot = (mNextRenderSlot + 1) % SlotCount();
+    mStats.RenderWaitMs +=
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitBegin).count();
+
+    if (slot.Error)
+    {
+        // 模拟失败的帧不能渲染，槽位直接归还
+        slot.State = Owner::Free;
+        std::exception_ptr error = std::move(slot.Error);
+        slot.Error = nullptr;
+        std::rethrow_exception(error);
+    }
+
+    slot.State = Owner::Render;
+    return index;
+}
+
+void FramePipeline::ReleaseFromRender(uint32 slot)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    assert(slot < SlotCount() && mSlots[slot].State == Owner::Render);
+    mSlots[slot].State = Owner::Free;
+    ++mStats.RenderedFrames;
+}
+
+void FramePipeline::WaitIdle()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    mCondition.wait(lock, [this]() { return mQueue.empty() && !mBusy; });
+}
+
+FramePipeline::uint32 FramePipeline::PendingFrames() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    uint32 count = 0;
+    for (const Slot &slot : mSlots)
+    {
+        if (slot.State == Owner::Simulation || slot.State == Owner::Ready)
+            ++count;
+    }
+    return count;
+}
+
+FramePipeline::Owner FramePipeline::GetOwner(uint32 slot) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    assert(slot < SlotCount());
+    return mSlots[slot].State;
+}
+
+FramePipeline::Statistics FramePipeline::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void FramePipeline::ThreadLoop()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        mCondition.wait(lock, [this]() { return mStopping || !mQueue.empty(); });
+        if (mQueue.empty())
+            return;
+
+        const uint32 index = mQueue.front();
+        mQueue.pop_front();
+        mBusy = true;
+
+        // 槽位处于模拟状态，只有本线程会访问它的任务
+        Task work = std::move(mSlots[index].Work);
+        const uint64 frame = mSlots[index].Frame;
+        std::exception_ptr error;
+        lock.unlock();
+        try
+        {
+            work(index, frame);
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+        work = nullptr;
+        lock.lock();
+
+        mSlots[index].Error = error;
+        mSlots[index].State = Owner::Ready;
+        ++mStats.SimulatedFrames;
+        mBusy = false;
+        mCondition.notify_all();
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 两级帧流水线：模拟线程准备第 N+1 帧的同时，调用线程（渲染）记录第 N 帧
+// 每一帧占用环中的一个槽位（对应一个帧资源），槽位的所有权按 空闲 -> 模拟 -> 就绪 -> 渲染 -> 空闲 的顺序显式转移：
+// BeginSimulation 把空闲的槽位交给模拟线程，模拟完成后槽位变为就绪，AcquireForRender 把它交给渲染，
+// ReleaseFromRender 再把它归还。同一时刻只有一方拥有某个槽位，模拟只写入自己拥有的帧资源，渲染只读取自己拥有的帧资源。
+// 这样每帧的耗时从 模拟 + 渲染 变为 max(模拟, 渲染)，代价是画面比输入多延迟一帧。
+//
+// 槽位归还之后 GPU 可能仍在使用对应的帧资源，模拟任务开始写入之前仍要按围栏等待，本类不依赖 Direct3D。
+// 模拟任务按开始的顺序在同一个线程上依次执行，其中抛出的异常在 AcquireForRender 中重新抛出。
+class FramePipeline
+{
+  public:
+    using uint32 = std::uint32_t;
+    using uint64 = std::uint64_t;
+    // 在模拟线程上调用，参数为槽位与帧序号（从 0 开始）
+    using Task = std::function<void(uint32 slot, uint64 frame)>;
+
+    enum class Owner
+    {
+        Free,
+        Simulation,
+        Ready,
+        Render
+    };
+
+    struct Statistics
+    {
+        uint64 SimulatedFrames = 0;
+        uint64 RenderedFrames = 0;
+        // AcquireForRender 等待模拟完成的总时间（毫秒）。模拟比渲染慢时它会增长
+        double RenderWaitMs = 0.0;
+    };
+
+    explicit FramePipeline(uint32 slotCount);
+    FramePipeline(const FramePipeline &rhs) = delete;
+    FramePipeline &operator=(const FramePipeline &rhs) = delete;
+    // 执行完已经开始的模拟任务之后结束模拟线程
+    ~FramePipeline();
+
+    uint32 SlotCount() const
+    {
+        return static_cast<uint32>(mSlots.size());
+    }
+
+    // 把环中的下一个槽位交给模拟线程执行 task，不等待它完成。这个槽位必须已经由渲染归还
+    void BeginSimulation(Task task);
+
+    // 等待最早开始模拟的一帧完成，把它的槽位交给调用者并返回槽位。
+    // 必须已经有开始模拟的帧；模拟任务抛出异常时槽位回到空闲状态，异常在这里重新抛出
+    uint32 AcquireForRender();
+
+    // 渲染完毕（命令已提交），把槽位归还给流水线
+    void ReleaseFromRender(uint32 slot);
+
+    // 等待已经开始的模拟全部完成，不改变槽位的所有权。调整窗口大小等会改变模拟所读取的状态的操作之前调用
+    void WaitIdle();
+
+    // 已经开始模拟、尚未交给渲染的帧数
+    uint32 PendingFrames() const;
+
+    Owner GetOwner(uint32 slot) const;
+
+    Statistics GetStatistics() const;
+
+  private:
+    struct Slot
+    {
+        Owner State = Owner::Free;
+        uint64 Frame = 0;
+        Task Work;
+        std::exception_ptr Error;
+    };
+
+    void ThreadLoop();
+
+  private:
+    mutable std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::vector<Slot> mSlots;
+    // 等待模拟的槽位，按开始的顺序排列
+    std::deque<uint32> mQueue;
+    bool mBusy = false;
+    bool mStopping = false;
+
+    uint32 mNextSimulationSlot = 0;
+    uint32 mNextRenderSlot = 0;
+    uint64 mNextFrame = 0;
+    Statistics mStats;
+
+    std::thread mThread;
+};
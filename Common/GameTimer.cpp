@@ -96,6 +96,14 @@ void GameTimer::Tick()
     }
 }
 
+void GameTimer::Advance(double deltaTime)
+{
+    mDeltaTime = deltaTime < 0.0 ? 0.0 : deltaTime;
+    // 总时间仍由计数换算而来，这里把时间差换算成计数累加到当前时刻上
+    mCurrTime = mPrevTime + (__int64)(mDeltaTime / mSecondsPerCount + 0.5);
+    mPrevTime = mCurrTime;
+}
+
 // 返回自调用 Reset 函数开始不计暂停时间的总时间
 float GameTimer::TotalTime() const
 {
@@ -17,6 +17,8 @@ public:
     void Start(); // 解除计时器暂停时调用
     void Stop();  // 暂停计时器时调用
     void Tick();  // 每帧都要调用
+    // 代替 Tick：以给定的时间差（秒）推进计时器，与真实经过的时间无关。无窗口运行时用它得到确定的帧序列
+    void Advance(double deltaTime);
 
 private:
     double mSecondsPerCount;
@@ -1,8 +1,63 @@
 #include "GeometryGenerator.h"
+#include "HeightField.h"
+#include "ThreadPool.h"
 #include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define GEOMETRY_GENERATOR_SSE2
+#endif
 
 using namespace DirectX;
 
+//
+// MeshData
+//
+
+GeometryGenerator::uint32 GeometryGenerator::MeshData::IndexByteSize() const
+{
+    auto maxIndex = std::max_element(Indices32.begin(), Indices32.end());
+    return (maxIndex == Indices32.end() || *maxIndex <= 0xffff) ? 2 : 4;
+}
+
+void GeometryGenerator::MeshData::CopyIndices(uint16 *dst) const
+{
+    const uint32 *src = Indices32.data();
+    const size_t count = Indices32.size();
+
+    // 超出范围的索引在 SIMD 路径中会饱和为 65535，在标量路径中会被截断，两者都会悄悄画错。
+    // 先检查范围，保证下面两条路径都只处理能精确表示的值
+    if (std::any_of(src, src + count, [](uint32 index) { return index > 0xffff; }))
+        throw std::out_of_range("GeometryGenerator::MeshData::CopyIndices: index does not fit in 16 bits");
+
+    size_t i = 0;
+
+#if defined(GEOMETRY_GENERATOR_SSE2)
+    // SSE2 只有带符号饱和的 32 -> 16 位打包指令。先减去 32768 把 [0, 65535] 平移到带符号 16 位的范围内，
+    // 打包后再把最高位翻转回来
+    const __m128i bias32 = _mm_set1_epi32(0x8000);
+    const __m128i bias16 = _mm_set1_epi16(static_cast<short>(0x8000));
+    for (; i + 8 <= count; i += 8)
+    {
+        __m128i lo = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i)), bias32);
+        __m128i hi = _mm_sub_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i + 4)), bias32);
+        __m128i packed = _mm_xor_si128(_mm_packs_epi32(lo, hi), bias16);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), packed);
+    }
+#endif
+
+    for (; i < count; ++i)
+        dst[i] = static_cast<uint16>(src[i]);
+}
+
+void GeometryGenerator::MeshData::CopyIndices(uint32 *dst) const
+{
+    if (!Indices32.empty())
+        std::memcpy(dst, Indices32.data(), Indices32.size() * sizeof(uint32));
+}
+
 GeometryGenerator::MeshData GeometryGenerator::CreateGeosphere(float radius, uint32 numSubdivisions)
 {
     MeshData meshData;
@@ -479,6 +534,12 @@ void GeometryGenerator::BuildCylinderBottomCap(float bottomRadius, float topRadi
 }
 
 GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n)
+{
+    return CreateGrid(width, depth, m, n, nullptr, nullptr);
+}
+
+GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float depth, uint32 m, uint32 n,
+                                                          const HeightField *heightField, ThreadPool *threadPool)
 {
     MeshData meshData;
 
@@ -499,45 +560,101 @@ GeometryGenerator::MeshData GeometryGenerator::CreateGrid(float width, float dep
     float dv = 1.0f / (m - 1);
 
     meshData.Vertices.resize(vertexCount);
-    for (uint32 i = 0; i < m; ++i)
-    {
-        float z = halfDepth - i * dz;
-        for (uint32 j = 0; j < n; ++j)
-        {
-            float x = -halfWidth + j * dx;
+    meshData.Indices32.resize(faceCount * 3); // 每个三角形面有 3 个索引
 
-            meshData.Vertices[i * n + j].Position = XMFLOAT3(x, 0.0f, z);
-            meshData.Vertices[i * n + j].Normal = XMFLOAT3(0.0f, 1.0f, 0.0f);
-            meshData.Vertices[i * n + j].TangentU = XMFLOAT3(1.0f, 0.0f, 0.0f);
+    // 各行顶点互不依赖，可以按行并行生成。行内每次计算 4 个顶点
+    auto buildVertexRows = [&](size_t rowBegin, size_t rowEnd) {
+        const XMVECTOR laneOffsets = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
 
-            // 在栅格上拉伸纹理。
-            meshData.Vertices[i * n + j].TexC.x = j * du;
-            meshData.Vertices[i * n + j].TexC.y = i * dv;
+        for (size_t i = rowBegin; i < rowEnd; ++i)
+        {
+            float z = halfDepth - i * dz;
+            float v = i * dv;
+            XMVECTOR zs = XMVectorReplicate(z);
+            Vertex *row = &meshData.Vertices[i * n];
+
+            for (uint32 j = 0; j < n; j += 4)
+            {
+                XMVECTOR columns = XMVectorAdd(XMVectorReplicate(static_cast<float>(j)), laneOffsets);
+                XMVECTOR xs = XMVectorAdd(XMVectorReplicate(-halfWidth), XMVectorMultiply(columns, XMVectorReplicate(dx)));
+                XMVECTOR us = XMVectorMultiply(columns, XMVectorReplicate(du));
+
+                XMVECTOR ys = XMVectorZero();
+                XMVECTOR nx = XMVectorZero();
+                XMVECTOR ny = XMVectorSplatOne();
+                XMVECTOR nz = XMVectorZero();
+                if (heightField != nullptr)
+                    heightField->Evaluate4(xs, zs, ys, nx, ny, nz);
+
+                // 切线沿 +x 方向：(1, df/dx, 0) 单位化，而 df/dx = -nx / ny
+                XMVECTOR invLength = XMVectorReciprocalSqrt(XMVectorMultiplyAdd(nx, nx, XMVectorMultiply(ny, ny)));
+                XMVECTOR tx = XMVectorMultiply(ny, invLength);
+                XMVECTOR ty = XMVectorNegate(XMVectorMultiply(nx, invLength));
+
+                XMFLOAT4 x4, y4, nx4, ny4, nz4, tx4, ty4, u4;
+                XMStoreFloat4(&x4, xs);
+                XMStoreFloat4(&y4, ys);
+                XMStoreFloat4(&nx4, nx);
+                XMStoreFloat4(&ny4, ny);
+                XMStoreFloat4(&nz4, nz);
+                XMStoreFloat4(&tx4, tx);
+                XMStoreFloat4(&ty4, ty);
+                XMStoreFloat4(&u4, us);
+
+                uint32 laneCount = std::min(4u, n - j);
+                for (uint32 k = 0; k < laneCount; ++k)
+                {
+                    Vertex &vertex = row[j + k];
+                    vertex.Position = XMFLOAT3((&x4.x)[k], (&y4.x)[k], z);
+                    vertex.Normal = XMFLOAT3((&nx4.x)[k], (&ny4.x)[k], (&nz4.x)[k]);
+                    vertex.TangentU = XMFLOAT3((&tx4.x)[k], (&ty4.x)[k], 0.0f);
+
+                    // 在栅格上拉伸纹理。
+                    vertex.TexC.x = (&u4.x)[k];
+                    vertex.TexC.y = v;
+                }
+            }
         }
-    }
+    };
 
     //
     // Create the indices.
     //
 
-    meshData.Indices32.resize(faceCount * 3); // 每个三角形面有 3 个索引
-
-    // 遍历每个四边形并计算索引
-    uint32 k = 0;
-    for (uint32 i = 0; i < m - 1; ++i)
-    {
-        for (uint32 j = 0; j < n - 1; ++j)
+    // 遍历每个四边形并计算索引。第 i 行四边形的索引从 i * (n - 1) * 6 处开始
+    auto buildIndexRows = [&](size_t rowBegin, size_t rowEnd) {
+        for (size_t i = rowBegin; i < rowEnd; ++i)
         {
-            meshData.Indices32[k] = i * n + j;
-            meshData.Indices32[k + 1] = i * n + j + 1;
-            meshData.Indices32[k + 2] = (i + 1) * n + j;
-
-            meshData.Indices32[k + 3] = (i + 1) * n + j;
-            meshData.Indices32[k + 4] = i * n + j + 1;
-            meshData.Indices32[k + 5] = (i + 1) * n + j + 1;
-
-            k += 6; // 下一个四边形
+            uint32 k = static_cast<uint32>(i) * (n - 1) * 6;
+            for (uint32 j = 0; j < n - 1; ++j)
+            {
+                uint32 i0 = static_cast<uint32>(i) * n + j;
+                uint32 i1 = i0 + n;
+
+                meshData.Indices32[k] = i0;
+                meshData.Indices32[k + 1] = i0 + 1;
+                meshData.Indices32[k + 2] = i1;
+
+                meshData.Indices32[k + 3] = i1;
+                meshData.Indices32[k + 4] = i0 + 1;
+                meshData.Indices32[k + 5] = i1 + 1;
+
+                k += 6; // 下一个四边形
+            }
         }
+    };
+
+    if (threadPool != nullptr)
+    {
+        // 每段约 16K 个顶点，既能摊薄调度开销，又能让各线程的负载保持均衡
+        size_t rowsPerChunk = std::max<size_t>(1, 16384 / n);
+        threadPool->ParallelFor(m, rowsPerChunk, buildVertexRows);
+        threadPool->ParallelFor(m - 1, rowsPerChunk, buildIndexRows);
+    }
+    else
+    {
+        buildVertexRows(0, m);
+        buildIndexRows(0, m - 1);
     }
 
     return meshData;
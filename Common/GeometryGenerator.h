@@ -4,6 +4,9 @@
 #include <cstdint>
 #include <vector>
 
+class HeightField;
+class ThreadPool;
+
 // 程序性几何体的生成代码
 // 程序性几何体（procedural geometry，也有译作过程化几何体。这个词的译法较多，大意就是
 // “根据用户提供的参数以程序自动生成对应的几何体”
@@ -55,21 +58,44 @@ class GeometryGenerator
     struct MeshData
     {
         std::vector<Vertex> Vertices;
+        // 索引只以 32 位的形式存储这一份。需要 16 位索引时再由下列方法转换到调用者提供的内存中，
+        // 因此不会再在 MeshData 内部缓存第二份副本，修改 Indices32 后也不存在缓存过期的问题。
+        // 下列方法都是 const 且不修改任何成员，多个线程可以同时调用
         std::vector<uint32> Indices32;
-        std::vector<uint16> &GetIndices16()
+
+        // 能表示全部索引的最小索引宽度（2 或 4 字节）
+        uint32 IndexByteSize() const;
+
+        // 把索引写入 dst（至少 Indices32.size() 个元素），例如直接写入映射的上传缓冲区，不分配内存。
+        // 16 位版本以 SIMD 指令每次收窄 8 个索引，要求所有索引都不超过 65535（见 IndexByteSize），
+        // 否则抛出 std::out_of_range 且不写入 dst
+        void CopyIndices(uint16 *dst) const;
+        void CopyIndices(uint32 *dst) const;
+
+        // 把转换后的索引追加到 indices 的末尾。CopyIndices 抛出异常时 indices 的内容保持不变
+        template <typename Index>
+        void AppendIndices(std::vector<Index> &indices) const
         {
-            if (mIndices16.empty())
+            size_t offset = indices.size();
+            indices.resize(offset + Indices32.size());
+            try
             {
-                mIndices16.resize(Indices32.size());
-                for (size_t i = 0; i < Indices32.size(); ++i)
-                    mIndices16[i] = static_cast<uint16>(Indices32[i]);
+                CopyIndices(indices.data() + offset);
+            }
+            catch (...)
+            {
+                indices.resize(offset);
+                throw;
             }
-
-            return mIndices16;
         }
 
-      private:
-        std::vector<uint16> mIndices16;
+        // 返回 16 位索引的副本。每次调用都会重新转换，只需要读取时请用 CopyIndices/AppendIndices
+        std::vector<uint16> GetIndices16() const
+        {
+            std::vector<uint16> indices;
+            AppendIndices(indices);
+            return indices;
+        }
     };
 
     /// <summary>
@@ -103,6 +129,14 @@ class GeometryGenerator
     /// </summary>
     MeshData CreateGrid(float width, float depth, uint32 m, uint32 n);
 
+    /// <summary>
+    /// Same as CreateGrid, but every vertex is displaced by heightField (flat if null),
+    /// with normals and tangents taken from it. Rows are filled in parallel on threadPool
+    /// (serially if null), and each row is generated 4 vertices at a time.
+    /// </summary>
+    MeshData CreateGrid(float width, float depth, uint32 m, uint32 n, const HeightField *heightField,
+                        ThreadPool *threadPool);
+
     /// <summary>
     /// Creates a quad aligned with the screen.  This is useful for postprocessing and screen effects.
     /// </summary>
@@ -0,0 +1,224 @@
+#include "GpuHeapAllocator.h"
+#include "logger.h"
+#include <algorithm>
+
+GpuHeapAllocator::GpuHeapAllocator(ID3D12Device *device, uint64 heapSize) : mDevice(device), mHeapSize(heapSize)
+{
+    assert(device != nullptr);
+    assert(heapSize >= D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT);
+}
+
+GpuHeapAllocator::~GpuHeapAllocator()
+{
+#if defined(DEBUG) | defined(_DEBUG)
+    // 所有放置资源都应当在分配器之前释放
+    for (const auto &pool : mPools)
+    {
+        for (const auto &heap : pool.Heaps)
+            assert(heap.Allocator == nullptr || heap.Allocator->IsEmpty());
+    }
+#endif
+}
+
+GpuHeapAllocator::ResourceClass GpuHeapAllocator::ClassOf(const D3D12_RESOURCE_DESC &desc)
+{
+    if (desc.Dimension == D3D12_RESOURCE_DIMENSION_BUFFER)
+        return ResourceClass::Buffer;
+    if (desc.Flags & (D3D12_RESOURCE_FLAG_ALLOW_RENDER_TARGET | D3D12_RESOURCE_FLAG_ALLOW_DEPTH_STENCIL))
+        return ResourceClass::RenderTargetOrDepthStencil;
+    return ResourceClass::Texture;
+}
+
+GpuHeapAllocator::uint32 GpuHeapAllocator::PoolIndex(D3D12_HEAP_TYPE heapType, ResourceClass resourceClass)
+{
+    for (uint32 i = 0; i < mPools.size(); ++i)
+    {
+        if (mPools[i].HeapType == heapType && mPools[i].Class == resourceClass)
+            return i;
+    }
+
+    Pool pool;
+    pool.HeapType = heapType;
+    pool.Class = resourceClass;
+    mPools.push_back(std::move(pool));
+    return static_cast<uint32>(mPools.size() - 1);
+}
+
+GpuHeapAllocator::uint32 GpuHeapAllocator::CreateHeap(Pool &pool, uint64 heapSize, uint64 alignment)
+{
+    static const D3D12_HEAP_FLAGS classFlags[] = {
+        D3D12_HEAP_FLAG_ALLOW_ONLY_BUFFERS,
+        D3D12_HEAP_FLAG_ALLOW_ONLY_NON_RT_DS_TEXTURES,
+        D3D12_HEAP_FLAG_ALLOW_ONLY_RT_DS_TEXTURES,
+    };
+
+    D3D12_HEAP_DESC heapDesc = {};
+    heapDesc.SizeInBytes = heapSize;
+    heapDesc.Properties = CD3DX12_HEAP_PROPERTIES(pool.HeapType);
+    heapDesc.Alignment = alignment;
+    heapDesc.Flags = classFlags[static_cast<int>(pool.Class)];
+
+    Heap heap;
+    ThrowIfFailed(mDevice->CreateHeap(&heapDesc, IID_PPV_ARGS(heap.Resource.GetAddressOf())));
+    heap.Allocator = std::make_unique<TlsfAllocator>(heapSize, D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT);
+
+    // 优先复用已释放的堆留下的空位
+    for (uint32 i = 0; i < pool.Heaps.size(); ++i)
+    {
+        if (pool.Heaps[i].Resource == nullptr)
+        {
+            pool.Heaps[i] = std::move(heap);
+            return i;
+        }
+    }
+
+    pool.Heaps.push_back(std::move(heap));
+    return static_cast<uint32>(pool.Heaps.size() - 1);
+}
+
+GpuHeapAllocator::Allocation GpuHeapAllocator::CreateResource(const D3D12_RESOURCE_DESC &desc,
+                                                              D3D12_HEAP_TYPE heapType,
+                                                              D3D12_RESOURCE_STATES initialState,
+                                                              const D3D12_CLEAR_VALUE *clearValue)
+{
+    D3D12_RESOURCE_ALLOCATION_INFO info = mDevice->GetResourceAllocationInfo(0, 1, &desc);
+    if (info.SizeInBytes == UINT64_MAX)
+        ThrowIfFailed(E_INVALIDARG);
+
+    Allocation allocation;
+    allocation.Pool = PoolIndex(heapType, ClassOf(desc));
+    Pool &pool = mPools[allocation.Pool];
+
+    bool found = false;
+    for (uint32 i = 0; i < pool.Heaps.size() && !found; ++i)
+    {
+        if (pool.Heaps[i].Allocator == nullptr)
+            continue;
+
+        allocation.Range = pool.Heaps[i].Allocator->Allocate(info.SizeInBytes, info.Alignment);
+        if (allocation.Range.IsValid())
+        {
+            allocation.Heap = i;
+            found = true;
+        }
+    }
+
+    if (!found)
+    {
+        // 渲染目标/深度模板堆按 4MB 对齐，以便容纳多重采样纹理
+        uint64 heapAlignment = pool.Class == ResourceClass::RenderTargetOrDepthStencil
+                                   ? D3D12_DEFAULT_MSAA_RESOURCE_PLACEMENT_ALIGNMENT
+                                   : D3D12_DEFAULT_RESOURCE_PLACEMENT_ALIGNMENT;
+        heapAlignment = std::max<uint64>(heapAlignment, info.Alignment);
+
+        // 放不进标准大小的堆的资源单独使用一个堆
+        uint64 heapSize = mHeapSize;
+        if (info.SizeInBytes > mHeapSize)
+            heapSize = (info.SizeInBytes + heapAlignment - 1) & ~(heapAlignment - 1);
+
+        allocation.Heap = CreateHeap(pool, heapSize, heapAlignment);
+        allocation.Range = pool.Heaps[allocation.Heap].Allocator->Allocate(info.SizeInBytes, info.Alignment);
+        assert(allocation.Range.IsValid());
+    }
+
+    Heap &heap = pool.Heaps[allocation.Heap];
+    HRESULT hr = mDevice->CreatePlacedResource(heap.Resource.Get(), allocation.Range.Offset, &desc, initialState,
+                                               clearValue, IID_PPV_ARGS(allocation.Resource.GetAddressOf()));
+    if (FAILED(hr))
+    {
+        heap.Allocator->Free(allocation.Range);
+        ThrowIfFailed(hr);
+    }
+
+    return allocation;
+}
+
+GpuHeapAllocator::Allocation GpuHeapAllocator::CreateBuffer(UINT64 byteSize, D3D12_HEAP_TYPE heapType,
+                                                            D3D12_RESOURCE_STATES initialState)
+{
+    auto desc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+    return CreateResource(desc, heapType, initialState);
+}
+
+void GpuHeapAllocator::Free(Allocation &allocation)
+{
+    if (!allocation.IsValid())
+        return;
+
+    allocation.Resource.Reset();
+
+    Pool &pool = mPools[allocation.Pool];
+    Heap &heap = pool.Heaps[allocation.Heap];
+    heap.Allocator->Free(allocation.Range);
+    allocation.Range = TlsfAllocator::Allocation();
+
+    // 每个池至少保留一个标准大小的堆，避免反复创建与销毁；其余变空的堆立即释放
+    if (heap.Allocator->IsEmpty())
+    {
+        bool keep = false;
+        if (heap.Allocator->Capacity() == mHeapSize)
+        {
+            keep = true;
+            for (uint32 i = 0; i < pool.Heaps.size(); ++i)
+            {
+                const Heap &other = pool.Heaps[i];
+                if (i != allocation.Heap && other.Allocator != nullptr && other.Allocator->Capacity() == mHeapSize)
+                {
+                    keep = false;
+                    break;
+                }
+            }
+        }
+
+        if (!keep)
+        {
+            heap.Allocator.reset();
+            heap.Resource.Reset();
+        }
+    }
+}
+
+GpuHeapAllocator::Statistics GpuHeapAllocator::GetStatistics() const
+{
+    Statistics stats;
+    for (const auto &pool : mPools)
+    {
+        for (const auto &heap : pool.Heaps)
+        {
+            if (heap.Allocator == nullptr)
+                continue;
+
+            TlsfAllocator::Statistics heapStats = heap.Allocator->GetStatistics();
+            ++stats.HeapCount;
+            stats.HeapBytes += heapStats.Capacity;
+            stats.UsedBytes += heapStats.UsedBytes;
+            stats.AllocationCount += heapStats.AllocationCount;
+            stats.FreeBlockCount += heapStats.FreeBlockCount;
+            stats.LargestFreeBlock = std::max(stats.LargestFreeBlock, heapStats.LargestFreeBlock);
+        }
+    }
+    return stats;
+}
+
+void GpuHeapAllocator::LogStatistics() const
+{
+    static const char *classNames[] = {"buffer", "texture", "rt/ds"};
+    const double mb = 1.0 / (1024.0 * 1024.0);
+
+    for (const auto &pool : mPools)
+    {
+        for (uint32 i = 0; i < pool.Heaps.size(); ++i)
+        {
+            const Heap &heap = pool.Heaps[i];
+            if (heap.Allocator == nullptr)
+                continue;
+
+            TlsfAllocator::Statistics stats = heap.Allocator->GetStatistics();
+            DINFO("GpuHeapAllocator: heap type %d %s #%u: %.2f / %.2f MB used, %u allocations, %u free blocks, "
+                  "largest free %.2f MB, fragmentation %.1f%%",
+                  static_cast<int>(pool.HeapType), classNames[static_cast<int>(pool.Class)], i, stats.UsedBytes * mb,
+                  stats.Capacity * mb, stats.AllocationCount, stats.FreeBlockCount, stats.LargestFreeBlock * mb,
+                  stats.Fragmentation() * 100.0f);
+        }
+    }
+}
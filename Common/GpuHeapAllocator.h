@@ -0,0 +1,119 @@
+#pragma once
+
+#include "TlsfAllocator.h"
+#include "d3dUtil.h"
+#include <memory>
+#include <vector>
+
+// 在大块的 ID3D12Heap 中创建放置资源（placed resource）
+// CreateCommittedResource 每次都会隐式地创建一个独立的堆，也就是一次操作系统级别的显存分配。
+// GpuHeapAllocator 按堆类型与资源类别各维护一组固定大小的堆，每个堆由一个 TlsfAllocator 划分空间，
+// 资源通过 CreatePlacedResource 放置其中。资源的对齐要求（64KB，或多重采样纹理的 4MB）由
+// GetResourceAllocationInfo 给出；超过堆大小的资源单独使用一个刚好容纳它的堆。
+//
+// 为了兼容资源堆层级 1（D3D12_RESOURCE_HEAP_TIER_1）的硬件，缓冲区、普通纹理以及渲染目标/深度模板纹理
+// 总是放在不同的堆中。
+//
+// 目前深度/模板缓冲区与（给出 allocator 时的）UploadBuffer 从这里分配。UploadBatch 与 d3dUtil::CreateDefaultBuffer
+// 创建的默认堆缓冲区仍是提交资源：它们由 MeshGeometry 以 ComPtr 持有，放置资源还需要在释放时归还 Allocation。
+class GpuHeapAllocator
+{
+  public:
+    using uint32 = std::uint32_t;
+    using uint64 = std::uint64_t;
+
+    static const uint64 DefaultHeapSize = 64ull * 1024 * 1024;
+
+    class Allocation
+    {
+      public:
+        ID3D12Resource *Get() const
+        {
+            return Resource.Get();
+        }
+
+        bool IsValid() const
+        {
+            return Resource != nullptr;
+        }
+
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+
+      private:
+        friend class GpuHeapAllocator;
+
+        uint32 Pool = 0;
+        uint32 Heap = 0;
+        TlsfAllocator::Allocation Range;
+    };
+
+    struct Statistics
+    {
+        uint32 HeapCount = 0;
+        uint64 HeapBytes = 0;
+        uint64 UsedBytes = 0;
+        uint32 AllocationCount = 0;
+        uint32 FreeBlockCount = 0;
+        // 所有堆中最大的空闲块，即不新建堆时能放下的最大资源
+        uint64 LargestFreeBlock = 0;
+
+        // 外部碎片率：1 - 最大空闲块 / 空闲总量
+        float Fragmentation() const
+        {
+            uint64 freeBytes = HeapBytes - UsedBytes;
+            return freeBytes == 0 ? 0.0f : 1.0f - static_cast<float>(LargestFreeBlock) / freeBytes;
+        }
+    };
+
+    GpuHeapAllocator(ID3D12Device *device, uint64 heapSize = DefaultHeapSize);
+    GpuHeapAllocator(const GpuHeapAllocator &rhs) = delete;
+    GpuHeapAllocator &operator=(const GpuHeapAllocator &rhs) = delete;
+    ~GpuHeapAllocator();
+
+    Allocation CreateResource(const D3D12_RESOURCE_DESC &desc, D3D12_HEAP_TYPE heapType,
+                              D3D12_RESOURCE_STATES initialState, const D3D12_CLEAR_VALUE *clearValue = nullptr);
+
+    Allocation CreateBuffer(UINT64 byteSize, D3D12_HEAP_TYPE heapType, D3D12_RESOURCE_STATES initialState);
+
+    // 释放资源并归还其所占的空间。与释放提交资源一样，调用者要保证 GPU 已不再使用它
+    void Free(Allocation &allocation);
+
+    Statistics GetStatistics() const;
+
+    // 把各个堆的使用情况与碎片率输出到日志
+    void LogStatistics() const;
+
+  private:
+    // 资源堆层级 1 要求这三类资源分别放在不同的堆中
+    enum class ResourceClass
+    {
+        Buffer,
+        Texture,
+        RenderTargetOrDepthStencil,
+        Count
+    };
+
+    struct Heap
+    {
+        Microsoft::WRL::ComPtr<ID3D12Heap> Resource;
+        std::unique_ptr<TlsfAllocator> Allocator;
+    };
+
+    struct Pool
+    {
+        D3D12_HEAP_TYPE HeapType;
+        ResourceClass Class;
+        // 已释放的堆在 Heaps 中留下空位，以免已有的 Allocation 中保存的下标失效
+        std::vector<Heap> Heaps;
+    };
+
+    static ResourceClass ClassOf(const D3D12_RESOURCE_DESC &desc);
+
+    uint32 PoolIndex(D3D12_HEAP_TYPE heapType, ResourceClass resourceClass);
+    uint32 CreateHeap(Pool &pool, uint64 heapSize, uint64 alignment);
+
+  private:
+    ID3D12Device *mDevice;
+    uint64 mHeapSize;
+    std::vector<Pool> mPools;
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+// 稳定的 64 位内容哈希
+// 管线状态、着色器等缓存以内容哈希作为键，并把它写入磁盘文件名与索引中，所以哈希值不能依赖指针、进程或编译器
+// （std::hash 不保证这一点）。这里使用 FNV-1a 逐字节累积，最后再做一次 64 位混合以改善低位的分布。
+// 同样的字节序列（不论分几次 Update）总是得到同样的结果。
+class Hasher
+{
+  public:
+    using uint64 = std::uint64_t;
+
+    void Update(const void *data, size_t byteSize)
+    {
+        const auto *bytes = static_cast<const std::uint8_t *>(data);
+        uint64 state = mState;
+        for (size_t i = 0; i < byteSize; ++i)
+        {
+            state ^= bytes[i];
+            state *= 0x100000001b3ull;
+        }
+        mState = state;
+    }
+
+    // 只适用于没有填充字节的标量类型：结构体应逐个成员地 Update，以免把未初始化的填充字节算进去
+    template <typename T>
+    void Update(const T &value)
+    {
+        static_assert(std::is_arithmetic_v<T> || std::is_enum_v<T>, "hash structs member by member");
+        Update(&value, sizeof(T));
+    }
+
+    // 字符串连同长度一起哈希，("ab", "c") 与 ("a", "bc") 得到不同的结果。空指针与空字符串相同
+    void UpdateString(const char *str)
+    {
+        const size_t length = str != nullptr ? std::strlen(str) : 0;
+        Update(static_cast<std::uint64_t>(length));
+        Update(str, length);
+    }
+
+    void UpdateString(const std::string &str)
+    {
+        Update(static_cast<std::uint64_t>(str.size()));
+        Update(str.data(), str.size());
+    }
+
+    uint64 Digest() const
+    {
+        // splitmix64 的终结函数
+        uint64 x = mState;
+        x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+        x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+        return x ^ (x >> 31);
+    }
+
+    static uint64 Hash(const void *data, size_t byteSize)
+    {
+        Hasher hasher;
+        hasher.Update(data, byteSize);
+        return hasher.Digest();
+    }
+
+    // 固定 16 位的小写十六进制字符串，用作文件名或管线库中的名字
+    static std::wstring ToHex(uint64 value)
+    {
+        static const wchar_t digits[] = L"0123456789abcdef";
+        std::wstring text(16, L'0');
+        for (int i = 15; i >= 0; --i, value >>= 4)
+            text[i] = digits[value & 0xf];
+        return text;
+    }
+
+  private:
+    uint64 mState = 0xcbf29ce484222325ull;
+};
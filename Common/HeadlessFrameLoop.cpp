@@ -0,0 +1,290 @@
+#include "HeadlessFrameLoop.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+namespace
+{
+std::vector<std::string> SplitColumns(const std::string &line)
+{
+    std::vector<std::string> columns;
+    std::string column;
+    std::istringstream stream(line);
+    while (std::getline(stream, column, ','))
+    {
+        const size_t first = column.find_first_not_of(" \t");
+        const size_t last = column.find_last_not_of(" \t");
+        columns.push_back(first == std::string::npos ? std::string() : column.substr(first, last - first + 1));
+    }
+    return columns;
+}
+
+bool ParseSeconds(const std::string &text, double &value)
+{
+    if (text.empty())
+        return false;
+    char *end = nullptr;
+    value = std::strtod(text.c_str(), &end);
+    return *end == '\0' && std::isfinite(value) && value >= 0.0;
+}
+
+bool ParseNumber(const std::wstring &text, double &value)
+{
+    if (text.empty())
+        return false;
+    wchar_t *end = nullptr;
+    value = std::wcstod(text.c_str(), &end);
+    return *end == L'\0' && std::isfinite(value) && value >= 0.0;
+}
+
+bool ParseCount(const std::wstring &text, std::uint32_t &value)
+{
+    double number = 0.0;
+    if (!ParseNumber(text, number) || number != std::floor(number) || number > 0xffffffffu)
+        return false;
+    value = static_cast<std::uint32_t>(number);
+    return true;
+}
+
+std::string ToUtf8(const std::wstring &text)
+{
+    const auto utf8 = std::filesystem::path(text).u8string();
+    return std::string(utf8.begin(), utf8.end());
+}
+
+double Milliseconds(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - begin).count();
+}
+} // namespace
+
+FrameTimeSource::FrameTimeSource(double fixedDeltaTime) : mFixedDeltaTime(fixedDeltaTime)
+{
+}
+
+bool FrameTimeSource::Load(const std::wstring &fileName, std::string &error)
+{
+    std::ifstream file(std::filesystem::path(fileName), std::ios::binary);
+    if (!file)
+    {
+        error = "cannot open " + ToUtf8(fileName);
+        return false;
+    }
+
+    std::ostringstream text;
+    text << file.rdbuf();
+    return Parse(text.str(), error);
+}
+
+bool FrameTimeSource::Parse(const std::string &text, std::string &error)
+{
+    std::vector<double> recorded;
+    // 没有表头时读取第一列
+    size_t column = 0;
+    bool firstLine = true;
+
+    std::istringstream stream(text);
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(stream, line))
+    {
+        ++lineNumber;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.find_first_not_of(" \t") == std::string::npos || line[line.find_first_not_of(" \t")] == '#')
+            continue;
+
+        const std::vector<std::string> columns = SplitColumns(line);
+        if (firstLine)
+        {
+            firstLine = false;
+            double value = 0.0;
+            if (!ParseSeconds(columns[0], value))
+            {
+                auto it = std::find(columns.begin(), columns.end(), "delta_time");
+                if (it == columns.end())
+                {
+                    error = "line " + std::to_string(lineNumber) + ": the header has no delta_time column";
+                    return false;
+                }
+                column = static_cast<size_t>(it - columns.begin());
+                continue;
+            }
+        }
+
+        double value = 0.0;
+        if (column >= columns.size() || !ParseSeconds(columns[column], value))
+        {
+            error = "line " + std::to_string(lineNumber) + ": invalid delta time";
+            return false;
+        }
+        recorded.push_back(value);
+    }
+
+    if (recorded.empty())
+    {
+        error = "no delta times";
+        return false;
+    }
+
+    mRecorded = std::move(recorded);
+    return true;
+}
+
+double FrameTimeSource::DeltaTime(uint64 frame) const
+{
+    if (mRecorded.empty())
+        return mFixedDeltaTime;
+    return mRecorded[static_cast<size_t>(frame % mRecorded.size())];
+}
+
+FrameTimingLog::Summary FrameTimingLog::Summarize(double FrameTiming::*field) const
+{
+    Summary summary;
+    if (mFrames.empty())
+        return summary;
+
+    std::vector<double> values;
+    values.reserve(mFrames.size());
+    double total = 0.0;
+    for (const FrameTiming &frame : mFrames)
+    {
+        values.push_back(frame.*field);
+        total += frame.*field;
+    }
+    std::sort(values.begin(), values.end());
+
+    // 最近秩法：第 p 百分位数为排序后第 ceil(p * n) 个值
+    auto percentile = [&values](double p) {
+        const auto rank = static_cast<size_t>(std::ceil(p * values.size()));
+        return values[rank == 0 ? 0 : rank - 1];
+    };
+
+    summary.Mean = total / values.size();
+    summary.Median = percentile(0.5);
+    summary.P95 = percentile(0.95);
+    summary.P99 = percentile(0.99);
+    summary.Max = values.back();
+    return summary;
+}
+
+std::string FrameTimingLog::ToCsv() const
+{
+    std::string csv = "frame,delta_time,update_ms,draw_ms,frame_ms\n";
+    char line[160];
+    for (const FrameTiming &frame : mFrames)
+    {
+        std::snprintf(line, sizeof(line), "%llu,%.17g,%.4f,%.4f,%.4f\n",
+                      static_cast<unsigned long long>(frame.Frame), frame.DeltaTime, frame.UpdateMs, frame.DrawMs,
+                      frame.FrameMs);
+        csv += line;
+    }
+    return csv;
+}
+
+bool FrameTimingLog::Write(const std::wstring &fileName) const
+{
+    std::ofstream file(std::filesystem::path(fileName), std::ios::binary | std::ios::trunc);
+    if (!file)
+        return false;
+
+    const std::string csv = ToCsv();
+    file.write(csv.data(), static_cast<std::streamsize>(csv.size()));
+    return static_cast<bool>(file);
+}
+
+bool HeadlessFrameLoop::ParseArguments(const std::vector<std::wstring> &arguments, Options &options,
+                                       std::string &error)
+{
+    for (size_t i = 0; i < arguments.size(); ++i)
+    {
+        const std::wstring &argument = arguments[i];
+        if (argument == L"--headless")
+        {
+            options.Enabled = true;
+            continue;
+        }
+
+        const bool takesValue = argument == L"--frames" || argument == L"--warmup" || argument == L"--dt" ||
+                                argument == L"--dt-file" || argument == L"--timings";
+        if (!takesValue)
+        {
+            error = "unknown argument " + ToUtf8(argument);
+            return false;
+        }
+        if (i + 1 == arguments.size())
+        {
+            error = ToUtf8(argument) + " needs a value";
+            return false;
+        }
+
+        const std::wstring &value = arguments[++i];
+        bool valid = true;
+        if (argument == L"--frames")
+            valid = ParseCount(value, options.FrameCount);
+        else if (argument == L"--warmup")
+            valid = ParseCount(value, options.WarmupFrames);
+        else if (argument == L"--dt")
+            valid = ParseNumber(value, options.FixedDeltaTime);
+        else if (argument == L"--dt-file")
+            options.DeltaTimeFile = value;
+        else
+            options.TimingFile = value;
+
+        if (!valid)
+        {
+            error = "invalid value for " + ToUtf8(argument) + ": " + ToUtf8(value);
+            return false;
+        }
+    }
+    return true;
+}
+
+FrameTimingLog HeadlessFrameLoop::Run(const Options &options, const FrameTimeSource &timeSource,
+                                      const Stages &stages)
+{
+    using Clock = std::chrono::steady_clock;
+
+    FrameTimingLog log;
+    const uint64 frameCount = static_cast<uint64>(options.WarmupFrames) + options.FrameCount;
+    for (uint64 frame = 0; frame < frameCount; ++frame)
+    {
+        // 计时帧从时间差序列的开头取值，与预热帧数无关，记录中第 k 帧的 delta_time 就是序列的第 k 项。
+        // 预热帧同样从序列开头取值，所以用写出的记录以同样的预热帧数重放时（计时帧数不少于预热帧数），
+        // 每一帧的时间差都与录制时相同
+        const bool warmup = frame < options.WarmupFrames;
+        const uint64 index = warmup ? frame : frame - options.WarmupFrames;
+        const double deltaTime = timeSource.DeltaTime(index);
+
+        const Clock::time_point frameBegin = Clock::now();
+        if (stages.BeginFrame)
+            stages.BeginFrame(deltaTime);
+
+        const Clock::time_point updateBegin = Clock::now();
+        if (stages.Update)
+            stages.Update(deltaTime);
+
+        const Clock::time_point drawBegin = Clock::now();
+        if (stages.Draw)
+            stages.Draw(deltaTime);
+        const Clock::time_point frameEnd = Clock::now();
+
+        if (warmup)
+            continue;
+
+        FrameTiming timing;
+        timing.Frame = index;
+        timing.DeltaTime = deltaTime;
+        timing.UpdateMs = Milliseconds(updateBegin, drawBegin);
+        timing.DrawMs = Milliseconds(drawBegin, frameEnd);
+        timing.FrameMs = Milliseconds(frameBegin, frameEnd);
+        log.Add(timing);
+    }
+    return log;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// 无窗口运行时每一帧的时间差来源
+// 默认每帧使用相同的时间差；也可以从文件中载入录制的时间差序列，按顺序逐帧使用，用完之后从头循环。
+// 两种方式都与真实经过的时间无关，同样的输入每次运行都得到同样的模拟结果，便于比较前后两次运行的耗时。
+class FrameTimeSource
+{
+  public:
+    using uint64 = std::uint64_t;
+
+    explicit FrameTimeSource(double fixedDeltaTime = 1.0 / 60.0);
+
+    // 载入录制的时间差（单位：秒）。每行一个数值，空行与 # 开头的行被忽略；
+    // 第一行为含有 delta_time 列的 CSV 表头时（例如 FrameTimingLog 写出的文件），读取这一列。
+    // 失败时返回 false，原来的设置保持不变
+    bool Load(const std::wstring &fileName, std::string &error);
+    bool Parse(const std::string &text, std::string &error);
+
+    // 第 frame 帧（从 0 开始）的时间差
+    double DeltaTime(uint64 frame) const;
+
+    bool IsRecorded() const
+    {
+        return !mRecorded.empty();
+    }
+
+    size_t RecordedCount() const
+    {
+        return mRecorded.size();
+    }
+
+  private:
+    double mFixedDeltaTime;
+    std::vector<double> mRecorded;
+};
+
+// 一帧中各阶段的 CPU 耗时（单位：毫秒）
+struct FrameTiming
+{
+    std::uint64_t Frame = 0;
+    double DeltaTime = 0.0;
+    double UpdateMs = 0.0;
+    double DrawMs = 0.0;
+    // 从帧开始到 Draw 返回的总耗时，包括 BeginFrame
+    double FrameMs = 0.0;
+};
+
+// 逐帧记录的耗时，可以写成 CSV 文件供回归比较使用
+class FrameTimingLog
+{
+  public:
+    struct Summary
+    {
+        double Mean = 0.0;
+        double Median = 0.0;
+        double P95 = 0.0;
+        double P99 = 0.0;
+        double Max = 0.0;
+    };
+
+    void Add(const FrameTiming &timing)
+    {
+        mFrames.push_back(timing);
+    }
+
+    const std::vector<FrameTiming> &Frames() const
+    {
+        return mFrames;
+    }
+
+    // 统计某一列，例如 Summarize(&FrameTiming::FrameMs)。没有记录时各项均为 0
+    Summary Summarize(double FrameTiming::*field) const;
+
+    // 表头为 frame,delta_time,update_ms,draw_ms,frame_ms。delta_time 以足够的精度写出，
+    // 可以直接作为 FrameTimeSource::Load 的输入，以完全相同的时间差重放
+    std::string ToCsv() const;
+    bool Write(const std::wstring &fileName) const;
+
+  private:
+    std::vector<FrameTiming> mFrames;
+};
+
+// 不依赖窗口与消息循环的确定性帧循环
+// D3DApp::Run 由 Win32 消息泵驱动，时间差来自真实时间，无法用于性能测试与长时间运行的测试。
+// 本类按给定的帧数逐帧调用 BeginFrame、Update 与 Draw，时间差由 FrameTimeSource 提供，
+// 并用 steady_clock 分别测量 Update 与 Draw 的 CPU 耗时。它不依赖任何图形 API，
+// 配合 NullCommandBackend 可以在没有 GPU 的性能测试机上运行。
+class HeadlessFrameLoop
+{
+  public:
+    using uint32 = std::uint32_t;
+    using uint64 = std::uint64_t;
+    // 参数为本帧的时间差（单位：秒）
+    using Stage = std::function<void(double deltaTime)>;
+
+    struct Options
+    {
+        // 命令行中是否给出了 --headless
+        bool Enabled = false;
+        // 预热帧照常运行，但不计入耗时记录（例如首次使用时的内存分配与 PSO 创建）
+        uint32 WarmupFrames = 0;
+        uint32 FrameCount = 1000;
+        double FixedDeltaTime = 1.0 / 60.0;
+        // 非空时从这个文件载入录制的时间差，代替 FixedDeltaTime
+        std::wstring DeltaTimeFile;
+        // 非空时把逐帧耗时写入这个文件
+        std::wstring TimingFile = L"FrameTimings.csv";
+    };
+
+    struct Stages
+    {
+        // 每帧开始时调用，不计入 Update 与 Draw 的耗时（例如推进计时器），可以为空
+        Stage BeginFrame;
+        Stage Update;
+        Stage Draw;
+    };
+
+    // 解析命令行参数：
+    //   --headless  --frames <N>  --warmup <N>  --dt <秒>  --dt-file <文件>  --timings <文件>
+    // 未识别的参数或格式错误的数值返回 false 并给出原因
+    static bool ParseArguments(const std::vector<std::wstring> &arguments, Options &options, std::string &error);
+
+    // 运行 WarmupFrames + FrameCount 帧，返回后 FrameCount 帧的耗时。
+    // 预热帧与计时帧都从 timeSource 的第 0 帧开始取时间差
+    static FrameTimingLog Run(const Options &options, const FrameTimeSource &timeSource, const Stages &stages);
+};
@@ -0,0 +1,70 @@
+#include "HeightField.h"
+#include <cmath>
+
+using namespace DirectX;
+
+void XM_CALLCONV HeightField::Evaluate4(FXMVECTOR x, FXMVECTOR z, XMVECTOR &height, XMVECTOR &normalX,
+                                        XMVECTOR &normalY, XMVECTOR &normalZ) const
+{
+    XMFLOAT4 xs, zs;
+    XMStoreFloat4(&xs, x);
+    XMStoreFloat4(&zs, z);
+
+    float h[4];
+    XMFLOAT3 n[4];
+    const float *px = &xs.x;
+    const float *pz = &zs.x;
+    for (int i = 0; i < 4; ++i)
+    {
+        h[i] = Height(px[i], pz[i]);
+        n[i] = Normal(px[i], pz[i]);
+    }
+
+    height = XMVectorSet(h[0], h[1], h[2], h[3]);
+    normalX = XMVectorSet(n[0].x, n[1].x, n[2].x, n[3].x);
+    normalY = XMVectorSet(n[0].y, n[1].y, n[2].y, n[3].y);
+    normalZ = XMVectorSet(n[0].z, n[1].z, n[2].z, n[3].z);
+}
+
+float HillsHeightField::Height(float x, float z) const
+{
+    return 0.3f * (z * sinf(0.1f * x) + x * cosf(0.1f * z));
+}
+
+XMFLOAT3 HillsHeightField::Normal(float x, float z) const
+{
+    // n = (-df/dx, 1, -df/dz)
+    XMFLOAT3 n(-0.03f * z * cosf(0.1f * x) - 0.3f * cosf(0.1f * z), 1.0f,
+               -0.3f * sinf(0.1f * x) + 0.03f * x * sinf(0.1f * z));
+
+    XMVECTOR unitNormal = XMVector3Normalize(XMLoadFloat3(&n));
+    XMStoreFloat3(&n, unitNormal);
+
+    return n;
+}
+
+void XM_CALLCONV HillsHeightField::Evaluate4(FXMVECTOR x, FXMVECTOR z, XMVECTOR &height, XMVECTOR &normalX,
+                                             XMVECTOR &normalY, XMVECTOR &normalZ) const
+{
+    const XMVECTOR frequency = XMVectorReplicate(0.1f);
+
+    XMVECTOR sinX, cosX, sinZ, cosZ;
+    XMVectorSinCos(&sinX, &cosX, XMVectorMultiply(x, frequency));
+    XMVectorSinCos(&sinZ, &cosZ, XMVectorMultiply(z, frequency));
+
+    height = XMVectorMultiply(XMVectorReplicate(0.3f),
+                              XMVectorMultiplyAdd(z, sinX, XMVectorMultiply(x, cosZ)));
+
+    // 与 Normal 相同：n = (-0.03 z cos(0.1x) - 0.3 cos(0.1z), 1, -0.3 sin(0.1x) + 0.03 x sin(0.1z))，再单位化
+    XMVECTOR nx = XMVectorNegate(XMVectorMultiplyAdd(XMVectorMultiply(XMVectorReplicate(0.03f), z), cosX,
+                                                     XMVectorMultiply(XMVectorReplicate(0.3f), cosZ)));
+    XMVECTOR nz = XMVectorMultiplyAdd(XMVectorMultiply(XMVectorReplicate(0.03f), x), sinZ,
+                                      XMVectorMultiply(XMVectorReplicate(-0.3f), sinX));
+
+    XMVECTOR lengthSq = XMVectorMultiplyAdd(nx, nx, XMVectorMultiplyAdd(nz, nz, XMVectorSplatOne()));
+    XMVECTOR invLength = XMVectorReciprocalSqrt(lengthSq);
+
+    normalX = XMVectorMultiply(nx, invLength);
+    normalY = invLength;
+    normalZ = XMVectorMultiply(nz, invLength);
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// 高度场 y = f(x, z)
+// 除逐点计算的 Height/Normal 之外，还要提供一次计算 4 个点的 Evaluate4，以便生成大规模地形网格时能利用 SIMD。
+class HeightField
+{
+  public:
+    virtual ~HeightField() = default;
+
+    virtual float Height(float x, float z) const = 0;
+    virtual DirectX::XMFLOAT3 Normal(float x, float z) const = 0;
+
+    // x、z 的 4 个通道为 4 个采样点，分别输出它们的高度以及单位法线的三个分量（SoA 形式）。
+    // 默认实现逐点调用 Height/Normal，派生类应以向量运算重写它
+    virtual void XM_CALLCONV Evaluate4(DirectX::FXMVECTOR x, DirectX::FXMVECTOR z, DirectX::XMVECTOR &height,
+                                       DirectX::XMVECTOR &normalX, DirectX::XMVECTOR &normalY,
+                                       DirectX::XMVECTOR &normalZ) const;
+};
+
+// 演示程序中“山丘”地形的高度函数：y = 0.3 * (z * sin(0.1x) + x * cos(0.1z))
+class HillsHeightField : public HeightField
+{
+  public:
+    float Height(float x, float z) const override;
+    DirectX::XMFLOAT3 Normal(float x, float z) const override;
+
+    // 以 XMVectorSinCos 的多项式近似同时计算 4 个点的正弦与余弦
+    void XM_CALLCONV Evaluate4(DirectX::FXMVECTOR x, DirectX::FXMVECTOR z, DirectX::XMVECTOR &height,
+                               DirectX::XMVECTOR &normalX, DirectX::XMVECTOR &normalY,
+                               DirectX::XMVECTOR &normalZ) const override;
+};
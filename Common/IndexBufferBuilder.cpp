@@ -0,0 +1,247 @@
+#include "IndexBufferBuilder.h"
+#include <algorithm>
+
+//
+// IndexBufferBuilder
+//
+
+IndexBufferBuilder::IndexBufferBuilder(bool allowSplit) : mAllowSplit(allowSplit)
+{
+}
+
+IndexBufferBuilder::uint32 IndexBufferBuilder::AddSubmesh(const uint32 *indices, size_t indexCount,
+                                                          std::int32_t baseVertexLocation)
+{
+    Source source;
+    source.FirstIndex = mSourceIndices.size();
+    source.IndexCount = indexCount;
+    source.BaseVertexLocation = baseVertexLocation;
+
+    mSourceIndices.insert(mSourceIndices.end(), indices, indices + indexCount);
+    mSources.push_back(source);
+    return static_cast<uint32>(mSources.size() - 1);
+}
+
+bool IndexBufferBuilder::Split16(const Source &source, std::vector<Range> &parts, std::vector<uint32> &partMins) const
+{
+    const uint32 *indices = mSourceIndices.data() + source.FirstIndex;
+
+    auto addPart = [&](size_t begin, size_t end, uint32 minIndex) {
+        Range part;
+        part.StartIndexLocation = static_cast<uint32>(begin);
+        part.IndexCount = static_cast<uint32>(end - begin);
+        part.BaseVertexLocation = source.BaseVertexLocation + static_cast<std::int32_t>(minIndex);
+        parts.push_back(part);
+        partMins.push_back(minIndex);
+    };
+
+    if (source.IndexCount == 0)
+    {
+        addPart(0, 0, 0);
+        return true;
+    }
+
+    auto range = std::minmax_element(indices, indices + source.IndexCount);
+    if (*range.second - *range.first <= MaxIndex16)
+    {
+        addPart(0, source.IndexCount, *range.first);
+        return true;
+    }
+
+    if (!mAllowSplit || source.IndexCount % 3 != 0)
+        return false;
+
+    // 按三角形顺序累积，一旦加入下一个三角形会使跨度超出 16 位就另起一段
+    size_t begin = 0;
+    uint32 runMin = UINT32_MAX;
+    uint32 runMax = 0;
+    for (size_t i = 0; i < source.IndexCount; i += 3)
+    {
+        uint32 triMin = std::min({indices[i], indices[i + 1], indices[i + 2]});
+        uint32 triMax = std::max({indices[i], indices[i + 1], indices[i + 2]});
+        if (triMax - triMin > MaxIndex16)
+            return false;
+
+        uint32 newMin = std::min(runMin, triMin);
+        uint32 newMax = std::max(runMax, triMax);
+        if (i > begin && newMax - newMin > MaxIndex16)
+        {
+            addPart(begin, i, runMin);
+            begin = i;
+            newMin = triMin;
+            newMax = triMax;
+        }
+        runMin = newMin;
+        runMax = newMax;
+    }
+    addPart(begin, source.IndexCount, runMin);
+
+    return true;
+}
+
+void IndexBufferBuilder::Build()
+{
+    mIndices16.clear();
+    mIndices32.clear();
+    mRanges.clear();
+    mSubmeshes.clear();
+
+    std::vector<std::vector<Range>> parts(mSources.size());
+    std::vector<std::vector<uint32>> partMins(mSources.size());
+
+    bool fits16 = true;
+    for (size_t i = 0; i < mSources.size() && fits16; ++i)
+        fits16 = Split16(mSources[i], parts[i], partMins[i]);
+
+    mIndexByteSize = fits16 ? 2 : 4;
+
+    if (fits16)
+    {
+        mIndices16.reserve(mSourceIndices.size());
+        for (size_t i = 0; i < mSources.size(); ++i)
+        {
+            const uint32 *indices = mSourceIndices.data() + mSources[i].FirstIndex;
+
+            Submesh submesh;
+            submesh.FirstRange = static_cast<uint32>(mRanges.size());
+            submesh.RangeCount = static_cast<uint32>(parts[i].size());
+
+            for (size_t p = 0; p < parts[i].size(); ++p)
+            {
+                Range range = parts[i][p];
+                const uint32 minIndex = partMins[i][p];
+                const uint32 *begin = indices + range.StartIndexLocation;
+
+                range.StartIndexLocation = static_cast<uint32>(mIndices16.size());
+                for (uint32 k = 0; k < range.IndexCount; ++k)
+                    mIndices16.push_back(static_cast<uint16>(begin[k] - minIndex));
+
+                mRanges.push_back(range);
+            }
+            mSubmeshes.push_back(submesh);
+        }
+    }
+    else
+    {
+        // 32 位索引不需要拆分，也不需要调整索引
+        mIndices32 = mSourceIndices;
+        for (const auto &source : mSources)
+        {
+            Submesh submesh;
+            submesh.FirstRange = static_cast<uint32>(mRanges.size());
+            submesh.RangeCount = 1;
+
+            Range range;
+            range.IndexCount = static_cast<uint32>(source.IndexCount);
+            range.StartIndexLocation = static_cast<uint32>(source.FirstIndex);
+            range.BaseVertexLocation = source.BaseVertexLocation;
+
+            mRanges.push_back(range);
+            mSubmeshes.push_back(submesh);
+        }
+    }
+}
+
+const void *IndexBufferBuilder::Data() const
+{
+    return mIndexByteSize == 2 ? static_cast<const void *>(mIndices16.data())
+                               : static_cast<const void *>(mIndices32.data());
+}
+
+size_t IndexBufferBuilder::DataByteSize() const
+{
+    return mIndexByteSize == 2 ? mIndices16.size() * sizeof(uint16) : mIndices32.size() * sizeof(uint32);
+}
+
+//
+// IndexCodec
+//
+
+namespace
+{
+template <typename T>
+void EncodeIndices(const T *indices, size_t indexCount, std::vector<std::uint8_t> &output)
+{
+    output.reserve(output.size() + indexCount + indexCount / 4);
+
+    std::uint32_t previous[3] = {0, 0, 0};
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        const std::uint32_t index = indices[i];
+        // 差值按 32 位回绕计算，解码时同样回绕，因此任意两个索引之差都能正确还原
+        const std::int32_t delta = static_cast<std::int32_t>(index - previous[i % 3]);
+        std::uint32_t value = (static_cast<std::uint32_t>(delta) << 1) ^ static_cast<std::uint32_t>(delta >> 31);
+        previous[i % 3] = index;
+
+        while (value >= 0x80)
+        {
+            output.push_back(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        output.push_back(static_cast<std::uint8_t>(value));
+    }
+}
+
+template <typename T, std::uint32_t MaxIndex>
+bool DecodeIndices(const std::uint8_t *data, size_t byteSize, T *indices, size_t indexCount)
+{
+    const std::uint8_t *p = data;
+    const std::uint8_t *end = data + byteSize;
+
+    std::uint32_t previous[3] = {0, 0, 0};
+    for (size_t i = 0; i < indexCount; ++i)
+    {
+        if (p == end)
+            return false;
+
+        std::uint32_t value = *p++;
+        // 绝大多数差值只占 1 字节
+        if (value >= 0x80)
+        {
+            value &= 0x7f;
+            for (std::uint32_t shift = 7;; shift += 7)
+            {
+                if (p == end || shift > 28)
+                    return false;
+
+                const std::uint32_t byte = *p++;
+                // 第 5 个字节只剩 4 位有效，更高的位会在移位时被丢掉，必须视为损坏
+                if (shift == 28 && (byte & 0x70) != 0)
+                    return false;
+                value |= (byte & 0x7f) << shift;
+                if (byte < 0x80)
+                    break;
+            }
+        }
+
+        std::uint32_t &corner = previous[i % 3];
+        corner += (value >> 1) ^ (0u - (value & 1));
+        if (corner > MaxIndex)
+            return false;
+
+        indices[i] = static_cast<T>(corner);
+    }
+
+    return p == end;
+}
+} // namespace
+
+void IndexCodec::Encode(const uint32 *indices, size_t indexCount, std::vector<std::uint8_t> &output)
+{
+    EncodeIndices(indices, indexCount, output);
+}
+
+void IndexCodec::Encode(const uint16 *indices, size_t indexCount, std::vector<std::uint8_t> &output)
+{
+    EncodeIndices(indices, indexCount, output);
+}
+
+bool IndexCodec::Decode(const std::uint8_t *data, size_t byteSize, uint32 *indices, size_t indexCount)
+{
+    return DecodeIndices<uint32, UINT32_MAX>(data, byteSize, indices, indexCount);
+}
+
+bool IndexCodec::Decode(const std::uint8_t *data, size_t byteSize, uint16 *indices, size_t indexCount)
+{
+    return DecodeIndices<uint16, UINT16_MAX>(data, byteSize, indices, indexCount);
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 索引缓冲区构建
+// MeshGeometry::IndexFormat 默认为 R16_UINT，若直接把顶点数较多的网格的索引转换为 16 位，大于 65535 的索引
+// 就会被截断。IndexBufferBuilder 收集所有子网格的索引后统一决定索引宽度：
+//  1. 先把每个子网格的索引减去其最小值，并把差值累加到 BaseVertexLocation 上。只要子网格内索引的跨度不超过
+//     65535，无论它在整个顶点缓冲区中的位置如何，都可以使用 16 位索引；
+//  2. 跨度超过 65535 的子网格（允许拆分时）按三角形顺序拆成若干段，使每段的跨度都不超过 65535。
+//     这不需要复制任何顶点，但拆分后的子网格需要按段分别绘制；
+//  3. 仍然有子网格无法满足时（不允许拆分，或者单个三角形的跨度就已超出），整个缓冲区改用 32 位索引。
+// 一个 MeshGeometry 只有一个 IndexFormat，所以宽度是按整个缓冲区选择的。
+class IndexBufferBuilder
+{
+  public:
+    using uint16 = std::uint16_t;
+    using uint32 = std::uint32_t;
+
+    // 一次绘制调用所需的参数，含义与 SubmeshGeometry 中的同名成员相同
+    struct Range
+    {
+        uint32 IndexCount = 0;
+        uint32 StartIndexLocation = 0;
+        std::int32_t BaseVertexLocation = 0;
+    };
+
+    // 每个输入的子网格对应 Ranges() 中从 FirstRange 开始的 RangeCount 段
+    struct Submesh
+    {
+        uint32 FirstRange = 0;
+        uint32 RangeCount = 0;
+    };
+
+    static const uint32 MaxIndex16 = 0xffff;
+
+    explicit IndexBufferBuilder(bool allowSplit = true);
+
+    // indices 相对于 baseVertexLocation（与 SubmeshGeometry 的约定相同），拆分时必须为三角形列表。返回子网格的序号
+    uint32 AddSubmesh(const uint32 *indices, size_t indexCount, std::int32_t baseVertexLocation = 0);
+
+    uint32 AddSubmesh(const std::vector<uint32> &indices, std::int32_t baseVertexLocation = 0)
+    {
+        return AddSubmesh(indices.data(), indices.size(), baseVertexLocation);
+    }
+
+    void Reserve(size_t indexCount)
+    {
+        mSourceIndices.reserve(indexCount);
+    }
+
+    // 根据已添加的子网格生成索引缓冲区。之后可以继续添加子网格并再次调用
+    void Build();
+
+    // 2 或 4
+    uint32 IndexByteSize() const
+    {
+        return mIndexByteSize;
+    }
+
+    // IndexByteSize() 为 2 时有效
+    const std::vector<uint16> &Indices16() const
+    {
+        return mIndices16;
+    }
+
+    // IndexByteSize() 为 4 时有效
+    const std::vector<uint32> &Indices32() const
+    {
+        return mIndices32;
+    }
+
+    const void *Data() const;
+    size_t DataByteSize() const;
+
+    const std::vector<Range> &Ranges() const
+    {
+        return mRanges;
+    }
+
+    const Submesh &GetSubmesh(uint32 submesh) const
+    {
+        return mSubmeshes[submesh];
+    }
+
+    size_t SubmeshCount() const
+    {
+        return mSubmeshes.size();
+    }
+
+  private:
+    struct Source
+    {
+        size_t FirstIndex = 0;
+        size_t IndexCount = 0;
+        std::int32_t BaseVertexLocation = 0;
+    };
+
+    // 按 16 位的要求划分子网格，每段记录为 {起始位置, 数量, 段内最小索引}。无法满足时返回 false
+    bool Split16(const Source &source, std::vector<Range> &parts, std::vector<uint32> &partMins) const;
+
+  private:
+    bool mAllowSplit;
+    std::vector<uint32> mSourceIndices;
+    std::vector<Source> mSources;
+
+    uint32 mIndexByteSize = 2;
+    std::vector<uint16> mIndices16;
+    std::vector<uint32> mIndices32;
+    std::vector<Range> mRanges;
+    std::vector<Submesh> mSubmeshes;
+};
+
+// 索引压缩编码
+// 三角形列表中相邻两个三角形的对应顶点通常相距很近。每个索引都编码为与前一个三角形中同一位置的索引之差，
+// 差值经 zigzag 变换为无符号数后以变长整数（每字节 7 位，最高位表示后面还有字节）存储，
+// 规则网格一般可以压缩到每个索引 1 字节左右。
+// 只适合用于存储，使用前需先解码。
+class IndexCodec
+{
+  public:
+    using uint16 = std::uint16_t;
+    using uint32 = std::uint32_t;
+
+    // 编码结果追加到 output 的末尾
+    static void Encode(const uint32 *indices, size_t indexCount, std::vector<std::uint8_t> &output);
+    static void Encode(const uint16 *indices, size_t indexCount, std::vector<std::uint8_t> &output);
+
+    // 解码出恰好 indexCount 个索引。数据不完整、有多余字节或（16 位输出时）索引超出 65535 都返回 false
+    static bool Decode(const std::uint8_t *data, size_t byteSize, uint32 *indices, size_t indexCount);
+    static bool Decode(const std::uint8_t *data, size_t byteSize, uint16 *indices, size_t indexCount);
+};
@@ -0,0 +1,193 @@
+#include "Lz4Block.h"
+#include <cstring>
+
+namespace
+{
+// LZ4 格式的约束：匹配至少 4 字节；最后 5 个字节必须是字面量；最后一个匹配必须在距末尾 12 字节之前开始
+const std::size_t MinMatch = 4;
+const std::size_t LastLiterals = 5;
+const std::size_t MatchFindLimit = 12;
+const std::size_t MaxOffset = 65535;
+
+const unsigned HashLog = 12;
+
+std::uint32_t Read32(const std::uint8_t *p)
+{
+    std::uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+std::uint32_t HashSequence(std::uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - HashLog);
+}
+
+// 按 LZ4 的方式写出超过 15 的长度：先写 255 直到剩余部分小于 255
+bool WriteLength(std::uint8_t *&op, const std::uint8_t *oend, std::size_t length)
+{
+    for (; length >= 255; length -= 255)
+    {
+        if (op == oend)
+            return false;
+        *op++ = 255;
+    }
+    if (op == oend)
+        return false;
+    *op++ = static_cast<std::uint8_t>(length);
+    return true;
+}
+
+bool ReadLength(const std::uint8_t *&ip, const std::uint8_t *iend, std::size_t &length)
+{
+    std::uint8_t byte;
+    do
+    {
+        if (ip == iend)
+            return false;
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+// 写出一个序列：字面量 [literals, literals + literalLength)，之后是一个匹配（matchLength 为 0 表示最后一个序列）
+bool WriteSequence(std::uint8_t *&op, const std::uint8_t *oend, const std::uint8_t *literals,
+                   std::size_t literalLength, std::size_t offset, std::size_t matchLength)
+{
+    if (op == oend)
+        return false;
+    std::uint8_t *token = op++;
+
+    *token = static_cast<std::uint8_t>((literalLength < 15 ? literalLength : 15) << 4);
+    if (literalLength >= 15 && !WriteLength(op, oend, literalLength - 15))
+        return false;
+    if (literalLength > static_cast<std::size_t>(oend - op))
+        return false;
+    if (literalLength > 0)
+        std::memcpy(op, literals, literalLength);
+    op += literalLength;
+
+    if (matchLength == 0)
+        return true;
+
+    if (oend - op < 2)
+        return false;
+    *op++ = static_cast<std::uint8_t>(offset & 0xff);
+    *op++ = static_cast<std::uint8_t>(offset >> 8);
+
+    const std::size_t extra = matchLength - MinMatch;
+    *token |= static_cast<std::uint8_t>(extra < 15 ? extra : 15);
+    return extra < 15 || WriteLength(op, oend, extra - 15);
+}
+} // namespace
+
+std::size_t Lz4Block::Compress(const void *src, std::size_t srcSize, void *dst, std::size_t dstCapacity)
+{
+    const auto *base = static_cast<const std::uint8_t *>(src);
+    auto *op = static_cast<std::uint8_t *>(dst);
+    const std::uint8_t *oend = op + dstCapacity;
+
+    std::size_t ip = 0;
+    std::size_t anchor = 0;
+
+    if (srcSize > MatchFindLimit)
+    {
+        // 哈希表记录最近一次出现某 4 字节序列的位置（加 1，0 表示空）
+        std::uint32_t table[1u << HashLog] = {};
+        const std::size_t matchLimit = srcSize - LastLiterals;
+
+        while (ip + MatchFindLimit < srcSize)
+        {
+            const std::uint32_t sequence = Read32(base + ip);
+            std::uint32_t &slot = table[HashSequence(sequence)];
+            const std::size_t candidate = slot;
+            slot = static_cast<std::uint32_t>(ip + 1);
+
+            if (candidate == 0 || ip - (candidate - 1) > MaxOffset || Read32(base + candidate - 1) != sequence)
+            {
+                // 越久没有找到匹配，步长越大，不可压缩的数据很快就能扫过去
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            std::size_t ref = candidate - 1;
+            std::size_t length = MinMatch;
+            while (ip + length < matchLimit && base[ref + length] == base[ip + length])
+                ++length;
+            // 向前延伸匹配，吃掉本来要作为字面量写出的字节
+            while (ip > anchor && ref > 0 && base[ip - 1] == base[ref - 1])
+            {
+                --ip;
+                --ref;
+                ++length;
+            }
+
+            if (!WriteSequence(op, oend, base + anchor, ip - anchor, ip - ref, length))
+                return 0;
+            ip += length;
+            anchor = ip;
+        }
+    }
+
+    if (!WriteSequence(op, oend, base + anchor, srcSize - anchor, 0, 0))
+        return 0;
+    return static_cast<std::size_t>(op - static_cast<std::uint8_t *>(dst));
+}
+
+bool Lz4Block::Decompress(const void *src, std::size_t srcSize, void *dst, std::size_t dstSize)
+{
+    const auto *ip = static_cast<const std::uint8_t *>(src);
+    const std::uint8_t *iend = ip + srcSize;
+    auto *const begin = static_cast<std::uint8_t *>(dst);
+    std::uint8_t *op = begin;
+    std::uint8_t *const oend = op + dstSize;
+
+    for (;;)
+    {
+        if (ip == iend)
+            return false;
+        const std::uint8_t token = *ip++;
+
+        std::size_t literalLength = token >> 4;
+        if (literalLength == 15 && !ReadLength(ip, iend, literalLength))
+            return false;
+        if (literalLength > static_cast<std::size_t>(iend - ip) || literalLength > static_cast<std::size_t>(oend - op))
+            return false;
+        if (literalLength > 0)
+            std::memcpy(op, ip, literalLength);
+        ip += literalLength;
+        op += literalLength;
+
+        // 最后一个序列只有字面量
+        if (ip == iend)
+            return op == oend;
+
+        if (iend - ip < 2)
+            return false;
+        const std::size_t offset = ip[0] | (static_cast<std::size_t>(ip[1]) << 8);
+        ip += 2;
+        if (offset == 0 || offset > static_cast<std::size_t>(op - begin))
+            return false;
+
+        std::size_t matchLength = token & 15;
+        if (matchLength == 15 && !ReadLength(ip, iend, matchLength))
+            return false;
+        matchLength += MinMatch;
+        if (matchLength > static_cast<std::size_t>(oend - op))
+            return false;
+
+        // 偏移量小于长度时源与目标重叠（例如重复的短模式），只能逐字节复制
+        const std::uint8_t *match = op - offset;
+        if (offset >= matchLength)
+        {
+            std::memcpy(op, match, matchLength);
+            op += matchLength;
+        }
+        else
+        {
+            for (std::size_t i = 0; i < matchLength; ++i)
+                *op++ = *match++;
+        }
+    }
+}
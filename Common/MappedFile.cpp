@@ -0,0 +1,190 @@
+#include "MappedFile.h"
+#include <filesystem>
+#include <utility>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(MappedFile &&rhs) noexcept
+    : mData(std::exchange(rhs.mData, nullptr)), mSize(std::exchange(rhs.mSize, 0)),
+      mOpen(std::exchange(rhs.mOpen, false)), mError(std::move(rhs.mError)), mSystemError(rhs.mSystemError)
+{
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        Close();
+        mData = std::exchange(rhs.mData, nullptr);
+        mSize = std::exchange(rhs.mSize, 0);
+        mOpen = std::exchange(rhs.mOpen, false);
+        mError = std::move(rhs.mError);
+        mSystemError = rhs.mSystemError;
+    }
+    return *this;
+}
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+bool MappedFile::Fail(const std::string &message, int systemError)
+{
+    Close();
+    mError = message;
+    mSystemError = systemError;
+    if (systemError != 0)
+        mError += " (system error " + std::to_string(systemError) + ")";
+    return false;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::wstring &filename)
+{
+    Close();
+    mError.clear();
+    mSystemError = 0;
+
+    HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return Fail("cannot open the file", static_cast<int>(GetLastError()));
+
+    LARGE_INTEGER fileSize = {};
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        int error = static_cast<int>(GetLastError());
+        CloseHandle(file);
+        return Fail("cannot query the file size", error);
+    }
+    if (static_cast<ULONGLONG>(fileSize.QuadPart) > SIZE_MAX)
+    {
+        CloseHandle(file);
+        return Fail("the file is too large to map", 0);
+    }
+
+    // 不能为长度为 0 的文件创建映射对象
+    if (fileSize.QuadPart == 0)
+    {
+        CloseHandle(file);
+        mOpen = true;
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    int error = static_cast<int>(GetLastError());
+    CloseHandle(file);
+    if (mapping == nullptr)
+        return Fail("cannot create the file mapping", error);
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    error = static_cast<int>(GetLastError());
+    CloseHandle(mapping);
+    if (view == nullptr)
+        return Fail("cannot map a view of the file", error);
+
+    mData = static_cast<const std::uint8_t *>(view);
+    mSize = static_cast<std::size_t>(fileSize.QuadPart);
+    mOpen = true;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mData != nullptr)
+        UnmapViewOfFile(mData);
+
+    mData = nullptr;
+    mSize = 0;
+    mOpen = false;
+}
+
+void MappedFile::Prefetch(std::size_t offset, std::size_t size) const
+{
+    if (offset >= mSize || size == 0)
+        return;
+    Span<const std::uint8_t> range = Bytes(offset, size < mSize - offset ? size : mSize - offset);
+
+    // PrefetchVirtualMemory 从 Windows 8 开始提供，Windows 7 上只能等访问时按页调入
+#if _WIN32_WINNT >= 0x0602
+    WIN32_MEMORY_RANGE_ENTRY entry;
+    entry.VirtualAddress = const_cast<std::uint8_t *>(range.data());
+    entry.NumberOfBytes = range.size();
+    PrefetchVirtualMemory(GetCurrentProcess(), 1, &entry, 0);
+#endif
+}
+
+#else
+
+bool MappedFile::Open(const std::wstring &filename)
+{
+    Close();
+    mError.clear();
+    mSystemError = 0;
+
+    int fd = open(std::filesystem::path(filename).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return Fail("cannot open the file", errno);
+
+    struct stat status = {};
+    if (fstat(fd, &status) != 0)
+    {
+        int error = errno;
+        close(fd);
+        return Fail("cannot query the file size", error);
+    }
+
+    // 不能映射长度为 0 的区间
+    if (status.st_size == 0)
+    {
+        close(fd);
+        mOpen = true;
+        return true;
+    }
+
+    void *view = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    int error = errno;
+    close(fd);
+    if (view == MAP_FAILED)
+        return Fail("cannot map the file", error);
+
+    mData = static_cast<const std::uint8_t *>(view);
+    mSize = static_cast<std::size_t>(status.st_size);
+    mOpen = true;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (mData != nullptr)
+        munmap(const_cast<std::uint8_t *>(mData), mSize);
+
+    mData = nullptr;
+    mSize = 0;
+    mOpen = false;
+}
+
+void MappedFile::Prefetch(std::size_t offset, std::size_t size) const
+{
+    if (offset >= mSize || size == 0)
+        return;
+    Span<const std::uint8_t> range = Bytes(offset, size < mSize - offset ? size : mSize - offset);
+
+    // madvise 要求起始地址按页对齐
+    const auto pageSize = static_cast<std::uintptr_t>(sysconf(_SC_PAGESIZE));
+    const auto begin = reinterpret_cast<std::uintptr_t>(range.data()) & ~(pageSize - 1);
+    const auto end = reinterpret_cast<std::uintptr_t>(range.data()) + range.size();
+    madvise(reinterpret_cast<void *>(begin), end - begin, MADV_WILLNEED);
+}
+
+#endif
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "Span.h"
+#include <cstdint>
+#include <string>
+
+// 以只读方式映射到内存中的文件
+// 文件内容由操作系统按页调入，打开文件时不会读取也不会复制数据，Bytes() 返回的视图在 Close 或析构之前一直有效。
+// 只访问其中一部分的大文件（例如资源包）只有被访问到的页才会从磁盘读入；已知马上要用到的区间可以先调用 Prefetch，
+// 让操作系统在后台提前读取。Windows 与 POSIX 系统都可以使用。
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &rhs) = delete;
+    MappedFile &operator=(const MappedFile &rhs) = delete;
+    MappedFile(MappedFile &&rhs) noexcept;
+    MappedFile &operator=(MappedFile &&rhs) noexcept;
+    ~MappedFile();
+
+    // 失败时返回 false 并保持关闭状态，原因见 Error() 与 SystemError()。空文件可以打开，但 Bytes() 为空
+    bool Open(const std::wstring &filename);
+    void Close();
+
+    bool IsOpen() const
+    {
+        return mOpen;
+    }
+
+    const std::uint8_t *Data() const
+    {
+        return mData;
+    }
+
+    std::size_t Size() const
+    {
+        return mSize;
+    }
+
+    Span<const std::uint8_t> Bytes() const
+    {
+        return Span<const std::uint8_t>(mData, mSize);
+    }
+
+    // [offset, offset + size) 的视图，超出文件范围时返回空视图
+    Span<const std::uint8_t> Bytes(std::size_t offset, std::size_t size) const
+    {
+        if (offset > mSize || size > mSize - offset)
+            return Span<const std::uint8_t>();
+        return Span<const std::uint8_t>(mData + offset, size);
+    }
+
+    // 提示操作系统在后台调入 [offset, offset + size) 所在的页，不会阻塞调用线程。超出文件的部分被忽略
+    void Prefetch(std::size_t offset, std::size_t size) const;
+
+    // 上一次 Open 失败的原因
+    const std::string &Error() const
+    {
+        return mError;
+    }
+
+    // 上一次 Open 失败时的系统错误码（Windows 上为 GetLastError，其他系统上为 errno），不是系统调用失败时为 0
+    int SystemError() const
+    {
+        return mSystemError;
+    }
+
+  private:
+    bool Fail(const std::string &message, int systemError);
+
+  private:
+    // 映射建立之后文件句柄就可以关闭了，映射本身会保持对文件的引用
+    const std::uint8_t *mData = nullptr;
+    std::size_t mSize = 0;
+    bool mOpen = false;
+    std::string mError;
+    int mSystemError = 0;
+};
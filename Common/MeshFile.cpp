@@ -0,0 +1,378 @@
+#include "MeshFile.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+using namespace DirectX;
+
+namespace
+{
+std::uint64_t AlignUp(std::uint64_t value, std::uint64_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+// 检查 [offset, offset + size) 是否完全位于文件内（避免加法溢出）
+bool InRange(std::uint64_t offset, std::uint64_t size, std::uint64_t fileSize)
+{
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+BoundingBox ToBoundingBox(const float center[3], const float extents[3])
+{
+    return BoundingBox(XMFLOAT3(center[0], center[1], center[2]), XMFLOAT3(extents[0], extents[1], extents[2]));
+}
+
+void FromBoundingBox(const BoundingBox &box, float center[3], float extents[3])
+{
+    center[0] = box.Center.x;
+    center[1] = box.Center.y;
+    center[2] = box.Center.z;
+    extents[0] = box.Extents.x;
+    extents[1] = box.Extents.y;
+    extents[2] = box.Extents.z;
+}
+
+// 从表中逐项读取。文件中的表不一定满足结构体的对齐要求，所以用 memcpy
+template <typename T>
+T ReadEntry(const std::uint8_t *base, std::uint64_t offset, std::uint32_t index)
+{
+    T entry;
+    std::memcpy(&entry, base + offset + static_cast<std::uint64_t>(index) * sizeof(T), sizeof(T));
+    return entry;
+}
+} // namespace
+
+//
+// MeshFile
+//
+
+bool MeshFile::Open(const std::wstring &filename)
+{
+    Close();
+
+    if (!mFile.Open(filename))
+        return Fail("cannot open or map the file");
+
+    return Parse(mFile.Bytes());
+}
+
+bool MeshFile::Parse(Span<const std::uint8_t> bytes)
+{
+    mVersion = 0;
+    mVertexStreams.clear();
+    mIndexBuffers.clear();
+    mSubmeshes.clear();
+    mBounds = BoundingBox();
+    mError.clear();
+
+    const std::uint8_t *base = bytes.data();
+    const std::uint64_t size = bytes.size();
+
+    if (size < sizeof(MeshFileHeader))
+        return Fail("file is smaller than the header");
+    if (reinterpret_cast<std::uintptr_t>(base) % DataAlignment != 0)
+        return Fail("file data is not 16-byte aligned");
+
+    MeshFileHeader header;
+    std::memcpy(&header, base, sizeof(header));
+
+    if (header.Magic != Magic)
+        return Fail("not a mesh file");
+    if (header.Version == 0 || header.Version > CurrentVersion)
+        return Fail("unsupported mesh file version " + std::to_string(header.Version));
+    if (header.HeaderSize < sizeof(MeshFileHeader) || header.FileSize != size)
+        return Fail("header is corrupt");
+
+    // 各表的位置由各项数量推算
+    const std::uint64_t vertexTable = header.HeaderSize;
+    const std::uint64_t indexTable =
+        vertexTable + static_cast<std::uint64_t>(header.VertexStreamCount) * sizeof(MeshFileVertexStream);
+    const std::uint64_t submeshTable =
+        indexTable + static_cast<std::uint64_t>(header.IndexBufferCount) * sizeof(MeshFileIndexBuffer);
+    const std::uint64_t stringTable =
+        submeshTable + static_cast<std::uint64_t>(header.SubmeshCount) * sizeof(MeshFileSubmesh);
+
+    if (!InRange(stringTable, header.StringTableSize, size))
+        return Fail("tables extend past the end of the file");
+
+    const char *strings = reinterpret_cast<const char *>(base + stringTable);
+    auto readName = [&](std::uint32_t offset, std::string_view &name) {
+        if (offset >= header.StringTableSize)
+            return false;
+        const void *terminator = std::memchr(strings + offset, '\0', header.StringTableSize - offset);
+        if (terminator == nullptr)
+            return false;
+        name = std::string_view(strings + offset, static_cast<const char *>(terminator) - (strings + offset));
+        return true;
+    };
+
+    auto readData = [&](std::uint64_t offset, std::uint64_t dataSize, Span<const std::uint8_t> &data) {
+        if (offset % DataAlignment != 0 || !InRange(offset, dataSize, size))
+            return false;
+        data = Span<const std::uint8_t>(base + offset, static_cast<size_t>(dataSize));
+        return true;
+    };
+
+    mVertexStreams.resize(header.VertexStreamCount);
+    for (uint32 i = 0; i < header.VertexStreamCount; ++i)
+    {
+        auto desc = ReadEntry<MeshFileVertexStream>(base, vertexTable, i);
+        VertexStream &stream = mVertexStreams[i];
+        stream.ByteStride = desc.ByteStride;
+        stream.VertexCount = desc.VertexCount;
+
+        if (!readName(desc.NameOffset, stream.Name) ||
+            desc.DataSize != static_cast<std::uint64_t>(desc.ByteStride) * desc.VertexCount ||
+            !readData(desc.DataOffset, desc.DataSize, stream.Data))
+            return Fail("vertex stream " + std::to_string(i) + " is corrupt");
+    }
+
+    mIndexBuffers.resize(header.IndexBufferCount);
+    for (uint32 i = 0; i < header.IndexBufferCount; ++i)
+    {
+        auto desc = ReadEntry<MeshFileIndexBuffer>(base, indexTable, i);
+        IndexBuffer &indexBuffer = mIndexBuffers[i];
+        indexBuffer.IndexByteSize = desc.IndexByteSize;
+        indexBuffer.IndexCount = desc.IndexCount;
+
+        if (!readName(desc.NameOffset, indexBuffer.Name) || (desc.IndexByteSize != 2 && desc.IndexByteSize != 4) ||
+            desc.DataSize != static_cast<std::uint64_t>(desc.IndexByteSize) * desc.IndexCount ||
+            !readData(desc.DataOffset, desc.DataSize, indexBuffer.Data))
+            return Fail("index buffer " + std::to_string(i) + " is corrupt");
+    }
+
+    mSubmeshes.resize(header.SubmeshCount);
+    for (uint32 i = 0; i < header.SubmeshCount; ++i)
+    {
+        auto desc = ReadEntry<MeshFileSubmesh>(base, submeshTable, i);
+        Submesh &submesh = mSubmeshes[i];
+        submesh.VertexStream = desc.VertexStream;
+        submesh.IndexBuffer = desc.IndexBuffer;
+        submesh.IndexCount = desc.IndexCount;
+        submesh.StartIndexLocation = desc.StartIndexLocation;
+        submesh.BaseVertexLocation = desc.BaseVertexLocation;
+        submesh.Bounds = ToBoundingBox(desc.BoundsCenter, desc.BoundsExtents);
+
+        if (!readName(desc.NameOffset, submesh.Name) || desc.VertexStream >= header.VertexStreamCount ||
+            desc.IndexBuffer >= header.IndexBufferCount ||
+            static_cast<std::uint64_t>(desc.StartIndexLocation) + desc.IndexCount >
+                mIndexBuffers[desc.IndexBuffer].IndexCount)
+            return Fail("submesh " + std::to_string(i) + " is corrupt");
+    }
+
+    mVersion = header.Version;
+    mBounds = ToBoundingBox(header.BoundsCenter, header.BoundsExtents);
+    return true;
+}
+
+void MeshFile::Close()
+{
+    mFile.Close();
+    mVersion = 0;
+    mVertexStreams.clear();
+    mIndexBuffers.clear();
+    mSubmeshes.clear();
+    mBounds = BoundingBox();
+    mError.clear();
+}
+
+const MeshFile::Submesh *MeshFile::FindSubmesh(std::string_view name) const
+{
+    for (const auto &submesh : mSubmeshes)
+    {
+        if (submesh.Name == name)
+            return &submesh;
+    }
+    return nullptr;
+}
+
+bool MeshFile::Fail(const std::string &message)
+{
+    mFile.Close();
+    mVertexStreams.clear();
+    mIndexBuffers.clear();
+    mSubmeshes.clear();
+    mError = message;
+    return false;
+}
+
+//
+// MeshFileWriter
+//
+
+MeshFileWriter::uint32 MeshFileWriter::AddVertexStream(const std::string &name, const void *vertices,
+                                                       uint32 byteStride, uint32 vertexCount)
+{
+    assert(byteStride > 0);
+
+    Stream stream;
+    stream.Name = name;
+    stream.Stride = byteStride;
+    stream.Count = vertexCount;
+    auto bytes = static_cast<const std::uint8_t *>(vertices);
+    stream.Data.assign(bytes, bytes + static_cast<size_t>(byteStride) * vertexCount);
+
+    mVertexStreams.push_back(std::move(stream));
+    return static_cast<uint32>(mVertexStreams.size() - 1);
+}
+
+MeshFileWriter::uint32 MeshFileWriter::AddIndexBuffer(const std::string &name, const std::uint16_t *indices,
+                                                      uint32 indexCount)
+{
+    return AddIndexBuffer(name, indices, sizeof(std::uint16_t), indexCount);
+}
+
+MeshFileWriter::uint32 MeshFileWriter::AddIndexBuffer(const std::string &name, const std::uint32_t *indices,
+                                                      uint32 indexCount)
+{
+    return AddIndexBuffer(name, indices, sizeof(std::uint32_t), indexCount);
+}
+
+MeshFileWriter::uint32 MeshFileWriter::AddIndexBuffer(const std::string &name, const void *indices,
+                                                      uint32 indexByteSize, uint32 indexCount)
+{
+    Stream stream;
+    stream.Name = name;
+    stream.Stride = indexByteSize;
+    stream.Count = indexCount;
+    auto bytes = static_cast<const std::uint8_t *>(indices);
+    stream.Data.assign(bytes, bytes + static_cast<size_t>(indexByteSize) * indexCount);
+
+    mIndexBuffers.push_back(std::move(stream));
+    return static_cast<uint32>(mIndexBuffers.size() - 1);
+}
+
+void MeshFileWriter::AddSubmesh(const std::string &name, uint32 vertexStream, uint32 indexBuffer, uint32 indexCount,
+                                uint32 startIndexLocation, std::int32_t baseVertexLocation,
+                                const BoundingBox &bounds)
+{
+    assert(vertexStream < mVertexStreams.size());
+    assert(indexBuffer < mIndexBuffers.size());
+    assert(static_cast<std::uint64_t>(startIndexLocation) + indexCount <= mIndexBuffers[indexBuffer].Count);
+
+    Submesh submesh;
+    submesh.Name = name;
+    submesh.Desc.VertexStream = vertexStream;
+    submesh.Desc.IndexBuffer = indexBuffer;
+    submesh.Desc.IndexCount = indexCount;
+    submesh.Desc.StartIndexLocation = startIndexLocation;
+    submesh.Desc.BaseVertexLocation = baseVertexLocation;
+    FromBoundingBox(bounds, submesh.Desc.BoundsCenter, submesh.Desc.BoundsExtents);
+
+    mSubmeshes.push_back(std::move(submesh));
+}
+
+std::vector<std::uint8_t> MeshFileWriter::Serialize() const
+{
+    std::string strings;
+    auto addName = [&strings](const std::string &name) {
+        auto offset = static_cast<std::uint32_t>(strings.size());
+        strings.append(name);
+        strings.push_back('\0');
+        return offset;
+    };
+
+    std::vector<MeshFileVertexStream> vertexTable(mVertexStreams.size());
+    std::vector<MeshFileIndexBuffer> indexTable(mIndexBuffers.size());
+    std::vector<MeshFileSubmesh> submeshTable(mSubmeshes.size());
+
+    for (size_t i = 0; i < mVertexStreams.size(); ++i)
+        vertexTable[i].NameOffset = addName(mVertexStreams[i].Name);
+    for (size_t i = 0; i < mIndexBuffers.size(); ++i)
+        indexTable[i].NameOffset = addName(mIndexBuffers[i].Name);
+    for (size_t i = 0; i < mSubmeshes.size(); ++i)
+    {
+        submeshTable[i] = mSubmeshes[i].Desc;
+        submeshTable[i].NameOffset = addName(mSubmeshes[i].Name);
+    }
+
+    MeshFileHeader header;
+    header.Magic = MeshFile::Magic;
+    header.Version = MeshFile::CurrentVersion;
+    header.HeaderSize = sizeof(MeshFileHeader);
+    header.VertexStreamCount = static_cast<std::uint32_t>(mVertexStreams.size());
+    header.IndexBufferCount = static_cast<std::uint32_t>(mIndexBuffers.size());
+    header.SubmeshCount = static_cast<std::uint32_t>(mSubmeshes.size());
+    header.StringTableSize = static_cast<std::uint32_t>(strings.size());
+
+    // 依次为各数据段分配 16 字节对齐的位置
+    std::uint64_t offset = sizeof(MeshFileHeader) + vertexTable.size() * sizeof(MeshFileVertexStream) +
+                           indexTable.size() * sizeof(MeshFileIndexBuffer) +
+                           submeshTable.size() * sizeof(MeshFileSubmesh) + strings.size();
+
+    auto placeData = [&offset](const Stream &stream, std::uint64_t &dataOffset, std::uint64_t &dataSize) {
+        offset = AlignUp(offset, MeshFile::DataAlignment);
+        dataOffset = offset;
+        dataSize = stream.Data.size();
+        offset += dataSize;
+    };
+
+    for (size_t i = 0; i < mVertexStreams.size(); ++i)
+    {
+        vertexTable[i].ByteStride = mVertexStreams[i].Stride;
+        vertexTable[i].VertexCount = mVertexStreams[i].Count;
+        placeData(mVertexStreams[i], vertexTable[i].DataOffset, vertexTable[i].DataSize);
+    }
+    for (size_t i = 0; i < mIndexBuffers.size(); ++i)
+    {
+        indexTable[i].IndexByteSize = mIndexBuffers[i].Stride;
+        indexTable[i].IndexCount = mIndexBuffers[i].Count;
+        placeData(mIndexBuffers[i], indexTable[i].DataOffset, indexTable[i].DataSize);
+    }
+    header.FileSize = offset;
+
+    // 整个文件的包围盒为各子网格包围盒的并集
+    if (!mSubmeshes.empty())
+    {
+        BoundingBox bounds = ToBoundingBox(submeshTable[0].BoundsCenter, submeshTable[0].BoundsExtents);
+        for (size_t i = 1; i < submeshTable.size(); ++i)
+        {
+            BoundingBox::CreateMerged(bounds, bounds,
+                                      ToBoundingBox(submeshTable[i].BoundsCenter, submeshTable[i].BoundsExtents));
+        }
+        FromBoundingBox(bounds, header.BoundsCenter, header.BoundsExtents);
+    }
+
+    // 对齐产生的空隙保持为 0
+    std::vector<std::uint8_t> bytes(static_cast<size_t>(offset), 0);
+    std::uint8_t *cursor = bytes.data();
+    auto write = [&cursor](const void *data, size_t size) {
+        if (size > 0)
+            std::memcpy(cursor, data, size);
+        cursor += size;
+    };
+
+    write(&header, sizeof(header));
+    write(vertexTable.data(), vertexTable.size() * sizeof(MeshFileVertexStream));
+    write(indexTable.data(), indexTable.size() * sizeof(MeshFileIndexBuffer));
+    write(submeshTable.data(), submeshTable.size() * sizeof(MeshFileSubmesh));
+    write(strings.data(), strings.size());
+
+    for (size_t i = 0; i < mVertexStreams.size(); ++i)
+    {
+        if (!mVertexStreams[i].Data.empty())
+            std::memcpy(bytes.data() + vertexTable[i].DataOffset, mVertexStreams[i].Data.data(),
+                        mVertexStreams[i].Data.size());
+    }
+    for (size_t i = 0; i < mIndexBuffers.size(); ++i)
+    {
+        if (!mIndexBuffers[i].Data.empty())
+            std::memcpy(bytes.data() + indexTable[i].DataOffset, mIndexBuffers[i].Data.data(),
+                        mIndexBuffers[i].Data.size());
+    }
+
+    return bytes;
+}
+
+bool MeshFileWriter::Write(const std::wstring &filename) const
+{
+    std::vector<std::uint8_t> bytes = Serialize();
+
+    std::ofstream fout(std::filesystem::path(filename), std::ios::binary | std::ios::trunc);
+    if (!fout)
+        return false;
+
+    fout.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    return static_cast<bool>(fout);
+}
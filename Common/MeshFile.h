@@ -0,0 +1,232 @@
+#pragma once
+
+#include "MappedFile.h"
+#include "Span.h"
+#include <DirectXCollision.h>
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// 二进制网格容器（.mesh）
+// 演示程序中的几何体都在 Build*Geometry 中以程序方式生成。对于较大的场景，可以离线生成一次并写入此格式，
+// 运行时通过内存映射打开文件，顶点/索引数据直接以 Span 的形式交给 CreateDefaultBuffer 上传，不再经过额外的复制。
+//
+// 文件布局（小端序，所有数据段按 16 字节对齐）：
+//   MeshFileHeader
+//   MeshFileVertexStream[VertexStreamCount]
+//   MeshFileIndexBuffer[IndexBufferCount]
+//   MeshFileSubmesh[SubmeshCount]
+//   字符串表（以 '\0' 结尾的名称依次排列）
+//   各顶点流与索引缓冲区的数据
+//
+// 版本号在布局发生不兼容变化时递增；文件头记录了自身的大小，以便以后在文件头末尾追加字段而不破坏旧的读取代码。
+
+struct MeshFileHeader
+{
+    std::uint32_t Magic = 0;
+    std::uint32_t Version = 0;
+    std::uint32_t HeaderSize = 0;
+    std::uint32_t VertexStreamCount = 0;
+    std::uint32_t IndexBufferCount = 0;
+    std::uint32_t SubmeshCount = 0;
+    std::uint32_t StringTableSize = 0;
+    std::uint32_t Reserved = 0;
+    std::uint64_t FileSize = 0;
+    // 所有子网格包围盒的并集
+    float BoundsCenter[3] = {};
+    float BoundsExtents[3] = {};
+};
+
+struct MeshFileVertexStream
+{
+    std::uint32_t NameOffset = 0;
+    std::uint32_t ByteStride = 0;
+    std::uint32_t VertexCount = 0;
+    std::uint32_t Reserved = 0;
+    std::uint64_t DataOffset = 0;
+    std::uint64_t DataSize = 0;
+};
+
+struct MeshFileIndexBuffer
+{
+    std::uint32_t NameOffset = 0;
+    // 每个索引所占的字节数：2 或 4
+    std::uint32_t IndexByteSize = 0;
+    std::uint32_t IndexCount = 0;
+    std::uint32_t Reserved = 0;
+    std::uint64_t DataOffset = 0;
+    std::uint64_t DataSize = 0;
+};
+
+struct MeshFileSubmesh
+{
+    std::uint32_t NameOffset = 0;
+    std::uint32_t VertexStream = 0;
+    std::uint32_t IndexBuffer = 0;
+    // 以下三项与 SubmeshGeometry 相同
+    std::uint32_t IndexCount = 0;
+    std::uint32_t StartIndexLocation = 0;
+    std::int32_t BaseVertexLocation = 0;
+    float BoundsCenter[3] = {};
+    float BoundsExtents[3] = {};
+};
+
+// 读取 .mesh 文件。所有 Span 与名称都指向映射的文件（或 Parse 传入的内存），在 Close/再次打开之前有效
+class MeshFile
+{
+  public:
+    using uint32 = std::uint32_t;
+
+    static const uint32 Magic = 0x464d5844; // "DXMF"
+    static const uint32 CurrentVersion = 1;
+    static const uint32 DataAlignment = 16;
+
+    struct VertexStream
+    {
+        std::string_view Name;
+        uint32 ByteStride = 0;
+        uint32 VertexCount = 0;
+        Span<const std::uint8_t> Data;
+    };
+
+    struct IndexBuffer
+    {
+        std::string_view Name;
+        uint32 IndexByteSize = 0;
+        uint32 IndexCount = 0;
+        Span<const std::uint8_t> Data;
+
+        // 数据段按 16 字节对齐，可以直接按索引类型访问
+        Span<const std::uint16_t> Indices16() const
+        {
+            assert(IndexByteSize == 2);
+            return Span<const std::uint16_t>(reinterpret_cast<const std::uint16_t *>(Data.data()), IndexCount);
+        }
+
+        Span<const std::uint32_t> Indices32() const
+        {
+            assert(IndexByteSize == 4);
+            return Span<const std::uint32_t>(reinterpret_cast<const std::uint32_t *>(Data.data()), IndexCount);
+        }
+    };
+
+    struct Submesh
+    {
+        std::string_view Name;
+        uint32 VertexStream = 0;
+        uint32 IndexBuffer = 0;
+        uint32 IndexCount = 0;
+        uint32 StartIndexLocation = 0;
+        std::int32_t BaseVertexLocation = 0;
+        DirectX::BoundingBox Bounds;
+    };
+
+    MeshFile() = default;
+    MeshFile(const MeshFile &rhs) = delete;
+    MeshFile &operator=(const MeshFile &rhs) = delete;
+
+    // 映射并解析文件。失败时返回 false，原因见 Error()
+    bool Open(const std::wstring &filename);
+
+    // 解析已在内存中的文件内容，bytes 必须至少 16 字节对齐，并且在使用本对象期间保持有效
+    bool Parse(Span<const std::uint8_t> bytes);
+
+    void Close();
+
+    const std::string &Error() const
+    {
+        return mError;
+    }
+
+    uint32 Version() const
+    {
+        return mVersion;
+    }
+
+    const std::vector<VertexStream> &VertexStreams() const
+    {
+        return mVertexStreams;
+    }
+
+    const std::vector<IndexBuffer> &IndexBuffers() const
+    {
+        return mIndexBuffers;
+    }
+
+    const std::vector<Submesh> &Submeshes() const
+    {
+        return mSubmeshes;
+    }
+
+    const DirectX::BoundingBox &Bounds() const
+    {
+        return mBounds;
+    }
+
+    // 找不到时返回 nullptr
+    const Submesh *FindSubmesh(std::string_view name) const;
+
+  private:
+    bool Fail(const std::string &message);
+
+  private:
+    MappedFile mFile;
+    uint32 mVersion = 0;
+    std::vector<VertexStream> mVertexStreams;
+    std::vector<IndexBuffer> mIndexBuffers;
+    std::vector<Submesh> mSubmeshes;
+    DirectX::BoundingBox mBounds;
+    std::string mError;
+};
+
+// 生成 .mesh 文件。数据在 Add* 时被复制，调用者无需保持其有效
+class MeshFileWriter
+{
+  public:
+    using uint32 = std::uint32_t;
+
+    // 返回顶点流的序号
+    uint32 AddVertexStream(const std::string &name, const void *vertices, uint32 byteStride, uint32 vertexCount);
+
+    template <typename Vertex>
+    uint32 AddVertexStream(const std::string &name, const std::vector<Vertex> &vertices)
+    {
+        return AddVertexStream(name, vertices.data(), sizeof(Vertex), static_cast<uint32>(vertices.size()));
+    }
+
+    // 返回索引缓冲区的序号
+    uint32 AddIndexBuffer(const std::string &name, const std::uint16_t *indices, uint32 indexCount);
+    uint32 AddIndexBuffer(const std::string &name, const std::uint32_t *indices, uint32 indexCount);
+
+    void AddSubmesh(const std::string &name, uint32 vertexStream, uint32 indexBuffer, uint32 indexCount,
+                    uint32 startIndexLocation, std::int32_t baseVertexLocation, const DirectX::BoundingBox &bounds);
+
+    std::vector<std::uint8_t> Serialize() const;
+
+    // 失败时返回 false
+    bool Write(const std::wstring &filename) const;
+
+  private:
+    struct Stream
+    {
+        std::string Name;
+        uint32 Stride = 0;
+        uint32 Count = 0;
+        std::vector<std::uint8_t> Data;
+    };
+
+    struct Submesh
+    {
+        std::string Name;
+        MeshFileSubmesh Desc;
+    };
+
+    uint32 AddIndexBuffer(const std::string &name, const void *indices, uint32 indexByteSize, uint32 indexCount);
+
+  private:
+    std::vector<Stream> mVertexStreams;
+    std::vector<Stream> mIndexBuffers;
+    std::vector<Submesh> mSubmeshes;
+};
@@ -0,0 +1,153 @@
+#include "MeshGeometryBuilder.h"
+
+using namespace DirectX;
+
+MeshGeometryBuilder::MeshGeometryBuilder(uint32 vertexByteStride)
+    : mVertexByteStride(vertexByteStride), mIndices(false)
+{
+    assert(vertexByteStride > 0);
+}
+
+void MeshGeometryBuilder::Reserve(size_t vertexCount, size_t indexCount)
+{
+    mVertices.reserve(vertexCount * mVertexByteStride);
+    mIndices.Reserve(indexCount);
+}
+
+std::uint8_t *MeshGeometryBuilder::AllocateVertices(size_t count)
+{
+    size_t offset = mVertices.size();
+    mVertices.resize(offset + count * mVertexByteStride);
+    mVertexCount += static_cast<uint32>(count);
+    return mVertices.data() + offset;
+}
+
+void MeshGeometryBuilder::AddMesh(const std::string &name, const void *vertices, uint32 vertexCount,
+                                  const uint32 *indices, size_t indexCount, const BoundingBox &bounds)
+{
+    std::uint8_t *dst = AllocateVertices(vertexCount);
+    if (vertexCount > 0)
+        std::memcpy(dst, vertices, static_cast<size_t>(vertexCount) * mVertexByteStride);
+
+    AddSubmesh(name, mVertexCount - vertexCount, indices, indexCount, bounds);
+}
+
+void MeshGeometryBuilder::AddIndices(const std::string &name, const std::string &baseName, const uint32 *indices,
+                                     size_t indexCount)
+{
+    auto it = mEntryLookup.find(baseName);
+    assert(it != mEntryLookup.end());
+
+    const Entry &base = mEntries[it->second];
+    AddSubmesh(name, base.BaseVertex, indices, indexCount, base.Bounds);
+}
+
+void MeshGeometryBuilder::AddSubmesh(const std::string &name, uint32 baseVertex, const uint32 *indices,
+                                     size_t indexCount, const BoundingBox &bounds)
+{
+    assert(mEntryLookup.find(name) == mEntryLookup.end());
+
+    Entry entry;
+    entry.Name = name;
+    entry.IndexSubmesh = mIndices.AddSubmesh(indices, indexCount, static_cast<std::int32_t>(baseVertex));
+    entry.BaseVertex = baseVertex;
+    entry.Bounds = bounds;
+
+    mEntryLookup[name] = mEntries.size();
+    mEntries.push_back(std::move(entry));
+}
+
+std::unique_ptr<MeshGeometry> MeshGeometryBuilder::Build(ID3D12Device *device, ID3D12GraphicsCommandList *cmdList,
+                                                         const std::string &name)
+{
+    assert(!mVertices.empty() && !mEntries.empty());
+    mIndices.Build();
+
+    const UINT vbByteSize = (UINT)mVertices.size();
+    const UINT ibByteSize = (UINT)mIndices.DataByteSize();
+    // 索引数据紧跟在顶点数据之后，按 16 字节对齐
+    const UINT64 ibOffset = (vbByteSize + 15) & ~15ull;
+
+    auto geo = CreateGeometry(name);
+
+    auto defaultHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    auto vbDesc = CD3DX12_RESOURCE_DESC::Buffer(vbByteSize);
+    auto ibDesc = CD3DX12_RESOURCE_DESC::Buffer(ibByteSize);
+    ThrowIfFailed(device->CreateCommittedResource(&defaultHeap, D3D12_HEAP_FLAG_NONE, &vbDesc,
+                                                  D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                  IID_PPV_ARGS(geo->VertexBufferGPU.GetAddressOf())));
+    ThrowIfFailed(device->CreateCommittedResource(&defaultHeap, D3D12_HEAP_FLAG_NONE, &ibDesc,
+                                                  D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                  IID_PPV_ARGS(geo->IndexBufferGPU.GetAddressOf())));
+
+    // 顶点与索引共用一个上传缓冲区
+    auto uploadHeap = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+    auto uploadDesc = CD3DX12_RESOURCE_DESC::Buffer(ibOffset + ibByteSize);
+    ThrowIfFailed(device->CreateCommittedResource(&uploadHeap, D3D12_HEAP_FLAG_NONE, &uploadDesc,
+                                                  D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                                  IID_PPV_ARGS(geo->VertexBufferUploader.GetAddressOf())));
+
+    // 我们不会在 CPU 端读取上传缓冲区
+    CD3DX12_RANGE readRange(0, 0);
+    std::uint8_t *mapped = nullptr;
+    ThrowIfFailed(geo->VertexBufferUploader->Map(0, &readRange, reinterpret_cast<void **>(&mapped)));
+    std::memcpy(mapped, mVertices.data(), vbByteSize);
+    std::memcpy(mapped + ibOffset, mIndices.Data(), ibByteSize);
+    geo->VertexBufferUploader->Unmap(0, nullptr);
+
+    // 两个缓冲区的状态转换都合并为一次 ResourceBarrier 调用
+    D3D12_RESOURCE_BARRIER barriers[2] = {
+        CD3DX12_RESOURCE_BARRIER::Transition(geo->VertexBufferGPU.Get(), D3D12_RESOURCE_STATE_COMMON,
+                                             D3D12_RESOURCE_STATE_COPY_DEST),
+        CD3DX12_RESOURCE_BARRIER::Transition(geo->IndexBufferGPU.Get(), D3D12_RESOURCE_STATE_COMMON,
+                                             D3D12_RESOURCE_STATE_COPY_DEST)};
+    cmdList->ResourceBarrier(2, barriers);
+
+    cmdList->CopyBufferRegion(geo->VertexBufferGPU.Get(), 0, geo->VertexBufferUploader.Get(), 0, vbByteSize);
+    cmdList->CopyBufferRegion(geo->IndexBufferGPU.Get(), 0, geo->VertexBufferUploader.Get(), ibOffset, ibByteSize);
+
+    barriers[0] = CD3DX12_RESOURCE_BARRIER::Transition(geo->VertexBufferGPU.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
+                                                       D3D12_RESOURCE_STATE_GENERIC_READ);
+    barriers[1] = CD3DX12_RESOURCE_BARRIER::Transition(geo->IndexBufferGPU.Get(), D3D12_RESOURCE_STATE_COPY_DEST,
+                                                       D3D12_RESOURCE_STATE_GENERIC_READ);
+    cmdList->ResourceBarrier(2, barriers);
+
+    return geo;
+}
+
+std::unique_ptr<MeshGeometry> MeshGeometryBuilder::Build(UploadBatch &uploadBatch, const std::string &name)
+{
+    assert(!mVertices.empty() && !mEntries.empty());
+    mIndices.Build();
+
+    auto geo = CreateGeometry(name);
+    geo->VertexBufferGPU = uploadBatch.CreateDefaultBuffer(mVertices.data(), geo->VertexBufferByteSize);
+    geo->IndexBufferGPU = uploadBatch.CreateDefaultBuffer(mIndices.Data(), geo->IndexBufferByteSize);
+
+    return geo;
+}
+
+std::unique_ptr<MeshGeometry> MeshGeometryBuilder::CreateGeometry(const std::string &name) const
+{
+    auto geo = std::make_unique<MeshGeometry>();
+    geo->Name = name;
+    geo->VertexByteStride = mVertexByteStride;
+    geo->VertexBufferByteSize = (UINT)mVertices.size();
+    geo->IndexFormat = mIndices.IndexByteSize() == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    geo->IndexBufferByteSize = (UINT)mIndices.DataByteSize();
+
+    for (const auto &entry : mEntries)
+    {
+        // 不允许拆分，每个子网格恰好对应一段
+        const IndexBufferBuilder::Range &range = mIndices.Ranges()[mIndices.GetSubmesh(entry.IndexSubmesh).FirstRange];
+
+        SubmeshGeometry submesh;
+        submesh.IndexCount = range.IndexCount;
+        submesh.StartIndexLocation = range.StartIndexLocation;
+        submesh.BaseVertexLocation = range.BaseVertexLocation;
+        submesh.Bounds = entry.Bounds;
+        geo->DrawArgs[entry.Name] = submesh;
+    }
+
+    return geo;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+#include "IndexBufferBuilder.h"
+#include "UploadBatch.h"
+#include "d3dUtil.h"
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// 把多个网格合并到同一对顶点/索引缓冲区中
+// 演示程序原本要手动计算每个物体在合并缓冲区中的顶点偏移（BaseVertexLocation）与起始索引（StartIndexLocation），
+// 再逐个元素地复制顶点与索引。MeshGeometryBuilder 在添加网格时自动计算这些偏移量，顶点按目标格式直接写入
+// 合并后的缓冲区；索引宽度由 IndexBufferBuilder 选择。Build 时顶点与索引共用一个上传缓冲区，一次性上传。
+class MeshGeometryBuilder
+{
+  public:
+    using uint32 = std::uint32_t;
+
+    explicit MeshGeometryBuilder(uint32 vertexByteStride);
+
+    // 预留所有网格的顶点与索引总数，避免添加过程中反复扩容
+    void Reserve(size_t vertexCount, size_t indexCount);
+
+    // 添加一个网格，convert 把 GeometryGenerator::Vertex 转换为目标顶点格式 Vertex。
+    // 子网格的包围盒由顶点位置计算得出。索引宽度要等到所有网格都添加完才能确定，
+    // 所以各子网格最终的 SubmeshGeometry 在 Build 之后才能从 MeshGeometry::DrawArgs 中得到
+    template <typename Vertex, typename Convert>
+    void AddMesh(const std::string &name, const GeometryGenerator::MeshData &meshData, Convert convert)
+    {
+        static_assert(std::is_trivially_copyable_v<Vertex>, "Vertex must be trivially copyable");
+        assert(sizeof(Vertex) == mVertexByteStride);
+
+        std::uint8_t *dst = AllocateVertices(meshData.Vertices.size());
+        for (const auto &v : meshData.Vertices)
+        {
+            Vertex vertex = convert(v);
+            std::memcpy(dst, &vertex, sizeof(Vertex));
+            dst += sizeof(Vertex);
+        }
+
+        DirectX::BoundingBox bounds;
+        if (!meshData.Vertices.empty())
+        {
+            DirectX::BoundingBox::CreateFromPoints(bounds, meshData.Vertices.size(), &meshData.Vertices[0].Position,
+                                                   sizeof(GeometryGenerator::Vertex));
+        }
+
+        AddSubmesh(name, mVertexCount - static_cast<uint32>(meshData.Vertices.size()), meshData.Indices32.data(),
+                   meshData.Indices32.size(), bounds);
+    }
+
+    // 添加一个已经是目标格式的网格
+    void AddMesh(const std::string &name, const void *vertices, uint32 vertexCount, const uint32 *indices,
+                 size_t indexCount, const DirectX::BoundingBox &bounds);
+
+    // 添加一组与已添加的网格 baseName 共用顶点的索引（例如 LOD），包围盒沿用 baseName 的
+    void AddIndices(const std::string &name, const std::string &baseName, const uint32 *indices, size_t indexCount);
+
+    uint32 VertexCount() const
+    {
+        return mVertexCount;
+    }
+
+    // 生成 MeshGeometry 并记录上传命令。顶点与索引共用一个上传缓冲区（保存在 VertexBufferUploader 中），
+    // 与 CreateDefaultBuffer 相同，要等到命令执行完毕之后才能调用 DisposeUploaders
+    std::unique_ptr<MeshGeometry> Build(ID3D12Device *device, ID3D12GraphicsCommandList *cmdList,
+                                        const std::string &name);
+
+    // 同上，但上传数据登记到 uploadBatch 中，由调用者统一 Record；生成的 MeshGeometry 不持有上传缓冲区
+    std::unique_ptr<MeshGeometry> Build(UploadBatch &uploadBatch, const std::string &name);
+
+  private:
+    std::uint8_t *AllocateVertices(size_t count);
+
+    // 填写除 GPU 缓冲区以外的字段，要求 mIndices 已经 Build
+    std::unique_ptr<MeshGeometry> CreateGeometry(const std::string &name) const;
+
+    void AddSubmesh(const std::string &name, uint32 baseVertex, const uint32 *indices, size_t indexCount,
+                    const DirectX::BoundingBox &bounds);
+
+  private:
+    struct Entry
+    {
+        std::string Name;
+        uint32 IndexSubmesh = 0;
+        uint32 BaseVertex = 0;
+        DirectX::BoundingBox Bounds;
+    };
+
+    uint32 mVertexByteStride;
+    uint32 mVertexCount = 0;
+    std::vector<std::uint8_t> mVertices;
+    IndexBufferBuilder mIndices;
+    std::vector<Entry> mEntries;
+    std::unordered_map<std::string, size_t> mEntryLookup;
+};
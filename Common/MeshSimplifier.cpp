@@ -0,0 +1,587 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <queue>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+// 对称 4x4 矩阵形式的二次误差：Q(p) = p^T A p + 2 b^T p + c，再除以累计权重（三角形面积）即得到平方距离
+struct Quadric
+{
+    double A00 = 0.0, A01 = 0.0, A02 = 0.0, A11 = 0.0, A12 = 0.0, A22 = 0.0;
+    double B0 = 0.0, B1 = 0.0, B2 = 0.0;
+    double C = 0.0;
+    double Weight = 0.0;
+
+    void AddPlane(double nx, double ny, double nz, double d, double weight)
+    {
+        A00 += weight * nx * nx;
+        A01 += weight * nx * ny;
+        A02 += weight * nx * nz;
+        A11 += weight * ny * ny;
+        A12 += weight * ny * nz;
+        A22 += weight * nz * nz;
+        B0 += weight * nx * d;
+        B1 += weight * ny * d;
+        B2 += weight * nz * d;
+        C += weight * d * d;
+        Weight += weight;
+    }
+
+    Quadric &operator+=(const Quadric &q)
+    {
+        A00 += q.A00;
+        A01 += q.A01;
+        A02 += q.A02;
+        A11 += q.A11;
+        A12 += q.A12;
+        A22 += q.A22;
+        B0 += q.B0;
+        B1 += q.B1;
+        B2 += q.B2;
+        C += q.C;
+        Weight += q.Weight;
+        return *this;
+    }
+
+    double Evaluate(double x, double y, double z) const
+    {
+        double r = x * x * A00 + y * y * A11 + z * z * A22 + 2.0 * (x * y * A01 + x * z * A02 + y * z * A12) +
+                   2.0 * (x * B0 + y * B1 + z * B2) + C;
+        return Weight > 0.0 ? std::max(r, 0.0) / Weight : 0.0;
+    }
+};
+
+// 候选折叠：把顶点 From 合并到顶点 To 上
+struct Collapse
+{
+    double Cost;
+    std::uint32_t From;
+    std::uint32_t To;
+
+    // std::priority_queue 为大顶堆，反转比较以取出误差最小的候选
+    bool operator<(const Collapse &rhs) const
+    {
+        return Cost > rhs.Cost;
+    }
+};
+
+class QemSimplifier
+{
+  public:
+    using uint32 = std::uint32_t;
+
+    QemSimplifier(const XMFLOAT3 *positions, size_t positionStride, size_t vertexCount,
+                  const std::vector<uint32> &indices);
+
+    // 持续折叠，直到存活的索引数不大于 targetIndexCount，或最小的折叠误差超过 maxError
+    void Run(size_t targetIndexCount, float maxError);
+
+    std::vector<uint32> GetIndices() const;
+
+    size_t LiveIndexCount() const
+    {
+        return mLiveTriangles * 3;
+    }
+
+    // 被移除的原始顶点到简化后网格的最大距离。二次误差只是面积加权的平均平方距离，
+    // 不能作为屏幕空间误差的上界，因此在这里逐个顶点实际测量
+    float MaxError() const;
+
+  private:
+    const XMFLOAT3 &Position(uint32 v) const
+    {
+        return *reinterpret_cast<const XMFLOAT3 *>(reinterpret_cast<const std::uint8_t *>(mPositions) + v * mStride);
+    }
+
+    double Cost(uint32 from, uint32 to) const;
+    bool IsValid(uint32 from, uint32 to) const;
+    void Apply(uint32 from, uint32 to);
+    void PushEdges(uint32 v);
+
+  private:
+    const XMFLOAT3 *mPositions;
+    size_t mStride;
+
+    std::vector<uint32> mTriangles;
+    std::vector<bool> mTriangleAlive;
+    size_t mLiveTriangles = 0;
+
+    // 位置相同的顶点共用一个“规范顶点”，二次误差在规范顶点上累计
+    std::vector<uint32> mCanonical;
+    std::vector<Quadric> mQuadrics;
+    std::vector<bool> mLocked;
+    std::vector<bool> mRemoved;
+
+    // 每个顶点所属的三角形，可能包含已失效的三角形
+    std::vector<std::vector<uint32>> mVertexTriangles;
+    // 被移除的顶点合并到了哪个顶点上
+    std::vector<uint32> mCollapsedTo;
+
+    std::priority_queue<Collapse> mQueue;
+};
+
+// 点 p 到三角形 abc 的最近距离（Ericson, Real-Time Collision Detection 5.1.5）
+double PointTriangleDistance(const XMFLOAT3 &point, const XMFLOAT3 &pa, const XMFLOAT3 &pb, const XMFLOAT3 &pc)
+{
+    const double p[3] = {point.x, point.y, point.z};
+    const double a[3] = {pa.x, pa.y, pa.z};
+    const double b[3] = {pb.x, pb.y, pb.z};
+    const double c[3] = {pc.x, pc.y, pc.z};
+
+    auto dot = [](const double *u, const double *v) { return u[0] * v[0] + u[1] * v[1] + u[2] * v[2]; };
+    auto distanceTo = [&p](double x, double y, double z) {
+        return std::sqrt((p[0] - x) * (p[0] - x) + (p[1] - y) * (p[1] - y) + (p[2] - z) * (p[2] - z));
+    };
+
+    const double ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+    const double ac[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+    const double ap[3] = {p[0] - a[0], p[1] - a[1], p[2] - a[2]};
+    const double d1 = dot(ab, ap);
+    const double d2 = dot(ac, ap);
+    if (d1 <= 0.0 && d2 <= 0.0)
+        return distanceTo(a[0], a[1], a[2]);
+
+    const double bp[3] = {p[0] - b[0], p[1] - b[1], p[2] - b[2]};
+    const double d3 = dot(ab, bp);
+    const double d4 = dot(ac, bp);
+    if (d3 >= 0.0 && d4 <= d3)
+        return distanceTo(b[0], b[1], b[2]);
+
+    const double vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0)
+    {
+        const double v = d1 / (d1 - d3);
+        return distanceTo(a[0] + v * ab[0], a[1] + v * ab[1], a[2] + v * ab[2]);
+    }
+
+    const double cp[3] = {p[0] - c[0], p[1] - c[1], p[2] - c[2]};
+    const double d5 = dot(ab, cp);
+    const double d6 = dot(ac, cp);
+    if (d6 >= 0.0 && d5 <= d6)
+        return distanceTo(c[0], c[1], c[2]);
+
+    const double vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0)
+    {
+        const double w = d2 / (d2 - d6);
+        return distanceTo(a[0] + w * ac[0], a[1] + w * ac[1], a[2] + w * ac[2]);
+    }
+
+    const double va = d3 * d6 - d5 * d4;
+    if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0)
+    {
+        const double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        return distanceTo(b[0] + w * (c[0] - b[0]), b[1] + w * (c[1] - b[1]), b[2] + w * (c[2] - b[2]));
+    }
+
+    // 投影落在三角形内部
+    const double denom = 1.0 / (va + vb + vc);
+    const double v = vb * denom;
+    const double w = vc * denom;
+    return distanceTo(a[0] + ab[0] * v + ac[0] * w, a[1] + ab[1] * v + ac[1] * w, a[2] + ab[2] * v + ac[2] * w);
+}
+
+QemSimplifier::QemSimplifier(const XMFLOAT3 *positions, size_t positionStride, size_t vertexCount,
+                             const std::vector<uint32> &indices)
+    : mPositions(positions), mStride(positionStride), mTriangles(indices)
+{
+    assert(indices.size() % 3 == 0);
+    size_t triangleCount = indices.size() / 3;
+
+    //
+    // 合并位置完全相同的顶点。同一位置若对应多个顶点（纹理接缝、硬边），则锁定它们
+    //
+
+    mCanonical.resize(vertexCount);
+    std::vector<uint32> duplicates(vertexCount, 0);
+    {
+        struct PositionHash
+        {
+            size_t operator()(const XMFLOAT3 &p) const
+            {
+                std::uint32_t bits[3];
+                std::memcpy(bits, &p, sizeof(bits));
+                return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+            }
+        };
+        struct PositionEqual
+        {
+            bool operator()(const XMFLOAT3 &a, const XMFLOAT3 &b) const
+            {
+                return a.x == b.x && a.y == b.y && a.z == b.z;
+            }
+        };
+
+        std::unordered_map<XMFLOAT3, uint32, PositionHash, PositionEqual> lookup;
+        lookup.reserve(vertexCount);
+        for (uint32 v = 0; v < vertexCount; ++v)
+        {
+            auto it = lookup.emplace(Position(v), v).first;
+            mCanonical[v] = it->second;
+            ++duplicates[it->second];
+        }
+    }
+
+    mLocked.assign(vertexCount, false);
+    for (uint32 v = 0; v < vertexCount; ++v)
+        mLocked[v] = duplicates[mCanonical[v]] > 1;
+
+    //
+    // 只被一个三角形使用的边为开放边界，锁定边界上的顶点
+    //
+
+    std::unordered_map<std::uint64_t, uint32> edgeUse;
+    edgeUse.reserve(indices.size());
+    mTriangleAlive.assign(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        uint32 c[3] = {mCanonical[indices[t * 3 + 0]], mCanonical[indices[t * 3 + 1]], mCanonical[indices[t * 3 + 2]]};
+        if (c[0] == c[1] || c[1] == c[2] || c[0] == c[2])
+            continue;
+
+        mTriangleAlive[t] = true;
+        ++mLiveTriangles;
+
+        for (int e = 0; e < 3; ++e)
+        {
+            uint32 a = std::min(c[e], c[(e + 1) % 3]);
+            uint32 b = std::max(c[e], c[(e + 1) % 3]);
+            ++edgeUse[(static_cast<std::uint64_t>(a) << 32) | b];
+        }
+    }
+
+    std::vector<bool> boundary(vertexCount, false);
+    for (const auto &e : edgeUse)
+    {
+        if (e.second == 1)
+        {
+            boundary[static_cast<uint32>(e.first >> 32)] = true;
+            boundary[static_cast<uint32>(e.first & 0xffffffff)] = true;
+        }
+    }
+    for (uint32 v = 0; v < vertexCount; ++v)
+        mLocked[v] = mLocked[v] || boundary[mCanonical[v]];
+
+    //
+    // 以三角形面积为权重累计各顶点的平面二次误差
+    //
+
+    mQuadrics.resize(vertexCount);
+    mVertexTriangles.resize(vertexCount);
+    mRemoved.assign(vertexCount, false);
+    mCollapsedTo.resize(vertexCount);
+    for (uint32 v = 0; v < vertexCount; ++v)
+        mCollapsedTo[v] = v;
+
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        if (!mTriangleAlive[t])
+            continue;
+
+        const XMFLOAT3 &p0 = Position(mTriangles[t * 3 + 0]);
+        const XMFLOAT3 &p1 = Position(mTriangles[t * 3 + 1]);
+        const XMFLOAT3 &p2 = Position(mTriangles[t * 3 + 2]);
+
+        double e1[3] = {(double)p1.x - p0.x, (double)p1.y - p0.y, (double)p1.z - p0.z};
+        double e2[3] = {(double)p2.x - p0.x, (double)p2.y - p0.y, (double)p2.z - p0.z};
+        double n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        double length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+        for (int k = 0; k < 3; ++k)
+            mVertexTriangles[mTriangles[t * 3 + k]].push_back(static_cast<uint32>(t));
+
+        if (length <= 0.0)
+            continue;
+
+        n[0] /= length;
+        n[1] /= length;
+        n[2] /= length;
+        double d = -(n[0] * p0.x + n[1] * p0.y + n[2] * p0.z);
+
+        Quadric q;
+        q.AddPlane(n[0], n[1], n[2], d, 0.5 * length);
+        for (int k = 0; k < 3; ++k)
+            mQuadrics[mCanonical[mTriangles[t * 3 + k]]] += q;
+    }
+
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        if (!mTriangleAlive[t])
+            continue;
+
+        for (int e = 0; e < 3; ++e)
+        {
+            uint32 a = mTriangles[t * 3 + e];
+            uint32 b = mTriangles[t * 3 + (e + 1) % 3];
+            if (!mLocked[a])
+                mQueue.push({Cost(a, b), a, b});
+            if (!mLocked[b])
+                mQueue.push({Cost(b, a), b, a});
+        }
+    }
+}
+
+double QemSimplifier::Cost(uint32 from, uint32 to) const
+{
+    Quadric q = mQuadrics[mCanonical[from]];
+    q += mQuadrics[mCanonical[to]];
+
+    const XMFLOAT3 &p = Position(to);
+    return q.Evaluate(p.x, p.y, p.z);
+}
+
+bool QemSimplifier::IsValid(uint32 from, uint32 to) const
+{
+    if (mRemoved[from] || mRemoved[to] || mLocked[from])
+        return false;
+
+    bool connected = false;
+    const XMFLOAT3 &target = Position(to);
+    XMVECTOR pt = XMLoadFloat3(&target);
+
+    for (uint32 t : mVertexTriangles[from])
+    {
+        if (!mTriangleAlive[t])
+            continue;
+
+        const uint32 *tri = &mTriangles[t * 3];
+        if (tri[0] == to || tri[1] == to || tri[2] == to)
+        {
+            connected = true;
+            continue;
+        }
+
+        // 不与 to 相邻的三角形在折叠后依然存在：不允许其翻转或退化
+        XMVECTOR p[3];
+        XMVECTOR q[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            p[k] = XMLoadFloat3(&Position(tri[k]));
+            q[k] = tri[k] == from ? pt : p[k];
+        }
+
+        XMVECTOR n0 = XMVector3Cross(p[1] - p[0], p[2] - p[0]);
+        XMVECTOR n1 = XMVector3Cross(q[1] - q[0], q[2] - q[0]);
+
+        float len0 = XMVectorGetX(XMVector3Length(n0));
+        float len1 = XMVectorGetX(XMVector3Length(n1));
+        if (len1 <= 1e-4f * len0)
+            return false;
+        if (XMVectorGetX(XMVector3Dot(n0, n1)) < 0.2f * len0 * len1)
+            return false;
+    }
+
+    return connected;
+}
+
+void QemSimplifier::Apply(uint32 from, uint32 to)
+{
+    for (uint32 t : mVertexTriangles[from])
+    {
+        if (!mTriangleAlive[t])
+            continue;
+
+        uint32 *tri = &mTriangles[t * 3];
+        if (tri[0] == to || tri[1] == to || tri[2] == to)
+        {
+            mTriangleAlive[t] = false;
+            --mLiveTriangles;
+            continue;
+        }
+
+        for (int k = 0; k < 3; ++k)
+        {
+            if (tri[k] == from)
+                tri[k] = to;
+        }
+        mVertexTriangles[to].push_back(t);
+    }
+
+    mVertexTriangles[from].clear();
+    mRemoved[from] = true;
+    mCollapsedTo[from] = to;
+    mQuadrics[mCanonical[to]] += mQuadrics[mCanonical[from]];
+
+    // 顺带清理 to 的三角形列表中已失效的项
+    auto &list = mVertexTriangles[to];
+    list.erase(std::remove_if(list.begin(), list.end(), [this](uint32 t) { return !mTriangleAlive[t]; }), list.end());
+}
+
+void QemSimplifier::PushEdges(uint32 v)
+{
+    for (uint32 t : mVertexTriangles[v])
+    {
+        if (!mTriangleAlive[t])
+            continue;
+
+        for (int k = 0; k < 3; ++k)
+        {
+            uint32 u = mTriangles[t * 3 + k];
+            if (u == v)
+                continue;
+            if (!mLocked[u])
+                mQueue.push({Cost(u, v), u, v});
+            if (!mLocked[v])
+                mQueue.push({Cost(v, u), v, u});
+        }
+    }
+}
+
+void QemSimplifier::Run(size_t targetIndexCount, float maxError)
+{
+    double maxCost = static_cast<double>(maxError) * maxError;
+
+    while (LiveIndexCount() > targetIndexCount && !mQueue.empty())
+    {
+        Collapse c = mQueue.top();
+        mQueue.pop();
+
+        if (!IsValid(c.From, c.To))
+            continue;
+
+        // 二次误差只增不减，因此队列中的代价是一个下界。若代价已经变大，按新代价重新入队
+        double cost = Cost(c.From, c.To);
+        if (cost > c.Cost * (1.0 + 1e-6) + 1e-12)
+        {
+            mQueue.push({cost, c.From, c.To});
+            continue;
+        }
+
+        if (cost > maxCost)
+        {
+            // 放回队列，后续以更宽松的误差继续简化时还能用到它
+            mQueue.push(c);
+            break;
+        }
+
+        Apply(c.From, c.To);
+        PushEdges(c.To);
+    }
+}
+
+float QemSimplifier::MaxError() const
+{
+    double maxDistance = 0.0;
+    for (uint32 v = 0; v < mRemoved.size(); ++v)
+    {
+        if (!mRemoved[v])
+            continue;
+
+        // 沿折叠链找到 v 最终合并到的顶点，v 原先所在的区域被这个顶点周围的三角形覆盖。
+        // 只在这些三角形中取最近距离，得到的是 v 到简化网格距离的上界
+        uint32 target = v;
+        while (mRemoved[target])
+            target = mCollapsedTo[target];
+
+        const XMFLOAT3 &p = Position(v);
+        double distance = PointTriangleDistance(p, Position(target), Position(target), Position(target));
+        for (uint32 t : mVertexTriangles[target])
+        {
+            if (!mTriangleAlive[t])
+                continue;
+
+            const uint32 *tri = &mTriangles[t * 3];
+            distance =
+                std::min(distance, PointTriangleDistance(p, Position(tri[0]), Position(tri[1]), Position(tri[2])));
+        }
+        maxDistance = std::max(maxDistance, distance);
+    }
+    return static_cast<float>(maxDistance);
+}
+
+std::vector<std::uint32_t> QemSimplifier::GetIndices() const
+{
+    std::vector<uint32> result;
+    result.reserve(LiveIndexCount());
+
+    for (size_t t = 0; t < mTriangleAlive.size(); ++t)
+    {
+        if (mTriangleAlive[t])
+            result.insert(result.end(), &mTriangles[t * 3], &mTriangles[t * 3] + 3);
+    }
+
+    return result;
+}
+} // namespace
+
+std::vector<std::uint32_t> MeshSimplifier::Simplify(const XMFLOAT3 *positions, size_t positionStride,
+                                                    size_t vertexCount, const std::vector<uint32> &indices,
+                                                    size_t targetIndexCount, float maxError, float *outError)
+{
+    QemSimplifier simplifier(positions, positionStride, vertexCount, indices);
+    simplifier.Run(targetIndexCount, maxError);
+
+    if (outError != nullptr)
+        *outError = simplifier.MaxError();
+
+    return simplifier.GetIndices();
+}
+
+MeshLodChain MeshSimplifier::BuildLodChain(const GeometryGenerator::MeshData &meshData, uint32 levelCount,
+                                           float reduction, float maxError)
+{
+    if (meshData.Vertices.empty())
+        return MeshLodChain();
+
+    return BuildLodChain(&meshData.Vertices[0].Position, sizeof(GeometryGenerator::Vertex), meshData.Vertices.size(),
+                         meshData.Indices32, levelCount, reduction, maxError);
+}
+
+MeshLodChain MeshSimplifier::BuildLodChain(const XMFLOAT3 *positions, size_t positionStride, size_t vertexCount,
+                                           const std::vector<uint32> &indices, uint32 levelCount, float reduction,
+                                           float maxError)
+{
+    MeshLodChain chain;
+    if (levelCount == 0)
+        return chain;
+
+    MeshLod base;
+    base.Indices = indices;
+    chain.Levels.push_back(std::move(base));
+
+    // 所有级别在同一次简化过程中依次截取，因此每一级的误差都是相对原始网格而言的，而非逐级累加
+    QemSimplifier simplifier(positions, positionStride, vertexCount, indices);
+
+    for (uint32 level = 1; level < levelCount; ++level)
+    {
+        size_t previousCount = chain.Levels.back().Indices.size();
+        size_t target = static_cast<size_t>(previousCount / 3 * reduction) * 3;
+
+        simplifier.Run(target, maxError);
+
+        // 简化幅度过小（多被锁定顶点所限），再增加级别已没有意义
+        if (simplifier.LiveIndexCount() == 0 || simplifier.LiveIndexCount() > previousCount * 9 / 10)
+            break;
+
+        MeshLod lod;
+        lod.Indices = simplifier.GetIndices();
+        lod.Error = simplifier.MaxError();
+        chain.Levels.push_back(std::move(lod));
+    }
+
+    return chain;
+}
+
+std::uint32_t LodSelector::SelectLevel(const float *levelErrors, std::uint32_t levelCount, float distance,
+                                       float projectionScale, float pixelThreshold)
+{
+    if (levelCount == 0)
+        return 0;
+
+    // 避免观察点进入包围球时除以 0
+    distance = std::max(distance, 1e-3f);
+
+    // 误差随级别单调递增，从最粗糙的一级开始向下查找
+    for (std::uint32_t level = levelCount - 1; level > 0; --level)
+    {
+        if (levelErrors[level] * projectionScale / distance <= pixelThreshold)
+            return level;
+    }
+
+    return 0;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <DirectXMath.h>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// 基于二次误差度量（quadric error metric，QEM）的边折叠网格简化，以及配套的 LOD 选择
+// 每一级 LOD 只是一组新的索引，所有级别都共用原始网格的顶点缓冲区，因此可以直接把它们追加到同一个索引缓冲区中，
+// 再以不同的 SubmeshGeometry 来绘制。
+
+// 单级 LOD
+struct MeshLod
+{
+    std::vector<std::uint32_t> Indices;
+    // 该级相对于原始网格的最大几何误差（局部空间中的距离）：被移除的原始顶点到简化网格的最大距离，
+    // 在每个顶点最终合并到的顶点周围测量，因此是偏大的上界，可以直接用作屏幕空间误差的依据。第 0 级为 0
+    float Error = 0.0f;
+};
+
+struct MeshLodChain
+{
+    // Levels[0] 为原始网格，级别越高三角形越少
+    std::vector<MeshLod> Levels;
+};
+
+class MeshSimplifier
+{
+  public:
+    using uint32 = std::uint32_t;
+
+    // 简化 indices 所描述的三角形列表，直到索引数不大于 targetIndexCount，或下一次折叠的二次误差估计
+    // （面积加权的平均距离）将超过 maxError 为止。
+    // 网格的开放边界以及纹理接缝（位置相同但属性不同的顶点）上的顶点会被锁定，以避免产生裂缝。
+    // outError 可为空，否则返回被移除的顶点到简化后网格的最大距离（实际测量，而非二次误差估计）
+    static std::vector<uint32> Simplify(const DirectX::XMFLOAT3 *positions, size_t positionStride, size_t vertexCount,
+                                        const std::vector<uint32> &indices, size_t targetIndexCount, float maxError,
+                                        float *outError);
+
+    // 为 meshData 生成 levelCount 级 LOD 链（含原始网格），每一级的目标三角形数为上一级的 reduction 倍。
+    // 当网格无法再被简化时，链会提前结束
+    static MeshLodChain BuildLodChain(const GeometryGenerator::MeshData &meshData, uint32 levelCount,
+                                      float reduction = 0.5f, float maxError = 1e30f);
+
+    static MeshLodChain BuildLodChain(const DirectX::XMFLOAT3 *positions, size_t positionStride, size_t vertexCount,
+                                      const std::vector<uint32> &indices, uint32 levelCount, float reduction = 0.5f,
+                                      float maxError = 1e30f);
+};
+
+// 根据屏幕空间误差为渲染项选择 LOD
+class LodSelector
+{
+  public:
+    // 投影比例：距离为 1 处、长度为 1 的物体在屏幕上所占的像素数
+    static float ProjectionScale(float fovY, float viewportHeight)
+    {
+        return viewportHeight / (2.0f * tanf(0.5f * fovY));
+    }
+
+    // 返回投影到屏幕上的误差不超过 pixelThreshold 的最粗糙级别。
+    // levelErrors 为各级的几何误差（需已乘上世界变换的缩放），distance 为观察点到物体包围球的距离
+    static std::uint32_t SelectLevel(const float *levelErrors, std::uint32_t levelCount, float distance,
+                                     float projectionScale, float pixelThreshold);
+};
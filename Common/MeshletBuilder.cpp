@@ -0,0 +1,282 @@
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+const std::uint32_t InvalidLocalIndex = 0xffffffff;
+
+// 当簇中三角形法线的最小夹角余弦不大于此值时（法线分散程度接近半球），背面剔除几乎不可能成功，
+// 直接标记为不可剔除，省去 GPU 端的测试
+const float MinConeDot = 0.1f;
+
+std::int32_t QuantizeSnorm8(float v)
+{
+    v = std::max(-1.0f, std::min(1.0f, v));
+    return static_cast<std::int32_t>(v * 127.0f + (v >= 0.0f ? 0.5f : -0.5f));
+}
+
+float DequantizeSnorm8(std::uint32_t packed, int shift)
+{
+    auto v = static_cast<std::int8_t>((packed >> shift) & 0xff);
+    return static_cast<float>(v) / 127.0f;
+}
+
+const XMFLOAT3 &PositionAt(const XMFLOAT3 *positions, size_t stride, std::uint32_t i)
+{
+    return *reinterpret_cast<const XMFLOAT3 *>(reinterpret_cast<const std::uint8_t *>(positions) + i * stride);
+}
+} // namespace
+
+void MeshletData::AppendIndices(std::uint32_t meshletIndex, std::vector<std::uint32_t> &indices) const
+{
+    const Meshlet &m = Meshlets[meshletIndex];
+    for (std::uint32_t i = 0; i < m.PrimitiveCount; ++i)
+    {
+        std::uint32_t i0, i1, i2;
+        MeshletBuilder::UnpackTriangle(PrimitiveIndices[m.PrimitiveOffset + i], i0, i1, i2);
+
+        indices.push_back(UniqueVertexIndices[m.VertexOffset + i0]);
+        indices.push_back(UniqueVertexIndices[m.VertexOffset + i1]);
+        indices.push_back(UniqueVertexIndices[m.VertexOffset + i2]);
+    }
+}
+
+MeshletBuilder::MeshletBuilder(uint32 maxVertices, uint32 maxPrimitives)
+    : mMaxVertices(maxVertices), mMaxPrimitives(maxPrimitives)
+{
+    // 簇内局部索引只有 10 位
+    assert(mMaxVertices >= 3 && mMaxVertices <= 1024);
+    assert(mMaxPrimitives >= 1);
+}
+
+MeshletData MeshletBuilder::Build(const GeometryGenerator::MeshData &meshData) const
+{
+    if (meshData.Vertices.empty() || meshData.Indices32.empty())
+        return MeshletData();
+
+    return Build(&meshData.Vertices[0].Position, sizeof(GeometryGenerator::Vertex), meshData.Vertices.size(),
+                 meshData.Indices32.data(), meshData.Indices32.size());
+}
+
+MeshletData MeshletBuilder::Build(const XMFLOAT3 *positions, size_t positionStride, size_t vertexCount,
+                                  const uint32 *indices, size_t indexCount) const
+{
+    assert(indexCount % 3 == 0);
+
+    MeshletData result;
+
+    // 按最坏情况预留空间，避免在切分过程中反复扩容
+    size_t triangleCount = indexCount / 3;
+    size_t meshletEstimate = triangleCount / mMaxPrimitives + 1;
+    result.Meshlets.reserve(meshletEstimate);
+    result.PrimitiveIndices.reserve(triangleCount);
+    result.UniqueVertexIndices.reserve(std::min(indexCount, meshletEstimate * mMaxVertices));
+
+    // 记录每个顶点在当前簇中的局部索引，不在当前簇中的为 InvalidLocalIndex
+    std::vector<uint32> localIndex(vertexCount, InvalidLocalIndex);
+
+    Meshlet current;
+
+    auto flush = [&]() {
+        if (current.PrimitiveCount == 0)
+            return;
+
+        for (uint32 i = 0; i < current.VertexCount; ++i)
+            localIndex[result.UniqueVertexIndices[current.VertexOffset + i]] = InvalidLocalIndex;
+
+        result.Meshlets.push_back(current);
+
+        current.VertexOffset = static_cast<uint32>(result.UniqueVertexIndices.size());
+        current.VertexCount = 0;
+        current.PrimitiveOffset = static_cast<uint32>(result.PrimitiveIndices.size());
+        current.PrimitiveCount = 0;
+    };
+
+    // 依原索引顺序贪心地填充簇。GeometryGenerator 生成的网格都是逐行（逐环）排列的，
+    // 相邻三角形共享顶点，因此按顺序切分就能得到空间上紧凑的簇
+    for (size_t t = 0; t < triangleCount; ++t)
+    {
+        uint32 tri[3] = {indices[t * 3 + 0], indices[t * 3 + 1], indices[t * 3 + 2]};
+
+        uint32 newVertices = 0;
+        for (int k = 0; k < 3; ++k)
+        {
+            bool seen = localIndex[tri[k]] != InvalidLocalIndex;
+            for (int j = 0; j < k; ++j)
+                seen = seen || tri[j] == tri[k];
+            if (!seen)
+                ++newVertices;
+        }
+
+        if (current.VertexCount + newVertices > mMaxVertices || current.PrimitiveCount + 1 > mMaxPrimitives)
+            flush();
+
+        uint32 local[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            if (localIndex[tri[k]] == InvalidLocalIndex)
+            {
+                localIndex[tri[k]] = current.VertexCount++;
+                result.UniqueVertexIndices.push_back(tri[k]);
+            }
+            local[k] = localIndex[tri[k]];
+        }
+
+        result.PrimitiveIndices.push_back(PackTriangle(local[0], local[1], local[2]));
+        ++current.PrimitiveCount;
+    }
+
+    flush();
+
+    result.CullData.resize(result.Meshlets.size());
+    for (size_t i = 0; i < result.Meshlets.size(); ++i)
+        ComputeCullData(positions, positionStride, result, result.Meshlets[i], result.CullData[i]);
+
+    return result;
+}
+
+void MeshletBuilder::ComputeCullData(const XMFLOAT3 *positions, size_t positionStride, const MeshletData &meshlets,
+                                     const Meshlet &meshlet, MeshletCullData &cullData) const
+{
+    //
+    // 包围球
+    //
+
+    std::vector<XMFLOAT3> points(meshlet.VertexCount);
+    for (uint32 i = 0; i < meshlet.VertexCount; ++i)
+        points[i] = PositionAt(positions, positionStride, meshlets.UniqueVertexIndices[meshlet.VertexOffset + i]);
+
+    BoundingSphere sphere;
+    BoundingSphere::CreateFromPoints(sphere, points.size(), points.data(), sizeof(XMFLOAT3));
+    cullData.BoundingSphere = XMFLOAT4(sphere.Center.x, sphere.Center.y, sphere.Center.z, sphere.Radius);
+
+    //
+    // 法线锥：锥轴取各三角形单位法线之和的方向，阈值由与锥轴夹角最大的法线决定
+    //
+
+    std::vector<XMVECTOR> normals;
+    std::vector<XMVECTOR> firstPoints;
+    normals.reserve(meshlet.PrimitiveCount);
+    firstPoints.reserve(meshlet.PrimitiveCount);
+
+    XMVECTOR axis = XMVectorZero();
+    for (uint32 i = 0; i < meshlet.PrimitiveCount; ++i)
+    {
+        uint32 i0, i1, i2;
+        UnpackTriangle(meshlets.PrimitiveIndices[meshlet.PrimitiveOffset + i], i0, i1, i2);
+
+        XMVECTOR p0 = XMLoadFloat3(&points[i0]);
+        XMVECTOR p1 = XMLoadFloat3(&points[i1]);
+        XMVECTOR p2 = XMLoadFloat3(&points[i2]);
+
+        // 本项目使用左手坐标系，顺时针环绕的三角形为正面
+        XMVECTOR n = XMVector3Cross(p1 - p0, p2 - p0);
+        float length = XMVectorGetX(XMVector3Length(n));
+
+        // 忽略退化三角形
+        if (length <= 1e-12f)
+            continue;
+
+        n = n * (1.0f / length);
+        normals.push_back(n);
+        firstPoints.push_back(p0);
+        axis += n;
+    }
+
+    // 默认视为不可剔除：锥轴任取，阈值为 1
+    cullData.NormalCone = 127u << 24;
+    cullData.ApexOffset = 0.0f;
+
+    float axisLength = XMVectorGetX(XMVector3Length(axis));
+    if (normals.empty() || axisLength <= 1e-6f)
+        return;
+    axis = axis * (1.0f / axisLength);
+
+    float minDot = 1.0f;
+    for (const auto &n : normals)
+        minDot = std::min(minDot, XMVectorGetX(XMVector3Dot(n, axis)));
+
+    if (minDot <= MinConeDot)
+        return;
+
+    // 锥顶需要位于所有三角形平面的背面一侧，这里沿锥轴反方向找到满足条件的最远点
+    XMVECTOR center = XMLoadFloat3(&sphere.Center);
+    float apexOffset = 0.0f;
+    for (size_t i = 0; i < normals.size(); ++i)
+    {
+        float d = XMVectorGetX(XMVector3Dot(center - firstPoints[i], normals[i]));
+        float dn = XMVectorGetX(XMVector3Dot(axis, normals[i]));
+        apexOffset = std::max(apexOffset, d / dn);
+    }
+
+    // cutoff = sin(锥半角)。量化时向上取整一个单位，保证剔除判定始终是保守的
+    float cutoff = std::sqrt(1.0f - minDot * minDot);
+    std::int32_t qx = QuantizeSnorm8(XMVectorGetX(axis));
+    std::int32_t qy = QuantizeSnorm8(XMVectorGetY(axis));
+    std::int32_t qz = QuantizeSnorm8(XMVectorGetZ(axis));
+    std::int32_t qw = std::min(QuantizeSnorm8(cutoff) + 1, 127);
+
+    cullData.NormalCone = (static_cast<uint32>(qx) & 0xff) | ((static_cast<uint32>(qy) & 0xff) << 8) |
+                          ((static_cast<uint32>(qz) & 0xff) << 16) | ((static_cast<uint32>(qw) & 0xff) << 24);
+    cullData.ApexOffset = apexOffset;
+}
+
+bool MeshletCuller::IsBackfacing(const MeshletCullData &cullData, const XMFLOAT3 &localEyePos)
+{
+    // 阈值为 1 的法线锥不参与背面剔除
+    if (((cullData.NormalCone >> 24) & 0xff) == 127)
+        return false;
+
+    XMVECTOR axis = XMVectorSet(DequantizeSnorm8(cullData.NormalCone, 0), DequantizeSnorm8(cullData.NormalCone, 8),
+                                DequantizeSnorm8(cullData.NormalCone, 16), 0.0f);
+    float cutoff = DequantizeSnorm8(cullData.NormalCone, 24);
+
+    XMVECTOR center = XMVectorSet(cullData.BoundingSphere.x, cullData.BoundingSphere.y, cullData.BoundingSphere.z, 1.0f);
+    XMVECTOR apex = center - axis * cullData.ApexOffset;
+
+    XMVECTOR view = apex - XMLoadFloat3(&localEyePos);
+    float viewLength = XMVectorGetX(XMVector3Length(view));
+    if (viewLength <= 1e-6f)
+        return false;
+
+    // 观察方向与锥内所有法线的夹角都小于 90° 时，簇内的三角形全部背向观察点
+    return XMVectorGetX(XMVector3Dot(view, axis)) >= cutoff * viewLength;
+}
+
+MeshletCuller::Stats MeshletCuller::Cull(const MeshletData &meshlets, const BoundingFrustum &localFrustum,
+                                         const XMFLOAT3 &localEyePos, std::vector<std::uint32_t> &visibleMeshlets)
+{
+    Stats stats;
+    stats.Total = static_cast<std::uint32_t>(meshlets.Meshlets.size());
+
+    visibleMeshlets.clear();
+    visibleMeshlets.reserve(meshlets.Meshlets.size());
+
+    for (std::uint32_t i = 0; i < stats.Total; ++i)
+    {
+        const MeshletCullData &c = meshlets.CullData[i];
+
+        BoundingSphere sphere(XMFLOAT3(c.BoundingSphere.x, c.BoundingSphere.y, c.BoundingSphere.z),
+                              c.BoundingSphere.w);
+        if (localFrustum.Contains(sphere) == DISJOINT)
+        {
+            ++stats.FrustumCulled;
+            continue;
+        }
+
+        if (IsBackfacing(c, localEyePos))
+        {
+            ++stats.BackfaceCulled;
+            continue;
+        }
+
+        visibleMeshlets.push_back(i);
+    }
+
+    stats.Visible = static_cast<std::uint32_t>(visibleMeshlets.size());
+    return stats;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <DirectXCollision.h>
+#include <DirectXMath.h>
+#include <cstdint>
+#include <vector>
+
+// 网格簇（meshlet，也称 cluster）
+// MeshGeometry 只能通过 DrawArgs 以整个子网格为单位进行绘制，所以剔除与 LOD 也只能以物体为粒度。
+// 这里把任意一个 MeshData 切分为许多个小簇，每个簇最多含 64 个顶点、124 个三角形（与 D3D12 网格着色器
+// 的常用上限一致）。每个簇都带有一个包围球以及一个法线锥（normal cone），以便逐簇地进行视锥体剔除与背面剔除。
+
+// 单个网格簇在两个索引数组中所占的范围
+struct Meshlet
+{
+    // 在 MeshletData::UniqueVertexIndices 中的起始位置与数量
+    std::uint32_t VertexOffset = 0;
+    std::uint32_t VertexCount = 0;
+    // 在 MeshletData::PrimitiveIndices 中的起始位置与数量（以三角形为单位）
+    std::uint32_t PrimitiveOffset = 0;
+    std::uint32_t PrimitiveCount = 0;
+};
+
+// 每个网格簇的剔除数据，共 24 字节
+struct MeshletCullData
+{
+    // xyz 为包围球球心，w 为包围球半径（物体局部空间）
+    DirectX::XMFLOAT4 BoundingSphere = {0.0f, 0.0f, 0.0f, 0.0f};
+    // 法线锥按 8:8:8:8 打包为有符号归一化整数：xyz 为锥轴，w 为剔除阈值（cutoff）。
+    // 若 w 为 127（即 1.0），则表示该簇的法线过于分散，不能进行背面剔除
+    std::uint32_t NormalCone = 0;
+    // 锥顶 = 包围球球心 - 锥轴 * ApexOffset
+    float ApexOffset = 0.0f;
+};
+
+struct MeshletData
+{
+    std::vector<Meshlet> Meshlets;
+    std::vector<MeshletCullData> CullData;
+
+    // 各簇所引用的顶点在原顶点缓冲区中的索引（簇内去重）
+    std::vector<std::uint32_t> UniqueVertexIndices;
+    // 各簇的三角形：3 个簇内局部索引按 10:10:10 打包到一个 uint32 中
+    std::vector<std::uint32_t> PrimitiveIndices;
+
+    // 把第 meshletIndex 个簇还原为普通的三角形列表索引（指向原顶点缓冲区），并追加到 indices 的末尾。
+    // 这样即使不使用网格着色器，也可以只绘制未被剔除的簇
+    void AppendIndices(std::uint32_t meshletIndex, std::vector<std::uint32_t> &indices) const;
+};
+
+class MeshletBuilder
+{
+  public:
+    using uint32 = std::uint32_t;
+
+    static const uint32 MaxVertexLimit = 64;
+    static const uint32 MaxPrimitiveLimit = 124;
+
+    explicit MeshletBuilder(uint32 maxVertices = MaxVertexLimit, uint32 maxPrimitives = MaxPrimitiveLimit);
+
+    MeshletData Build(const GeometryGenerator::MeshData &meshData) const;
+
+    // positions 以 positionStride 字节为步长读取，因此可以直接传入任意顶点结构体中的位置成员
+    MeshletData Build(const DirectX::XMFLOAT3 *positions, size_t positionStride, size_t vertexCount,
+                      const uint32 *indices, size_t indexCount) const;
+
+    static uint32 PackTriangle(uint32 i0, uint32 i1, uint32 i2)
+    {
+        return (i0 & 0x3ff) | ((i1 & 0x3ff) << 10) | ((i2 & 0x3ff) << 20);
+    }
+
+    static void UnpackTriangle(uint32 packed, uint32 &i0, uint32 &i1, uint32 &i2)
+    {
+        i0 = packed & 0x3ff;
+        i1 = (packed >> 10) & 0x3ff;
+        i2 = (packed >> 20) & 0x3ff;
+    }
+
+  private:
+    void ComputeCullData(const DirectX::XMFLOAT3 *positions, size_t positionStride, const MeshletData &meshlets,
+                         const Meshlet &meshlet, MeshletCullData &cullData) const;
+
+  private:
+    uint32 mMaxVertices;
+    uint32 mMaxPrimitives;
+};
+
+// CPU 端的参考剔除器，其判定规则与 GPU 端（放大着色器）中应使用的规则一致，可用于无窗口环境下的验证
+class MeshletCuller
+{
+  public:
+    struct Stats
+    {
+        std::uint32_t Total = 0;
+        std::uint32_t FrustumCulled = 0;
+        std::uint32_t BackfaceCulled = 0;
+        std::uint32_t Visible = 0;
+    };
+
+    // localFrustum 与 localEyePos 都需要事先变换到网格的局部空间中。
+    // 通过剔除的簇的序号会写入 visibleMeshlets（先被清空）
+    static Stats Cull(const MeshletData &meshlets, const DirectX::BoundingFrustum &localFrustum,
+                      const DirectX::XMFLOAT3 &localEyePos, std::vector<std::uint32_t> &visibleMeshlets);
+
+    // 仅依据法线锥判断该簇是否完全背向观察点
+    static bool IsBackfacing(const MeshletCullData &cullData, const DirectX::XMFLOAT3 &localEyePos);
+};
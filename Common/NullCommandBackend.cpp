@@ -0,0 +1,199 @@
+#include "NullCommandBackend.h"
+
+namespace
+{
+// 当前命令列表上已经绑定的状态
+struct BindingState
+{
+    bool RootSignature = false;
+    bool VertexBuffer = false;
+    bool IndexBuffer = false;
+    bool PrimitiveTopology = false;
+    bool RenderTarget = false;
+};
+} // namespace
+
+void NullCommandBackend::Execute(const CommandStream &stream)
+{
+    BindingState state;
+    uint64 commandIndex = 0;
+    // 当前这一串连续屏障的数量
+    uint32 barrierRun = 0;
+
+    mStats.ByteSize += stream.ByteSize();
+
+    stream.ForEach([this, &state, &commandIndex, &barrierRun](CommandType type, const void *payload) {
+        if (type >= CommandType::Count)
+        {
+            ReportError("unknown command type", commandIndex++);
+            return;
+        }
+        ++mStats.CommandCounts[static_cast<size_t>(type)];
+
+        const bool isBarrier = type == CommandType::TransitionBarrier || type == CommandType::AliasingBarrier;
+        if (isBarrier && barrierRun++ % CommandStream::MaxBarriersPerBatch == 0)
+            ++mStats.BarrierBatchCount;
+        if (!isBarrier)
+            barrierRun = 0;
+
+        switch (type)
+        {
+        case CommandType::SetPipelineState:
+            if (static_cast<const CmdSetPipelineState *>(payload)->PipelineState == nullptr)
+                ReportError("SetPipelineState: null pipeline state", commandIndex);
+            break;
+        case CommandType::SetGraphicsRootSignature:
+            state.RootSignature = static_cast<const CmdSetGraphicsRootSignature *>(payload)->RootSignature != nullptr;
+            if (!state.RootSignature)
+                ReportError("SetGraphicsRootSignature: null root signature", commandIndex);
+            break;
+        case CommandType::SetGraphicsRootConstantBufferView:
+            if (!state.RootSignature)
+                ReportError("SetGraphicsRootConstantBufferView: no root signature bound", commandIndex);
+            if (static_cast<const CmdSetGraphicsRootConstantBufferView *>(payload)->BufferLocation == 0)
+                ReportError("SetGraphicsRootConstantBufferView: null buffer location", commandIndex);
+            break;
+        case CommandType::SetVertexBuffer:
+            state.VertexBuffer = static_cast<const CmdSetVertexBuffer *>(payload)->BufferLocation != 0;
+            break;
+        case CommandType::SetIndexBuffer:
+            state.IndexBuffer = static_cast<const CmdSetIndexBuffer *>(payload)->BufferLocation != 0;
+            break;
+        case CommandType::SetPrimitiveTopology:
+            // 0 即 D3D_PRIMITIVE_TOPOLOGY_UNDEFINED
+            state.PrimitiveTopology = static_cast<const CmdSetPrimitiveTopology *>(payload)->Topology != 0;
+            break;
+        case CommandType::SetRenderTarget:
+            state.RenderTarget = static_cast<const CmdSetRenderTarget *>(payload)->RenderTargetView != 0;
+            break;
+        case CommandType::TransitionBarrier: {
+            const auto *cmd = static_cast<const CmdTransitionBarrier *>(payload);
+            if (cmd->Resource == nullptr)
+                ReportError("TransitionBarrier: null resource", commandIndex);
+            else if (cmd->StateBefore == cmd->StateAfter)
+                ReportError("TransitionBarrier: StateBefore equals StateAfter", commandIndex);
+            else
+                ApplyTransition(*cmd, commandIndex);
+            break;
+        }
+        case CommandType::AliasingBarrier:
+            if (static_cast<const CmdAliasingBarrier *>(payload)->ResourceAfter == nullptr)
+                ReportError("AliasingBarrier: null ResourceAfter", commandIndex);
+            break;
+        case CommandType::CopyBufferRegion: {
+            const auto *cmd = static_cast<const CmdCopyBufferRegion *>(payload);
+            if (cmd->DestinationBuffer == nullptr || cmd->SourceBuffer == nullptr)
+                ReportError("CopyBufferRegion: null buffer", commandIndex);
+            else if (cmd->DestinationBuffer == cmd->SourceBuffer)
+                ReportError("CopyBufferRegion: source and destination are the same buffer", commandIndex);
+            break;
+        }
+        case CommandType::DrawIndexedInstanced: {
+            const auto *cmd = static_cast<const CmdDrawIndexedInstanced *>(payload);
+            if (!state.RootSignature)
+                ReportError("DrawIndexedInstanced: no root signature bound", commandIndex);
+            else if (!state.VertexBuffer)
+                ReportError("DrawIndexedInstanced: no vertex buffer bound", commandIndex);
+            else if (!state.IndexBuffer)
+                ReportError("DrawIndexedInstanced: no index buffer bound", commandIndex);
+            else if (!state.PrimitiveTopology)
+                ReportError("DrawIndexedInstanced: no primitive topology set", commandIndex);
+            else if (!state.RenderTarget)
+                ReportError("DrawIndexedInstanced: no render target bound", commandIndex);
+
+            ++mStats.DrawCount;
+            mStats.InstanceCount += cmd->InstanceCount;
+            mStats.IndexCount += static_cast<uint64>(cmd->IndexCountPerInstance) * cmd->InstanceCount;
+            break;
+        }
+        default:
+            break;
+        }
+
+        ++commandIndex;
+    });
+}
+
+void NullCommandBackend::ResetStatistics()
+{
+    mStats = Statistics();
+    mFirstError.clear();
+}
+
+void NullCommandBackend::SetResourceState(const void *resource, uint32 state, uint32 subresourceCount)
+{
+    auto first = mResourceStates.lower_bound({resource, 0});
+    auto last = mResourceStates.upper_bound({resource, CommandStream::AllSubresources});
+    mResourceStates.erase(first, last);
+    mResourceStates[{resource, CommandStream::AllSubresources}] = state;
+
+    if (subresourceCount != 0)
+        mSubresourceCounts[resource] = subresourceCount;
+    else
+        mSubresourceCounts.erase(resource);
+}
+
+void NullCommandBackend::ResetResourceStates()
+{
+    mResourceStates.clear();
+    mSubresourceCounts.clear();
+}
+
+bool NullCommandBackend::GetResourceState(const void *resource, uint32 subresource, uint32 &state) const
+{
+    auto it = mResourceStates.find({resource, subresource});
+    if (it == mResourceStates.end())
+        it = mResourceStates.find({resource, CommandStream::AllSubresources});
+    if (it == mResourceStates.end())
+        return false;
+    state = it->second;
+    return true;
+}
+
+void NullCommandBackend::ApplyTransition(const CmdTransitionBarrier &cmd, uint64 commandIndex)
+{
+    auto first = mResourceStates.lower_bound({cmd.Resource, 0});
+    auto last = mResourceStates.upper_bound({cmd.Resource, CommandStream::AllSubresources});
+
+    if (cmd.Subresource == CommandStream::AllSubresources)
+    {
+        // 转换整个资源时，每个已知状态的子资源都必须处于 StateBefore
+        for (auto it = first; it != last; ++it)
+        {
+            if (it->second != cmd.StateBefore)
+            {
+                ReportError("TransitionBarrier: StateBefore does not match the resource state", commandIndex);
+                break;
+            }
+        }
+        mResourceStates.erase(first, last);
+        mResourceStates[{cmd.Resource, CommandStream::AllSubresources}] = cmd.StateAfter;
+        return;
+    }
+
+    uint32 current = 0;
+    if (GetResourceState(cmd.Resource, cmd.Subresource, current) && current != cmd.StateBefore)
+        ReportError("TransitionBarrier: StateBefore does not match the subresource state", commandIndex);
+
+    // 整个资源的状态不再适用于每个子资源。留着它的话，之后转换整个资源时会拿它与 StateBefore 比较而误报
+    auto whole = mResourceStates.find({cmd.Resource, CommandStream::AllSubresources});
+    if (whole != mResourceStates.end())
+    {
+        const uint32 wholeState = whole->second;
+        mResourceStates.erase(whole);
+
+        auto count = mSubresourceCounts.find(cmd.Resource);
+        if (count != mSubresourceCounts.end())
+        {
+            for (uint32 subresource = 0; subresource < count->second; ++subresource)
+                mResourceStates[{cmd.Resource, subresource}] = wholeState;
+        }
+    }
+    mResourceStates[{cmd.Resource, cmd.Subresource}] = cmd.StateAfter;
+}
+
+void NullCommandBackend::ReportError(const char *message, uint64 commandIndex)
+{
+    if (mStats.ErrorCount++ == 0)
+        mFirstError = "command " + std::to_string(commandIndex) + ": " + message;
+}
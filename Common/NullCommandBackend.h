@@ -0,0 +1,77 @@
+#pragma once
+
+#include "CommandStream.h"
+#include <array>
+#include <map>
+#include <string>
+#include <utility>
+
+// 不连接任何图形 API 的命令流后端：只校验命令是否合法并统计数量
+// 用于在没有 GPU 的环境（例如 Linux 上的性能测试机）中运行示例的 Draw，测量编码命令本身的 CPU 开销。
+// 校验规则与 D3D12 调试层的常见报错对应：绘制之前必须设置根签名、顶点/索引缓冲区、图元拓扑与渲染目标，
+// 转换屏障的资源不能为空且前后状态不能相同。
+// 此外，后端在多次 Execute 之间记住每个资源（及子资源）经屏障转换后的状态，就像 GPU 上按顺序执行的命令队列一样，
+// 屏障的 StateBefore 与记录的状态不符时报错；从未见过的资源则以第一个屏障的 StateBefore 为准。
+class NullCommandBackend
+{
+  public:
+    using uint32 = std::uint32_t;
+    using uint64 = std::uint64_t;
+
+    struct Statistics
+    {
+        std::array<uint64, static_cast<size_t>(CommandType::Count)> CommandCounts = {};
+        uint64 DrawCount = 0;
+        uint64 IndexCount = 0;
+        uint64 InstanceCount = 0;
+        // 连续的资源屏障在回放时合并为一次 ResourceBarrier 调用（每次最多 CommandStream::MaxBarriersPerBatch 个），
+        // 这里统计合并后的调用次数
+        uint64 BarrierBatchCount = 0;
+        uint64 ByteSize = 0;
+        uint64 ErrorCount = 0;
+    };
+
+    // 校验并统计一个命令流。每个命令流都视为一个独立的命令列表，绑定状态不会延续到下一个命令流
+    void Execute(const CommandStream &stream);
+
+    void ResetStatistics();
+
+    // 声明资源当前的状态（例如创建资源时的初始状态）。subresourceCount 为资源的子资源数，0 表示未知：
+    // 只转换其中一个子资源时，已知子资源数则把整个资源的状态展开为逐个子资源的状态；
+    // 未知时只能丢弃整个资源的状态，其余子资源的状态变为未知，以免之后转换整个资源时误报
+    void SetResourceState(const void *resource, uint32 state, uint32 subresourceCount = 0);
+    // 忘记所有资源的状态
+    void ResetResourceStates();
+
+    // 资源（或其子资源）当前的状态，未知时返回 false
+    bool GetResourceState(const void *resource, uint32 subresource, uint32 &state) const;
+
+    const Statistics &GetStatistics() const
+    {
+        return mStats;
+    }
+
+    uint64 GetCommandCount(CommandType type) const
+    {
+        return mStats.CommandCounts[static_cast<size_t>(type)];
+    }
+
+    // 第一条错误信息，没有错误时为空
+    const std::string &GetFirstError() const
+    {
+        return mFirstError;
+    }
+
+  private:
+    void ReportError(const char *message, uint64 commandIndex);
+    void ApplyTransition(const CmdTransitionBarrier &cmd, uint64 commandIndex);
+
+  private:
+    // 键为 (资源, 子资源)，子资源为 CommandStream::AllSubresources 的项表示整个资源的状态。
+    // 同一资源不会同时有整个资源的项与单个子资源的项
+    std::map<std::pair<const void *, uint32>, uint32> mResourceStates;
+    // 由 SetResourceState 给出的子资源数
+    std::map<const void *, uint32> mSubresourceCounts;
+    Statistics mStats;
+    std::string mFirstError;
+};
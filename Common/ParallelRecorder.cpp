@@ -0,0 +1,22 @@
+#include "ParallelRecorder.h"
+#include <algorithm>
+
+std::vector<RecordRange> ParallelRecorder::Partition(size_t drawCount, size_t maxLists, size_t minDrawsPerList)
+{
+    minDrawsPerList = std::max<size_t>(minDrawsPerList, 1);
+    size_t listCount = std::min(std::max<size_t>(maxLists, 1), std::max<size_t>(drawCount / minDrawsPerList, 1));
+
+    // 尽量平均：前 remainder 段各多分一个绘制项
+    size_t baseCount = drawCount / listCount;
+    size_t remainder = drawCount % listCount;
+
+    std::vector<RecordRange> ranges(listCount);
+    size_t begin = 0;
+    for (size_t i = 0; i < listCount; ++i)
+    {
+        ranges[i].Begin = begin;
+        begin += baseCount + (i < remainder ? 1 : 0);
+        ranges[i].End = begin;
+    }
+    return ranges;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include <cstddef>
+#include <vector>
+
+// 一个命令列表负责记录的绘制项范围 [Begin, End)
+struct RecordRange
+{
+    size_t Begin = 0;
+    size_t End = 0;
+};
+
+// 把一组绘制项拆分到多个命令列表中，由 ThreadPool 的各个线程并行记录
+// 只负责划分与调度，并不关心命令最终记录到哪里：record 回调可以写入 ID3D12GraphicsCommandList，
+// 也可以写入与图形 API 无关的命令流，所以划分策略本身可以脱离 Direct3D 进行性能测试。
+// 各段按绘制项的顺序编号，调用者按编号顺序提交对应的命令列表即可保持原有的绘制顺序。
+class ParallelRecorder
+{
+  public:
+    // 把 drawCount 个绘制项划分为连续的若干段：段数不超过 maxLists，并且每段至少有 minDrawsPerList 个
+    // 绘制项（绘制项过少时，多一个命令列表的开销比并行记录节省的时间更多）。至少返回一段，可能为空
+    static std::vector<RecordRange> Partition(size_t drawCount, size_t maxLists, size_t minDrawsPerList);
+
+    // 以 threadPool 并行地对每一段调用 record(listIndex, range)。函数返回时所有段都已记录完毕
+    template <typename RecordFunc>
+    static void Record(ThreadPool &threadPool, const std::vector<RecordRange> &ranges, RecordFunc &&record)
+    {
+        threadPool.ParallelFor(ranges.size(), 1, [&ranges, &record](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i)
+                record(i, ranges[i]);
+        });
+    }
+};
@@ -0,0 +1,346 @@
+#include "PipelineStateCache.h"
+#include "Hash.h"
+#include <fstream>
+
+using Microsoft::WRL::ComPtr;
+
+namespace
+{
+void HashShader(Hasher &hasher, const D3D12_SHADER_BYTECODE &shader)
+{
+    hasher.Update(static_cast<std::uint64_t>(shader.BytecodeLength));
+    hasher.Update(shader.pShaderBytecode, shader.BytecodeLength);
+}
+
+void HashBlendState(Hasher &hasher, const D3D12_BLEND_DESC &blend)
+{
+    hasher.Update(blend.AlphaToCoverageEnable);
+    hasher.Update(blend.IndependentBlendEnable);
+    for (const D3D12_RENDER_TARGET_BLEND_DESC &rt : blend.RenderTarget)
+    {
+        hasher.Update(rt.BlendEnable);
+        hasher.Update(rt.LogicOpEnable);
+        hasher.Update(rt.SrcBlend);
+        hasher.Update(rt.DestBlend);
+        hasher.Update(rt.BlendOp);
+        hasher.Update(rt.SrcBlendAlpha);
+        hasher.Update(rt.DestBlendAlpha);
+        hasher.Update(rt.BlendOpAlpha);
+        hasher.Update(rt.LogicOp);
+        hasher.Update(rt.RenderTargetWriteMask);
+    }
+}
+
+void HashRasterizerState(Hasher &hasher, const D3D12_RASTERIZER_DESC &rasterizer)
+{
+    hasher.Update(rasterizer.FillMode);
+    hasher.Update(rasterizer.CullMode);
+    hasher.Update(rasterizer.FrontCounterClockwise);
+    hasher.Update(rasterizer.DepthBias);
+    hasher.Update(rasterizer.DepthBiasClamp);
+    hasher.Update(rasterizer.SlopeScaledDepthBias);
+    hasher.Update(rasterizer.DepthClipEnable);
+    hasher.Update(rasterizer.MultisampleEnable);
+    hasher.Update(rasterizer.AntialiasedLineEnable);
+    hasher.Update(rasterizer.ForcedSampleCount);
+    hasher.Update(rasterizer.ConservativeRaster);
+}
+
+void HashStencilOp(Hasher &hasher, const D3D12_DEPTH_STENCILOP_DESC &op)
+{
+    hasher.Update(op.StencilFailOp);
+    hasher.Update(op.StencilDepthFailOp);
+    hasher.Update(op.StencilPassOp);
+    hasher.Update(op.StencilFunc);
+}
+
+void HashDepthStencilState(Hasher &hasher, const D3D12_DEPTH_STENCIL_DESC &depthStencil)
+{
+    hasher.Update(depthStencil.DepthEnable);
+    hasher.Update(depthStencil.DepthWriteMask);
+    hasher.Update(depthStencil.DepthFunc);
+    hasher.Update(depthStencil.StencilEnable);
+    hasher.Update(depthStencil.StencilReadMask);
+    hasher.Update(depthStencil.StencilWriteMask);
+    HashStencilOp(hasher, depthStencil.FrontFace);
+    HashStencilOp(hasher, depthStencil.BackFace);
+}
+
+void HashStreamOutput(Hasher &hasher, const D3D12_STREAM_OUTPUT_DESC &streamOutput)
+{
+    hasher.Update(streamOutput.NumEntries);
+    for (UINT i = 0; i < streamOutput.NumEntries; ++i)
+    {
+        const D3D12_SO_DECLARATION_ENTRY &entry = streamOutput.pSODeclaration[i];
+        hasher.Update(entry.Stream);
+        hasher.UpdateString(entry.SemanticName);
+        hasher.Update(entry.SemanticIndex);
+        hasher.Update(entry.StartComponent);
+        hasher.Update(entry.ComponentCount);
+        hasher.Update(entry.OutputSlot);
+    }
+    hasher.Update(streamOutput.NumStrides);
+    for (UINT i = 0; i < streamOutput.NumStrides; ++i)
+        hasher.Update(streamOutput.pBufferStrides[i]);
+    hasher.Update(streamOutput.RasterizedStream);
+}
+
+void HashInputLayout(Hasher &hasher, const D3D12_INPUT_LAYOUT_DESC &inputLayout)
+{
+    hasher.Update(inputLayout.NumElements);
+    for (UINT i = 0; i < inputLayout.NumElements; ++i)
+    {
+        const D3D12_INPUT_ELEMENT_DESC &element = inputLayout.pInputElementDescs[i];
+        hasher.UpdateString(element.SemanticName);
+        hasher.Update(element.SemanticIndex);
+        hasher.Update(element.Format);
+        hasher.Update(element.InputSlot);
+        hasher.Update(element.AlignedByteOffset);
+        hasher.Update(element.InputSlotClass);
+        hasher.Update(element.InstanceDataStepRate);
+    }
+}
+
+// 后台创建 PSO 时调用者的着色器字节码与输入布局可能已经释放，这里复制一份描述引用的全部数据
+class OwnedGraphicsPipelineDesc
+{
+  public:
+    explicit OwnedGraphicsPipelineDesc(const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc)
+        : mDesc(desc), mRootSignature(desc.pRootSignature)
+    {
+        CopyShader(mDesc.VS, mVS);
+        CopyShader(mDesc.PS, mPS);
+        CopyShader(mDesc.DS, mDS);
+        CopyShader(mDesc.HS, mHS);
+        CopyShader(mDesc.GS, mGS);
+
+        // 先保存所有字符串再设置指针，字符串所在的 vector 不会再重新分配
+        const D3D12_INPUT_LAYOUT_DESC &inputLayout = desc.InputLayout;
+        mInputElements.assign(inputLayout.pInputElementDescs, inputLayout.pInputElementDescs + inputLayout.NumElements);
+        for (const D3D12_INPUT_ELEMENT_DESC &element : mInputElements)
+            mSemanticNames.emplace_back(element.SemanticName != nullptr ? element.SemanticName : "");
+        for (size_t i = 0; i < mInputElements.size(); ++i)
+            mInputElements[i].SemanticName = mSemanticNames[i].c_str();
+        mDesc.InputLayout = {mInputElements.data(), (UINT)mInputElements.size()};
+
+        const D3D12_STREAM_OUTPUT_DESC &streamOutput = desc.StreamOutput;
+        mSODeclaration.assign(streamOutput.pSODeclaration, streamOutput.pSODeclaration + streamOutput.NumEntries);
+        for (const D3D12_SO_DECLARATION_ENTRY &entry : mSODeclaration)
+            mSOSemanticNames.emplace_back(entry.SemanticName != nullptr ? entry.SemanticName : "");
+        for (size_t i = 0; i < mSODeclaration.size(); ++i)
+        {
+            // 空名字表示跳过输出分量，必须保持为空指针
+            if (mSODeclaration[i].SemanticName != nullptr)
+                mSODeclaration[i].SemanticName = mSOSemanticNames[i].c_str();
+        }
+        mSOStrides.assign(streamOutput.pBufferStrides, streamOutput.pBufferStrides + streamOutput.NumStrides);
+        mDesc.StreamOutput.pSODeclaration = mSODeclaration.data();
+        mDesc.StreamOutput.pBufferStrides = mSOStrides.data();
+
+        // 管线库代替了 CachedPSO
+        mDesc.CachedPSO = {};
+    }
+
+    OwnedGraphicsPipelineDesc(const OwnedGraphicsPipelineDesc &rhs) = delete;
+    OwnedGraphicsPipelineDesc &operator=(const OwnedGraphicsPipelineDesc &rhs) = delete;
+
+    const D3D12_GRAPHICS_PIPELINE_STATE_DESC &Get() const
+    {
+        return mDesc;
+    }
+
+  private:
+    static void CopyShader(D3D12_SHADER_BYTECODE &shader, std::vector<std::uint8_t> &storage)
+    {
+        const auto *bytes = static_cast<const std::uint8_t *>(shader.pShaderBytecode);
+        storage.assign(bytes, bytes + shader.BytecodeLength);
+        shader.pShaderBytecode = storage.empty() ? nullptr : storage.data();
+    }
+
+  private:
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC mDesc;
+    ComPtr<ID3D12RootSignature> mRootSignature;
+    std::vector<std::uint8_t> mVS;
+    std::vector<std::uint8_t> mPS;
+    std::vector<std::uint8_t> mDS;
+    std::vector<std::uint8_t> mHS;
+    std::vector<std::uint8_t> mGS;
+    std::vector<D3D12_INPUT_ELEMENT_DESC> mInputElements;
+    std::vector<std::string> mSemanticNames;
+    std::vector<D3D12_SO_DECLARATION_ENTRY> mSODeclaration;
+    std::vector<std::string> mSOSemanticNames;
+    std::vector<UINT> mSOStrides;
+};
+} // namespace
+
+PipelineStateCache::PipelineStateCache(ID3D12Device *device, const std::wstring &libraryFile,
+                                       ThreadPool *threadPool)
+    : mDevice(device), mLibraryFile(libraryFile), mCache(threadPool)
+{
+    assert(device != nullptr);
+    OpenLibrary();
+}
+
+PipelineStateCache::~PipelineStateCache()
+{
+    mCache.WaitIdle();
+    SaveLibrary();
+}
+
+void PipelineStateCache::OpenLibrary()
+{
+    // ID3D12PipelineLibrary 需要 ID3D12Device1，较旧的系统上只在内存中缓存
+    ComPtr<ID3D12Device1> device1;
+    if (mLibraryFile.empty() || FAILED(mDevice.As(&device1)))
+        return;
+
+    std::ifstream fin(mLibraryFile, std::ios::binary | std::ios::ate);
+    if (fin)
+    {
+        mLibraryData.resize(static_cast<size_t>(fin.tellg()));
+        fin.seekg(0, std::ios_base::beg);
+        if (!fin.read(reinterpret_cast<char *>(mLibraryData.data()), mLibraryData.size()))
+            mLibraryData.clear();
+    }
+
+    HRESULT hr = device1->CreatePipelineLibrary(mLibraryData.data(), mLibraryData.size(), IID_PPV_ARGS(&mLibrary));
+    if (FAILED(hr) && !mLibraryData.empty())
+    {
+        // 驱动版本或显卡已经改变（D3D12_ERROR_DRIVER_VERSION_MISMATCH、D3D12_ERROR_ADAPTER_NOT_FOUND），
+        // 或者文件已损坏：丢弃旧的管线库，从空库开始
+        mLibraryData.clear();
+        hr = device1->CreatePipelineLibrary(nullptr, 0, IID_PPV_ARGS(&mLibrary));
+    }
+    if (FAILED(hr))
+        mLibrary = nullptr;
+}
+
+PipelineStateCache::uint64 PipelineStateCache::HashRootSignature(ID3DBlob *serializedRootSignature)
+{
+    assert(serializedRootSignature != nullptr);
+    return Hasher::Hash(serializedRootSignature->GetBufferPointer(), serializedRootSignature->GetBufferSize());
+}
+
+PipelineStateCache::uint64 PipelineStateCache::HashGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc,
+                                                                    uint64 rootSignatureHash)
+{
+    // 逐个成员哈希：结构体中有指针与填充字节，不能直接哈希整个结构体
+    Hasher hasher;
+    hasher.Update(rootSignatureHash);
+    HashShader(hasher, desc.VS);
+    HashShader(hasher, desc.PS);
+    HashShader(hasher, desc.DS);
+    HashShader(hasher, desc.HS);
+    HashShader(hasher, desc.GS);
+    HashStreamOutput(hasher, desc.StreamOutput);
+    HashBlendState(hasher, desc.BlendState);
+    hasher.Update(desc.SampleMask);
+    HashRasterizerState(hasher, desc.RasterizerState);
+    HashDepthStencilState(hasher, desc.DepthStencilState);
+    HashInputLayout(hasher, desc.InputLayout);
+    hasher.Update(desc.IBStripCutValue);
+    hasher.Update(desc.PrimitiveTopologyType);
+    hasher.Update(desc.NumRenderTargets);
+    // 只有前 NumRenderTargets 个格式有意义
+    for (UINT i = 0; i < desc.NumRenderTargets && i < 8; ++i)
+        hasher.Update(desc.RTVFormats[i]);
+    hasher.Update(desc.DSVFormat);
+    hasher.Update(desc.SampleDesc.Count);
+    hasher.Update(desc.SampleDesc.Quality);
+    hasher.Update(desc.NodeMask);
+    hasher.Update(desc.Flags);
+    return hasher.Digest();
+}
+
+ComPtr<ID3D12PipelineState> PipelineStateCache::GetGraphicsPipeline(uint64 key,
+                                                                    const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc)
+{
+    return mCache.GetOrCreate(key, [this, key, &desc]() { return CreateGraphicsPipeline(key, desc); });
+}
+
+void PipelineStateCache::RequestGraphicsPipeline(uint64 key, const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc)
+{
+    // 已经请求过的键不必再复制描述
+    if (mCache.GetState(key) != AsyncObjectCache<ComPtr<ID3D12PipelineState>>::State::Missing)
+        return;
+
+    auto owned = std::make_shared<OwnedGraphicsPipelineDesc>(desc);
+    mCache.GetOrCreateAsync(
+        key, [this, key, owned]() { return CreateGraphicsPipeline(key, owned->Get()); }, nullptr);
+}
+
+ID3D12PipelineState *PipelineStateCache::FindGraphicsPipeline(uint64 key, ID3D12PipelineState *fallback) const
+{
+    // 缓存持有 PSO 的引用，返回裸指针是安全的
+    return mCache.Find(key, fallback).Get();
+}
+
+void PipelineStateCache::WaitIdle()
+{
+    mCache.WaitIdle();
+}
+
+ComPtr<ID3D12PipelineState> PipelineStateCache::CreateGraphicsPipeline(uint64 key,
+                                                                       const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc)
+{
+    const std::wstring name = Hasher::ToHex(key);
+    ComPtr<ID3D12PipelineState> pso;
+    {
+        std::lock_guard<std::mutex> lock(mLibraryMutex);
+        if (mLibrary != nullptr &&
+            SUCCEEDED(mLibrary->LoadGraphicsPipeline(name.c_str(), &desc, IID_PPV_ARGS(&pso))))
+        {
+            ++mLibraryLoads;
+            return pso;
+        }
+    }
+
+    // 编译 PSO 是最耗时的部分，不持有锁
+    ThrowIfFailed(mDevice->CreateGraphicsPipelineState(&desc, IID_PPV_ARGS(&pso)));
+
+    std::lock_guard<std::mutex> lock(mLibraryMutex);
+    ++mCompiled;
+    if (mLibrary != nullptr && SUCCEEDED(mLibrary->StorePipeline(name.c_str(), pso.Get())))
+        mLibraryDirty = true;
+    return pso;
+}
+
+bool PipelineStateCache::SaveLibrary()
+{
+    std::lock_guard<std::mutex> lock(mLibraryMutex);
+    if (mLibrary == nullptr || !mLibraryDirty)
+        return true;
+
+    std::vector<std::uint8_t> data(mLibrary->GetSerializedSize());
+    if (FAILED(mLibrary->Serialize(data.data(), data.size())))
+        return false;
+
+    const std::wstring tempFile = mLibraryFile + L".tmp";
+    {
+        std::ofstream fout(tempFile, std::ios::binary | std::ios::trunc);
+        if (!fout.write(reinterpret_cast<const char *>(data.data()), data.size()))
+            return false;
+    }
+    if (!MoveFileExW(tempFile.c_str(), mLibraryFile.c_str(), MOVEFILE_REPLACE_EXISTING))
+        return false;
+
+    mLibraryDirty = false;
+    return true;
+}
+
+PipelineStateCache::Statistics PipelineStateCache::GetStatistics() const
+{
+    const auto cacheStats = mCache.GetStatistics();
+
+    Statistics stats;
+    stats.Requests = cacheStats.Requests;
+    stats.Hits = cacheStats.Hits;
+    stats.Misses = cacheStats.Misses;
+    stats.FallbackUses = cacheStats.FallbackUses;
+    stats.Failed = cacheStats.Failed;
+
+    std::lock_guard<std::mutex> lock(mLibraryMutex);
+    stats.LibraryLoads = mLibraryLoads;
+    stats.Compiled = mCompiled;
+    return stats;
+}
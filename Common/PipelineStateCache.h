@@ -0,0 +1,88 @@
+#pragma once
+
+#include "AsyncObjectCache.h"
+#include "d3dUtil.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 以完整管线描述的哈希值为键的 PSO 缓存
+// 原先 BuildPSOs 以 "opaque"、"opaque_wireframe" 之类的名字在启动时依次同步创建所有 PSO，每次启动都重新编译。
+// PipelineStateCache：
+//   - 用 HashGraphicsPipeline 把 D3D12_GRAPHICS_PIPELINE_STATE_DESC 的全部内容（包括着色器字节码与输入布局，
+//     根签名以其序列化数据的哈希代替）换算为稳定的 64 位键，描述相同的 PSO 只创建一次；
+//   - RequestGraphicsPipeline 在后台线程上创建 PSO，就绪之前 FindGraphicsPipeline 返回调用者给出的替代 PSO；
+//   - 设备支持时把 PSO 存入 ID3D12PipelineLibrary 并在析构（或 SaveLibrary）时写入磁盘，
+//     下次启动直接从管线库中加载，跳过驱动的着色器编译。
+// 驱动或显卡更换之后旧的管线库会被拒绝，此时自动丢弃它并重新创建。
+// 缓存不淘汰条目：创建过的每一个 PSO（包括着色器热重载换下的旧版本）都保留到缓存析构。
+class PipelineStateCache
+{
+  public:
+    using uint32 = std::uint32_t;
+    using uint64 = std::uint64_t;
+
+    struct Statistics
+    {
+        // 见 AsyncObjectCache::Statistics
+        uint32 Requests = 0;
+        uint32 Hits = 0;
+        uint32 Misses = 0;
+        uint32 FallbackUses = 0;
+        uint32 Failed = 0;
+        // 从管线库中加载的 PSO 数
+        uint32 LibraryLoads = 0;
+        // 由驱动编译的 PSO 数
+        uint32 Compiled = 0;
+    };
+
+    // libraryFile 为空时不使用磁盘上的管线库。threadPool 为空时所有 PSO 都同步创建
+    PipelineStateCache(ID3D12Device *device, const std::wstring &libraryFile,
+                       ThreadPool *threadPool = &ThreadPool::Default());
+    PipelineStateCache(const PipelineStateCache &rhs) = delete;
+    PipelineStateCache &operator=(const PipelineStateCache &rhs) = delete;
+    // 等待后台创建完成并保存管线库
+    ~PipelineStateCache();
+
+    // 根签名没有可以直接哈希的描述，使用 D3D12SerializeRootSignature 的结果
+    static uint64 HashRootSignature(ID3DBlob *serializedRootSignature);
+    // desc.pRootSignature 本身不参与哈希，由 rootSignatureHash 代替；CachedPSO 也不参与哈希
+    static uint64 HashGraphicsPipeline(const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc, uint64 rootSignatureHash);
+
+    // 同步返回 key 对应的 PSO，没有时立即创建。失败时抛出异常
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> GetGraphicsPipeline(uint64 key,
+                                                                    const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc);
+    // 在后台创建 key 对应的 PSO。desc 引用的着色器字节码与输入布局会被复制，调用返回后即可释放
+    void RequestGraphicsPipeline(uint64 key, const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc);
+    // PSO 已就绪时返回它，否则（仍在创建或创建失败）返回 fallback。返回的指针在缓存销毁之前有效
+    ID3D12PipelineState *FindGraphicsPipeline(uint64 key, ID3D12PipelineState *fallback) const;
+
+    // 等待所有后台创建完成
+    void WaitIdle();
+
+    // 管线库中有新的 PSO 时写入磁盘。先写入临时文件再替换，写到一半中断不会损坏原有的管线库
+    bool SaveLibrary();
+
+    Statistics GetStatistics() const;
+
+  private:
+    Microsoft::WRL::ComPtr<ID3D12PipelineState> CreateGraphicsPipeline(uint64 key,
+                                                                       const D3D12_GRAPHICS_PIPELINE_STATE_DESC &desc);
+    void OpenLibrary();
+
+  private:
+    Microsoft::WRL::ComPtr<ID3D12Device> mDevice;
+    std::wstring mLibraryFile;
+
+    // ID3D12PipelineLibrary 直接引用创建时传入的数据，必须比它存活得更久
+    std::vector<std::uint8_t> mLibraryData;
+    Microsoft::WRL::ComPtr<ID3D12PipelineLibrary> mLibrary;
+    // 保护 mLibrary 与下面的计数
+    mutable std::mutex mLibraryMutex;
+    bool mLibraryDirty = false;
+    uint32 mLibraryLoads = 0;
+    uint32 mCompiled = 0;
+
+    // 最后声明，最先析构：后台任务用到了上面的成员
+    AsyncObjectCache<Microsoft::WRL::ComPtr<ID3D12PipelineState>> mCache;
+};
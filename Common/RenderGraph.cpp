@@ -0,0 +1,411 @@
+#include "RenderGraph.h"
+#include <algorithm>
+#include <cassert>
+
+namespace
+{
+RenderGraph::uint64 AlignUp(RenderGraph::uint64 value, RenderGraph::uint64 alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+RenderGraph::ResourceHandle RenderGraph::ImportResource(const std::string &name, uint32 initialState, uint32 finalState)
+{
+    Resource resource;
+    resource.Name = name;
+    resource.Imported = true;
+    resource.InitialState = initialState;
+    resource.FinalState = finalState;
+    mResources.push_back(resource);
+    mCompiled = false;
+
+    ResourceHandle handle;
+    handle.Index = (uint32)mResources.size() - 1;
+    return handle;
+}
+
+RenderGraph::ResourceHandle RenderGraph::CreateTransient(const std::string &name, const TransientDesc &desc)
+{
+    assert(desc.Size > 0 && desc.Alignment > 0);
+
+    Resource resource;
+    resource.Name = name;
+    resource.Imported = false;
+    resource.InitialState = desc.InitialState;
+    resource.FinalState = desc.InitialState;
+    resource.Size = desc.Size;
+    resource.Alignment = desc.Alignment;
+    mResources.push_back(resource);
+    mCompiled = false;
+
+    ResourceHandle handle;
+    handle.Index = (uint32)mResources.size() - 1;
+    return handle;
+}
+
+RenderGraph::PassHandle RenderGraph::AddPass(const std::string &name, ExecuteFunc execute)
+{
+    Pass pass;
+    pass.Name = name;
+    pass.Execute = std::move(execute);
+    mPasses.push_back(std::move(pass));
+    mCompiled = false;
+
+    PassHandle handle;
+    handle.Index = (uint32)mPasses.size() - 1;
+    return handle;
+}
+
+RenderGraph::Access &RenderGraph::FindOrAddAccess(PassHandle pass, ResourceHandle resource, bool isWrite)
+{
+    assert(pass.Index < mPasses.size() && resource.Index < mResources.size());
+    mCompiled = false;
+
+    for (Access &access : mPasses[pass.Index].Accesses)
+    {
+        if (access.Resource == resource.Index)
+            return access;
+    }
+
+    Access access = {resource.Index, 0, isWrite};
+    mPasses[pass.Index].Accesses.push_back(access);
+    return mPasses[pass.Index].Accesses.back();
+}
+
+void RenderGraph::Read(PassHandle pass, ResourceHandle resource, uint32 state)
+{
+    Access &access = FindOrAddAccess(pass, resource, false);
+    // 同一个 Pass 既读又写时，以写入状态为准
+    if (!access.IsWrite)
+        access.State |= state;
+}
+
+void RenderGraph::Write(PassHandle pass, ResourceHandle resource, uint32 state)
+{
+    Access &access = FindOrAddAccess(pass, resource, true);
+    assert((!access.IsWrite || access.State == 0 || access.State == state) &&
+           "a pass can only write a resource in one state");
+    access.IsWrite = true;
+    access.State = state;
+}
+
+void RenderGraph::SetSideEffect(PassHandle pass)
+{
+    assert(pass.Index < mPasses.size());
+    mPasses[pass.Index].SideEffect = true;
+    mCompiled = false;
+}
+
+void RenderGraph::Compile()
+{
+    mBarriers.clear();
+    mStats = Statistics();
+    mStats.PassCount = (uint32)mPasses.size();
+
+    CullPasses();
+    AllocateTransients();
+    BuildBarriers();
+
+    mCompiled = true;
+}
+
+void RenderGraph::CullPasses()
+{
+    // 从后往前遍历：带副作用的 Pass 与写入了后续存活 Pass 所需资源的 Pass 才被保留，
+    // 保留的 Pass 读取的资源随之成为“被需要的”资源
+    std::vector<bool> needed(mResources.size(), false);
+
+    for (size_t i = mPasses.size(); i-- > 0;)
+    {
+        Pass &pass = mPasses[i];
+        bool alive = pass.SideEffect;
+        for (const Access &access : pass.Accesses)
+        {
+            if (access.IsWrite && (mResources[access.Resource].Imported || needed[access.Resource]))
+                alive = true;
+        }
+
+        pass.Culled = !alive;
+        if (pass.Culled)
+        {
+            ++mStats.CulledPassCount;
+            continue;
+        }
+
+        for (const Access &access : pass.Accesses)
+        {
+            if (!access.IsWrite)
+                needed[access.Resource] = true;
+        }
+    }
+}
+
+void RenderGraph::AllocateTransients()
+{
+    // 计算每个资源被存活 Pass 使用的区间
+    for (Resource &resource : mResources)
+    {
+        resource.FirstPass = InvalidIndex;
+        resource.LastPass = InvalidIndex;
+        resource.HeapOffset = InvalidOffset;
+        resource.NeedsAliasingBarrier = false;
+    }
+    for (uint32 i = 0; i < (uint32)mPasses.size(); ++i)
+    {
+        if (mPasses[i].Culled)
+            continue;
+        for (const Access &access : mPasses[i].Accesses)
+        {
+            Resource &resource = mResources[access.Resource];
+            if (resource.FirstPass == InvalidIndex)
+                resource.FirstPass = i;
+            resource.LastPass = i;
+        }
+    }
+
+    std::vector<uint32> transients;
+    for (uint32 i = 0; i < (uint32)mResources.size(); ++i)
+    {
+        if (!mResources[i].Imported && mResources[i].FirstPass != InvalidIndex)
+            transients.push_back(i);
+    }
+
+    // 先放大的资源，小资源更容易填进剩下的空隙
+    std::stable_sort(transients.begin(), transients.end(),
+                     [this](uint32 a, uint32 b) { return mResources[a].Size > mResources[b].Size; });
+
+    auto lifetimesOverlap = [](const Resource &a, const Resource &b) {
+        return a.FirstPass <= b.LastPass && b.FirstPass <= a.LastPass;
+    };
+    auto memoryOverlaps = [](const Resource &a, uint64 offset, uint64 size) {
+        return a.HeapOffset < offset + size && offset < a.HeapOffset + a.Size;
+    };
+
+    std::vector<uint32> placed;
+    for (uint32 index : transients)
+    {
+        Resource &resource = mResources[index];
+        mStats.TransientBytes += AlignUp(resource.Size, resource.Alignment);
+
+        // 候选位置为 0 以及每个生命周期重叠的已放置资源的末尾，取不与它们冲突的最低位置
+        std::vector<uint64> candidates(1, 0);
+        for (uint32 other : placed)
+        {
+            if (lifetimesOverlap(resource, mResources[other]))
+                candidates.push_back(AlignUp(mResources[other].HeapOffset + mResources[other].Size, resource.Alignment));
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        for (uint64 offset : candidates)
+        {
+            bool fits = true;
+            for (uint32 other : placed)
+            {
+                if (lifetimesOverlap(resource, mResources[other]) &&
+                    memoryOverlaps(mResources[other], offset, resource.Size))
+                {
+                    fits = false;
+                    break;
+                }
+            }
+            if (fits)
+            {
+                resource.HeapOffset = offset;
+                break;
+            }
+        }
+        assert(resource.HeapOffset != InvalidOffset);
+
+        placed.push_back(index);
+        mStats.TransientHeapSize = std::max(mStats.TransientHeapSize, resource.HeapOffset + resource.Size);
+    }
+
+    // 与其他资源共用内存的资源在第一次使用前需要一个别名屏障。编译结果每帧重复执行，
+    // 即使本帧内没有更早使用这块内存的资源，上一帧中更晚使用它的资源也会留下别的内容
+    for (uint32 index : placed)
+    {
+        Resource &resource = mResources[index];
+        for (uint32 other : placed)
+        {
+            if (other != index && memoryOverlaps(mResources[other], resource.HeapOffset, resource.Size))
+            {
+                resource.NeedsAliasingBarrier = true;
+                break;
+            }
+        }
+    }
+}
+
+void RenderGraph::BuildBarriers()
+{
+    std::vector<uint32> currentStates(mResources.size());
+    // 当前状态是否为只读状态的组合，是的话被其子集的读取不需要转换。
+    // 导入资源的初始状态由外部给出，已经包含了读取所需的全部状态时同样不需要转换
+    std::vector<bool> currentIsRead(mResources.size(), false);
+    // 临时资源在最后一次使用之后是否已经转换回初始状态
+    std::vector<bool> restored(mResources.size(), false);
+    for (size_t i = 0; i < mResources.size(); ++i)
+    {
+        currentStates[i] = mResources[i].InitialState;
+        currentIsRead[i] = mResources[i].Imported;
+    }
+
+    // 编译结果每帧重复执行，所以临时资源在最后一次使用之后要转换回创建时的初始状态，下一帧的第一个屏障才与之相符。
+    // 转换紧接在最后一次使用之后（下一个存活 Pass 的屏障中），这时还没有别的资源通过别名屏障占用它的内存
+    auto restoreTransients = [&](uint32 passIndex) {
+        for (uint32 i = 0; i < (uint32)mResources.size(); ++i)
+        {
+            const Resource &resource = mResources[i];
+            if (resource.Imported || restored[i] || resource.LastPass == InvalidIndex || resource.LastPass >= passIndex)
+                continue;
+            restored[i] = true;
+            if (currentStates[i] != resource.InitialState)
+                mBarriers.push_back({i, false, currentStates[i], resource.InitialState});
+            currentStates[i] = resource.InitialState;
+        }
+    };
+
+    // 从 passIndex 开始连续只读取 resource 的存活 Pass 所需状态的并集
+    auto readStateUnion = [this](uint32 passIndex, uint32 resource) {
+        uint32 state = 0;
+        for (uint32 i = passIndex; i <= mResources[resource].LastPass; ++i)
+        {
+            if (mPasses[i].Culled)
+                continue;
+            for (const Access &access : mPasses[i].Accesses)
+            {
+                if (access.Resource != resource)
+                    continue;
+                if (access.IsWrite)
+                    return state;
+                state |= access.State;
+            }
+        }
+        return state;
+    };
+
+    for (uint32 i = 0; i < (uint32)mPasses.size(); ++i)
+    {
+        Pass &pass = mPasses[i];
+        pass.BarrierBegin = (uint32)mBarriers.size();
+        pass.BarrierEnd = pass.BarrierBegin;
+        if (pass.Culled)
+            continue;
+
+        restoreTransients(i);
+        for (const Access &access : pass.Accesses)
+        {
+            const Resource &resource = mResources[access.Resource];
+            uint32 &current = currentStates[access.Resource];
+
+            if (resource.NeedsAliasingBarrier && resource.FirstPass == i)
+            {
+                mBarriers.push_back({access.Resource, true, 0, 0});
+                ++mStats.AliasingBarrierCount;
+            }
+
+            if (access.IsWrite)
+            {
+                if (current != access.State)
+                    mBarriers.push_back({access.Resource, false, current, access.State});
+                current = access.State;
+                currentIsRead[access.Resource] = false;
+            }
+            else
+            {
+                bool satisfied = current == access.State ||
+                                 (currentIsRead[access.Resource] && access.State != 0 &&
+                                  (current & access.State) == access.State);
+                if (!satisfied)
+                {
+                    // 之后的读取可能已经包含在当前状态中，并集与当前状态相同时不需要转换
+                    uint32 state = readStateUnion(i, access.Resource);
+                    if (state != current)
+                        mBarriers.push_back({access.Resource, false, current, state});
+                    current = state;
+                }
+                currentIsRead[access.Resource] = true;
+            }
+        }
+
+        pass.BarrierEnd = (uint32)mBarriers.size();
+        if (pass.BarrierEnd != pass.BarrierBegin)
+            ++mStats.BarrierBatchCount;
+    }
+
+    mFinalBarrierBegin = (uint32)mBarriers.size();
+    restoreTransients((uint32)mPasses.size());
+    for (uint32 i = 0; i < (uint32)mResources.size(); ++i)
+    {
+        if (mResources[i].Imported && currentStates[i] != mResources[i].FinalState)
+            mBarriers.push_back({i, false, currentStates[i], mResources[i].FinalState});
+    }
+    if (mBarriers.size() != mFinalBarrierBegin)
+        ++mStats.BarrierBatchCount;
+
+    mStats.BarrierCount = (uint32)mBarriers.size();
+}
+
+void RenderGraph::SetPhysicalResource(ResourceHandle resource, void *physicalResource)
+{
+    assert(resource.Index < mResources.size());
+    mResources[resource.Index].Physical = physicalResource;
+}
+
+void RenderGraph::RecordBarriers(CommandStream &stream, uint32 begin, uint32 end) const
+{
+    for (uint32 i = begin; i < end; ++i)
+    {
+        const Barrier &barrier = mBarriers[i];
+        void *physical = mResources[barrier.Resource].Physical;
+        assert(physical != nullptr && "SetPhysicalResource must be called before recording");
+
+        if (barrier.Aliasing)
+            stream.AliasingBarrier(nullptr, physical);
+        else
+            stream.TransitionBarrier(physical, barrier.StateBefore, barrier.StateAfter);
+    }
+}
+
+void RenderGraph::Execute(CommandStream &stream) const
+{
+    assert(mCompiled);
+
+    for (uint32 i = 0; i < (uint32)mPasses.size(); ++i)
+    {
+        const Pass &pass = mPasses[i];
+        if (pass.Culled)
+            continue;
+
+        RecordBarriers(stream, pass.BarrierBegin, pass.BarrierEnd);
+        if (pass.Execute)
+            pass.Execute(stream);
+    }
+
+    RecordFinalBarriers(stream);
+}
+
+void RenderGraph::RecordPassBarriers(CommandStream &stream, PassHandle pass) const
+{
+    assert(mCompiled && pass.Index < mPasses.size());
+    RecordBarriers(stream, mPasses[pass.Index].BarrierBegin, mPasses[pass.Index].BarrierEnd);
+}
+
+void RenderGraph::RecordFinalBarriers(CommandStream &stream) const
+{
+    assert(mCompiled);
+    RecordBarriers(stream, mFinalBarrierBegin, (uint32)mBarriers.size());
+}
+
+bool RenderGraph::IsCulled(PassHandle pass) const
+{
+    assert(mCompiled && pass.Index < mPasses.size());
+    return mPasses[pass.Index].Culled;
+}
+
+RenderGraph::uint64 RenderGraph::GetTransientOffset(ResourceHandle resource) const
+{
+    assert(mCompiled && resource.Index < mResources.size());
+    return mResources[resource.Index].HeapOffset;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "CommandStream.h"
+#include <functional>
+#include <string>
+#include <vector>
+
+// 帧图（render graph）
+// 原先每个示例的 Draw 都手工插入资源屏障，一次一个，也无法让生命周期不重叠的临时资源共用内存。
+// RenderGraph 中的每个 Pass 只声明它读写哪些资源、需要它们处于什么状态，Compile 之后：
+//   1. 剔除结果没有被使用的 Pass：只有带副作用的 Pass（写入导入的外部资源或调用了 SetSideEffect）
+//      以及它们所依赖的 Pass 会被保留；
+//   2. 推导每个 Pass 之前需要的状态转换，同一个 Pass 之前的所有屏障连续写入命令流，回放时合并为一次
+//      ResourceBarrier 调用；连续几个 Pass 以不同的只读状态读取同一资源时，只转换一次到这些状态的并集；
+//   3. 为临时资源（transient）计算生命周期，并把生命周期不重叠的资源放在同一块堆内存的重叠区间中，
+//      在复用内存的位置插入别名屏障。
+// 临时资源在最后一次使用之后被转换回 TransientDesc::InitialState，编译结果可以每帧重复执行。
+//
+// 编译过程只依赖资源状态的数值，不包含 d3d12.h，可以脱离 GPU 检查屏障数量与峰值内存。
+// 状态以 D3D12_RESOURCE_STATES 的数值传入，物理资源以不透明指针在执行前绑定。
+//
+// 使用流程：
+//   auto backBuffer = graph.ImportResource("BackBuffer", PRESENT, PRESENT);
+//   auto pass = graph.AddPass("Opaque", [](CommandStream &stream) { ... });
+//   graph.Write(pass, backBuffer, RENDER_TARGET);
+//   graph.Compile();                                  // 结构不变时只需编译一次
+//   graph.SetPhysicalResource(backBuffer, resource);  // 每帧绑定物理资源
+//   graph.Execute(stream);
+class RenderGraph
+{
+  public:
+    using uint32 = std::uint32_t;
+    using uint64 = std::uint64_t;
+    using ExecuteFunc = std::function<void(CommandStream &)>;
+
+    static const uint32 InvalidIndex = ~0u;
+    static const uint64 InvalidOffset = ~0ull;
+
+    struct ResourceHandle
+    {
+        uint32 Index = InvalidIndex;
+
+        bool IsValid() const
+        {
+            return Index != InvalidIndex;
+        }
+    };
+
+    struct PassHandle
+    {
+        uint32 Index = InvalidIndex;
+
+        bool IsValid() const
+        {
+            return Index != InvalidIndex;
+        }
+    };
+
+    // 临时资源的内存需求，通常来自 ID3D12Device::GetResourceAllocationInfo
+    struct TransientDesc
+    {
+        uint64 Size = 0;
+        uint64 Alignment = 64 * 1024;
+        // 在别名内存上创建资源时所用的初始状态
+        uint32 InitialState = 0;
+    };
+
+    struct Statistics
+    {
+        uint32 PassCount = 0;
+        uint32 CulledPassCount = 0;
+        // 转换屏障与别名屏障的总数
+        uint32 BarrierCount = 0;
+        uint32 AliasingBarrierCount = 0;
+        // 合并之后的 ResourceBarrier 调用次数
+        uint32 BarrierBatchCount = 0;
+        // 存活的临时资源各自独占内存时所需的总字节数
+        uint64 TransientBytes = 0;
+        // 别名之后临时资源堆的大小，即峰值内存
+        uint64 TransientHeapSize = 0;
+    };
+
+    // 导入一个由外部管理的资源。执行之前它处于 initialState，所有 Pass 执行完毕后会被转换到 finalState
+    ResourceHandle ImportResource(const std::string &name, uint32 initialState, uint32 finalState);
+
+    // 声明一个只在本帧内使用的临时资源，其内存由 Compile 在临时资源堆中分配
+    ResourceHandle CreateTransient(const std::string &name, const TransientDesc &desc);
+
+    // 按执行顺序添加 Pass
+    PassHandle AddPass(const std::string &name, ExecuteFunc execute);
+
+    // Pass 以只读状态 state 读取 resource。同一个 Pass 多次读取时，所需状态取并集
+    void Read(PassHandle pass, ResourceHandle resource, uint32 state);
+    // Pass 以状态 state 写入 resource。同一个 Pass 对同一资源只能有一种写入状态
+    void Write(PassHandle pass, ResourceHandle resource, uint32 state);
+    // 即使没有任何 Pass 使用其结果也不剔除（例如只写入回读缓冲区的 Pass）
+    void SetSideEffect(PassHandle pass);
+
+    // 剔除 Pass、推导屏障并分配临时资源。添加或修改 Pass 之后需要重新编译
+    void Compile();
+
+    // 绑定资源对应的 ID3D12Resource。导入的资源每帧都可能变化（例如后台缓冲区）
+    void SetPhysicalResource(ResourceHandle resource, void *physicalResource);
+
+    // 依次把每个存活 Pass 之前的屏障与 Pass 本身的命令写入 stream，最后写入导入资源的最终转换
+    void Execute(CommandStream &stream) const;
+
+    // 只写入某个 Pass 之前的屏障，用于把 Pass 的命令分散到多个命令流中（例如多线程记录）的场合
+    void RecordPassBarriers(CommandStream &stream, PassHandle pass) const;
+    // 只写入所有 Pass 执行完毕后的最终转换（导入资源转换到 finalState，尚未转换回初始状态的临时资源转换回初始状态）
+    void RecordFinalBarriers(CommandStream &stream) const;
+
+    bool IsCulled(PassHandle pass) const;
+
+    // 临时资源在临时资源堆中的偏移量，被剔除而不需要内存的资源返回 InvalidOffset
+    uint64 GetTransientOffset(ResourceHandle resource) const;
+
+    const Statistics &GetStatistics() const
+    {
+        return mStats;
+    }
+
+  private:
+    struct Access
+    {
+        uint32 Resource;
+        uint32 State;
+        bool IsWrite;
+    };
+
+    struct Pass
+    {
+        std::string Name;
+        ExecuteFunc Execute;
+        std::vector<Access> Accesses;
+        bool SideEffect = false;
+        // 以下由 Compile 填写
+        bool Culled = false;
+        // 在 mBarriers 中的区间 [BarrierBegin, BarrierEnd)
+        uint32 BarrierBegin = 0;
+        uint32 BarrierEnd = 0;
+    };
+
+    struct Resource
+    {
+        std::string Name;
+        bool Imported;
+        uint32 InitialState;
+        uint32 FinalState;
+        uint64 Size = 0;
+        uint64 Alignment = 1;
+        void *Physical = nullptr;
+        // 以下由 Compile 填写，First/Last 为存活 Pass 的编号
+        uint32 FirstPass = InvalidIndex;
+        uint32 LastPass = InvalidIndex;
+        uint64 HeapOffset = InvalidOffset;
+        // 第一次使用前是否需要别名屏障
+        bool NeedsAliasingBarrier = false;
+    };
+
+    struct Barrier
+    {
+        uint32 Resource;
+        // 别名屏障的 StateBefore/StateAfter 无意义
+        bool Aliasing;
+        uint32 StateBefore;
+        uint32 StateAfter;
+    };
+
+    void CullPasses();
+    void AllocateTransients();
+    void BuildBarriers();
+    void RecordBarriers(CommandStream &stream, uint32 begin, uint32 end) const;
+    Access &FindOrAddAccess(PassHandle pass, ResourceHandle resource, bool isWrite);
+
+  private:
+    std::vector<Pass> mPasses;
+    std::vector<Resource> mResources;
+    std::vector<Barrier> mBarriers;
+    // mBarriers 中最终转换的起点
+    uint32 mFinalBarrierBegin = 0;
+    bool mCompiled = false;
+    Statistics mStats;
+};
@@ -0,0 +1,253 @@
+#include "ResourceStateTracker.h"
+#include <algorithm>
+#include <cassert>
+
+//
+// ResourceStateMap
+//
+
+void ResourceStateMap::Register(const void *resource, uint32 subresourceCount, uint32 state)
+{
+    assert(resource != nullptr && subresourceCount > 0);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    Entry &entry = mEntries[resource];
+    entry.SubresourceCount = subresourceCount;
+    entry.States.assign(1, state);
+}
+
+void ResourceStateMap::Unregister(const void *resource)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.erase(resource);
+}
+
+bool ResourceStateMap::GetState(const void *resource, uint32 subresource, uint32 &state) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(resource);
+    if (it == mEntries.end())
+        return false;
+
+    const Entry &entry = it->second;
+    if (entry.States.size() == 1)
+        state = entry.States[0];
+    else if (subresource < entry.States.size())
+        state = entry.States[subresource];
+    else
+        return false;
+    return true;
+}
+
+ResourceStateMap::uint32 ResourceStateMap::GetSubresourceCount(const void *resource) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    auto it = mEntries.find(resource);
+    return it != mEntries.end() ? it->second.SubresourceCount : 1;
+}
+
+size_t ResourceStateMap::Size() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mEntries.size();
+}
+
+//
+// ResourceStateTracker
+//
+
+ResourceStateTracker::ResourceStateTracker(ResourceStateMap &states) : mGlobalStates(states)
+{
+}
+
+void ResourceStateTracker::TransitionResource(void *resource, uint32 stateAfter, uint32 subresource)
+{
+    assert(resource != nullptr);
+    ++mStats.RequestedTransitions;
+
+    auto it = mLocalStates.find(resource);
+    if (subresource == AllSubresources)
+    {
+        if (it == mLocalStates.end())
+        {
+            mPendingBarriers.push_back({resource, AllSubresources, stateAfter});
+            mLocalStates.emplace(resource, std::vector<uint32>(1, stateAfter));
+            return;
+        }
+
+        std::vector<uint32> &states = it->second;
+        if (states.size() == 1)
+        {
+            TransitionSubresource(resource, states, 0, stateAfter);
+        }
+        else
+        {
+            // 各子资源的状态不同，只能逐个转换
+            for (uint32 i = 0; i < (uint32)states.size(); ++i)
+                TransitionSubresource(resource, states, i, stateAfter);
+        }
+        states.assign(1, stateAfter);
+        return;
+    }
+
+    if (it == mLocalStates.end())
+    {
+        uint32 subresourceCount = mGlobalStates.GetSubresourceCount(resource);
+        it = mLocalStates.emplace(resource, std::vector<uint32>(subresourceCount, UnknownState)).first;
+    }
+
+    std::vector<uint32> &states = it->second;
+    if (states.size() == 1)
+    {
+        uint32 subresourceCount = mGlobalStates.GetSubresourceCount(resource);
+        if (subresourceCount == 1)
+        {
+            TransitionSubresource(resource, states, 0, stateAfter);
+            return;
+        }
+        states.assign(subresourceCount, states[0]);
+    }
+
+    assert(subresource < states.size());
+    TransitionSubresource(resource, states, subresource, stateAfter);
+}
+
+void ResourceStateTracker::TransitionSubresource(void *resource, std::vector<uint32> &states, uint32 subresource,
+                                                 uint32 stateAfter)
+{
+    // states 只有一个元素时表示整个资源
+    uint32 barrierSubresource = states.size() == 1 ? AllSubresources : subresource;
+    if (states[subresource] == UnknownState)
+    {
+        // 在本命令列表中第一次使用
+        mPendingBarriers.push_back({resource, barrierSubresource, stateAfter});
+    }
+    else
+    {
+        QueueBarrier(resource, barrierSubresource, states[subresource], stateAfter);
+    }
+    states[subresource] = stateAfter;
+}
+
+void ResourceStateTracker::QueueBarrier(void *resource, uint32 subresource, uint32 stateBefore, uint32 stateAfter)
+{
+    // 与尚未写出的同一资源的屏障合并
+    auto sameTarget = [resource, subresource](const Barrier &barrier) {
+        return barrier.Resource == resource && barrier.Subresource == subresource;
+    };
+    auto it = std::find_if(mBarriers.begin(), mBarriers.end(), sameTarget);
+    if (it != mBarriers.end())
+    {
+        ++mStats.ElidedTransitions;
+        it->StateAfter = stateAfter;
+        // A→B 之后又 B→A，两个屏障都不需要
+        if (it->StateBefore == it->StateAfter)
+            mBarriers.erase(it);
+        return;
+    }
+
+    if (stateBefore == stateAfter)
+    {
+        ++mStats.ElidedTransitions;
+        return;
+    }
+
+    mBarriers.push_back({resource, subresource, stateBefore, stateAfter});
+}
+
+ResourceStateTracker::uint32 ResourceStateTracker::FlushBarriers(CommandStream &stream)
+{
+    for (const Barrier &barrier : mBarriers)
+        stream.TransitionBarrier(barrier.Resource, barrier.StateBefore, barrier.StateAfter, barrier.Subresource);
+
+    uint32 count = (uint32)mBarriers.size();
+    mStats.FlushedBarriers += count;
+    mBarriers.clear();
+    return count;
+}
+
+ResourceStateTracker::uint32 ResourceStateTracker::ResolvePendingBarriers(CommandStream &prologue)
+{
+    assert(mBarriers.empty() && "FlushBarriers must be called before resolving pending barriers");
+
+    uint32 count = 0;
+    std::lock_guard<std::mutex> lock(mGlobalStates.mMutex);
+
+    for (const PendingBarrier &pending : mPendingBarriers)
+    {
+        auto it = mGlobalStates.mEntries.find(pending.Resource);
+        if (it == mGlobalStates.mEntries.end())
+        {
+            // 未登记的资源无从得知之前的状态，调用者需要先 Register
+            assert(false && "resource state is not registered");
+            continue;
+        }
+
+        const std::vector<uint32> &globalStates = it->second.States;
+        if (pending.Subresource == AllSubresources && globalStates.size() > 1)
+        {
+            for (uint32 i = 0; i < (uint32)globalStates.size(); ++i)
+            {
+                if (globalStates[i] != pending.StateAfter)
+                {
+                    prologue.TransitionBarrier(pending.Resource, globalStates[i], pending.StateAfter, i);
+                    ++count;
+                }
+            }
+            continue;
+        }
+
+        uint32 stateBefore = globalStates.size() == 1 ? globalStates[0] : globalStates[pending.Subresource];
+        if (stateBefore != pending.StateAfter)
+        {
+            prologue.TransitionBarrier(pending.Resource, stateBefore, pending.StateAfter, pending.Subresource);
+            ++count;
+        }
+        else
+        {
+            ++mStats.ElidedTransitions;
+        }
+    }
+
+    // 写回本命令列表结束时的状态
+    for (const auto &local : mLocalStates)
+    {
+        auto it = mGlobalStates.mEntries.find(local.first);
+        if (it == mGlobalStates.mEntries.end())
+            continue;
+
+        std::vector<uint32> &globalStates = it->second.States;
+        const std::vector<uint32> &localStates = local.second;
+        if (localStates.size() == 1)
+        {
+            globalStates = localStates;
+            continue;
+        }
+
+        if (globalStates.size() == 1)
+            globalStates.assign(localStates.size(), globalStates[0]);
+        for (size_t i = 0; i < localStates.size(); ++i)
+        {
+            if (localStates[i] != UnknownState)
+                globalStates[i] = localStates[i];
+        }
+        // 所有子资源的状态又变得相同时，合并为一个
+        if (std::all_of(globalStates.begin(), globalStates.end(),
+                        [&globalStates](uint32 state) { return state == globalStates[0]; }))
+            globalStates.resize(1);
+    }
+
+    mStats.ResolvedBarriers += count;
+    mPendingBarriers.clear();
+    mLocalStates.clear();
+    return count;
+}
+
+void ResourceStateTracker::Reset()
+{
+    assert(mBarriers.empty());
+    mLocalStates.clear();
+    mBarriers.clear();
+    mPendingBarriers.clear();
+    mStats = Statistics();
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "CommandStream.h"
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// 资源状态跟踪
+// 原先没有任何地方记录 ID3D12Resource 当前处于什么状态，每段代码只能假设一个状态并手工插入屏障，
+// 例如 CreateDefaultBuffer 总是 COMMON→COPY_DEST→GENERIC_READ，哪怕资源已经处于目标状态。
+// 状态跟踪分为两层：
+//   ResourceStateMap     所有命令列表共享的全局状态，即按提交顺序执行完之前所有命令列表后资源所处的状态；
+//   ResourceStateTracker 每个命令列表（命令流）各有一个，只在记录它的线程中使用，不需要加锁。
+// 记录时只需说明资源“需要”处于什么状态：
+//   - 命令列表中第一次使用某个资源时还不知道它之前的状态，先记为待定屏障（pending），
+//     提交前由 ResolvePendingBarriers 对照全局状态补齐，写入在本命令列表之前执行的命令流中；
+//   - 之后的转换根据本地记录的状态生成，前后状态相同的转换直接丢弃；
+//   - 屏障先缓存起来，直到下一次绘制或分派之前调用 FlushBarriers 才一次性写入命令流，
+//     期间对同一资源的多次转换会被合并，A→B→A 这样的往返会被整个消除。
+// 状态以 D3D12_RESOURCE_STATES 的数值表示，资源以不透明指针表示，可以配合 NullCommandBackend 在没有 GPU 的环境中测试。
+//
+// 目前只有 UploadBatch（经由 UploadPlanner）使用它们，ResourceStateMap 也只在一次 Record 中存在：
+// 全局状态以资源指针为键，资源销毁后地址可能被新资源复用，长期保存的映射要求每处释放资源的代码都先 Unregister，
+// 而几何体的缓冲区由 MeshGeometry 以 ComPtr 持有，随处都可能释放。每帧的后台缓冲区与深度缓冲区转换则由
+// RenderGraph 按导入时声明的状态推导，不经过这里。
+
+class ResourceStateMap
+{
+  public:
+    using uint32 = std::uint32_t;
+
+    // 登记一个资源及其当前状态（通常是创建时的初始状态），所有子资源都处于 state
+    void Register(const void *resource, uint32 subresourceCount, uint32 state);
+    // 资源销毁之前注销
+    void Unregister(const void *resource);
+
+    // 资源（或其子资源）当前的全局状态，未登记时返回 false
+    bool GetState(const void *resource, uint32 subresource, uint32 &state) const;
+    uint32 GetSubresourceCount(const void *resource) const;
+
+    size_t Size() const;
+
+  private:
+    friend class ResourceStateTracker;
+
+    struct Entry
+    {
+        uint32 SubresourceCount = 1;
+        // 所有子资源状态相同时只有一个元素，否则每个子资源一个
+        std::vector<uint32> States;
+    };
+
+    mutable std::mutex mMutex;
+    std::unordered_map<const void *, Entry> mEntries;
+};
+
+class ResourceStateTracker
+{
+  public:
+    using uint32 = std::uint32_t;
+
+    static constexpr uint32 AllSubresources = CommandStream::AllSubresources;
+
+    struct Statistics
+    {
+        // 调用 TransitionResource 的次数
+        uint32 RequestedTransitions = 0;
+        // 因为前后状态相同或被合并而没有产生屏障的转换
+        uint32 ElidedTransitions = 0;
+        // FlushBarriers 写入的屏障数
+        uint32 FlushedBarriers = 0;
+        // ResolvePendingBarriers 写入的屏障数
+        uint32 ResolvedBarriers = 0;
+    };
+
+    // states 用于查询子资源的数量并在提交前解析待定屏障，必须比跟踪器存活得更久
+    explicit ResourceStateTracker(ResourceStateMap &states);
+    ResourceStateTracker(const ResourceStateTracker &rhs) = delete;
+    ResourceStateTracker &operator=(const ResourceStateTracker &rhs) = delete;
+
+    // 要求资源（或其某个子资源）在下一次绘制或分派时处于 stateAfter
+    void TransitionResource(void *resource, uint32 stateAfter, uint32 subresource = AllSubresources);
+
+    // 把缓存的屏障写入 stream，应在每次绘制或分派之前调用。返回写入的屏障数
+    uint32 FlushBarriers(CommandStream &stream);
+
+    // 提交之前调用：对照全局状态解析待定屏障并写入 prologue，随后把本命令列表结束时各资源的状态写回全局状态。
+    // prologue 必须在本命令列表之前执行；多个命令列表要按提交顺序依次调用。返回写入的屏障数
+    uint32 ResolvePendingBarriers(CommandStream &prologue);
+
+    // 清空本地状态，开始记录下一个命令列表。缓存的屏障必须已经写出
+    void Reset();
+
+    const Statistics &GetStatistics() const
+    {
+        return mStats;
+    }
+
+    size_t PendingBarrierCount() const
+    {
+        return mPendingBarriers.size();
+    }
+
+  private:
+    // 本地未知的状态。D3D12_RESOURCE_STATES 不会用到所有位
+    static constexpr uint32 UnknownState = 0xffffffff;
+
+    struct Barrier
+    {
+        void *Resource;
+        uint32 Subresource;
+        uint32 StateBefore;
+        uint32 StateAfter;
+    };
+
+    struct PendingBarrier
+    {
+        void *Resource;
+        uint32 Subresource;
+        uint32 StateAfter;
+    };
+
+    void TransitionSubresource(void *resource, std::vector<uint32> &states, uint32 subresource, uint32 stateAfter);
+    void QueueBarrier(void *resource, uint32 subresource, uint32 stateBefore, uint32 stateAfter);
+
+  private:
+    ResourceStateMap &mGlobalStates;
+    // 本命令列表中每个资源最后的状态：一个元素表示整个资源，否则每个子资源一个，可能为 UnknownState
+    std::unordered_map<void *, std::vector<uint32>> mLocalStates;
+    std::vector<Barrier> mBarriers;
+    std::vector<PendingBarrier> mPendingBarriers;
+    Statistics mStats;
+};
@@ -0,0 +1,404 @@
+#include "ShaderCache.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace
+{
+const std::uint32_t IndexMagic = 0x49434853; // "SHCI"
+const std::uint32_t IndexVersion = 1;
+
+bool ReadWholeFile(const std::wstring &filename, std::vector<std::uint8_t> &bytes)
+{
+    std::ifstream fin(std::filesystem::path(filename), std::ios::binary | std::ios::ate);
+    if (!fin)
+        return false;
+
+    bytes.resize(static_cast<size_t>(fin.tellg()));
+    fin.seekg(0, std::ios_base::beg);
+    return static_cast<bool>(fin.read(reinterpret_cast<char *>(bytes.data()), bytes.size()));
+}
+
+// 每次写入使用各自的临时文件：同一进程内的多个线程、共用缓存目录的多个进程可能同时写同一个文件，
+// 共用一个临时文件名时一个写入者会截断另一个正在写的内容，或者把它的临时文件先一步改名
+std::filesystem::path UniqueTempPath(const std::filesystem::path &path)
+{
+    static const std::uint64_t processTag = (std::uint64_t(std::random_device()()) << 32) | std::random_device()();
+    static std::atomic<std::uint64_t> counter{0};
+
+    std::filesystem::path tempPath = path;
+    tempPath += L"." + Hasher::ToHex(processTag) + L"." + std::to_wstring(counter++) + L".tmp";
+    return tempPath;
+}
+
+// 先写入临时文件再替换，写到一半中断不会留下损坏的文件
+bool WriteWholeFile(const std::wstring &filename, const void *data, size_t size)
+{
+    const std::filesystem::path path(filename);
+    const std::filesystem::path tempPath = UniqueTempPath(path);
+    std::error_code error;
+    {
+        std::ofstream fout(tempPath, std::ios::binary | std::ios::trunc);
+        if (!fout.write(static_cast<const char *>(data), static_cast<std::streamsize>(size)))
+        {
+            fout.close();
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(tempPath, path, error);
+    if (!error)
+        return true;
+    std::filesystem::remove(tempPath, error);
+    return false;
+}
+
+// 文件不存在时返回 false。映射文件而不是读入，每次查找都要哈希所有源文件，不必为此分配内存
+bool HashFile(const std::wstring &filename, std::uint64_t &hash)
+{
+    MappedFile file;
+    if (!file.Open(filename))
+        return false;
+    hash = Hasher::Hash(file.Data(), file.Size());
+    return true;
+}
+
+// wchar_t 在 Windows 上为 2 字节，在其他平台上为 4 字节，统一按 32 位保存与哈希
+void HashWideString(Hasher &hasher, const std::wstring &str)
+{
+    hasher.Update(static_cast<std::uint64_t>(str.size()));
+    for (wchar_t c : str)
+        hasher.Update(static_cast<std::uint32_t>(c));
+}
+
+class IndexWriter
+{
+  public:
+    template <typename T>
+    void Write(T value)
+    {
+        const auto *bytes = reinterpret_cast<const std::uint8_t *>(&value);
+        mBytes.insert(mBytes.end(), bytes, bytes + sizeof(T));
+    }
+
+    void WriteString(const std::wstring &str)
+    {
+        Write(static_cast<std::uint32_t>(str.size()));
+        for (wchar_t c : str)
+            Write(static_cast<std::uint32_t>(c));
+    }
+
+    const std::vector<std::uint8_t> &Bytes() const
+    {
+        return mBytes;
+    }
+
+  private:
+    std::vector<std::uint8_t> mBytes;
+};
+
+// 读取越界之后所有读取都返回 false
+class IndexReader
+{
+  public:
+    explicit IndexReader(const std::vector<std::uint8_t> &bytes) : mBytes(bytes)
+    {
+    }
+
+    template <typename T>
+    bool Read(T &value)
+    {
+        if (mBytes.size() - mOffset < sizeof(T))
+            return false;
+        std::memcpy(&value, mBytes.data() + mOffset, sizeof(T));
+        mOffset += sizeof(T);
+        return true;
+    }
+
+    bool ReadString(std::wstring &str)
+    {
+        std::uint32_t length = 0;
+        if (!Read(length) || (mBytes.size() - mOffset) / sizeof(std::uint32_t) < length)
+            return false;
+        str.resize(length);
+        for (std::uint32_t i = 0; i < length; ++i)
+        {
+            std::uint32_t c = 0;
+            Read(c);
+            str[i] = static_cast<wchar_t>(c);
+        }
+        return true;
+    }
+
+  private:
+    const std::vector<std::uint8_t> &mBytes;
+    size_t mOffset = 0;
+};
+} // namespace
+
+ShaderCache::ShaderCache(const std::wstring &directory, ShaderCompiler &compiler)
+    : mDirectory(directory), mCompiler(compiler)
+{
+    std::error_code error;
+    std::filesystem::create_directories(std::filesystem::path(mDirectory), error);
+    LoadIndex();
+}
+
+ShaderCache::~ShaderCache()
+{
+    SaveIndex();
+}
+
+ShaderCache::uint64 ShaderCache::HashRequest(const ShaderCompileRequest &request, uint64 compilerVersion)
+{
+    Hasher hasher;
+    hasher.Update(compilerVersion);
+    HashWideString(hasher, std::filesystem::path(request.FileName).lexically_normal().generic_wstring());
+    hasher.Update(static_cast<std::uint64_t>(request.Defines.size()));
+    for (const auto &define : request.Defines)
+    {
+        hasher.UpdateString(define.first);
+        hasher.UpdateString(define.second);
+    }
+    hasher.UpdateString(request.EntryPoint);
+    hasher.UpdateString(request.Target);
+    hasher.Update(request.Flags);
+    return hasher.Digest();
+}
+
+ShaderCompileResult ShaderCache::GetOrCompile(const ShaderCompileRequest &request)
+{
+    const uint64 requestHash = HashRequest(request, mCompiler.Version());
+
+    ShaderCompileResult result;
+    if (Lookup(requestHash, result))
+        return result;
+
+    result = Compile(request, requestHash);
+    SaveIndex();
+    return result;
+}
+
+std::vector<ShaderCompileResult> ShaderCache::GetOrCompileAll(const std::vector<ShaderCompileRequest> &requests,
+                                                              ThreadPool &threadPool)
+{
+    std::vector<ShaderCompileResult> results(requests.size());
+    std::vector<uint64> requestHashes(requests.size());
+    std::vector<size_t> misses;
+
+    const uint64 compilerVersion = mCompiler.Version();
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        requestHashes[i] = HashRequest(requests[i], compilerVersion);
+        if (!Lookup(requestHashes[i], results[i]))
+            misses.push_back(i);
+    }
+
+    if (misses.empty())
+        return results;
+
+    // 每个着色器的编译都是独立的，一个任务编译一个
+    threadPool.ParallelFor(misses.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const size_t index = misses[i];
+            results[index] = Compile(requests[index], requestHashes[index]);
+        }
+    });
+
+    SaveIndex();
+    return results;
+}
+
+bool ShaderCache::Lookup(uint64 requestHash, ShaderCompileResult &result)
+{
+    IndexEntry entry;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        auto it = mIndex.find(requestHash);
+        if (it == mIndex.end())
+        {
+            ++mStats.Misses;
+            return false;
+        }
+        entry = it->second;
+    }
+
+    // 在锁外读取文件：源文件任何一个改变（或被删除）都意味着需要重新编译
+    bool valid = true;
+    for (const ShaderDependency &dependency : entry.Dependencies)
+    {
+        uint64 contentHash = 0;
+        if (!HashFile(dependency.FileName, contentHash) || contentHash != dependency.ContentHash)
+        {
+            valid = false;
+            break;
+        }
+    }
+    if (valid)
+        valid = ReadWholeFile(BytecodeFileName(entry.BytecodeKey), result.Bytecode) && !result.Bytecode.empty();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!valid)
+    {
+        ++mStats.StaleEntries;
+        ++mStats.Misses;
+        // 期间另一个线程可能已经重新编译并替换了这个条目
+        auto it = mIndex.find(requestHash);
+        if (it != mIndex.end() && it->second.BytecodeKey == entry.BytecodeKey)
+            RemoveEntry(requestHash);
+        result.Bytecode.clear();
+        return false;
+    }
+
+    ++mStats.Hits;
+    result.Succeeded = true;
+    result.Errors.clear();
+    result.Dependencies = entry.Dependencies;
+    return true;
+}
+
+ShaderCompileResult ShaderCache::Compile(const ShaderCompileRequest &request, uint64 requestHash)
+{
+    ShaderCompileResult result = mCompiler.Compile(request);
+    if (!result.Succeeded)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        ++mStats.Failed;
+        return result;
+    }
+
+    // 字节码以全部输入的哈希命名：请求相同、源文件内容也相同的编译结果必然相同。
+    // 内容哈希由编译器在读取时算出，与字节码对应的正是这些内容，不必（也不能）在编译之后重新读取文件
+    IndexEntry entry;
+    entry.Dependencies = result.Dependencies;
+    Hasher hasher;
+    hasher.Update(requestHash);
+    for (const ShaderDependency &dependency : entry.Dependencies)
+    {
+        HashWideString(hasher, dependency.FileName);
+        hasher.Update(dependency.ContentHash);
+    }
+    entry.BytecodeKey = hasher.Digest();
+
+    // 字节码文件按内容寻址，已经存在的文件内容必然相同，不必重写。
+    // 在 Windows 上替换一个正被其他线程读取的文件还会失败
+    const std::wstring bytecodeFile = BytecodeFileName(entry.BytecodeKey);
+    std::error_code error;
+    if (!std::filesystem::exists(std::filesystem::path(bytecodeFile), error) &&
+        !WriteWholeFile(bytecodeFile, result.Bytecode.data(), result.Bytecode.size()))
+        return result;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    // 同一个请求被同时编译了两次时，第二次的结果与已有的条目相同
+    auto it = mIndex.find(requestHash);
+    if (it != mIndex.end() && it->second.BytecodeKey == entry.BytecodeKey)
+        return result;
+    RemoveEntry(requestHash);
+    mIndex[requestHash] = std::move(entry);
+    mIndexDirty = true;
+    return result;
+}
+
+void ShaderCache::RemoveEntry(uint64 requestHash)
+{
+    auto it = mIndex.find(requestHash);
+    if (it == mIndex.end())
+        return;
+
+    // 其他请求（例如只有文件名写法不同的请求）可能共用同一个字节码文件
+    const uint64 bytecodeKey = it->second.BytecodeKey;
+    mIndex.erase(it);
+    mIndexDirty = true;
+
+    for (const auto &other : mIndex)
+    {
+        if (other.second.BytecodeKey == bytecodeKey)
+            return;
+    }
+    std::error_code error;
+    std::filesystem::remove(std::filesystem::path(BytecodeFileName(bytecodeKey)), error);
+}
+
+std::wstring ShaderCache::BytecodeFileName(uint64 bytecodeKey) const
+{
+    return (std::filesystem::path(mDirectory) / (Hasher::ToHex(bytecodeKey) + L".cso")).wstring();
+}
+
+void ShaderCache::LoadIndex()
+{
+    std::vector<std::uint8_t> bytes;
+    if (!ReadWholeFile((std::filesystem::path(mDirectory) / L"index.bin").wstring(), bytes))
+        return;
+
+    // 索引损坏或版本不符时整个丢弃，所有着色器重新编译一次
+    IndexReader reader(bytes);
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    std::uint32_t entryCount = 0;
+    if (!reader.Read(magic) || magic != IndexMagic || !reader.Read(version) || version != IndexVersion ||
+        !reader.Read(entryCount))
+        return;
+
+    std::unordered_map<uint64, IndexEntry> index;
+    for (std::uint32_t i = 0; i < entryCount; ++i)
+    {
+        uint64 requestHash = 0;
+        IndexEntry entry;
+        std::uint32_t dependencyCount = 0;
+        if (!reader.Read(requestHash) || !reader.Read(entry.BytecodeKey) || !reader.Read(dependencyCount))
+            return;
+        for (std::uint32_t j = 0; j < dependencyCount; ++j)
+        {
+            ShaderDependency dependency;
+            if (!reader.ReadString(dependency.FileName) || !reader.Read(dependency.ContentHash))
+                return;
+            entry.Dependencies.push_back(std::move(dependency));
+        }
+        index[requestHash] = std::move(entry);
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mIndex = std::move(index);
+}
+
+bool ShaderCache::SaveIndex()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if (!mIndexDirty)
+        return true;
+
+    IndexWriter writer;
+    writer.Write(IndexMagic);
+    writer.Write(IndexVersion);
+    writer.Write(static_cast<std::uint32_t>(mIndex.size()));
+    for (const auto &item : mIndex)
+    {
+        writer.Write(item.first);
+        writer.Write(item.second.BytecodeKey);
+        writer.Write(static_cast<std::uint32_t>(item.second.Dependencies.size()));
+        for (const ShaderDependency &dependency : item.second.Dependencies)
+        {
+            writer.WriteString(dependency.FileName);
+            writer.Write(dependency.ContentHash);
+        }
+    }
+
+    const std::vector<std::uint8_t> &bytes = writer.Bytes();
+    if (!WriteWholeFile((std::filesystem::path(mDirectory) / L"index.bin").wstring(), bytes.data(), bytes.size()))
+        return false;
+
+    mIndexDirty = false;
+    return true;
+}
+
+ShaderCache::Statistics ShaderCache::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
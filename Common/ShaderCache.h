@@ -0,0 +1,125 @@
+#pragma once
+
+#include "ThreadPool.h"
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// 一次着色器编译的全部输入
+struct ShaderCompileRequest
+{
+    std::wstring FileName;
+    // 宏定义的名字与值
+    std::vector<std::pair<std::string, std::string>> Defines;
+    std::string EntryPoint;
+    std::string Target;
+    // 编译标志，例如 D3DCOMPILE_DEBUG
+    std::uint32_t Flags = 0;
+};
+
+// 编译读取的一个源文件
+struct ShaderDependency
+{
+    std::wstring FileName;
+    // 编译器实际读到的内容的哈希（Hasher::Hash）
+    std::uint64_t ContentHash = 0;
+};
+
+struct ShaderCompileResult
+{
+    bool Succeeded = false;
+    std::vector<std::uint8_t> Bytecode;
+    // 编译器输出的错误与警告
+    std::string Errors;
+    // 编译读取的所有源文件（主文件与所有被包含的文件）。编译失败时为失败之前读取过的文件
+    std::vector<ShaderDependency> Dependencies;
+};
+
+// 着色器编译器接口
+// ShaderCache 只通过它编译缓存未命中的着色器，Windows 上由 D3DShaderCompiler 实现，
+// 在没有 d3dcompiler 的环境中可以换成一个桩实现来检查缓存本身的行为。Compile 可能在多个线程中同时调用
+class ShaderCompiler
+{
+  public:
+    virtual ~ShaderCompiler() = default;
+
+    // 结果的 Dependencies 记录编译读取的每个源文件，以及交给编译器的内容的哈希。
+    // 哈希必须由读取时的内容计算：编译之后再重新读取文件的话，期间的修改（例如热重载时编辑器的保存）
+    // 会让旧的字节码记上新内容的哈希，之后的查找便一直命中这份过期的字节码
+    virtual ShaderCompileResult Compile(const ShaderCompileRequest &request) = 0;
+
+    // 编译器的版本，版本变化时所有缓存都会失效
+    virtual std::uint64_t Version() const = 0;
+};
+
+// 以内容哈希为键的着色器编译缓存
+// 原先每次启动都要调用 D3DCompileFromFile 重新编译所有着色器，调试版本关闭了优化也仍要花费不少时间。
+// ShaderCache 把编译得到的字节码保存在缓存目录中，下次请求相同的编译时直接读取，完全跳过编译器：
+//   - 索引（index.bin）以请求的哈希（文件名、宏、入口点、目标、编译标志与编译器版本）为键，
+//     记录上次编译读取的每个源文件及编译器读到的内容的哈希，以及字节码文件的名字；
+//   - 查找时重新计算这些源文件的内容哈希，任何一个文件（包括被包含的文件）改变都会使条目失效并重新编译，
+//     旧的字节码文件随之删除；
+//   - 字节码文件以所有输入的哈希命名（<哈希>.cso），与 fxc 生成的文件格式相同。
+// GetOrCompileAll 先查找全部请求，再把未命中的请求分发到线程池中并行编译。
+class ShaderCache
+{
+  public:
+    using uint32 = std::uint32_t;
+    using uint64 = std::uint64_t;
+
+    struct Statistics
+    {
+        uint32 Hits = 0;
+        uint32 Misses = 0;
+        // 因源文件或字节码文件改变而失效的条目
+        uint32 StaleEntries = 0;
+        uint32 Failed = 0;
+    };
+
+    // 缓存目录不存在时自动创建。compiler 必须比缓存存活得更久
+    ShaderCache(const std::wstring &directory, ShaderCompiler &compiler);
+    ShaderCache(const ShaderCache &rhs) = delete;
+    ShaderCache &operator=(const ShaderCache &rhs) = delete;
+    ~ShaderCache();
+
+    ShaderCompileResult GetOrCompile(const ShaderCompileRequest &request);
+    // 结果与 requests 一一对应，未命中的请求在线程池中并行编译
+    std::vector<ShaderCompileResult> GetOrCompileAll(const std::vector<ShaderCompileRequest> &requests,
+                                                     ThreadPool &threadPool);
+
+    // 索引有变化时写入磁盘。每次编译之后都会自动调用
+    bool SaveIndex();
+
+    // 请求的哈希值，不包含源文件的内容
+    static uint64 HashRequest(const ShaderCompileRequest &request, uint64 compilerVersion);
+
+    Statistics GetStatistics() const;
+
+  private:
+    struct IndexEntry
+    {
+        // 所有输入（请求与源文件内容）的哈希，也是字节码文件的名字
+        uint64 BytecodeKey = 0;
+        std::vector<ShaderDependency> Dependencies;
+    };
+
+    bool Lookup(uint64 requestHash, ShaderCompileResult &result);
+    ShaderCompileResult Compile(const ShaderCompileRequest &request, uint64 requestHash);
+
+    std::wstring BytecodeFileName(uint64 bytecodeKey) const;
+    void LoadIndex();
+    // 调用者持有锁
+    void RemoveEntry(uint64 requestHash);
+
+  private:
+    std::wstring mDirectory;
+    ShaderCompiler &mCompiler;
+
+    mutable std::mutex mMutex;
+    std::unordered_map<uint64, IndexEntry> mIndex;
+    bool mIndexDirty = false;
+    Statistics mStats;
+};
@@ -0,0 +1,356 @@
+#include "ShaderHotReload.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <filesystem>
+
+namespace
+{
+// C++17 中 u8string 返回 std::string，C++20 中返回 std::u8string，逐字符复制两者都适用
+std::string ToUtf8(const std::wstring &fileName)
+{
+    const auto text = std::filesystem::path(fileName).generic_u8string();
+    return std::string(text.begin(), text.end());
+}
+
+std::string Describe(const ShaderCompileRequest &request)
+{
+    return ToUtf8(request.FileName) + " (" + request.EntryPoint + ", " + request.Target + ")";
+}
+
+ShaderHotReload::Bytecode ToBytecode(std::vector<std::uint8_t> &bytes)
+{
+    return std::make_shared<const std::vector<std::uint8_t>>(std::move(bytes));
+}
+} // namespace
+
+ShaderHotReload::ShaderHotReload(ShaderCache &cache, ThreadPool &threadPool, std::chrono::milliseconds pollInterval)
+    : mCache(cache), mThreadPool(threadPool), mPollInterval(pollInterval), mLastPoll(std::chrono::steady_clock::now())
+{
+}
+
+ShaderHotReload::~ShaderHotReload()
+{
+    WaitIdle();
+}
+
+std::vector<ShaderHotReload::uint32> ShaderHotReload::AddShaders(const std::vector<ShaderCompileRequest> &requests)
+{
+    std::vector<ShaderCompileResult> results = mCache.GetOrCompileAll(requests, mThreadPool);
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::vector<uint32> ids;
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        const ShaderCompileResult &result = results[i];
+        const auto id = static_cast<uint32>(mShaders.size());
+        ids.push_back(id);
+
+        Shader shader;
+        shader.Request = requests[i];
+        if (result.Succeeded)
+            shader.BytecodeHash = Hasher::Hash(result.Bytecode.data(), result.Bytecode.size());
+        shader.Valid = result.Succeeded;
+        mShaders.push_back(std::move(shader));
+
+        // 连主文件都没能读取时至少监视主文件，它被创建或修复后就会重新编译
+        SetDependencies(id, result.Dependencies.empty() ? std::vector<ShaderDependency>{{requests[i].FileName}}
+                                                        : result.Dependencies);
+    }
+    return ids;
+}
+
+ShaderHotReload::uint32 ShaderHotReload::AddPipeline(const std::vector<uint32> &shaders, PipelineBuilder builder)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    // 调用者用注册时各着色器的字节码创建了当前的管线
+    std::vector<std::uint64_t> builtHashes;
+    for (uint32 shader : shaders)
+    {
+        assert(shader < mShaders.size());
+        builtHashes.push_back(mShaders[shader].BytecodeHash);
+    }
+
+    mPipelines.push_back({shaders, std::move(builder), std::move(builtHashes)});
+    return static_cast<uint32>(mPipelines.size() - 1);
+}
+
+void ShaderHotReload::Update()
+{
+    ApplyPendingChanges();
+
+    const auto now = std::chrono::steady_clock::now();
+    if (now - mLastPoll < mPollInterval)
+        return;
+    mLastPoll = now;
+    CheckForChanges();
+}
+
+void ShaderHotReload::CheckForChanges()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (const std::wstring &fileName : mWatcher.Poll())
+        {
+            auto it = mFileUsers.find(fileName);
+            if (it != mFileUsers.end())
+                mDirtyShaders.insert(it->second.begin(), it->second.end());
+        }
+    }
+
+    if (IsIdle())
+    {
+        // 收取上一轮的结果（包括其中未捕获的异常），再开始新的一轮
+        WaitIdle();
+        StartReload();
+    }
+}
+
+ShaderHotReload::uint32 ShaderHotReload::ApplyPendingChanges()
+{
+    std::vector<Commit> commits;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        commits.swap(mCommits);
+        mStats.PipelinesSwapped += static_cast<uint32>(commits.size());
+    }
+
+    // 按创建的先后顺序提交，同一个管线被重新创建了多次时最后一次生效
+    for (const Commit &commit : commits)
+        commit();
+    return static_cast<uint32>(commits.size());
+}
+
+void ShaderHotReload::WaitIdle()
+{
+    if (!mReload.valid())
+        return;
+
+    try
+    {
+        mReload.get();
+    }
+    catch (const std::exception &e)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mErrors.push_back(std::string("shader reload failed: ") + e.what());
+    }
+    catch (...)
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mErrors.push_back("shader reload failed");
+    }
+}
+
+bool ShaderHotReload::IsIdle() const
+{
+    return !mReload.valid() || mReload.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+std::vector<std::string> ShaderHotReload::TakeErrors()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    std::vector<std::string> errors;
+    errors.swap(mErrors);
+    return errors;
+}
+
+ShaderHotReload::Statistics ShaderHotReload::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+std::wstring ShaderHotReload::NormalizeFileName(const std::wstring &fileName)
+{
+    return std::filesystem::path(fileName).lexically_normal().generic_wstring();
+}
+
+void ShaderHotReload::SetDependencies(uint32 shader, const std::vector<ShaderDependency> &dependencies)
+{
+    std::vector<std::wstring> fileNames;
+    for (const ShaderDependency &dependency : dependencies)
+        fileNames.push_back(NormalizeFileName(dependency.FileName));
+    std::sort(fileNames.begin(), fileNames.end());
+    fileNames.erase(std::unique(fileNames.begin(), fileNames.end()), fileNames.end());
+
+    // 先加入新的依赖再移除旧的：仍在使用的文件保留原来的状态，期间发生的修改不会被漏掉
+    for (const std::wstring &fileName : fileNames)
+    {
+        mFileUsers[fileName].insert(shader);
+        mWatcher.Watch(fileName);
+    }
+
+    for (const std::wstring &fileName : mShaders[shader].Dependencies)
+    {
+        if (std::binary_search(fileNames.begin(), fileNames.end(), fileName))
+            continue;
+
+        auto it = mFileUsers.find(fileName);
+        it->second.erase(shader);
+        if (it->second.empty())
+        {
+            mFileUsers.erase(it);
+            mWatcher.Unwatch(fileName);
+        }
+    }
+
+    mShaders[shader].Dependencies = std::move(fileNames);
+}
+
+void ShaderHotReload::StartReload()
+{
+    std::vector<uint32> shaders;
+    std::vector<ShaderCompileRequest> requests;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mDirtyShaders.empty())
+            return;
+
+        shaders.assign(mDirtyShaders.begin(), mDirtyShaders.end());
+        mDirtyShaders.clear();
+        for (uint32 shader : shaders)
+            requests.push_back(mShaders[shader].Request);
+        ++mStats.Reloads;
+    }
+
+    mReload = mThreadPool.Submit([this, shaders = std::move(shaders), requests = std::move(requests)]() mutable {
+        Reload(std::move(shaders), std::move(requests));
+    });
+}
+
+void ShaderHotReload::Reload(std::vector<uint32> shaders, std::vector<ShaderCompileRequest> requests)
+{
+    // 缓存按源文件内容判断是否过期，只有真正改变的着色器才会调用编译器，并且在线程池中并行编译
+    std::vector<ShaderCompileResult> results = mCache.GetOrCompileAll(requests, mThreadPool);
+
+    // 本轮得到的字节码，以及受影响的管线（复制出来，创建期间主线程可以继续注册新的管线）
+    std::unordered_map<uint32, Bytecode> bytecodes;
+    std::vector<Pipeline> pipelines;
+    std::vector<uint32> pipelineIds;
+    std::vector<uint32> missingShaders;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+
+        for (size_t i = 0; i < shaders.size(); ++i)
+        {
+            ShaderCompileResult &result = results[i];
+            Shader &shader = mShaders[shaders[i]];
+
+            if (!result.Dependencies.empty())
+                SetDependencies(shaders[i], result.Dependencies);
+
+            shader.Valid = result.Succeeded;
+            if (!result.Succeeded)
+            {
+                ++mStats.ShaderErrors;
+                mErrors.push_back(Describe(shader.Request) + ": " + result.Errors);
+                continue;
+            }
+
+            ++mStats.ShadersCompiled;
+            shader.BytecodeHash = Hasher::Hash(result.Bytecode.data(), result.Bytecode.size());
+            bytecodes[shaders[i]] = ToBytecode(result.Bytecode);
+        }
+
+        // 重新创建所用字节码与上次创建时不同、并且所有着色器都可用的管线。与上次创建时比较而不是只看本轮的改动：
+        // 顶点着色器改变时像素着色器恰好有语法错误，这一轮跳过的管线要在像素着色器修好的那一轮用新的顶点着色器创建
+        for (uint32 id = 0; id < mPipelines.size(); ++id)
+        {
+            const Pipeline &pipeline = mPipelines[id];
+            bool affected = false;
+            bool valid = true;
+            for (size_t i = 0; i < pipeline.Shaders.size(); ++i)
+            {
+                const Shader &shader = mShaders[pipeline.Shaders[i]];
+                affected = affected || shader.BytecodeHash != pipeline.BuiltHashes[i];
+                valid = valid && shader.Valid;
+            }
+            if (!affected || !valid)
+                continue;
+
+            pipelines.push_back(pipeline);
+            pipelineIds.push_back(id);
+            for (uint32 shader : pipeline.Shaders)
+            {
+                if (bytecodes.count(shader) == 0)
+                    missingShaders.push_back(shader);
+            }
+        }
+
+        if (pipelines.empty())
+            return;
+
+        std::sort(missingShaders.begin(), missingShaders.end());
+        missingShaders.erase(std::unique(missingShaders.begin(), missingShaders.end()), missingShaders.end());
+        requests.clear();
+        for (uint32 shader : missingShaders)
+            requests.push_back(mShaders[shader].Request);
+    }
+
+    // 管线中没有改变的着色器不在本轮中，从缓存中取出它们的字节码（源文件没有变化，必然命中）
+    results = mCache.GetOrCompileAll(requests, mThreadPool);
+    for (size_t i = 0; i < missingShaders.size(); ++i)
+    {
+        if (results[i].Succeeded)
+            bytecodes[missingShaders[i]] = ToBytecode(results[i].Bytecode);
+    }
+
+    // 各管线的创建互不相关，一个任务创建一个
+    mThreadPool.ParallelFor(pipelines.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const Pipeline &pipeline = pipelines[i];
+            const std::string name = "pipeline " + std::to_string(pipelineIds[i]);
+
+            std::vector<Bytecode> inputs;
+            std::vector<std::uint64_t> inputHashes;
+            for (uint32 shader : pipeline.Shaders)
+            {
+                auto it = bytecodes.find(shader);
+                if (it == bytecodes.end())
+                    break;
+                inputs.push_back(it->second);
+                inputHashes.push_back(Hasher::Hash(it->second->data(), it->second->size()));
+            }
+
+            std::string error;
+            Commit commit;
+            if (inputs.size() != pipeline.Shaders.size())
+            {
+                error = name + ": a shader could not be compiled";
+            }
+            else
+            {
+                try
+                {
+                    commit = pipeline.Builder(inputs);
+                }
+                catch (const std::exception &e)
+                {
+                    error = name + ": " + e.what();
+                }
+                catch (...)
+                {
+                    error = name + ": the builder failed";
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!error.empty())
+            {
+                ++mStats.PipelineErrors;
+                mErrors.push_back(std::move(error));
+            }
+            else
+            {
+                // mPipelines 只会追加，序号一直有效
+                ++mStats.PipelinesBuilt;
+                mPipelines[pipelineIds[i]].BuiltHashes = std::move(inputHashes);
+                if (commit)
+                    mCommits.push_back(std::move(commit));
+            }
+        }
+    });
+}
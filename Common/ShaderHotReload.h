@@ -0,0 +1,132 @@
+#pragma once
+
+#include "FileWatcher.h"
+#include "ShaderCache.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 着色器热重载
+// 修改 color.hlsl 之后不必重启程序：监视每个着色器编译时读取的源文件（包括被包含的文件），
+// 文件变化后只重新编译依赖它的着色器（经由 ShaderCache），只重新创建所用字节码与上次创建时不同的管线，
+// 这些工作都在后台线程中完成，新的管线在帧边界上（ApplyPendingChanges）才换入，绘制时不会看到半更新的状态。
+//
+// 本类不依赖 Direct3D：管线由调用者提供的 PipelineBuilder 创建，换入由它返回的提交函数完成，
+// 因此依赖关系与调度可以用桩编译器在没有 GPU 的环境中检查。
+//
+// 一次只进行一轮重新编译；进行期间发生的变化会在这一轮结束后的下一次 Update/CheckForChanges 中处理。
+// 编译或创建失败时保留旧的管线，错误信息通过 TakeErrors 取出；管线记得自己上次创建时所用的字节码，
+// 因另一个着色器编译失败或创建失败而跳过的改动会在之后的某一轮中补上，不会丢失。
+class ShaderHotReload
+{
+  public:
+    using uint32 = std::uint32_t;
+    using Bytecode = std::shared_ptr<const std::vector<std::uint8_t>>;
+    // 在帧边界上调用，把新的管线换入
+    using Commit = std::function<void()>;
+    // 在后台线程中调用，参数为管线所用各着色器的最新字节码（顺序与 AddPipeline 时相同），返回换入新管线的提交函数。
+    // 抛出异常表示创建失败
+    using PipelineBuilder = std::function<Commit(const std::vector<Bytecode> &shaders)>;
+
+    struct Statistics
+    {
+        // 开始的重新编译轮数
+        uint32 Reloads = 0;
+        uint32 ShadersCompiled = 0;
+        uint32 ShaderErrors = 0;
+        uint32 PipelinesBuilt = 0;
+        uint32 PipelineErrors = 0;
+        uint32 PipelinesSwapped = 0;
+    };
+
+    // cache 与 threadPool 必须比本对象存活得更久。pollInterval 为 Update 检查文件的最短间隔
+    ShaderHotReload(ShaderCache &cache, ThreadPool &threadPool,
+                    std::chrono::milliseconds pollInterval = std::chrono::milliseconds(250));
+    ShaderHotReload(const ShaderHotReload &rhs) = delete;
+    ShaderHotReload &operator=(const ShaderHotReload &rhs) = delete;
+    // 等待进行中的重新编译结束，尚未提交的管线被丢弃
+    ~ShaderHotReload();
+
+    // 注册着色器并开始监视它的源文件，返回的序号与 requests 一一对应。
+    // 依赖的文件由一次经过缓存的编译得到（程序启动时刚编译过，通常都能命中）
+    std::vector<uint32> AddShaders(const std::vector<ShaderCompileRequest> &requests);
+
+    // 注册一个使用 shaders 中各着色器的管线，其中任何一个着色器的字节码改变后都会用 builder 重新创建
+    uint32 AddPipeline(const std::vector<uint32> &shaders, PipelineBuilder builder);
+
+    // 每帧在帧边界上调用：先换入已经创建好的管线，再按间隔检查文件
+    void Update();
+
+    // 立即检查文件，有变化时在后台开始一轮重新编译（上一轮尚未结束时推迟到下一次调用）
+    void CheckForChanges();
+
+    // 调用后台创建好的管线的提交函数，返回换入的管线数量。只能在不会同时使用这些管线的线程（帧边界）上调用
+    uint32 ApplyPendingChanges();
+
+    // 等待进行中的一轮重新编译结束
+    void WaitIdle();
+
+    bool IsIdle() const;
+
+    // 取出自上次调用以来的编译与创建错误
+    std::vector<std::string> TakeErrors();
+
+    Statistics GetStatistics() const;
+
+  private:
+    struct Shader
+    {
+        ShaderCompileRequest Request;
+        // 上次编译所读取的文件，按 NormalizeFileName 规范化
+        std::vector<std::wstring> Dependencies;
+        // 上次成功编译的字节码的哈希，用于判断重新编译之后字节码是否真的改变（例如只改了注释）
+        std::uint64_t BytecodeHash = 0;
+        // 上次编译是否成功。有着色器编译失败的管线不会重新创建
+        bool Valid = false;
+    };
+
+    struct Pipeline
+    {
+        std::vector<uint32> Shaders;
+        PipelineBuilder Builder;
+        // 当前管线（调用者注册时的，或上次创建成功的）所用各着色器字节码的哈希，与 Shaders 一一对应。
+        // 只在创建成功时更新：某个着色器的 BytecodeHash 与它不同，就说明管线仍需重新创建
+        std::vector<std::uint64_t> BuiltHashes;
+    };
+
+    static std::wstring NormalizeFileName(const std::wstring &fileName);
+
+    // 调用者持有锁
+    void SetDependencies(uint32 shader, const std::vector<ShaderDependency> &dependencies);
+    void StartReload();
+    void Reload(std::vector<uint32> shaders, std::vector<ShaderCompileRequest> requests);
+
+  private:
+    ShaderCache &mCache;
+    ThreadPool &mThreadPool;
+    std::chrono::milliseconds mPollInterval;
+    std::chrono::steady_clock::time_point mLastPoll;
+
+    mutable std::mutex mMutex;
+    std::vector<Shader> mShaders;
+    std::vector<Pipeline> mPipelines;
+    FileWatcher mWatcher;
+    // 规范化的文件名 -> 依赖它的着色器
+    std::unordered_map<std::wstring, std::set<uint32>> mFileUsers;
+    // 文件已经变化、等待重新编译的着色器
+    std::set<uint32> mDirtyShaders;
+    std::vector<Commit> mCommits;
+    std::vector<std::string> mErrors;
+    Statistics mStats;
+
+    // 只由调用 Update/CheckForChanges 的线程访问
+    std::future<void> mReload;
+};
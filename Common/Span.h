@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+// 指向一段连续内存的只读/可写视图，不拥有这段内存
+// CMake 工程以 C++17 编译，还没有 std::span，这里只提供演示程序用得到的那部分接口（命名与 std::span 一致）。
+template <typename T>
+class Span
+{
+  public:
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using size_type = std::size_t;
+    using pointer = T *;
+    using iterator = T *;
+
+    constexpr Span() = default;
+
+    constexpr Span(T *data, size_type size) : mData(data), mSize(size)
+    {
+    }
+
+    template <size_type N>
+    constexpr Span(T (&array)[N]) : mData(array), mSize(N)
+    {
+    }
+
+    // 允许从 std::vector 以及 Span<U>（U 可以转换为 T，例如 Span<int> -> Span<const int>）隐式构造
+    template <typename Allocator, typename U = T, typename = std::enable_if_t<std::is_const_v<U>>>
+    Span(const std::vector<value_type, Allocator> &v) : mData(v.data()), mSize(v.size())
+    {
+    }
+
+    template <typename Allocator>
+    Span(std::vector<value_type, Allocator> &v) : mData(v.data()), mSize(v.size())
+    {
+    }
+
+    template <typename U, typename = std::enable_if_t<std::is_convertible_v<U (*)[], T (*)[]>>>
+    constexpr Span(const Span<U> &other) : mData(other.data()), mSize(other.size())
+    {
+    }
+
+    constexpr T *data() const
+    {
+        return mData;
+    }
+
+    constexpr size_type size() const
+    {
+        return mSize;
+    }
+
+    constexpr size_type size_bytes() const
+    {
+        return mSize * sizeof(T);
+    }
+
+    constexpr bool empty() const
+    {
+        return mSize == 0;
+    }
+
+    constexpr iterator begin() const
+    {
+        return mData;
+    }
+
+    constexpr iterator end() const
+    {
+        return mData + mSize;
+    }
+
+    T &operator[](size_type i) const
+    {
+        assert(i < mSize);
+        return mData[i];
+    }
+
+    Span subspan(size_type offset, size_type count) const
+    {
+        assert(offset <= mSize && count <= mSize - offset);
+        return Span(mData + offset, count);
+    }
+
+    Span first(size_type count) const
+    {
+        return subspan(0, count);
+    }
+
+  private:
+    T *mData = nullptr;
+    size_type mSize = 0;
+};
@@ -0,0 +1,76 @@
+#include "StagingArena.h"
+#include <cassert>
+
+StagingArena::StagingArena(uint64 capacity) : mCapacity(capacity)
+{
+    assert(capacity > 0);
+}
+
+StagingArena::uint64 StagingArena::Allocate(uint64 byteSize, uint64 alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    if (byteSize == 0 || byteSize > mCapacity)
+        return InvalidOffset;
+
+    // 整个环形缓冲区都空闲时从头开始，尽量保留最大的连续空间
+    if (mUsedBytes == 0)
+        mHead = mTail = 0;
+
+    const uint64 aligned = (mHead + alignment - 1) & ~(alignment - 1);
+
+    uint64 offset = InvalidOffset;
+    if (mUsedBytes == 0 || mHead > mTail)
+    {
+        // 已用空间为 [mTail, mHead)，空闲空间为 [mHead, mCapacity) 与 [0, mTail)
+        if (aligned + byteSize <= mCapacity)
+            offset = aligned;
+        else if (byteSize <= mTail)
+            offset = 0;
+    }
+    else if (mHead < mTail)
+    {
+        // 已用空间回绕过末尾，空闲空间只有 [mHead, mTail)
+        if (aligned + byteSize <= mTail)
+            offset = aligned;
+    }
+    // mHead == mTail 且 mUsedBytes > 0 表示已满
+
+    if (offset == InvalidOffset)
+        return InvalidOffset;
+
+    // 对齐产生的空隙以及回绕时末尾未用的部分都计入本次分配，随之一起释放
+    const uint64 newHead = offset + byteSize;
+    const uint64 consumed = offset >= mHead ? newHead - mHead : (mCapacity - mHead) + newHead;
+
+    mHead = newHead == mCapacity ? 0 : newHead;
+    mUsedBytes += consumed;
+    mPendingBytes += consumed;
+    return offset;
+}
+
+void StagingArena::Retire(uint64 fenceValue)
+{
+    if (mPendingBytes == 0)
+        return;
+
+    assert(mRetired.empty() || mRetired.back().FenceValue <= fenceValue);
+
+    RetiredRange range;
+    range.FenceValue = fenceValue;
+    range.End = mHead;
+    range.ByteSize = mPendingBytes;
+    mRetired.push_back(range);
+
+    mPendingBytes = 0;
+}
+
+void StagingArena::Release(uint64 completedFenceValue)
+{
+    while (!mRetired.empty() && mRetired.front().FenceValue <= completedFenceValue)
+    {
+        mTail = mRetired.front().End;
+        mUsedBytes -= mRetired.front().ByteSize;
+        mRetired.pop_front();
+    }
+}
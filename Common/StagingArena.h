@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+
+// 以围栏值回收空间的环形分配器
+// 只管理偏移量，不涉及任何 Direct3D 对象：UploadBatch 用它在一个上传堆缓冲区中为每次上传划分暂存空间。
+// 每次向命令队列提交之后调用 Retire，把此前分配的空间与本次提交的围栏值关联起来；
+// GPU 完成该围栏之后，Release 会把这些空间归还给环形缓冲区。
+class StagingArena
+{
+  public:
+    using uint64 = std::uint64_t;
+
+    static const uint64 InvalidOffset = ~0ull;
+
+    explicit StagingArena(uint64 capacity);
+
+    // 分配失败（剩余的连续空间不足）时返回 InvalidOffset。alignment 必须为 2 的幂
+    uint64 Allocate(uint64 byteSize, uint64 alignment);
+
+    // 自上次 Retire 以来分配的所有空间将在围栏值 fenceValue 完成后释放
+    void Retire(uint64 fenceValue);
+
+    // 释放所有围栏值不大于 completedFenceValue 的空间
+    void Release(uint64 completedFenceValue);
+
+    uint64 Capacity() const
+    {
+        return mCapacity;
+    }
+
+    // 已分配（含对齐与回绕浪费的部分）且尚未释放的字节数
+    uint64 UsedBytes() const
+    {
+        return mUsedBytes;
+    }
+
+    // 尚未 Retire 的字节数
+    uint64 PendingBytes() const
+    {
+        return mPendingBytes;
+    }
+
+  private:
+    struct RetiredRange
+    {
+        uint64 FenceValue;
+        // 释放后环形缓冲区的尾部移动到这里
+        uint64 End;
+        uint64 ByteSize;
+    };
+
+  private:
+    uint64 mCapacity;
+    // 下一次分配从 mHead 开始，最早的未释放空间从 mTail 开始
+    uint64 mHead = 0;
+    uint64 mTail = 0;
+    uint64 mUsedBytes = 0;
+    uint64 mPendingBytes = 0;
+    std::deque<RetiredRange> mRetired;
+};
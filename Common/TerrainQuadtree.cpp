@@ -0,0 +1,494 @@
+#include "TerrainQuadtree.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+
+using namespace DirectX;
+
+namespace
+{
+// 以块中心为原点采样高度场：CreateGrid 生成的栅格以原点为中心，借此得到相对于块中心的顶点坐标
+class TranslatedHeightField : public HeightField
+{
+  public:
+    TranslatedHeightField(const HeightField &source, float offsetX, float offsetZ)
+        : mSource(source), mOffsetX(offsetX), mOffsetZ(offsetZ)
+    {
+    }
+
+    float Height(float x, float z) const override
+    {
+        return mSource.Height(x + mOffsetX, z + mOffsetZ);
+    }
+
+    XMFLOAT3 Normal(float x, float z) const override
+    {
+        return mSource.Normal(x + mOffsetX, z + mOffsetZ);
+    }
+
+    void XM_CALLCONV Evaluate4(FXMVECTOR x, FXMVECTOR z, XMVECTOR &height, XMVECTOR &normalX, XMVECTOR &normalY,
+                               XMVECTOR &normalZ) const override
+    {
+        mSource.Evaluate4(XMVectorAdd(x, XMVectorReplicate(mOffsetX)), XMVectorAdd(z, XMVectorReplicate(mOffsetZ)),
+                          height, normalX, normalY, normalZ);
+    }
+
+  private:
+    const HeightField &mSource;
+    float mOffsetX;
+    float mOffsetZ;
+};
+} // namespace
+
+TerrainQuadtree::TerrainQuadtree(const HeightField &heightField, const TerrainSettings &settings,
+                                 ThreadPool *threadPool)
+    : mHeightField(heightField), mSettings(settings), mThreadPool(threadPool)
+{
+    assert(mSettings.ChunkResolution >= 2);
+    assert(mSettings.MaxLevel < 29);
+    assert(mSettings.MaxInFlightRequests >= 1);
+
+    BuildSharedIndices();
+}
+
+TerrainQuadtree::~TerrainQuadtree()
+{
+    // 后台任务引用着本对象，必须等它们全部结束
+    for (auto &e : mInFlight)
+        e.second.wait();
+}
+
+void TerrainQuadtree::BuildSharedIndices()
+{
+    const uint32 n = mSettings.ChunkResolution;
+
+    // 借用一个单位大小的平坦栅格得到网格部分的索引，并据此确定裙边三角形的环绕方向
+    GeometryGenerator geoGen;
+    GeometryGenerator::MeshData grid = geoGen.CreateGrid(1.0f, 1.0f, n, n);
+    mIndices = std::move(grid.Indices32);
+
+    // 按环绕顺序收集四条边上的顶点：上边、右边、下边、左边
+    mPerimeter.clear();
+    for (uint32 j = 0; j < n; ++j)
+        mPerimeter.push_back(j);
+    for (uint32 i = 1; i < n; ++i)
+        mPerimeter.push_back(i * n + n - 1);
+    for (uint32 j = n - 1; j-- > 0;)
+        mPerimeter.push_back((n - 1) * n + j);
+    for (uint32 i = n - 1; i-- > 1;)
+        mPerimeter.push_back(i * n);
+
+    const uint32 perimeterCount = static_cast<uint32>(mPerimeter.size());
+    mVerticesPerChunk = n * n + perimeterCount;
+
+    for (uint32 k = 0; k < perimeterCount; ++k)
+    {
+        uint32 next = (k + 1) % perimeterCount;
+        uint32 a = mPerimeter[k];
+        uint32 b = mPerimeter[next];
+        uint32 skirtA = n * n + k;
+        uint32 skirtB = n * n + next;
+
+        // 裙边需要朝向块的外侧（本项目中三角形的正面法线为 (p1 - p0) x (p2 - p0)）
+        XMVECTOR pa = XMLoadFloat3(&grid.Vertices[a].Position);
+        XMVECTOR pb = XMLoadFloat3(&grid.Vertices[b].Position);
+        XMVECTOR down = XMVectorSet(0.0f, -1.0f, 0.0f, 0.0f);
+        XMVECTOR normal = XMVector3Cross(down, XMVectorSubtract(pb, pa));
+        XMVECTOR outward = XMVectorScale(XMVectorAdd(pa, pb), 0.5f);
+
+        if (XMVectorGetX(XMVector3Dot(normal, outward)) > 0.0f)
+        {
+            mIndices.insert(mIndices.end(), {a, skirtA, b, b, skirtA, skirtB});
+        }
+        else
+        {
+            mIndices.insert(mIndices.end(), {a, b, skirtA, b, skirtB, skirtA});
+        }
+    }
+}
+
+std::unique_ptr<TerrainChunk> TerrainQuadtree::GenerateChunk(const TerrainChunkKey &key) const
+{
+    const uint32 n = mSettings.ChunkResolution;
+
+    auto chunk = std::make_unique<TerrainChunk>();
+    chunk->Key = key;
+    chunk->Size = ChunkSize(key.Level);
+    chunk->Origin = XMFLOAT3((key.X + 0.5f) * chunk->Size, 0.0f, (key.Z + 0.5f) * chunk->Size);
+
+    TranslatedHeightField field(mHeightField, chunk->Origin.x, chunk->Origin.z);
+
+    // 块本身已经在后台线程中生成，网格内部不再并行
+    GeometryGenerator geoGen;
+    GeometryGenerator::MeshData grid = geoGen.CreateGrid(chunk->Size, chunk->Size, n, n, &field, nullptr);
+    chunk->Vertices = std::move(grid.Vertices);
+
+    chunk->MinHeight = chunk->MaxHeight = chunk->Vertices[0].Position.y;
+    for (const auto &v : chunk->Vertices)
+    {
+        chunk->MinHeight = std::min(chunk->MinHeight, v.Position.y);
+        chunk->MaxHeight = std::max(chunk->MaxHeight, v.Position.y);
+    }
+
+    //
+    // 几何误差：在每个单元的中心以及各边的中点上，比较高度函数与网格线性插值之间的差
+    //
+
+    const auto &vertices = chunk->Vertices;
+    auto sampleError = [&field, &vertices](uint32 a, uint32 b) {
+        const XMFLOAT3 &pa = vertices[a].Position;
+        const XMFLOAT3 &pb = vertices[b].Position;
+        float h = field.Height(0.5f * (pa.x + pb.x), 0.5f * (pa.z + pb.z));
+        return std::abs(h - 0.5f * (pa.y + pb.y));
+    };
+
+    float error = 0.0f;
+    for (uint32 i = 0; i + 1 < n; ++i)
+    {
+        for (uint32 j = 0; j + 1 < n; ++j)
+        {
+            uint32 i0 = i * n + j;
+            uint32 i1 = i0 + n;
+
+            // 单元中心位于对角线 (i0 + 1, i1) 的中点上
+            error = std::max(error, sampleError(i0 + 1, i1));
+            error = std::max(error, sampleError(i0, i0 + 1));
+            error = std::max(error, sampleError(i0, i1));
+            if (j + 2 == n)
+                error = std::max(error, sampleError(i0 + 1, i1 + 1));
+            if (i + 2 == n)
+                error = std::max(error, sampleError(i1, i1 + 1));
+        }
+    }
+    chunk->GeometricError = error;
+
+    //
+    // 裙边：把四周的顶点向下平移复制一份
+    //
+
+    float skirtDepth = std::max(mSettings.MinSkirtDepth, 4.0f * error);
+    chunk->Vertices.reserve(mVerticesPerChunk);
+    for (uint32 p : mPerimeter)
+    {
+        GeometryGenerator::Vertex v = chunk->Vertices[p];
+        v.Position.y -= skirtDepth;
+        chunk->Vertices.push_back(v);
+    }
+
+    return chunk;
+}
+
+void TerrainQuadtree::Update(const XMFLOAT3 &eyePos, float projectionScale)
+{
+    ++mFrame;
+    mSelected.clear();
+    mSelectedIndex.clear();
+    mRequests.clear();
+    mStats.RejectedRequests = 0;
+
+    CollectCompletedChunks(false);
+
+    //
+    // 遍历观察距离内的所有根块
+    //
+
+    float rootSize = mSettings.RootChunkSize;
+    auto minX = static_cast<std::int32_t>(std::floor((eyePos.x - mSettings.ViewDistance) / rootSize));
+    auto maxX = static_cast<std::int32_t>(std::floor((eyePos.x + mSettings.ViewDistance) / rootSize));
+    auto minZ = static_cast<std::int32_t>(std::floor((eyePos.z - mSettings.ViewDistance) / rootSize));
+    auto maxZ = static_cast<std::int32_t>(std::floor((eyePos.z + mSettings.ViewDistance) / rootSize));
+
+    for (std::int32_t z = minZ; z <= maxZ; ++z)
+    {
+        for (std::int32_t x = minX; x <= maxX; ++x)
+        {
+            TerrainChunkKey root;
+            root.X = x;
+            root.Z = z;
+            if (HorizontalDistance(root, eyePos) <= mSettings.ViewDistance)
+                Select(root, eyePos, projectionScale);
+        }
+    }
+
+    BalanceSelection(eyePos);
+
+    //
+    // 由近及远地处理缺失的块
+    //
+
+    std::sort(mRequests.begin(), mRequests.end(),
+              [](const Request &a, const Request &b) { return a.Distance < b.Distance; });
+
+    uint32 issued = 0;
+    for (const Request &request : mRequests)
+    {
+        if (mInFlight.size() >= mSettings.MaxInFlightRequests || issued >= mSettings.MaxInFlightRequests)
+            break;
+
+        // 平衡时同一个块可能被多个邻居请求
+        const uint64 packed = request.Key.Pack();
+        if (mChunks.find(packed) != mChunks.end() || mInFlight.find(packed) != mInFlight.end())
+            continue;
+
+        // 只要还能淘汰出空位就接受请求，保证驻留的块数不超过上限
+        if (mChunks.size() + mInFlight.size() >= mSettings.MaxResidentChunks + EvictableChunkCount())
+        {
+            ++mStats.RejectedRequests;
+            continue;
+        }
+
+        ++issued;
+        if (mThreadPool != nullptr)
+        {
+            TerrainChunkKey key = request.Key;
+            mInFlight[key.Pack()] = mThreadPool->Submit([this, key]() { return GenerateChunk(key); });
+        }
+        else
+        {
+            AddChunk(GenerateChunk(request.Key));
+        }
+    }
+
+    EvictChunks(mSettings.MaxResidentChunks);
+
+    mStats.ResidentChunks = static_cast<uint32>(mChunks.size());
+    mStats.InFlightRequests = static_cast<uint32>(mInFlight.size());
+    mStats.SelectedChunks = static_cast<uint32>(mSelected.size());
+}
+
+bool TerrainQuadtree::Select(const TerrainChunkKey &key, const XMFLOAT3 &eyePos, float projectionScale)
+{
+    auto it = mChunks.find(key.Pack());
+    if (it == mChunks.end())
+    {
+        RequestChunk(key, HorizontalDistance(key, eyePos));
+        return false;
+    }
+
+    TerrainChunk *chunk = it->second.get();
+    chunk->LastUsedFrame = mFrame;
+
+    // 观察点到块包围盒的距离
+    float half = 0.5f * chunk->Size;
+    float dx = std::max(std::abs(eyePos.x - chunk->Origin.x) - half, 0.0f);
+    float dz = std::max(std::abs(eyePos.z - chunk->Origin.z) - half, 0.0f);
+    float dy = std::max({chunk->MinHeight - eyePos.y, eyePos.y - chunk->MaxHeight, 0.0f});
+    float distance = std::max(std::sqrt(dx * dx + dy * dy + dz * dz), 1e-3f);
+
+    bool refine = key.Level < mSettings.MaxLevel &&
+                  chunk->GeometricError * projectionScale > mSettings.PixelErrorThreshold * distance;
+
+    if (refine)
+    {
+        TerrainChunkKey children[4];
+        bool allResident = true;
+        for (int c = 0; c < 4; ++c)
+        {
+            children[c].Level = key.Level + 1;
+            children[c].X = key.X * 2 + (c & 1);
+            children[c].Z = key.Z * 2 + (c >> 1);
+
+            auto child = mChunks.find(children[c].Pack());
+            if (child == mChunks.end())
+            {
+                allResident = false;
+                RequestChunk(children[c], HorizontalDistance(children[c], eyePos));
+            }
+            else
+            {
+                child->second->LastUsedFrame = mFrame;
+            }
+        }
+
+        // 4 个子块全部就绪后才细分，否则本帧仍绘制当前块
+        if (allResident)
+        {
+            for (const auto &child : children)
+                Select(child, eyePos, projectionScale);
+            return true;
+        }
+    }
+
+    AddSelected(chunk);
+    return true;
+}
+
+void TerrainQuadtree::AddSelected(TerrainChunk *chunk)
+{
+    mSelectedIndex[chunk->Key.Pack()] = mSelected.size();
+    mSelected.push_back(chunk);
+}
+
+void TerrainQuadtree::BalanceSelection(const XMFLOAT3 &eyePos)
+{
+    // 第 L 级的块要求四条边外侧的块不粗于第 L - 1 级：在外侧第 L - 1 级单元的各级祖先中查找选出的块，
+    // 找到更粗的块就把它细分，新的子块再去检查它们的邻居，直到没有违反的块为止
+    const std::int32_t offsets[4][2] = {{-1, 0}, {1, 0}, {0, -1}, {0, 1}};
+
+    std::vector<size_t> pending(mSelected.size());
+    for (size_t i = 0; i < pending.size(); ++i)
+        pending[i] = i;
+
+    while (!pending.empty())
+    {
+        const TerrainChunk *chunk = mSelected[pending.back()];
+        pending.pop_back();
+        if (chunk == nullptr || chunk->Key.Level < 2)
+            continue;
+
+        bool split = false;
+        for (const auto &offset : offsets)
+        {
+            // 外侧相邻的同级单元，右移得到它在更粗级别上的祖先（算术右移即向下取整）
+            const std::int32_t x = chunk->Key.X + offset[0];
+            const std::int32_t z = chunk->Key.Z + offset[1];
+
+            for (uint32 level = chunk->Key.Level - 1; level-- > 0;)
+            {
+                TerrainChunkKey coarse;
+                coarse.Level = level;
+                coarse.X = x >> (chunk->Key.Level - level);
+                coarse.Z = z >> (chunk->Key.Level - level);
+
+                auto selected = mSelectedIndex.find(coarse.Pack());
+                if (selected == mSelectedIndex.end())
+                    continue;
+
+                // 子块全部驻留才能细分，否则请求它们，本帧暂由裙边遮挡裂缝
+                TerrainChunk *children[4] = {};
+                bool allResident = true;
+                for (int c = 0; c < 4; ++c)
+                {
+                    TerrainChunkKey key;
+                    key.Level = level + 1;
+                    key.X = coarse.X * 2 + (c & 1);
+                    key.Z = coarse.Z * 2 + (c >> 1);
+
+                    auto child = mChunks.find(key.Pack());
+                    if (child == mChunks.end())
+                    {
+                        allResident = false;
+                        RequestChunk(key, HorizontalDistance(key, eyePos));
+                    }
+                    else
+                    {
+                        children[c] = child->second.get();
+                        children[c]->LastUsedFrame = mFrame;
+                    }
+                }
+
+                if (allResident)
+                {
+                    mSelected[selected->second] = nullptr;
+                    mSelectedIndex.erase(selected);
+                    for (TerrainChunk *child : children)
+                    {
+                        pending.push_back(mSelected.size());
+                        AddSelected(child);
+                    }
+                    split = true;
+                }
+                break;
+            }
+        }
+
+        // 一次细分只前进一级，重新检查直到邻居足够细
+        if (split)
+            pending.push_back(mSelectedIndex.at(chunk->Key.Pack()));
+    }
+
+    mSelected.erase(std::remove(mSelected.begin(), mSelected.end(), nullptr), mSelected.end());
+}
+
+void TerrainQuadtree::RequestChunk(const TerrainChunkKey &key, float distance)
+{
+    if (mInFlight.find(key.Pack()) != mInFlight.end())
+        return;
+
+    mRequests.push_back({key, distance});
+}
+
+void TerrainQuadtree::CollectCompletedChunks(bool wait)
+{
+    for (auto it = mInFlight.begin(); it != mInFlight.end();)
+    {
+        if (wait || it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+        {
+            AddChunk(it->second.get());
+            it = mInFlight.erase(it);
+        }
+        else
+        {
+            ++it;
+        }
+    }
+}
+
+void TerrainQuadtree::WaitForPendingChunks()
+{
+    CollectCompletedChunks(true);
+    EvictChunks(mSettings.MaxResidentChunks);
+    mStats.ResidentChunks = static_cast<uint32>(mChunks.size());
+    mStats.InFlightRequests = 0;
+}
+
+void TerrainQuadtree::AddChunk(std::unique_ptr<TerrainChunk> chunk)
+{
+    // 新生成的块视为上一帧刚用过：它在可淘汰的块中最新，但仍可在驻留数超限时让出位置
+    chunk->LastUsedFrame = mFrame > 0 ? mFrame - 1 : 0;
+    mChunks[chunk->Key.Pack()] = std::move(chunk);
+    ++mStats.GeneratedTotal;
+}
+
+size_t TerrainQuadtree::EvictableChunkCount() const
+{
+    size_t count = 0;
+    for (const auto &e : mChunks)
+    {
+        if (e.second->LastUsedFrame < mFrame)
+            ++count;
+    }
+    return count;
+}
+
+void TerrainQuadtree::EvictChunks(size_t targetCount)
+{
+    if (mChunks.size() <= targetCount)
+        return;
+
+    std::vector<std::pair<uint64, uint64>> candidates;
+    for (const auto &e : mChunks)
+    {
+        // 本帧用到的块不能淘汰，SelectedChunks 中的指针必须保持有效
+        if (e.second->LastUsedFrame < mFrame)
+            candidates.emplace_back(e.second->LastUsedFrame, e.first);
+    }
+
+    std::sort(candidates.begin(), candidates.end());
+    for (const auto &c : candidates)
+    {
+        if (mChunks.size() <= targetCount)
+            break;
+
+        mChunks.erase(c.second);
+        ++mStats.EvictedTotal;
+    }
+}
+
+float TerrainQuadtree::ChunkSize(uint32 level) const
+{
+    return mSettings.RootChunkSize / static_cast<float>(1u << level);
+}
+
+float TerrainQuadtree::HorizontalDistance(const TerrainChunkKey &key, const XMFLOAT3 &eyePos) const
+{
+    float size = ChunkSize(key.Level);
+    float centerX = (key.X + 0.5f) * size;
+    float centerZ = (key.Z + 0.5f) * size;
+
+    float dx = std::max(std::abs(eyePos.x - centerX) - 0.5f * size, 0.0f);
+    float dz = std::max(std::abs(eyePos.z - centerZ) - 0.5f * size, 0.0f);
+    return std::sqrt(dx * dx + dz * dz);
+}
@@ -0,0 +1,171 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+#include "HeightField.h"
+#include <DirectXMath.h>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+class ThreadPool;
+
+// 分块地形
+// 整个世界在 xz 平面上被划分为边长为 RootChunkSize 的根块，每个根块都是一棵四叉树的根，第 L 级的块边长为
+// RootChunkSize / 2^L。所有块都有相同的顶点数，因此它们共用同一组索引。
+// 每帧根据观察点逐块计算屏幕空间误差来选择细分级别；缺少的块交由后台线程生成，生成完成之前先用已驻留的父块代替。
+// 选择结果是平衡的：相邻块的级别最多相差 1，比邻居粗两级以上的块会被继续细分（所需的子块驻留之后生效）。
+// 相邻块之间因级别不同而产生的裂缝由块四周向下延伸的裙边（skirt）遮挡。
+// 驻留的块数量有上限，超出时按最近最少使用（LRU）的顺序淘汰当前帧未用到的块，因此内存占用与世界大小无关。
+// 本模块不依赖 Direct3D，选择与生成逻辑可以在无窗口环境中运行。
+
+struct TerrainSettings
+{
+    float RootChunkSize = 160.0f;
+    // 每个块每条边上的顶点数
+    std::uint32_t ChunkResolution = 33;
+    // 最大细分级别（根块为第 0 级）
+    std::uint32_t MaxLevel = 6;
+    // 只有与观察点的水平距离在此范围内的根块才会参与选择
+    float ViewDistance = 1000.0f;
+    // 允许的屏幕空间误差（像素）
+    float PixelErrorThreshold = 2.0f;
+    // 裙边的最小深度。实际深度取此值与块几何误差 4 倍中的较大者
+    float MinSkirtDepth = 1.0f;
+    std::uint32_t MaxResidentChunks = 512;
+    // 同时在后台生成的块数上限
+    std::uint32_t MaxInFlightRequests = 16;
+};
+
+struct TerrainChunkKey
+{
+    std::uint32_t Level = 0;
+    std::int32_t X = 0;
+    std::int32_t Z = 0;
+
+    std::uint64_t Pack() const
+    {
+        return (static_cast<std::uint64_t>(Level) << 58) |
+               ((static_cast<std::uint64_t>(static_cast<std::uint32_t>(X)) & 0x1fffffff) << 29) |
+               (static_cast<std::uint64_t>(static_cast<std::uint32_t>(Z)) & 0x1fffffff);
+    }
+};
+
+struct TerrainChunk
+{
+    TerrainChunkKey Key;
+
+    // 块中心在世界空间中的位置（y 为 0）。顶点坐标相对于此点存储，以免世界很大时损失精度
+    DirectX::XMFLOAT3 Origin = {0.0f, 0.0f, 0.0f};
+    float Size = 0.0f;
+
+    // 网格顶点之后紧跟着裙边顶点，索引见 TerrainQuadtree::Indices()
+    std::vector<GeometryGenerator::Vertex> Vertices;
+
+    // 块内高度的范围（世界空间）
+    float MinHeight = 0.0f;
+    float MaxHeight = 0.0f;
+
+    // 以此网格近似高度函数的最大竖直误差
+    float GeometricError = 0.0f;
+
+    std::uint64_t LastUsedFrame = 0;
+};
+
+class TerrainQuadtree
+{
+  public:
+    using uint32 = std::uint32_t;
+    using uint64 = std::uint64_t;
+
+    struct Stats
+    {
+        uint32 ResidentChunks = 0;
+        uint32 InFlightRequests = 0;
+        uint32 SelectedChunks = 0;
+        // 本帧因驻留上限而被拒绝的请求数
+        uint32 RejectedRequests = 0;
+        uint64 GeneratedTotal = 0;
+        uint64 EvictedTotal = 0;
+    };
+
+    // threadPool 为空时，请求的块在 Update 中同步生成（每帧最多 MaxInFlightRequests 个）
+    TerrainQuadtree(const HeightField &heightField, const TerrainSettings &settings, ThreadPool *threadPool);
+    TerrainQuadtree(const TerrainQuadtree &rhs) = delete;
+    TerrainQuadtree &operator=(const TerrainQuadtree &rhs) = delete;
+    ~TerrainQuadtree();
+
+    // 每帧调用一次。projectionScale 见 LodSelector::ProjectionScale
+    void Update(const DirectX::XMFLOAT3 &eyePos, float projectionScale);
+
+    // 本帧选出的块，在下一次 Update 之前有效
+    const std::vector<const TerrainChunk *> &SelectedChunks() const
+    {
+        return mSelected;
+    }
+
+    // 所有块共用的索引（三角形列表）
+    const std::vector<uint32> &Indices() const
+    {
+        return mIndices;
+    }
+
+    uint32 VerticesPerChunk() const
+    {
+        return mVerticesPerChunk;
+    }
+
+    const Stats &GetStats() const
+    {
+        return mStats;
+    }
+
+    // 阻塞直到所有在后台生成的块都完成，并将它们加入驻留集合
+    void WaitForPendingChunks();
+
+    // 按当前设置同步生成一个块，不影响驻留集合
+    std::unique_ptr<TerrainChunk> GenerateChunk(const TerrainChunkKey &key) const;
+
+  private:
+    struct Request
+    {
+        TerrainChunkKey Key;
+        float Distance;
+    };
+
+    void BuildSharedIndices();
+
+    bool Select(const TerrainChunkKey &key, const DirectX::XMFLOAT3 &eyePos, float projectionScale);
+    void AddSelected(TerrainChunk *chunk);
+    void BalanceSelection(const DirectX::XMFLOAT3 &eyePos);
+    void RequestChunk(const TerrainChunkKey &key, float distance);
+    void CollectCompletedChunks(bool wait);
+    void AddChunk(std::unique_ptr<TerrainChunk> chunk);
+    void EvictChunks(size_t targetCount);
+    size_t EvictableChunkCount() const;
+
+    float ChunkSize(uint32 level) const;
+    float HorizontalDistance(const TerrainChunkKey &key, const DirectX::XMFLOAT3 &eyePos) const;
+
+  private:
+    const HeightField &mHeightField;
+    TerrainSettings mSettings;
+    ThreadPool *mThreadPool;
+
+    std::vector<uint32> mIndices;
+    uint32 mVerticesPerChunk = 0;
+    // 沿块四周一圈的网格顶点，按环绕顺序排列。第 k 个裙边顶点由 mPerimeter[k] 向下平移得到
+    std::vector<uint32> mPerimeter;
+
+    std::unordered_map<uint64, std::unique_ptr<TerrainChunk>> mChunks;
+    std::unordered_map<uint64, std::future<std::unique_ptr<TerrainChunk>>> mInFlight;
+
+    std::vector<Request> mRequests;
+    std::vector<const TerrainChunk *> mSelected;
+    // 选出的块在 mSelected 中的位置，平衡时用来查找邻居。被细分的块在 mSelected 中置空，最后统一移除
+    std::unordered_map<uint64, size_t> mSelectedIndex;
+
+    uint64 mFrame = 0;
+    Stats mStats;
+};
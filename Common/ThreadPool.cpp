@@ -0,0 +1,152 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace
+{
+// ParallelFor 各参与线程共享的状态。工作线程可能在调用线程返回之后才开始执行，因此以 shared_ptr 持有
+struct ParallelForState
+{
+    std::function<void(size_t, size_t)> Body;
+    size_t Count = 0;
+    size_t GrainSize = 1;
+    size_t ChunkCount = 0;
+
+    std::atomic<size_t> NextChunk{0};
+    std::atomic<size_t> CompletedChunks{0};
+
+    std::mutex Mutex;
+    std::condition_variable Done;
+    std::exception_ptr Error;
+
+    // 不断领取下一段执行，直到所有段都被领取
+    void Run()
+    {
+        for (;;)
+        {
+            size_t chunk = NextChunk.fetch_add(1);
+            if (chunk >= ChunkCount)
+                return;
+
+            size_t begin = chunk * GrainSize;
+            size_t end = std::min(Count, begin + GrainSize);
+            try
+            {
+                Body(begin, end);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(Mutex);
+                if (!Error)
+                    Error = std::current_exception();
+            }
+
+            if (CompletedChunks.fetch_add(1) + 1 == ChunkCount)
+            {
+                std::lock_guard<std::mutex> lock(Mutex);
+                Done.notify_all();
+            }
+        }
+    }
+};
+} // namespace
+
+ThreadPool::ThreadPool(uint32 threadCount)
+{
+    if (threadCount == 0)
+    {
+        uint32 hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    mWorkers.reserve(threadCount);
+    for (uint32 i = 0; i < threadCount; ++i)
+        mWorkers.emplace_back([this]() { WorkerLoop(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStopping = true;
+    }
+    mCondition.notify_all();
+
+    for (auto &worker : mWorkers)
+        worker.join();
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mTasks.push_back(std::move(task));
+    }
+    mCondition.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() { return mStopping || !mTasks.empty(); });
+
+            // 退出前先把队列中剩余的任务执行完，保证 Submit 返回的 future 都能就绪
+            if (mTasks.empty())
+                return;
+
+            task = std::move(mTasks.front());
+            mTasks.pop_front();
+        }
+
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)> &body)
+{
+    if (count == 0)
+        return;
+
+    grainSize = std::max<size_t>(grainSize, 1);
+    size_t chunkCount = (count + grainSize - 1) / grainSize;
+
+    // 只有一段时没有必要经过任务队列
+    if (chunkCount == 1)
+    {
+        body(0, count);
+        return;
+    }
+
+    auto state = std::make_shared<ParallelForState>();
+    state->Body = body;
+    state->Count = count;
+    state->GrainSize = grainSize;
+    state->ChunkCount = chunkCount;
+
+    // 调用线程自己也会领取任务，所以最多只需唤醒 chunkCount - 1 个工作线程
+    size_t helperCount = std::min<size_t>(mWorkers.size(), chunkCount - 1);
+    for (size_t i = 0; i < helperCount; ++i)
+        Enqueue([state]() { state->Run(); });
+
+    state->Run();
+
+    // 其他线程领取的段可能仍在执行
+    {
+        std::unique_lock<std::mutex> lock(state->Mutex);
+        state->Done.wait(lock, [&state]() { return state->CompletedChunks.load() == state->ChunkCount; });
+    }
+
+    if (state->Error)
+        std::rethrow_exception(state->Error);
+}
+
+ThreadPool &ThreadPool::Default()
+{
+    static ThreadPool pool;
+    return pool;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// 固定数量工作线程的线程池
+// 演示程序中的网格生成、地形分块等工作都可以按行或按块拆分为互不相关的小任务，
+// 由 ParallelFor 分发到各个工作线程上执行；独立的后台任务则通过 Submit 提交。
+class ThreadPool
+{
+  public:
+    using uint32 = std::uint32_t;
+
+    // threadCount 为 0 时，创建（硬件线程数 - 1）个工作线程，调用线程本身也会参与 ParallelFor 的计算
+    explicit ThreadPool(uint32 threadCount = 0);
+    ThreadPool(const ThreadPool &rhs) = delete;
+    ThreadPool &operator=(const ThreadPool &rhs) = delete;
+    ~ThreadPool();
+
+    uint32 ThreadCount() const
+    {
+        return static_cast<uint32>(mWorkers.size());
+    }
+
+    // 提交一个后台任务，通过返回的 future 获取结果（或任务抛出的异常）
+    template <typename F>
+    std::future<std::invoke_result_t<F>> Submit(F &&task)
+    {
+        using Result = std::invoke_result_t<F>;
+
+        // std::function 要求可复制，因此用 shared_ptr 包装 packaged_task
+        auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+        std::future<Result> future = packaged->get_future();
+        Enqueue([packaged]() { (*packaged)(); });
+        return future;
+    }
+
+    // 把 [0, count) 按 grainSize 划分为若干段，并行地对每一段调用 body(begin, end)。
+    // 函数返回时所有段都已执行完毕；若某一段抛出异常，则在调用线程中重新抛出第一个异常
+    void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)> &body);
+
+    // 进程内共享的默认线程池
+    static ThreadPool &Default();
+
+  private:
+    void Enqueue(std::function<void()> task);
+    void WorkerLoop();
+
+  private:
+    std::vector<std::thread> mWorkers;
+
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<std::function<void()>> mTasks;
+    bool mStopping = false;
+};
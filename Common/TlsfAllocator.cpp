@@ -0,0 +1,302 @@
+#include "TlsfAllocator.h"
+#include <cassert>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace
+{
+// 最高位与最低位的 1 所在的位置，value 不能为 0
+std::uint32_t HighestBit(std::uint64_t value)
+{
+    assert(value != 0);
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<std::uint32_t>(index);
+#else
+    return 63u - static_cast<std::uint32_t>(__builtin_clzll(value));
+#endif
+}
+
+std::uint32_t LowestBit(std::uint64_t value)
+{
+    assert(value != 0);
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<std::uint32_t>(index);
+#else
+    return static_cast<std::uint32_t>(__builtin_ctzll(value));
+#endif
+}
+} // namespace
+
+TlsfAllocator::TlsfAllocator(uint64 capacity, uint64 granularity) : mGranularity(granularity)
+{
+    assert(granularity > 0 && (granularity & (granularity - 1)) == 0);
+    mGranularityLog2 = HighestBit(granularity);
+    mCapacity = capacity & ~(granularity - 1);
+    assert(mCapacity > 0);
+
+    for (auto &heads : mFreeHeads)
+    {
+        for (auto &head : heads)
+            head = InvalidBlock;
+    }
+
+    // 初始时整段空间是一个空闲块
+    uint32 block = NewBlock();
+    mBlocks[block].Offset = 0;
+    mBlocks[block].Size = mCapacity;
+    InsertFreeBlock(block);
+}
+
+void TlsfAllocator::Mapping(uint64 units, uint32 &firstLevel, uint32 &secondLevel)
+{
+    if (units < SecondLevelCount)
+    {
+        // 小块不再按 2 的幂划分，每个链表恰好对应一种大小
+        firstLevel = 0;
+        secondLevel = static_cast<uint32>(units);
+    }
+    else
+    {
+        uint32 highest = HighestBit(units);
+        firstLevel = highest - SecondLevelLog2 + 1;
+        secondLevel = static_cast<uint32>(units >> (highest - SecondLevelLog2)) - SecondLevelCount;
+    }
+}
+
+TlsfAllocator::uint32 TlsfAllocator::FindFreeBlock(uint64 units) const
+{
+    // 先向上取整到下一个链表的下界，这样找到的任何块都足够大，不必遍历链表
+    if (units >= SecondLevelCount)
+        units += (1ull << (HighestBit(units) - SecondLevelLog2)) - 1;
+
+    uint32 firstLevel, secondLevel;
+    Mapping(units, firstLevel, secondLevel);
+    if (firstLevel >= FirstLevelCount)
+        return InvalidBlock;
+
+    uint32 secondLevelMap = mSecondLevelBitmaps[firstLevel] & (~0u << secondLevel);
+    if (secondLevelMap == 0)
+    {
+        // 本级没有足够大的块，取更高一级中最小的非空链表
+        uint64 firstLevelMap = firstLevel + 1 < 64 ? mFirstLevelBitmap & (~0ull << (firstLevel + 1)) : 0;
+        if (firstLevelMap == 0)
+            return InvalidBlock;
+
+        firstLevel = LowestBit(firstLevelMap);
+        secondLevelMap = mSecondLevelBitmaps[firstLevel];
+    }
+
+    secondLevel = LowestBit(secondLevelMap);
+    return mFreeHeads[firstLevel][secondLevel];
+}
+
+void TlsfAllocator::InsertFreeBlock(uint32 block)
+{
+    Block &b = mBlocks[block];
+    uint32 firstLevel, secondLevel;
+    Mapping(b.Size >> mGranularityLog2, firstLevel, secondLevel);
+
+    b.IsFree = true;
+    b.PrevFree = InvalidBlock;
+    b.NextFree = mFreeHeads[firstLevel][secondLevel];
+    if (b.NextFree != InvalidBlock)
+        mBlocks[b.NextFree].PrevFree = block;
+    mFreeHeads[firstLevel][secondLevel] = block;
+
+    mFirstLevelBitmap |= 1ull << firstLevel;
+    mSecondLevelBitmaps[firstLevel] |= 1u << secondLevel;
+    ++mFreeBlockCount;
+}
+
+void TlsfAllocator::RemoveFreeBlock(uint32 block)
+{
+    Block &b = mBlocks[block];
+    assert(b.IsFree);
+
+    uint32 firstLevel, secondLevel;
+    Mapping(b.Size >> mGranularityLog2, firstLevel, secondLevel);
+
+    if (b.PrevFree != InvalidBlock)
+        mBlocks[b.PrevFree].NextFree = b.NextFree;
+    else
+        mFreeHeads[firstLevel][secondLevel] = b.NextFree;
+    if (b.NextFree != InvalidBlock)
+        mBlocks[b.NextFree].PrevFree = b.PrevFree;
+
+    if (mFreeHeads[firstLevel][secondLevel] == InvalidBlock)
+    {
+        mSecondLevelBitmaps[firstLevel] &= ~(1u << secondLevel);
+        if (mSecondLevelBitmaps[firstLevel] == 0)
+            mFirstLevelBitmap &= ~(1ull << firstLevel);
+    }
+
+    b.IsFree = false;
+    b.PrevFree = b.NextFree = InvalidBlock;
+    --mFreeBlockCount;
+}
+
+TlsfAllocator::uint32 TlsfAllocator::SplitFront(uint32 block, uint64 units)
+{
+    // NewBlock 可能使 mBlocks 重新分配，之后才能取引用
+    uint32 front = NewBlock();
+    Block &b = mBlocks[block];
+    Block &f = mBlocks[front];
+
+    const uint64 byteSize = units << mGranularityLog2;
+    assert(byteSize < b.Size);
+
+    f.Offset = b.Offset;
+    f.Size = byteSize;
+    f.PrevPhysical = b.PrevPhysical;
+    f.NextPhysical = block;
+    if (b.PrevPhysical != InvalidBlock)
+        mBlocks[b.PrevPhysical].NextPhysical = front;
+
+    b.Offset += byteSize;
+    b.Size -= byteSize;
+    b.PrevPhysical = front;
+    return front;
+}
+
+void TlsfAllocator::MergeNext(uint32 block)
+{
+    Block &b = mBlocks[block];
+    uint32 next = b.NextPhysical;
+    const Block &n = mBlocks[next];
+    assert(b.Offset + b.Size == n.Offset);
+
+    b.Size += n.Size;
+    b.NextPhysical = n.NextPhysical;
+    if (b.NextPhysical != InvalidBlock)
+        mBlocks[b.NextPhysical].PrevPhysical = block;
+
+    RecycleBlock(next);
+}
+
+TlsfAllocator::uint32 TlsfAllocator::NewBlock()
+{
+    if (mRecycledBlocks != InvalidBlock)
+    {
+        uint32 block = mRecycledBlocks;
+        mRecycledBlocks = mBlocks[block].NextFree;
+        mBlocks[block] = Block();
+        return block;
+    }
+
+    mBlocks.emplace_back();
+    return static_cast<uint32>(mBlocks.size() - 1);
+}
+
+void TlsfAllocator::RecycleBlock(uint32 block)
+{
+    mBlocks[block] = Block();
+    mBlocks[block].NextFree = mRecycledBlocks;
+    mRecycledBlocks = block;
+}
+
+TlsfAllocator::Allocation TlsfAllocator::Allocate(uint64 byteSize, uint64 alignment)
+{
+    assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    Allocation allocation;
+    if (byteSize == 0 || byteSize > mCapacity)
+        return allocation;
+
+    const uint64 units = (byteSize + mGranularity - 1) >> mGranularityLog2;
+    const uint64 alignUnits = alignment > mGranularity ? alignment >> mGranularityLog2 : 1;
+
+    // 先不考虑对齐查找一次，找到的块恰好对齐时就不必为对齐多预留空间
+    uint32 block = FindFreeBlock(units);
+    if (block == InvalidBlock || (mBlocks[block].Offset & (alignment - 1)) != 0)
+    {
+        if (alignUnits == 1)
+            return allocation;
+        block = FindFreeBlock(units + alignUnits - 1);
+        if (block == InvalidBlock)
+            return allocation;
+    }
+
+    RemoveFreeBlock(block);
+
+    // 对齐产生的空隙作为一个独立的空闲块留在前面
+    const uint64 offset = mBlocks[block].Offset;
+    const uint64 aligned = (offset + alignment - 1) & ~(alignment - 1);
+    if (aligned != offset)
+        InsertFreeBlock(SplitFront(block, (aligned - offset) >> mGranularityLog2));
+
+    // 多余的部分作为空闲块留在后面
+    if ((mBlocks[block].Size >> mGranularityLog2) > units)
+    {
+        uint32 used = SplitFront(block, units);
+        InsertFreeBlock(block);
+        block = used;
+    }
+
+    const Block &b = mBlocks[block];
+    allocation.Offset = b.Offset;
+    allocation.Size = b.Size;
+    allocation.Block = block;
+
+    mUsedBytes += b.Size;
+    ++mAllocationCount;
+    return allocation;
+}
+
+void TlsfAllocator::Free(const Allocation &allocation)
+{
+    assert(allocation.IsValid() && allocation.Block < mBlocks.size());
+
+    uint32 block = allocation.Block;
+    assert(!mBlocks[block].IsFree && mBlocks[block].Offset == allocation.Offset);
+
+    mUsedBytes -= mBlocks[block].Size;
+    --mAllocationCount;
+
+    uint32 next = mBlocks[block].NextPhysical;
+    if (next != InvalidBlock && mBlocks[next].IsFree)
+    {
+        RemoveFreeBlock(next);
+        MergeNext(block);
+    }
+
+    uint32 prev = mBlocks[block].PrevPhysical;
+    if (prev != InvalidBlock && mBlocks[prev].IsFree)
+    {
+        RemoveFreeBlock(prev);
+        MergeNext(prev);
+        block = prev;
+    }
+
+    InsertFreeBlock(block);
+}
+
+TlsfAllocator::Statistics TlsfAllocator::GetStatistics() const
+{
+    Statistics stats;
+    stats.Capacity = mCapacity;
+    stats.UsedBytes = mUsedBytes;
+    stats.FreeBytes = mCapacity - mUsedBytes;
+    stats.AllocationCount = mAllocationCount;
+    stats.FreeBlockCount = mFreeBlockCount;
+
+    // 最大的空闲块一定位于最高的非空链表中
+    if (mFirstLevelBitmap != 0)
+    {
+        uint32 firstLevel = HighestBit(mFirstLevelBitmap);
+        uint32 secondLevel = HighestBit(mSecondLevelBitmaps[firstLevel]);
+        for (uint32 block = mFreeHeads[firstLevel][secondLevel]; block != InvalidBlock;
+             block = mBlocks[block].NextFree)
+        {
+            if (mBlocks[block].Size > stats.LargestFreeBlock)
+                stats.LargestFreeBlock = mBlocks[block].Size;
+        }
+    }
+
+    return stats;
+}
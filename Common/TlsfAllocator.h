@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// 两级分离适配（TLSF，Two-Level Segregated Fit）分配器
+// 只管理一段 [0, capacity) 的偏移量空间，不涉及任何 Direct3D 对象：GpuHeapAllocator 用它在 ID3D12Heap 中
+// 为放置资源（placed resource）划分空间。空闲块按大小分为两级：第一级为 2 的幂，第二级再把每个区间等分为
+// SecondLevelCount 份，分配与释放都只需几次位运算即可定位到合适的空闲链表，耗时与已有的块数无关。
+// 所有大小与偏移量都是 granularity 的整数倍；释放时与物理上相邻的空闲块合并。
+class TlsfAllocator
+{
+  public:
+    using uint32 = std::uint32_t;
+    using uint64 = std::uint64_t;
+
+    static const uint32 InvalidBlock = ~0u;
+
+    struct Allocation
+    {
+        uint64 Offset = 0;
+        // 实际占用的大小（已按 granularity 向上取整）
+        uint64 Size = 0;
+        uint32 Block = InvalidBlock;
+
+        bool IsValid() const
+        {
+            return Block != InvalidBlock;
+        }
+    };
+
+    struct Statistics
+    {
+        uint64 Capacity = 0;
+        uint64 UsedBytes = 0;
+        uint64 FreeBytes = 0;
+        uint32 AllocationCount = 0;
+        uint32 FreeBlockCount = 0;
+        uint64 LargestFreeBlock = 0;
+
+        // 外部碎片率：1 - 最大空闲块 / 空闲总量。为 0 表示所有空闲空间连成一片
+        float Fragmentation() const
+        {
+            return FreeBytes == 0 ? 0.0f : 1.0f - static_cast<float>(LargestFreeBlock) / FreeBytes;
+        }
+    };
+
+    // granularity 必须为 2 的幂，capacity 会向下取整为它的整数倍
+    TlsfAllocator(uint64 capacity, uint64 granularity);
+
+    // alignment 必须为 2 的幂；空间不足时返回无效的 Allocation
+    Allocation Allocate(uint64 byteSize, uint64 alignment);
+
+    void Free(const Allocation &allocation);
+
+    uint64 Capacity() const
+    {
+        return mCapacity;
+    }
+
+    uint64 Granularity() const
+    {
+        return mGranularity;
+    }
+
+    uint64 UsedBytes() const
+    {
+        return mUsedBytes;
+    }
+
+    uint32 AllocationCount() const
+    {
+        return mAllocationCount;
+    }
+
+    bool IsEmpty() const
+    {
+        return mAllocationCount == 0;
+    }
+
+    Statistics GetStatistics() const;
+
+  private:
+    // 第二级的划分数为 2^SecondLevelLog2
+    static const uint32 SecondLevelLog2 = 5;
+    static const uint32 SecondLevelCount = 1u << SecondLevelLog2;
+    static const uint32 FirstLevelCount = 64 - SecondLevelLog2 + 1;
+
+    struct Block
+    {
+        uint64 Offset = 0;
+        uint64 Size = 0;
+        // 物理上相邻的块
+        uint32 PrevPhysical = InvalidBlock;
+        uint32 NextPhysical = InvalidBlock;
+        // 同一空闲链表中的块；已分配的块复用 NextFree 串起回收的节点
+        uint32 PrevFree = InvalidBlock;
+        uint32 NextFree = InvalidBlock;
+        bool IsFree = false;
+    };
+
+    // 由大小（以 granularity 为单位）计算所在的空闲链表
+    static void Mapping(uint64 units, uint32 &firstLevel, uint32 &secondLevel);
+
+    uint32 FindFreeBlock(uint64 units) const;
+    void InsertFreeBlock(uint32 block);
+    void RemoveFreeBlock(uint32 block);
+
+    // 从 block 的开头切下 units 个单位作为新块返回，block 保留剩余的部分
+    uint32 SplitFront(uint32 block, uint64 units);
+    // 把 next 合并到 block 中并回收 next
+    void MergeNext(uint32 block);
+
+    uint32 NewBlock();
+    void RecycleBlock(uint32 block);
+
+  private:
+    uint64 mCapacity;
+    uint64 mGranularity;
+    uint32 mGranularityLog2 = 0;
+    uint64 mUsedBytes = 0;
+    uint32 mAllocationCount = 0;
+    uint32 mFreeBlockCount = 0;
+
+    std::vector<Block> mBlocks;
+    uint32 mRecycledBlocks = InvalidBlock;
+
+    uint64 mFirstLevelBitmap = 0;
+    uint32 mSecondLevelBitmaps[FirstLevelCount] = {};
+    uint32 mFreeHeads[FirstLevelCount][SecondLevelCount];
+};
@@ -0,0 +1,132 @@
+#include "UploadBatch.h"
+#include "D3D12CommandReplay.h"
+#include <algorithm>
+
+using Microsoft::WRL::ComPtr;
+
+static_assert(UploadPlanner::CopyDestState == D3D12_RESOURCE_STATE_COPY_DEST, "UploadPlanner::CopyDestState");
+
+UploadBatch::UploadBatch(ID3D12Device *device, uint64 stagingCapacity) : mDevice(device), mArena(stagingCapacity)
+{
+    mStagingBuffer = CreateUploadBuffer(stagingCapacity);
+
+    // 上传堆中的缓冲区可以一直保持映射状态，我们不会在 CPU 端读取它
+    CD3DX12_RANGE readRange(0, 0);
+    ThrowIfFailed(mStagingBuffer->Map(0, &readRange, reinterpret_cast<void **>(&mStagingData)));
+}
+
+UploadBatch::~UploadBatch()
+{
+    if (mStagingBuffer != nullptr)
+        mStagingBuffer->Unmap(0, nullptr);
+}
+
+ComPtr<ID3D12Resource> UploadBatch::CreateUploadBuffer(UINT64 byteSize)
+{
+    ComPtr<ID3D12Resource> buffer;
+
+    auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+    auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+    ThrowIfFailed(mDevice->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+                                                   D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                                   IID_PPV_ARGS(buffer.GetAddressOf())));
+    return buffer;
+}
+
+ComPtr<ID3D12Resource> UploadBatch::CreateDefaultBuffer(const void *initData, UINT64 byteSize,
+                                                        D3D12_RESOURCE_STATES finalState)
+{
+    ComPtr<ID3D12Resource> defaultBuffer;
+
+    auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_DEFAULT);
+    auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(byteSize);
+    ThrowIfFailed(mDevice->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+                                                   D3D12_RESOURCE_STATE_COMMON, nullptr,
+                                                   IID_PPV_ARGS(defaultBuffer.GetAddressOf())));
+
+    Upload(defaultBuffer.Get(), 0, initData, byteSize, D3D12_RESOURCE_STATE_COMMON, finalState);
+    return defaultBuffer;
+}
+
+void UploadBatch::Upload(ID3D12Resource *destination, UINT64 destinationOffset, const void *data, UINT64 byteSize,
+                         D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter)
+{
+    assert(destination != nullptr);
+    if (byteSize == 0)
+        return;
+
+    UploadPlanner::Upload upload;
+    upload.Destination = destination;
+    upload.DestinationOffset = destinationOffset;
+    upload.ByteSize = byteSize;
+    upload.StateBefore = static_cast<std::uint32_t>(stateBefore);
+    upload.StateAfter = static_cast<std::uint32_t>(stateAfter);
+
+    uint64 offset = mArena.Allocate(byteSize, StagingAlignment);
+    if (offset != StagingArena::InvalidOffset)
+    {
+        upload.Source = mStagingBuffer.Get();
+        upload.SourceOffset = offset;
+        std::memcpy(mStagingData + offset, data, static_cast<size_t>(byteSize));
+    }
+    else
+    {
+        // 暂存空间已满，为这次上传单独创建一个上传缓冲区
+        OverflowBuffer overflow;
+        overflow.Resource = CreateUploadBuffer(byteSize);
+        overflow.FenceValue = UnsubmittedFence;
+
+        CD3DX12_RANGE readRange(0, 0);
+        void *mapped = nullptr;
+        ThrowIfFailed(overflow.Resource->Map(0, &readRange, &mapped));
+        std::memcpy(mapped, data, static_cast<size_t>(byteSize));
+        overflow.Resource->Unmap(0, nullptr);
+
+        upload.Source = overflow.Resource.Get();
+        upload.SourceOffset = 0;
+        mOverflow.push_back(std::move(overflow));
+    }
+
+    mPending.push_back(upload);
+}
+
+void UploadBatch::Record(ID3D12GraphicsCommandList *cmdList)
+{
+    if (mPending.empty())
+        return;
+
+    // 屏障的推导见 UploadPlanner：prologue 中的屏障要先于复制命令执行。
+    // 全局状态只在本批中有效，各资源之前的状态完全由 Upload 的调用者给出（原因见 ResourceStateTracker.h）
+    ResourceStateMap states;
+    CommandStream prologue;
+    CommandStream commands(mPending.size() * 64);
+    UploadPlanner::Record(mPending, states, prologue, commands);
+
+    ReplayCommandStream(prologue, cmdList);
+    ReplayCommandStream(commands, cmdList);
+
+    mPending.clear();
+}
+
+void UploadBatch::Submit(UINT64 fenceValue)
+{
+    assert(mPending.empty());
+
+    mArena.Retire(fenceValue);
+    for (auto &overflow : mOverflow)
+    {
+        if (overflow.FenceValue == UnsubmittedFence)
+            overflow.FenceValue = fenceValue;
+    }
+}
+
+void UploadBatch::ReleaseCompleted(UINT64 completedFenceValue)
+{
+    mArena.Release(completedFenceValue);
+
+    mOverflow.erase(std::remove_if(mOverflow.begin(), mOverflow.end(),
+                                   [completedFenceValue](const OverflowBuffer &overflow) {
+                                       return overflow.FenceValue <= completedFenceValue;
+                                   }),
+                    mOverflow.end());
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "StagingArena.h"
+#include "UploadPlanner.h"
+#include "d3dUtil.h"
+#include <vector>
+
+// 成批上传数据到默认堆中的缓冲区
+// d3dUtil::CreateDefaultBuffer 为每个缓冲区都单独创建一个上传缓冲区，并各自插入两次资源屏障，
+// 而这些上传缓冲区要一直保留到调用 DisposeUploaders 为止。UploadBatch 则只持有一个持久映射的上传缓冲区，
+// 所有待上传的数据都从中以 StagingArena 划分空间；Record 一次性记录全部复制命令，状态转换也合并为两次
+// ResourceBarrier 调用；暂存空间在对应的围栏完成后自动回收。
+//
+// 使用流程：
+//   CreateDefaultBuffer / Upload ...    // 登记上传，数据立即复制到暂存空间
+//   Record(cmdList)                     // 记录屏障与复制命令
+//   ExecuteCommandLists + Signal(fence)
+//   Submit(fence)                       // 本批暂存空间将在 fence 完成后回收
+//   ReleaseCompleted(completedFence)    // 可在每帧调用
+class UploadBatch
+{
+  public:
+    using uint64 = std::uint64_t;
+
+    // 每次复制的源数据在暂存空间中的对齐要求
+    static const uint64 StagingAlignment = 16;
+
+    UploadBatch(ID3D12Device *device, uint64 stagingCapacity = 32ull * 1024 * 1024);
+    UploadBatch(const UploadBatch &rhs) = delete;
+    UploadBatch &operator=(const UploadBatch &rhs) = delete;
+    ~UploadBatch();
+
+    // 创建一个默认堆中的缓冲区并登记以 initData 初始化它。Record 记录的命令执行完毕后，缓冲区处于 finalState
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
+        const void *initData, UINT64 byteSize, D3D12_RESOURCE_STATES finalState = D3D12_RESOURCE_STATE_GENERIC_READ);
+
+    // 登记一次向 destination 的 [destinationOffset, destinationOffset + byteSize) 写入数据的上传。
+    // stateBefore 为 Record 的命令执行前该资源所处的状态，stateAfter 为执行后的状态。
+    // 与 CreateDefaultBuffer 返回的缓冲区一样，调用者要保证 destination 在复制命令执行完毕前一直有效
+    void Upload(ID3D12Resource *destination, UINT64 destinationOffset, const void *data, UINT64 byteSize,
+                D3D12_RESOURCE_STATES stateBefore, D3D12_RESOURCE_STATES stateAfter);
+
+    // 把所有已登记的上传记录到命令列表中，之后可以继续登记下一批
+    void Record(ID3D12GraphicsCommandList *cmdList);
+
+    // Record 过的命令已提交，并将在 GPU 到达 fenceValue 时完成。
+    // Record 与 Submit 之间不能再登记新的上传，否则它们的暂存空间会随本批一起被回收
+    void Submit(UINT64 fenceValue);
+
+    // 回收围栏值不大于 completedFenceValue 的暂存空间与溢出缓冲区
+    void ReleaseCompleted(UINT64 completedFenceValue);
+
+    size_t PendingUploadCount() const
+    {
+        return mPending.size();
+    }
+
+    const StagingArena &Arena() const
+    {
+        return mArena;
+    }
+
+  private:
+    static const UINT64 UnsubmittedFence = ~0ull;
+
+    // 暂存空间不足以容纳的数据单独放在一个上传缓冲区中，同样在围栏完成后释放
+    struct OverflowBuffer
+    {
+        Microsoft::WRL::ComPtr<ID3D12Resource> Resource;
+        UINT64 FenceValue;
+    };
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> CreateUploadBuffer(UINT64 byteSize);
+
+  private:
+    ID3D12Device *mDevice;
+
+    Microsoft::WRL::ComPtr<ID3D12Resource> mStagingBuffer;
+    std::uint8_t *mStagingData = nullptr;
+    StagingArena mArena;
+
+    // 源数据所在的上传缓冲区为暂存缓冲区或溢出缓冲区
+    std::vector<UploadPlanner::Upload> mPending;
+    // 尚未 Submit 的溢出缓冲区的 FenceValue 为 UnsubmittedFence
+    std::vector<OverflowBuffer> mOverflow;
+};
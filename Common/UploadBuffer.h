@@ -1,5 +1,6 @@
 #pragma once
 
+#include "GpuHeapAllocator.h"
 #include "d3dUtil.h"
 
 // 实现了上传缓冲区资源的构造与析构函数、处理资源的映射和取消映射操作，
@@ -8,11 +9,13 @@
 // 注意，此类可用于各种类型的上传缓冲区，而并非只针对常量缓冲区。
 // 当用此类管理常量缓冲区时，我们就需要通过构造函数参数 isConstantBuffer 来对此加以描述。
 // 另外，如果此类中存储的是常量缓冲区，那么其中的构造函数将自动填充内存，使每个常量缓冲区的大小都成为 256B 的整数倍。
+// 给出 allocator 时，缓冲区作为放置资源创建在它管理的上传堆中，析构时归还空间；allocator 必须比缓冲区存活得更久。
 template <typename T>
 class UploadBuffer
 {
   public:
-    UploadBuffer(ID3D12Device *device, UINT elementCount, bool isConstantBuffer) : mIsConstantBuffer(isConstantBuffer)
+    UploadBuffer(ID3D12Device *device, UINT elementCount, bool isConstantBuffer, GpuHeapAllocator *allocator = nullptr)
+        : mAllocator(allocator), mIsConstantBuffer(isConstantBuffer)
     {
         mElementByteSize = sizeof(T);
         // 常量缓冲区的大小为 256B 的整数倍。这是因为硬件只能按 m*256B 的偏移量和 n*256B 的数据
@@ -26,11 +29,20 @@ class UploadBuffer
             mElementByteSize = d3dUtil::CalcConstantBufferByteSize(mElementByteSize);
         }
         // 由于常量缓冲区是用 D3D12_HEAP_TYPE_UPLOAD 这种堆类型来创建的，所以我们就能通过 CPU 为常量缓冲区资源更新数据。
-        auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
-        auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(mElementByteSize * elementCount);
-        ThrowIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
-                                                      D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
-                                                      IID_PPV_ARGS(&mUploadBuffer)));
+        if (mAllocator != nullptr)
+        {
+            mAllocation = mAllocator->CreateBuffer(static_cast<UINT64>(mElementByteSize) * elementCount,
+                                                   D3D12_HEAP_TYPE_UPLOAD, D3D12_RESOURCE_STATE_GENERIC_READ);
+            mUploadBuffer = mAllocation.Resource;
+        }
+        else
+        {
+            auto heapProperties = CD3DX12_HEAP_PROPERTIES(D3D12_HEAP_TYPE_UPLOAD);
+            auto resourceDesc = CD3DX12_RESOURCE_DESC::Buffer(mElementByteSize * elementCount);
+            ThrowIfFailed(device->CreateCommittedResource(&heapProperties, D3D12_HEAP_FLAG_NONE, &resourceDesc,
+                                                          D3D12_RESOURCE_STATE_GENERIC_READ, nullptr,
+                                                          IID_PPV_ARGS(&mUploadBuffer)));
+        }
 
         ThrowIfFailed(mUploadBuffer->Map(
             // 第一个参数是子资源（subresource）的索引(关于此处的子资源索引，请参考 12.3.4 节。)，指定了欲映射的子资源。
@@ -55,6 +67,9 @@ class UploadBuffer
             mUploadBuffer->Unmap(0, nullptr);
 
         mMappedData = nullptr;
+        mUploadBuffer.Reset();
+        if (mAllocator != nullptr)
+            mAllocator->Free(mAllocation);
     }
 
     ID3D12Resource *Resource() const
@@ -72,6 +87,9 @@ class UploadBuffer
     ComPtr<ID3D12Resource> mUploadBuffer;
     BYTE *mMappedData = nullptr;
 
+    GpuHeapAllocator *mAllocator = nullptr;
+    GpuHeapAllocator::Allocation mAllocation;
+
     UINT mElementByteSize = 0;
     bool mIsConstantBuffer = false;
 };
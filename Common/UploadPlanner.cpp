@@ -0,0 +1,30 @@
+#include "UploadPlanner.h"
+
+void UploadPlanner::Record(const std::vector<Upload> &uploads, ResourceStateMap &states, CommandStream &prologue,
+                           CommandStream &commands)
+{
+    if (uploads.empty())
+        return;
+
+    // 各目标资源在本批命令执行之前的状态由 Upload 的调用者给出，同一个资源以第一次登记的为准
+    for (const auto &upload : uploads)
+    {
+        uint32 state = 0;
+        if (!states.GetState(upload.Destination, 0, state))
+            states.Register(upload.Destination, 1, upload.StateBefore);
+    }
+
+    // 由状态跟踪器推导屏障：复制之前的屏障在解析待定屏障时写入 prologue，复制之后的屏障在最后一次性写出
+    ResourceStateTracker tracker(states);
+    for (const auto &upload : uploads)
+    {
+        tracker.TransitionResource(upload.Destination, CopyDestState);
+        commands.CopyBufferRegion(upload.Destination, upload.DestinationOffset, upload.Source, upload.SourceOffset,
+                                  upload.ByteSize);
+    }
+    for (const auto &upload : uploads)
+        tracker.TransitionResource(upload.Destination, upload.StateAfter);
+    tracker.FlushBarriers(commands);
+
+    tracker.ResolvePendingBarriers(prologue);
+}
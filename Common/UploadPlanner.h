@@ -0,0 +1,36 @@
+#pragma once
+
+#include "CommandStream.h"
+#include "ResourceStateTracker.h"
+#include <vector>
+
+// UploadBatch 中与 Direct3D 无关的部分：把登记的一批上传转换为复制命令与合并后的资源屏障
+// 资源与状态同样以不透明指针和 D3D12_RESOURCE_STATES 的数值表示，可以配合 NullCommandBackend 在没有 GPU 的环境中测试。
+class UploadPlanner
+{
+  public:
+    using uint32 = std::uint32_t;
+    using uint64 = std::uint64_t;
+
+    // D3D12_RESOURCE_STATE_COPY_DEST
+    static const uint32 CopyDestState = 0x400;
+
+    struct Upload
+    {
+        void *Destination = nullptr;
+        uint64 DestinationOffset = 0;
+        void *Source = nullptr;
+        uint64 SourceOffset = 0;
+        uint64 ByteSize = 0;
+        // 这批命令执行之前与之后目标资源所处的状态
+        uint32 StateBefore = 0;
+        uint32 StateAfter = 0;
+    };
+
+    // 把 uploads 记录为两个命令流：prologue 中是复制之前转换到 COPY_DEST 的屏障，必须先于 commands 执行；
+    // commands 中是全部复制命令以及转换到 StateAfter 的屏障。同一资源的多次上传只转换一次，已处于目标状态的资源
+    // 不插入屏障，两组屏障各自合并为一次 ResourceBarrier 调用。
+    // states 中未登记的目标资源以它第一次上传的 StateBefore 登记；记录之后 states 中是这批命令执行完毕后的状态
+    static void Record(const std::vector<Upload> &uploads, ResourceStateMap &states, CommandStream &prologue,
+                       CommandStream &commands);
+};
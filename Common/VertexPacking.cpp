@@ -0,0 +1,291 @@
+#include "VertexPacking.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+namespace
+{
+// 每批处理的顶点数，与 XMVECTOR 的通道数一致
+const size_t BatchSize = 4;
+
+// 以 SoA 形式同时对 4 个方向做八面体编码：x、y、z 的第 i 个通道即第 i 个方向的三个分量
+void XM_CALLCONV EncodeOctahedral4(FXMVECTOR x, FXMVECTOR y, FXMVECTOR z, XMSHORTN2 out[BatchSize])
+{
+    const XMVECTOR zero = XMVectorZero();
+    const XMVECTOR one = XMVectorSplatOne();
+
+    // 投影到八面体 |x| + |y| + |z| = 1 上
+    XMVECTOR l1 = XMVectorAdd(XMVectorAdd(XMVectorAbs(x), XMVectorAbs(y)), XMVectorAbs(z));
+    XMVECTOR invL1 = XMVectorReciprocal(XMVectorMax(l1, XMVectorReplicate(1e-20f)));
+    XMVECTOR u = XMVectorMultiply(x, invL1);
+    XMVECTOR v = XMVectorMultiply(y, invL1);
+
+    // 下半球沿对角线折叠到正方形的四个角上
+    XMVECTOR signU = XMVectorSelect(XMVectorNegate(one), one, XMVectorGreaterOrEqual(u, zero));
+    XMVECTOR signV = XMVectorSelect(XMVectorNegate(one), one, XMVectorGreaterOrEqual(v, zero));
+    XMVECTOR foldedU = XMVectorMultiply(XMVectorSubtract(one, XMVectorAbs(v)), signU);
+    XMVECTOR foldedV = XMVectorMultiply(XMVectorSubtract(one, XMVectorAbs(u)), signV);
+
+    XMVECTOR lower = XMVectorLess(z, zero);
+    u = XMVectorSelect(u, foldedU, lower);
+    v = XMVectorSelect(v, foldedV, lower);
+
+    // 量化为 16 位有符号归一化整数，与 XMStoreShortN2 的舍入方式相同
+    const XMVECTOR scale = XMVectorReplicate(32767.0f);
+    u = XMVectorRound(XMVectorMultiply(XMVectorClamp(u, XMVectorNegate(one), one), scale));
+    v = XMVectorRound(XMVectorMultiply(XMVectorClamp(v, XMVectorNegate(one), one), scale));
+
+    XMFLOAT4 qu, qv;
+    XMStoreFloat4(&qu, u);
+    XMStoreFloat4(&qv, v);
+
+    const float *pu = &qu.x;
+    const float *pv = &qv.x;
+    for (size_t i = 0; i < BatchSize; ++i)
+    {
+        out[i].x = static_cast<std::int16_t>(pu[i]);
+        out[i].y = static_cast<std::int16_t>(pv[i]);
+    }
+}
+
+// 读入 4 个方向并转置为 SoA 形式
+void LoadDirections4(const XMFLOAT3 *d0, const XMFLOAT3 *d1, const XMFLOAT3 *d2, const XMFLOAT3 *d3, XMVECTOR &x,
+                     XMVECTOR &y, XMVECTOR &z)
+{
+    XMMATRIX m;
+    m.r[0] = XMLoadFloat3(d0);
+    m.r[1] = XMLoadFloat3(d1);
+    m.r[2] = XMLoadFloat3(d2);
+    m.r[3] = XMLoadFloat3(d3);
+    m = XMMatrixTranspose(m);
+
+    x = m.r[0];
+    y = m.r[1];
+    z = m.r[2];
+}
+
+void EncodeBatch(const GeometryGenerator::Vertex *src[BatchSize], const QuantizationBounds &bounds,
+                 const XMFLOAT4 *colors[BatchSize], PackedVertex *dst[BatchSize], size_t count)
+{
+    XMVECTOR minimum = XMLoadFloat3(&bounds.Min);
+    XMVECTOR invExtent = XMVectorReciprocal(XMLoadFloat3(&bounds.Extent));
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        XMVECTOR p = XMVectorMultiply(XMVectorSubtract(XMLoadFloat3(&src[i]->Position), minimum), invExtent);
+        XMStoreUShortN4(&dst[i]->Position, XMVectorSetW(XMVectorSaturate(p), 1.0f));
+        XMStoreUByteN4(&dst[i]->Color, XMLoadFloat4(colors[i]));
+    }
+
+    XMSHORTN2 encoded[BatchSize];
+    XMVECTOR x, y, z;
+
+    LoadDirections4(&src[0]->Normal, &src[1]->Normal, &src[2]->Normal, &src[3]->Normal, x, y, z);
+    EncodeOctahedral4(x, y, z, encoded);
+    for (size_t i = 0; i < count; ++i)
+        dst[i]->Normal = encoded[i];
+
+    LoadDirections4(&src[0]->TangentU, &src[1]->TangentU, &src[2]->TangentU, &src[3]->TangentU, x, y, z);
+    EncodeOctahedral4(x, y, z, encoded);
+    for (size_t i = 0; i < count; ++i)
+        dst[i]->TangentU = encoded[i];
+}
+
+void EncodeImpl(const GeometryGenerator::Vertex *src, size_t count, const QuantizationBounds &bounds,
+                const XMFLOAT4 *colors, size_t colorStride, PackedVertex *dst)
+{
+    if (count == 0)
+        return;
+
+    const GeometryGenerator::Vertex *srcBatch[BatchSize];
+    const XMFLOAT4 *colorBatch[BatchSize];
+    PackedVertex *dstBatch[BatchSize];
+
+    for (size_t first = 0; first < count; first += BatchSize)
+    {
+        size_t batchCount = std::min(BatchSize, count - first);
+
+        // 不足一批时重复最后一个顶点补齐，多出的结果不会被写回
+        for (size_t i = 0; i < BatchSize; ++i)
+        {
+            size_t index = first + std::min(i, batchCount - 1);
+            srcBatch[i] = src + index;
+            colorBatch[i] = reinterpret_cast<const XMFLOAT4 *>(reinterpret_cast<const std::uint8_t *>(colors) +
+                                                               index * colorStride);
+            dstBatch[i] = dst + index;
+        }
+
+        EncodeBatch(srcBatch, bounds, colorBatch, dstBatch, batchCount);
+    }
+
+    // 纹理坐标逐分量以流的形式转换，XMConvertFloatToHalfStream 在支持 F16C 时会一次转换多个值
+    XMConvertFloatToHalfStream(&dst->TexC.x, sizeof(PackedVertex), &src->TexC.x, sizeof(GeometryGenerator::Vertex),
+                               count);
+    XMConvertFloatToHalfStream(&dst->TexC.y, sizeof(PackedVertex), &src->TexC.y, sizeof(GeometryGenerator::Vertex),
+                               count);
+}
+
+float AngleDegrees(FXMVECTOR a, FXMVECTOR b)
+{
+    // 夹角很小时 acos 在单精度下会损失大部分精度，改用 atan2(|a x b|, a . b)
+    XMVECTOR na = XMVector3Normalize(a);
+    XMVECTOR nb = XMVector3Normalize(b);
+    float s = XMVectorGetX(XMVector3Length(XMVector3Cross(na, nb)));
+    float c = XMVectorGetX(XMVector3Dot(na, nb));
+    return XMConvertToDegrees(std::atan2(s, c));
+}
+} // namespace
+
+QuantizationBounds QuantizationBounds::FromPositions(const XMFLOAT3 *positions, size_t positionStride,
+                                                     size_t vertexCount)
+{
+    QuantizationBounds bounds;
+    if (vertexCount == 0)
+        return bounds;
+
+    XMVECTOR minimum = XMVectorReplicate(+FLT_MAX);
+    XMVECTOR maximum = XMVectorReplicate(-FLT_MAX);
+    for (size_t i = 0; i < vertexCount; ++i)
+    {
+        auto p = reinterpret_cast<const XMFLOAT3 *>(reinterpret_cast<const std::uint8_t *>(positions) +
+                                                    i * positionStride);
+        XMVECTOR v = XMLoadFloat3(p);
+        minimum = XMVectorMin(minimum, v);
+        maximum = XMVectorMax(maximum, v);
+    }
+
+    XMStoreFloat3(&bounds.Min, minimum);
+    XMStoreFloat3(&bounds.Extent, XMVectorMax(XMVectorSubtract(maximum, minimum), XMVectorReplicate(1e-6f)));
+    return bounds;
+}
+
+QuantizationBounds QuantizationBounds::FromMeshData(const GeometryGenerator::MeshData &meshData)
+{
+    if (meshData.Vertices.empty())
+        return QuantizationBounds();
+
+    return FromPositions(&meshData.Vertices[0].Position, sizeof(GeometryGenerator::Vertex), meshData.Vertices.size());
+}
+
+XMMATRIX XM_CALLCONV QuantizationBounds::DequantizeMatrix() const
+{
+    return XMMatrixMultiply(XMMatrixScaling(Extent.x, Extent.y, Extent.z), XMMatrixTranslation(Min.x, Min.y, Min.z));
+}
+
+void VertexPacking::Encode(const GeometryGenerator::Vertex *src, size_t count, const QuantizationBounds &bounds,
+                           const XMFLOAT4 &color, PackedVertex *dst)
+{
+    EncodeImpl(src, count, bounds, &color, 0, dst);
+}
+
+void VertexPacking::Encode(const GeometryGenerator::Vertex *src, size_t count, const QuantizationBounds &bounds,
+                           const XMFLOAT4 *colors, PackedVertex *dst)
+{
+    assert(colors != nullptr || count == 0);
+    EncodeImpl(src, count, bounds, colors, sizeof(XMFLOAT4), dst);
+}
+
+void VertexPacking::Decode(const PackedVertex *src, size_t count, const QuantizationBounds &bounds,
+                           GeometryGenerator::Vertex *dst, XMFLOAT4 *colors)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        XMStoreFloat3(&dst[i].Position, DecodePosition(src[i].Position, bounds));
+        XMStoreFloat3(&dst[i].Normal, DecodeOctahedral(src[i].Normal));
+        XMStoreFloat3(&dst[i].TangentU, DecodeOctahedral(src[i].TangentU));
+        if (colors != nullptr)
+            XMStoreFloat4(&colors[i], XMLoadUByteN4(&src[i].Color));
+    }
+
+    if (count == 0)
+        return;
+
+    XMConvertHalfToFloatStream(&dst->TexC.x, sizeof(GeometryGenerator::Vertex), &src->TexC.x, sizeof(PackedVertex),
+                               count);
+    XMConvertHalfToFloatStream(&dst->TexC.y, sizeof(GeometryGenerator::Vertex), &src->TexC.y, sizeof(PackedVertex),
+                               count);
+}
+
+XMSHORTN2 XM_CALLCONV VertexPacking::EncodeOctahedral(FXMVECTOR direction)
+{
+    XMSHORTN2 encoded[BatchSize];
+    EncodeOctahedral4(XMVectorSplatX(direction), XMVectorSplatY(direction), XMVectorSplatZ(direction), encoded);
+    return encoded[0];
+}
+
+XMVECTOR XM_CALLCONV VertexPacking::DecodeOctahedral(const XMSHORTN2 &encoded)
+{
+    XMVECTOR uv = XMLoadShortN2(&encoded);
+    float u = XMVectorGetX(uv);
+    float v = XMVectorGetY(uv);
+    float z = 1.0f - std::abs(u) - std::abs(v);
+
+    // 还原被折叠到四个角上的下半球
+    float t = std::max(-z, 0.0f);
+    u += u >= 0.0f ? -t : t;
+    v += v >= 0.0f ? -t : t;
+
+    return XMVector3Normalize(XMVectorSet(u, v, z, 0.0f));
+}
+
+XMVECTOR XM_CALLCONV VertexPacking::DecodePosition(const XMUSHORTN4 &encoded, const QuantizationBounds &bounds)
+{
+    XMVECTOR q = XMLoadUShortN4(&encoded);
+    XMVECTOR p = XMVectorMultiplyAdd(q, XMLoadFloat3(&bounds.Extent), XMLoadFloat3(&bounds.Min));
+    return XMVectorSetW(p, 1.0f);
+}
+
+VertexPackingError VertexPacking::Validate(const GeometryGenerator::Vertex *src, size_t count,
+                                           const PackedVertex *packed, const QuantizationBounds &bounds)
+{
+    VertexPackingError error;
+
+    // 每个轴的最大舍入误差为半个量化步长，另留出 32 位浮点数本身的舍入余量
+    XMVECTOR extent = XMLoadFloat3(&bounds.Extent);
+    XMVECTOR farCorner = XMVectorAdd(XMVectorAbs(XMLoadFloat3(&bounds.Min)), extent);
+    error.PositionErrorBound = XMVectorGetX(XMVector3Length(extent)) * (0.5f / 65535.0f) +
+                               XMVectorGetX(XMVector3Length(farCorner)) * 1e-6f;
+
+    // 16 位八面体编码的最大角度误差约为 0.005 度，这里留出一倍的余量
+    error.DirectionErrorBoundDegrees = 0.01f;
+
+    // 半精度浮点数有 11 位有效位，就近舍入的相对误差不超过 2^-11
+    error.TexCRelativeErrorBound = 1.0f / 2048.0f;
+
+    // 低于半精度最小规格化数的值按绝对误差计算
+    const float minNormalHalf = 6.103515625e-05f;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        GeometryGenerator::Vertex decoded;
+        Decode(&packed[i], 1, bounds, &decoded, nullptr);
+
+        XMVECTOR p0 = XMLoadFloat3(&src[i].Position);
+        XMVECTOR p1 = XMLoadFloat3(&decoded.Position);
+        error.MaxPositionError = std::max(error.MaxPositionError, XMVectorGetX(XMVector3Length(p1 - p0)));
+
+        XMVECTOR n0 = XMLoadFloat3(&src[i].Normal);
+        if (XMVectorGetX(XMVector3LengthSq(n0)) > 0.0f)
+            error.MaxNormalErrorDegrees =
+                std::max(error.MaxNormalErrorDegrees, AngleDegrees(n0, XMLoadFloat3(&decoded.Normal)));
+
+        XMVECTOR t0 = XMLoadFloat3(&src[i].TangentU);
+        if (XMVectorGetX(XMVector3LengthSq(t0)) > 0.0f)
+            error.MaxTangentErrorDegrees =
+                std::max(error.MaxTangentErrorDegrees, AngleDegrees(t0, XMLoadFloat3(&decoded.TangentU)));
+
+        const float *uv0 = &src[i].TexC.x;
+        const float *uv1 = &decoded.TexC.x;
+        for (int k = 0; k < 2; ++k)
+        {
+            float relative = std::abs(uv1[k] - uv0[k]) / std::max(std::abs(uv0[k]), minNormalHalf);
+            error.MaxTexCRelativeError = std::max(error.MaxTexCRelativeError, relative);
+        }
+    }
+
+    return error;
+}
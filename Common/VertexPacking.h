@@ -0,0 +1,94 @@
+#pragma once
+
+#include "GeometryGenerator.h"
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <cstdint>
+
+// 压缩顶点格式
+// GeometryGenerator::Vertex 全部使用 32 位浮点数（44 字节），演示程序的顶点还要再带上一个 16 字节的 XMFLOAT4 颜色。
+// PackedVertex 只占 24 字节：
+//   Position  R16G16B16A16_UNORM  相对于网格包围盒量化的位置，w 恒为 1
+//   Normal    R16G16_SNORM        八面体（octahedral）编码的单位法线
+//   TangentU  R16G16_SNORM        八面体编码的单位切线
+//   TexC      R16G16_FLOAT        半精度纹理坐标
+//   Color     R8G8B8A8_UNORM      RGBA8 颜色
+// 顶点着色器读入的位置位于 [0, 1]^3 中，只需把 QuantizationBounds::DequantizeMatrix() 左乘到世界矩阵上即可还原，
+// 着色器无需改动；法线与切线则要在着色器中按 DecodeOctahedral 的方法解码。
+
+struct PackedVertex
+{
+    DirectX::PackedVector::XMUSHORTN4 Position;
+    DirectX::PackedVector::XMSHORTN2 Normal;
+    DirectX::PackedVector::XMSHORTN2 TangentU;
+    DirectX::PackedVector::XMHALF2 TexC;
+    DirectX::PackedVector::XMUBYTEN4 Color;
+};
+
+static_assert(sizeof(PackedVertex) == 24, "PackedVertex must stay tightly packed");
+
+// 位置量化所用的包围盒
+struct QuantizationBounds
+{
+    DirectX::XMFLOAT3 Min = {0.0f, 0.0f, 0.0f};
+    // 包围盒的边长。为避免除以 0，退化的轴也会被设为一个极小的正数
+    DirectX::XMFLOAT3 Extent = {1.0f, 1.0f, 1.0f};
+
+    static QuantizationBounds FromPositions(const DirectX::XMFLOAT3 *positions, size_t positionStride,
+                                            size_t vertexCount);
+    static QuantizationBounds FromMeshData(const GeometryGenerator::MeshData &meshData);
+
+    // 把 [0, 1]^3 中的量化位置还原回局部空间：p = Min + q * Extent
+    DirectX::XMMATRIX XM_CALLCONV DequantizeMatrix() const;
+};
+
+// 各分量的实测最大误差，以及由量化精度推导出的理论上限
+struct VertexPackingError
+{
+    float MaxPositionError = 0.0f;
+    float PositionErrorBound = 0.0f;
+    // 法线与切线解码后与原向量的最大夹角（度）
+    float MaxNormalErrorDegrees = 0.0f;
+    float MaxTangentErrorDegrees = 0.0f;
+    float DirectionErrorBoundDegrees = 0.0f;
+    // 纹理坐标的误差相对于原值计算（半精度浮点数为 11 位有效位）
+    float MaxTexCRelativeError = 0.0f;
+    float TexCRelativeErrorBound = 0.0f;
+
+    bool WithinBounds() const
+    {
+        return MaxPositionError <= PositionErrorBound && MaxNormalErrorDegrees <= DirectionErrorBoundDegrees &&
+               MaxTangentErrorDegrees <= DirectionErrorBoundDegrees && MaxTexCRelativeError <= TexCRelativeErrorBound;
+    }
+};
+
+class VertexPacking
+{
+  public:
+    // 批量编码：每次处理 4 个顶点，法线与切线的八面体编码以 SoA 形式在 XMVECTOR 的 4 个通道上并行完成，
+    // 纹理坐标以流的形式批量转换为半精度。所有顶点使用同一个颜色
+    static void Encode(const GeometryGenerator::Vertex *src, size_t count, const QuantizationBounds &bounds,
+                       const DirectX::XMFLOAT4 &color, PackedVertex *dst);
+
+    // 与 Encode 相同，但每个顶点都有各自的颜色
+    static void Encode(const GeometryGenerator::Vertex *src, size_t count, const QuantizationBounds &bounds,
+                       const DirectX::XMFLOAT4 *colors, PackedVertex *dst);
+
+    // 批量解码。colors 可为空
+    static void Decode(const PackedVertex *src, size_t count, const QuantizationBounds &bounds,
+                       GeometryGenerator::Vertex *dst, DirectX::XMFLOAT4 *colors);
+
+    //
+    // 单个分量的编解码，与着色器中的解码方法一一对应
+    //
+
+    static DirectX::PackedVector::XMSHORTN2 XM_CALLCONV EncodeOctahedral(DirectX::FXMVECTOR direction);
+    static DirectX::XMVECTOR XM_CALLCONV DecodeOctahedral(const DirectX::PackedVector::XMSHORTN2 &encoded);
+
+    static DirectX::XMVECTOR XM_CALLCONV DecodePosition(const DirectX::PackedVector::XMUSHORTN4 &encoded,
+                                                        const QuantizationBounds &bounds);
+
+    // 校验工具：把 packed 解码后与 src 逐顶点比较，统计误差并给出理论上限，可在生成网格后用 assert 检查
+    static VertexPackingError Validate(const GeometryGenerator::Vertex *src, size_t count,
+                                       const PackedVertex *packed, const QuantizationBounds &bounds);
+};
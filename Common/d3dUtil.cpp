@@ -1,4 +1,11 @@
 #include "d3dUtil.h"
+#include "AssetPack.h"
+#include "D3DShaderCompiler.h"
+#include "MappedFile.h"
+#include "MeshFile.h"
+#include "ThreadPool.h"
+#include <atomic>
+#include <cstring>
 
 bool d3dUtil::IsKeyDown(int vkeyCode)
 {
@@ -58,72 +65,208 @@ ComPtr<ID3D12Resource> d3dUtil::CreateDefaultBuffer(ID3D12Device *device, ID3D12
 }
 
 // 加载离线编译的 Shader 字节码（.cso）
-ComPtr<ID3DBlob> d3dUtil::LoadBinary(const std::wstring &filename)
+namespace
+{
+// 内容为映射文件的 ID3DBlob：离线编译的字节码等二进制数据不经过复制直接交给 Direct3D。
+// 映射是只读的，GetBufferPointer 返回的内存不能写入
+class MappedFileBlob : public ID3DBlob
 {
-    std::ifstream fin(filename, std::ios::binary);
+  public:
+    explicit MappedFileBlob(MappedFile &&file) : mFile(std::move(file))
+    {
+    }
+
+    HRESULT STDMETHODCALLTYPE QueryInterface(REFIID riid, void **object) override
+    {
+        if (object == nullptr)
+            return E_POINTER;
+        if (riid == __uuidof(IUnknown) || riid == __uuidof(ID3D10Blob))
+        {
+            *object = static_cast<ID3DBlob *>(this);
+            AddRef();
+            return S_OK;
+        }
+        *object = nullptr;
+        return E_NOINTERFACE;
+    }
+
+    ULONG STDMETHODCALLTYPE AddRef() override
+    {
+        return ++mRefCount;
+    }
+
+    ULONG STDMETHODCALLTYPE Release() override
+    {
+        ULONG refCount = --mRefCount;
+        if (refCount == 0)
+            delete this;
+        return refCount;
+    }
+
+    LPVOID STDMETHODCALLTYPE GetBufferPointer() override
+    {
+        return const_cast<std::uint8_t *>(mFile.Data());
+    }
+
+    SIZE_T STDMETHODCALLTYPE GetBufferSize() override
+    {
+        return mFile.Size();
+    }
 
-    fin.seekg(0, std::ios_base::end);
-    std::ifstream::pos_type size = (int)fin.tellg();
-    fin.seekg(0, std::ios_base::beg);
+  private:
+    std::atomic<ULONG> mRefCount = 1;
+    MappedFile mFile;
+};
+} // namespace
+
+// 文件以内存映射的方式打开，返回的 ID3DBlob 直接引用映射的内存，不分配也不复制。文件不存在或无法映射时抛出异常
+ComPtr<ID3DBlob> d3dUtil::LoadBinary(const std::wstring &filename)
+{
+    MappedFile file;
+    if (!file.Open(filename))
+    {
+        OutputDebugStringA(("LoadBinary: " + file.Error() + "\n").c_str());
+        HRESULT hr = file.SystemError() != 0 ? HRESULT_FROM_WIN32(file.SystemError()) : E_FAIL;
+        throw DxException(hr, L"d3dUtil::LoadBinary(" + filename + L")", AnsiToWString(__FILE__), __LINE__);
+    }
 
     ComPtr<ID3DBlob> blob;
-    ThrowIfFailed(D3DCreateBlob(size, blob.GetAddressOf()));
+    blob.Attach(new MappedFileBlob(std::move(file)));
+    return blob;
+}
+
+// 资源包在返回之后可能被关闭，所以内容总是复制到新的 blob 中。资源存在但数据损坏时抛出异常
+ComPtr<ID3DBlob> d3dUtil::LoadBinary(const AssetPack &pack, const std::string &name)
+{
+    const AssetPack::Asset *asset = pack.Find(name);
+    if (asset == nullptr)
+        return nullptr;
 
-    fin.read((char *)blob->GetBufferPointer(), size);
-    fin.close();
+    std::vector<std::uint8_t> bytes;
+    if (!pack.Read(*asset, bytes))
+        throw DxException(E_FAIL, L"d3dUtil::LoadBinary(" + AnsiToWString(name) + L")", AnsiToWString(__FILE__),
+                          __LINE__);
 
+    ComPtr<ID3DBlob> blob;
+    ThrowIfFailed(D3DCreateBlob(bytes.size(), blob.GetAddressOf()));
+    std::memcpy(blob->GetBufferPointer(), bytes.data(), bytes.size());
     return blob;
 }
 
-// 运行时对着色器进行编译
-ComPtr<ID3DBlob> d3dUtil::CompileShader(const std::wstring &filename, const D3D_SHADER_MACRO *defines,
-                                        const std::string &entrypoint, const std::string &target)
+std::unique_ptr<MeshGeometry> d3dUtil::CreateMeshGeometry(ID3D12Device *device, ID3D12GraphicsCommandList *cmdList,
+                                                          const MeshFile &meshFile, const std::string &name,
+                                                          UINT vertexStream, UINT indexBuffer, bool keepCPUCopies)
 {
-    // 若处于调试模式,则使用调试标志
-    UINT compileFlags = 0;
-#if defined(DEBUG) || defined(_DEBUG)
-    compileFlags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
-#endif
-    HRESULT hr = S_OK;
-
-    ComPtr<ID3DBlob> byteCode = nullptr;
-    ComPtr<ID3DBlob> errors;
-    hr = D3DCompileFromFile(
-        // 我们希望编译的以.hlsl 作为扩展名的 HLSL 源代码文件。
-        filename.c_str(),
-        // 在本书中，我们并不使用这个高级选项，因此总是将它指定为空指针。关于此参数的详细信息可参见 SDK 文档。
-        defines,
-        // 在本书中，我们并不使用这个高级选项，因此总是将它指定为空指针。关于此参数的详细信息可参见 SDK 文档。
-        D3D_COMPILE_STANDARD_FILE_INCLUDE,
-        // 着色器的入口点函数名。一个.hlsl 文件可能存有多个着色器程序
-        // （例如，一个顶点着色器和一个像素着色器），所以我们需要为待编译的着色器指定入口点。
-        entrypoint.c_str(),
-        // 指定所用着色器类型和版本的字符串。在本书中，我们采用的着色器模型版本是 5.0 和 5.1。
-        // 可以从 msdn 与微软 GitHub 上 DirectXShaderCompiler 项目的示例及 wiki
-        // 文档中获得更多相关信息（使用该版本着色器模型有 SDK 版本与特性级别等限制）。
-        target.c_str(),
-        // 指示对着色器代码应当如何编译的标志。在 SDK 文档里，这些标志列出得不少，但是此书中我们仅用两种。
-        // a）D3DCOMPILE_DEBUG：用调试模式来编译着色器。
-        // b）D3DCOMPILE_SKIP_OPTIMIZATION：指示编译器跳过优化阶段（对调试很有用处）。
-        compileFlags,
-        // 我们不会用到处理效果文件的高级编译选项，关于它的信息请参见 SDK 文档。
-        0,
-        // 返回一个指向 ID3DBlob 数据结构的指针，它存储着编译好的着色器对象字节码。
-        &byteCode,
-        // 返回一个指向 ID3DBlob 数据结构的指针。如果在编译过程中发生了错误，它便会储存报错的字符串。
-        &errors);
+    assert(vertexStream < meshFile.VertexStreams().size());
+    assert(indexBuffer < meshFile.IndexBuffers().size());
+
+    const MeshFile::VertexStream &vertices = meshFile.VertexStreams()[vertexStream];
+    const MeshFile::IndexBuffer &indices = meshFile.IndexBuffers()[indexBuffer];
+
+    const UINT vbByteSize = (UINT)vertices.Data.size_bytes();
+    const UINT ibByteSize = (UINT)indices.Data.size_bytes();
+
+    auto geo = std::make_unique<MeshGeometry>();
+    geo->Name = name;
+
+    if (keepCPUCopies)
+    {
+        ThrowIfFailed(D3DCreateBlob(vbByteSize, &geo->VertexBufferCPU));
+        CopyMemory(geo->VertexBufferCPU->GetBufferPointer(), vertices.Data.data(), vbByteSize);
+
+        ThrowIfFailed(D3DCreateBlob(ibByteSize, &geo->IndexBufferCPU));
+        CopyMemory(geo->IndexBufferCPU->GetBufferPointer(), indices.Data.data(), ibByteSize);
+    }
+
+    // 数据由映射的文件直接复制到上传堆中
+    geo->VertexBufferGPU =
+        CreateDefaultBuffer(device, cmdList, vertices.Data.data(), vbByteSize, geo->VertexBufferUploader);
+    geo->IndexBufferGPU = CreateDefaultBuffer(device, cmdList, indices.Data.data(), ibByteSize, geo->IndexBufferUploader);
+
+    geo->VertexByteStride = vertices.ByteStride;
+    geo->VertexBufferByteSize = vbByteSize;
+    geo->IndexFormat = indices.IndexByteSize == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    geo->IndexBufferByteSize = ibByteSize;
+
+    for (const auto &submesh : meshFile.Submeshes())
+    {
+        if (submesh.VertexStream != vertexStream || submesh.IndexBuffer != indexBuffer)
+            continue;
+
+        SubmeshGeometry args;
+        args.IndexCount = submesh.IndexCount;
+        args.StartIndexLocation = submesh.StartIndexLocation;
+        args.BaseVertexLocation = submesh.BaseVertexLocation;
+        args.Bounds = submesh.Bounds;
+        geo->DrawArgs[std::string(submesh.Name)] = args;
+    }
+
+    return geo;
+}
+
+// 编译结果保存在工作目录下的 ShaderCache 目录中，退出时写入索引
+ShaderCache &d3dUtil::GetShaderCache()
+{
+    static D3DShaderCompiler compiler;
+    static ShaderCache cache(L"ShaderCache", compiler);
+    return cache;
+}
+
+namespace
+{
+ComPtr<ID3DBlob> ToBlob(const ShaderCompileResult &result)
+{
+    // 将错误与警告信息输出到调试窗口
+    if (!result.Errors.empty())
+        OutputDebugStringA(result.Errors.c_str());
+    if (!result.Succeeded)
+        ThrowIfFailed(E_FAIL);
 
     // ID3DBlob 类型描述的其实就是一段普通的内存块，这是该接口的两个方法：
     // a）LPVOID GetBufferPointer：返回指向 ID3DBlob 对象中数据的 void* 类型的指针。由此
     // 可见，在使用此数据之前务必先要将它转换为适当的类型（参考下面的示例）。
     // b）SIZE_T GetBufferSize：返回缓冲区的字节大小（即该对象中的数据大小）。
+    ComPtr<ID3DBlob> byteCode;
+    ThrowIfFailed(D3DCreateBlob(result.Bytecode.size(), byteCode.GetAddressOf()));
+    std::memcpy(byteCode->GetBufferPointer(), result.Bytecode.data(), result.Bytecode.size());
+    return byteCode;
+}
+} // namespace
 
-    // 将错误信息输出到调试窗口
-    if (errors != nullptr)
-    {
-        OutputDebugStringA((char *)errors->GetBufferPointer());
-    }
-    ThrowIfFailed(hr);
+ShaderCompileRequest d3dUtil::MakeShaderRequest(const std::wstring &filename, const D3D_SHADER_MACRO *defines,
+                                                const std::string &entrypoint, const std::string &target)
+{
+    ShaderCompileRequest request;
+    request.FileName = filename;
+    // 宏定义数组以名字为空指针的元素结尾
+    for (; defines != nullptr && defines->Name != nullptr; ++defines)
+        request.Defines.emplace_back(defines->Name, defines->Definition != nullptr ? defines->Definition : "");
+    request.EntryPoint = entrypoint;
+    request.Target = target;
 
-    return byteCode;
+    // 若处于调试模式,则使用调试标志
+    // a）D3DCOMPILE_DEBUG：用调试模式来编译着色器。
+    // b）D3DCOMPILE_SKIP_OPTIMIZATION：指示编译器跳过优化阶段（对调试很有用处）。
+#if defined(DEBUG) || defined(_DEBUG)
+    request.Flags = D3DCOMPILE_DEBUG | D3DCOMPILE_SKIP_OPTIMIZATION;
+#endif
+    return request;
+}
+
+// 运行时对着色器进行编译。编译结果按源文件（包括被包含的文件）内容、宏、入口点、目标与编译标志缓存在磁盘上，
+// 这些都没有改变时直接读取上次的字节码，不再调用编译器
+ComPtr<ID3DBlob> d3dUtil::CompileShader(const std::wstring &filename, const D3D_SHADER_MACRO *defines,
+                                        const std::string &entrypoint, const std::string &target)
+{
+    return ToBlob(GetShaderCache().GetOrCompile(MakeShaderRequest(filename, defines, entrypoint, target)));
+}
+
+std::vector<ComPtr<ID3DBlob>> d3dUtil::CompileShaders(const std::vector<ShaderCompileRequest> &requests)
+{
+    std::vector<ShaderCompileResult> results = GetShaderCache().GetOrCompileAll(requests, ThreadPool::Default());
+
+    std::vector<ComPtr<ID3DBlob>> byteCodes;
+    for (const ShaderCompileResult &result : results)
+        byteCodes.push_back(ToBlob(result));
+    return byteCodes;
 }
@@ -2,6 +2,7 @@
 
 //#include "DDSTextureLoader.h"
 //#include "MathHelper.h"
+#include "ShaderCache.h"
 #include "DXTrace.h"
 #include "d3dx12.h"
 #include "MathHelper.h"
@@ -59,6 +60,10 @@ using ComPtr = Microsoft::WRL::ComPtr<T>;
 #endif
     */
 
+class AssetPack;
+class MeshFile;
+struct MeshGeometry;
+
 class d3dUtil
 {
   public:
@@ -81,14 +86,35 @@ class d3dUtil
         return (byteSize + 255) & ~255;
     }
 
+    // 以内存映射的方式加载二进制文件（例如离线编译的 .cso），返回的 blob 不复制文件内容
     static Microsoft::WRL::ComPtr<ID3DBlob> LoadBinary(const std::wstring &filename);
+    // 从资源包中读取二进制资源，压缩的资源在这里解压。包中没有这个资源时返回空指针，以便调用者改用散放的文件
+    static Microsoft::WRL::ComPtr<ID3DBlob> LoadBinary(const AssetPack &pack, const std::string &name);
 
     static Microsoft::WRL::ComPtr<ID3D12Resource> CreateDefaultBuffer(
         ID3D12Device *device, ID3D12GraphicsCommandList *cmdList, const void *initData, UINT64 byteSize,
         Microsoft::WRL::ComPtr<ID3D12Resource> &uploadBuffer);
 
+    // 由 .mesh 文件中的一个顶点流与一个索引缓冲区创建 MeshGeometry，引用它们的子网格都加入 DrawArgs。
+    // 数据直接从文件映射上传，只有 keepCPUCopies 为 true 时才会额外保留 VertexBufferCPU/IndexBufferCPU。
+    // 与 CreateDefaultBuffer 相同，返回的几何体中的上传缓冲区要等到复制命令执行完毕后才能释放
+    static std::unique_ptr<MeshGeometry> CreateMeshGeometry(ID3D12Device *device, ID3D12GraphicsCommandList *cmdList,
+                                                            const MeshFile &meshFile, const std::string &name,
+                                                            UINT vertexStream = 0, UINT indexBuffer = 0,
+                                                            bool keepCPUCopies = false);
+
     static Microsoft::WRL::ComPtr<ID3DBlob> CompileShader(const std::wstring &filename, const D3D_SHADER_MACRO *defines,
                                                           const std::string &entrypoint, const std::string &target);
+
+    // 描述一次 CompileShader 调用，编译标志与 CompileShader 相同
+    static ShaderCompileRequest MakeShaderRequest(const std::wstring &filename, const D3D_SHADER_MACRO *defines,
+                                                  const std::string &entrypoint, const std::string &target);
+    // 一次编译多个着色器：先查找缓存，未命中的着色器在线程池中并行编译。结果与 requests 一一对应
+    static std::vector<Microsoft::WRL::ComPtr<ID3DBlob>> CompileShaders(
+        const std::vector<ShaderCompileRequest> &requests);
+
+    // CompileShader/CompileShaders 所用的着色器缓存（工作目录下的 ShaderCache 目录），着色器热重载也经由它编译
+    static ShaderCache &GetShaderCache();
 };
 
 // 利用 SubmeshGeometry 来定义 MeshGeometry 中存储的单个几何体
@@ -115,6 +141,8 @@ struct MeshGeometry
 
     // 系统内存中的副本。由于顶点/索引可以是泛型格式（具体格式依用户而定），所以用 Blob 类型来表示
     // 待用户在使用时再将其转换为适当的类型
+    // 副本是可选的：只有需要在 CPU 端读取几何数据（如拾取、碰撞检测）时才创建，否则保持为空，
+    // 以免整个运行期间都在系统内存中多留一份全部几何数据
     ComPtr<ID3DBlob> VertexBufferCPU = nullptr;
     ComPtr<ID3DBlob> IndexBufferCPU = nullptr;
 
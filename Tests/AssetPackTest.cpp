@@ -0,0 +1,217 @@
+#include "AssetPack.h"
+#include "Check.h"
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+namespace fs = std::filesystem;
+
+std::vector<std::uint8_t> MakeText(size_t size)
+{
+    const std::string line = "float4 PS(VertexOut pin) : SV_Target { return pin.Color; }\n";
+    std::vector<std::uint8_t> bytes(size);
+    for (size_t i = 0; i < size; ++i)
+        bytes[i] = static_cast<std::uint8_t>(line[i % line.size()]);
+    return bytes;
+}
+
+// 线性同余生成的数据几乎不可压缩
+std::vector<std::uint8_t> MakeNoise(size_t size)
+{
+    std::vector<std::uint8_t> bytes(size);
+    std::uint32_t state = 12345;
+    for (std::uint8_t &byte : bytes)
+    {
+        state = state * 1664525u + 1013904223u;
+        byte = static_cast<std::uint8_t>(state >> 24);
+    }
+    return bytes;
+}
+
+bool ReadEquals(const AssetPack &pack, const std::string &name, const std::vector<std::uint8_t> &expected)
+{
+    const AssetPack::Asset *asset = pack.Find(name);
+    std::vector<std::uint8_t> bytes;
+    return asset != nullptr && asset->Size == expected.size() && pack.Read(*asset, bytes) && bytes == expected;
+}
+
+void TestRoundTrip()
+{
+    // 跨越多个块的可压缩数据、不可压缩数据与空资源
+    const std::vector<std::uint8_t> text = MakeText(3 * AssetPack::BlockSize + 123);
+    const std::vector<std::uint8_t> noise = MakeNoise(AssetPack::BlockSize + 7);
+
+    AssetPackWriter writer;
+    writer.AddAsset("Shaders\\color.hlsl", text.data(), text.size(), true);
+    writer.AddAsset("Shaders/noise.bin", noise.data(), noise.size(), true);
+    writer.AddAsset("empty", nullptr, 0, true);
+    writer.AddAsset("stored.hlsl", text.data(), 100, false);
+    // 同名资源替换之前的资源
+    writer.AddAsset("empty", nullptr, 0, false);
+    CHECK(writer.AssetCount() == 4);
+
+    const std::vector<std::uint8_t> bytes = writer.Serialize();
+    AssetPack pack;
+    CHECK(pack.Parse(bytes));
+    CHECK(pack.Assets().size() == 4);
+
+    CHECK(ReadEquals(pack, "Shaders/color.hlsl", text));
+    CHECK(ReadEquals(pack, "Shaders\\color.hlsl", text));
+    CHECK(ReadEquals(pack, "Shaders/noise.bin", noise));
+    CHECK(ReadEquals(pack, "empty", {}));
+    CHECK(ReadEquals(pack, "stored.hlsl", std::vector<std::uint8_t>(text.begin(), text.begin() + 100)));
+    CHECK(pack.Find("missing") == nullptr);
+    CHECK(pack.Find("shaders/color.hlsl") == nullptr);
+
+    // 压缩过的资源需要 Read，不可压缩与未要求压缩的资源可以零复制访问
+    const AssetPack::Asset *compressed = pack.Find("Shaders/color.hlsl");
+    CHECK(compressed->Method == AssetPack::Compression::Lz4Blocks);
+    CHECK(compressed->Data.size() < text.size());
+    CHECK(pack.View(*compressed).empty());
+    const AssetPack::Asset *raw = pack.Find("Shaders/noise.bin");
+    CHECK(raw->Method == AssetPack::Compression::None);
+    CHECK(pack.View(*raw).size() == noise.size() &&
+          std::memcmp(pack.View(*raw).data(), noise.data(), noise.size()) == 0);
+    CHECK(reinterpret_cast<std::uintptr_t>(pack.View(*raw).data()) % AssetPack::DataAlignment == 0);
+
+    // 同样的输入总是生成同样的文件
+    CHECK(writer.Serialize() == bytes);
+
+    // 写入文件之后映射打开
+    const fs::path file = fs::temp_directory_path() / "AssetPackTest.pack";
+    CHECK(writer.Write(file.wstring()));
+    AssetPack mapped;
+    CHECK(mapped.Open(file.wstring()));
+    CHECK(ReadEquals(mapped, "Shaders/color.hlsl", text));
+    CHECK(ReadEquals(mapped, "Shaders/noise.bin", noise));
+    mapped.Prefetch(*mapped.Find("Shaders/noise.bin"));
+    mapped.Close();
+    CHECK(mapped.Find("Shaders/color.hlsl") == nullptr);
+    fs::remove(file);
+
+    CHECK(!mapped.Open((fs::temp_directory_path() / "AssetPackTest.missing").wstring()));
+    CHECK(!mapped.Error().empty());
+}
+
+void TestAddDirectory()
+{
+    const fs::path directory = fs::temp_directory_path() / "AssetPackTest";
+    fs::remove_all(directory);
+    fs::create_directories(directory / "Shaders");
+    const std::vector<std::uint8_t> text = MakeText(1000);
+    std::ofstream(directory / "Shaders" / "color.hlsl", std::ios::binary)
+        .write(reinterpret_cast<const char *>(text.data()), static_cast<std::streamsize>(text.size()));
+    AssetPackWriter writer;
+    std::string error;
+    CHECK(writer.AddDirectory(directory.wstring(), true, error));
+
+    AssetPack pack;
+    const std::vector<std::uint8_t> bytes = writer.Serialize();
+    CHECK(pack.Parse(bytes));
+    CHECK(pack.Assets().size() == 1);
+    CHECK(ReadEquals(pack, "Shaders/color.hlsl", text));
+    fs::remove_all(directory);
+
+    CHECK(!writer.AddDirectory(directory.wstring(), true, error));
+    CHECK(!error.empty());
+}
+
+// 在序列化结果的 offset 处写入 value
+template <typename T>
+void Patch(std::vector<std::uint8_t> &bytes, size_t offset, T value)
+{
+    std::memcpy(bytes.data() + offset, &value, sizeof(T));
+}
+
+void TestCorruption()
+{
+    const std::vector<std::uint8_t> text = MakeText(2 * AssetPack::BlockSize);
+    AssetPackWriter writer;
+    writer.AddAsset("color.hlsl", text.data(), text.size(), true);
+    const std::vector<std::uint8_t> good = writer.Serialize();
+    const size_t entry = sizeof(AssetPackHeader);
+
+    AssetPack pack;
+    std::vector<std::uint8_t> bytes = good;
+    Patch(bytes, offsetof(AssetPackHeader, Magic), std::uint32_t(0));
+    CHECK(!pack.Parse(bytes));
+    CHECK(!pack.Error().empty());
+
+    bytes = good;
+    Patch(bytes, offsetof(AssetPackHeader, Version), AssetPack::CurrentVersion + 1);
+    CHECK(!pack.Parse(bytes));
+
+    // 截断的文件与文件头中的大小不一致
+    bytes.assign(good.begin(), good.end() - 1);
+    CHECK(!pack.Parse(bytes));
+    bytes.assign(good.begin(), good.begin() + sizeof(AssetPackHeader) - 1);
+    CHECK(!pack.Parse(bytes));
+
+    bytes = good;
+    Patch(bytes, offsetof(AssetPackHeader, SlotCount), std::uint32_t(3));
+    CHECK(!pack.Parse(bytes));
+
+    bytes = good;
+    Patch(bytes, entry + offsetof(AssetPackEntry, DataOffset), std::uint64_t(good.size()));
+    CHECK(!pack.Parse(bytes));
+
+    bytes = good;
+    Patch(bytes, entry + offsetof(AssetPackEntry, NameLength), std::uint32_t(1000));
+    CHECK(!pack.Parse(bytes));
+
+    bytes = good;
+    Patch(bytes, entry + offsetof(AssetPackEntry, Compression), std::uint32_t(7));
+    CHECK(!pack.Parse(bytes));
+
+    // 解析成功但块大小表损坏：Read 返回 false，不越界访问
+    CHECK(pack.Parse(good));
+    std::uint64_t dataOffset = 0;
+    std::memcpy(&dataOffset, good.data() + entry + offsetof(AssetPackEntry, DataOffset), sizeof(dataOffset));
+    bytes = good;
+    Patch(bytes, static_cast<size_t>(dataOffset), std::uint32_t(0x7fffffff));
+    CHECK(pack.Parse(bytes));
+    std::vector<std::uint8_t> contents;
+    CHECK(!pack.Read(pack.Assets()[0], contents));
+
+    bytes = good;
+    Patch(bytes, static_cast<size_t>(dataOffset), std::uint32_t(AssetPack::BlockSize | AssetPack::RawBlockFlag));
+    CHECK(pack.Parse(bytes));
+    CHECK(!pack.Read(pack.Assets()[0], contents));
+
+    // 逐字节翻转一个小资源包：无论哪个字节损坏，Parse、Find 与 Read 都不能越界或崩溃
+    AssetPackWriter small;
+    const std::vector<std::uint8_t> smallText = MakeText(300);
+    small.AddAsset("a.hlsl", smallText.data(), smallText.size(), true);
+    small.AddAsset("b.bin", smallText.data(), 40, false);
+    small.AddAsset("dir/c", nullptr, 0, false);
+    const std::vector<std::uint8_t> smallGood = small.Serialize();
+    size_t parsed = 0;
+    for (size_t i = 0; i < smallGood.size(); ++i)
+    {
+        bytes = smallGood;
+        bytes[i] ^= 0xa5;
+        if (!pack.Parse(bytes))
+            continue;
+        ++parsed;
+        for (const char *name : {"a.hlsl", "b.bin", "dir/c"})
+            pack.Find(name);
+        for (const AssetPack::Asset &asset : pack.Assets())
+            pack.Read(asset, contents);
+    }
+    // 数据段中的字节损坏不会被 Parse 发现
+    CHECK(parsed > 0);
+}
+} // namespace
+
+int main()
+{
+    TestRoundTrip();
+    TestAddDirectory();
+    TestCorruption();
+    return CheckResult();
+}
@@ -0,0 +1,187 @@
+#include "AsyncObjectCache.h"
+#include "Check.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+using Cache = AsyncObjectCache<std::string>;
+
+// 阻塞线程池的工作线程，直到 Open 被调用，用来让提交的任务排在队列里
+struct Gate
+{
+    std::promise<void> Promise;
+    std::shared_future<void> Future = Promise.get_future().share();
+
+    void Open()
+    {
+        Promise.set_value();
+    }
+};
+
+void TestSynchronous()
+{
+    Cache cache(nullptr);
+    int calls = 0;
+    auto create = [&calls]() {
+        ++calls;
+        return std::string("pso");
+    };
+
+    CHECK(cache.GetState(1) == Cache::State::Missing);
+    CHECK(cache.GetOrCreate(1, create) == "pso");
+    CHECK(cache.GetOrCreate(1, create) == "pso");
+    CHECK(calls == 1);
+    CHECK(cache.GetState(1) == Cache::State::Ready);
+
+    // 失败的键被记住：同步请求重新抛出，异步请求返回替代对象，都不会重试
+    auto fail = [&calls]() -> std::string {
+        ++calls;
+        throw std::runtime_error("compile error");
+    };
+    CHECK_THROWS(cache.GetOrCreate(2, fail), std::runtime_error);
+    CHECK_THROWS(cache.GetOrCreate(2, fail), std::runtime_error);
+    CHECK(cache.GetOrCreateAsync(2, fail, "fallback") == "fallback");
+    CHECK(calls == 2);
+    CHECK(cache.GetState(2) == Cache::State::Failed);
+
+    // 没有线程池时异步请求同步创建
+    CHECK(cache.GetOrCreateAsync(3, create, "fallback") == "pso");
+
+    const Cache::Statistics stats = cache.GetStatistics();
+    CHECK(stats.Requests == 6);
+    CHECK(stats.Misses == 3);
+    CHECK(stats.Hits == 1);
+    CHECK(stats.Created == 2);
+    CHECK(stats.Failed == 1);
+}
+
+void TestAsynchronous()
+{
+    ThreadPool threadPool(2);
+    Cache cache(&threadPool);
+    Gate gate;
+    std::atomic<int> calls{0};
+    auto create = [&]() {
+        gate.Future.wait();
+        ++calls;
+        return std::string("pso");
+    };
+
+    // 对象就绪之前一直返回替代对象，并且只创建一次
+    CHECK(cache.GetOrCreateAsync(1, create, "fallback") == "fallback");
+    CHECK(cache.GetOrCreateAsync(1, create, "fallback") == "fallback");
+    CHECK(cache.Find(1, "fallback") == "fallback");
+
+    gate.Open();
+    cache.WaitIdle();
+    CHECK(cache.GetOrCreateAsync(1, create, "fallback") == "pso");
+    CHECK(cache.Find(1, "fallback") == "pso");
+    CHECK(calls == 1);
+    CHECK(cache.GetStatistics().FallbackUses == 2);
+}
+
+// 多个线程同时请求同一批键，每个键只创建一次
+void TestConcurrentRequests()
+{
+    ThreadPool threadPool(3);
+    Cache cache(&threadPool);
+    std::atomic<int> calls{0};
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t)
+    {
+        threads.emplace_back([&cache, &calls, t]() {
+            for (Cache::uint64 key = 0; key < 64; ++key)
+            {
+                auto create = [&calls, key]() {
+                    ++calls;
+                    return std::to_string(key);
+                };
+                if ((key + t) % 2 == 0)
+                    CHECK(cache.GetOrCreate(key, create) == std::to_string(key));
+                else
+                    cache.GetOrCreateAsync(key, create, "");
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+    cache.WaitIdle();
+
+    CHECK(calls == 64);
+    CHECK(cache.Size() == 64);
+    for (Cache::uint64 key = 0; key < 64; ++key)
+        CHECK(cache.Find(key, "") == std::to_string(key));
+}
+
+// 单个工作线程上的任务先异步请求一个键，再同步请求同一个键：异步任务排在当前任务之后，
+// 同步请求必须直接执行它而不是等待，否则永远不会返回
+void TestSynchronousRequestOnWorkerDoesNotDeadlock()
+{
+    ThreadPool threadPool(1);
+    Cache cache(&threadPool);
+    int calls = 0;
+    auto create = [&calls]() {
+        ++calls;
+        return std::string("pso");
+    };
+
+    std::future<std::string> result = threadPool.Submit([&]() {
+        cache.GetOrCreateAsync(7, create, "fallback");
+        return cache.GetOrCreate(7, create);
+    });
+
+    if (result.wait_for(std::chrono::seconds(10)) != std::future_status::ready)
+    {
+        std::fprintf(stderr, "GetOrCreate deadlocked on a queued asynchronous task\n");
+        std::_Exit(1);
+    }
+    CHECK(result.get() == "pso");
+    CHECK(calls == 1);
+    cache.WaitIdle();
+    CHECK(calls == 1);
+}
+
+// 异步任务被同步请求抢先执行之后缓存就析构了，排在线程池中的任务不能再访问它
+void TestQueuedTaskOutlivesCache()
+{
+    ThreadPool threadPool(1);
+    Gate gate;
+    threadPool.Submit([&gate]() { gate.Future.wait(); });
+
+    int calls = 0;
+    {
+        Cache cache(&threadPool);
+        auto create = [&calls]() {
+            ++calls;
+            return std::string("pso");
+        };
+        CHECK(cache.GetOrCreateAsync(1, create, "fallback") == "fallback");
+        CHECK(cache.GetOrCreateAsync(2, create, "fallback") == "fallback");
+        CHECK(cache.GetOrCreate(1, create) == "pso");
+        // 析构时 WaitIdle 在调用线程上执行键 2 的任务，不必等被阻塞的工作线程
+    }
+    CHECK(calls == 2);
+
+    gate.Open();
+    threadPool.Submit([]() {}).wait();
+    CHECK(calls == 2);
+}
+} // namespace
+
+int main()
+{
+    TestSynchronous();
+    TestAsynchronous();
+    TestConcurrentRequests();
+    TestSynchronousRequestOnWorkerDoesNotDeadlock();
+    TestQueuedTaskOutlivesCache();
+    return CheckResult();
+}
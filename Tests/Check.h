@@ -0,0 +1,60 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+// 测试用的极简断言：失败时打印位置并计数，不中断后续检查。
+// 每个测试程序在 main 的末尾 return CheckResult()，失败数不为 0 时 ctest 判定为失败。可以在多个线程中使用
+inline std::atomic<int> &CheckFailureCount()
+{
+    static std::atomic<int> failures{0};
+    return failures;
+}
+
+#define CHECK(expr)                                                                                                    \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if (!(expr))                                                                                                   \
+        {                                                                                                              \
+            std::fprintf(stderr, "%s(%d): CHECK(%s) failed\n", __FILE__, __LINE__, #expr);                             \
+            ++CheckFailureCount();                                                                                     \
+        }                                                                                                              \
+    } while (false)
+
+// expr 必须抛出 type 类型的异常
+#define CHECK_THROWS(expr, type)                                                                                       \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        bool thrown__ = false;                                                                                         \
+        try                                                                                                            \
+        {                                                                                                              \
+            expr;                                                                                                      \
+        }                                                                                                              \
+        catch (const type &)                                                                                           \
+        {                                                                                                              \
+            thrown__ = true;                                                                                           \
+        }                                                                                                              \
+        if (!thrown__)                                                                                                 \
+        {                                                                                                              \
+            std::fprintf(stderr, "%s(%d): CHECK_THROWS(%s, %s) failed\n", __FILE__, __LINE__, #expr, #type);           \
+            ++CheckFailureCount();                                                                                     \
+        }                                                                                                              \
+    } while (false)
+
+inline int CheckResult()
+{
+    if (CheckFailureCount() != 0)
+        std::fprintf(stderr, "%d check(s) failed\n", CheckFailureCount().load());
+    return CheckFailureCount() == 0 ? 0 : 1;
+}
+
+// 基准测试只打印耗时，不参与判定：测试机的负载不可控，以耗时作为断言只会带来偶发的失败
+template <typename Function>
+void Benchmark(const char *name, unsigned long long operations, Function &&function)
+{
+    const auto begin = std::chrono::steady_clock::now();
+    function();
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count();
+    std::printf("[benchmark] %s: %.3f ms, %.1f ns/op\n", name, ms, operations == 0 ? 0.0 : ms * 1e6 / operations);
+}
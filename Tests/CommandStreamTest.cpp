@@ -0,0 +1,442 @@
+#include "Check.h"
+#include "NullCommandBackend.h"
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+using uint32 = CommandStream::uint32;
+using uint64 = CommandStream::uint64;
+
+int gPipelineState, gRootSignature, gTexture, gBuffer, gUpload;
+
+// 每种命令各编码一个，参数各不相同
+void EncodeAll(CommandStream &stream)
+{
+    const float color[4] = {0.1f, 0.2f, 0.3f, 1.0f};
+    stream.SetViewport(1.0f, 2.0f, 800.0f, 600.0f, 0.0f, 1.0f);
+    stream.SetScissorRect(3, 4, 800, 600);
+    stream.SetPipelineState(&gPipelineState);
+    stream.SetGraphicsRootSignature(&gRootSignature);
+    stream.SetGraphicsRootConstantBufferView(2, 0x10000);
+    stream.SetVertexBuffer(1, 0x20000, 4096, 32);
+    stream.SetIndexBuffer(0x30000, 1024, 57);
+    stream.SetPrimitiveTopology(4);
+    stream.SetRenderTarget(0x40, 0x80);
+    stream.ClearRenderTargetView(0x40, color);
+    stream.ClearDepthStencilView(0x80, 3, 1.0f, 7);
+    stream.TransitionBarrier(&gTexture, 0x4, 0x80, 5);
+    stream.AliasingBarrier(&gBuffer, &gTexture);
+    stream.CopyBufferRegion(&gBuffer, 64, &gUpload, 128, 256);
+    stream.DrawIndexedInstanced(36, 2, 6, -3, 1);
+}
+
+// 逐个检查 EncodeAll 写入的参数，返回访问到的命令数
+uint32 VerifyAll(const CommandStream &stream)
+{
+    uint32 index = 0;
+    stream.ForEach([&index](CommandType type, const void *payload) {
+        CHECK(static_cast<uint32>(type) == index);
+        switch (type)
+        {
+        case CommandType::SetViewport: {
+            const auto *cmd = static_cast<const CmdSetViewport *>(payload);
+            CHECK(cmd->TopLeftX == 1.0f && cmd->TopLeftY == 2.0f && cmd->Width == 800.0f && cmd->Height == 600.0f);
+            CHECK(cmd->MinDepth == 0.0f && cmd->MaxDepth == 1.0f);
+            break;
+        }
+        case CommandType::SetScissorRect: {
+            const auto *cmd = static_cast<const CmdSetScissorRect *>(payload);
+            CHECK(cmd->Left == 3 && cmd->Top == 4 && cmd->Right == 800 && cmd->Bottom == 600);
+            break;
+        }
+        case CommandType::SetPipelineState:
+            CHECK(static_cast<const CmdSetPipelineState *>(payload)->PipelineState == &gPipelineState);
+            break;
+        case CommandType::SetGraphicsRootSignature:
+            CHECK(static_cast<const CmdSetGraphicsRootSignature *>(payload)->RootSignature == &gRootSignature);
+            break;
+        case CommandType::SetGraphicsRootConstantBufferView: {
+            const auto *cmd = static_cast<const CmdSetGraphicsRootConstantBufferView *>(payload);
+            CHECK(cmd->RootParameterIndex == 2 && cmd->BufferLocation == 0x10000);
+            break;
+        }
+        case CommandType::SetVertexBuffer: {
+            const auto *cmd = static_cast<const CmdSetVertexBuffer *>(payload);
+            CHECK(cmd->Slot == 1 && cmd->BufferLocation == 0x20000);
+            CHECK(cmd->SizeInBytes == 4096 && cmd->StrideInBytes == 32);
+            break;
+        }
+        case CommandType::SetIndexBuffer: {
+            const auto *cmd = static_cast<const CmdSetIndexBuffer *>(payload);
+            CHECK(cmd->BufferLocation == 0x30000 && cmd->SizeInBytes == 1024 && cmd->Format == 57);
+            break;
+        }
+        case CommandType::SetPrimitiveTopology:
+            CHECK(static_cast<const CmdSetPrimitiveTopology *>(payload)->Topology == 4);
+            break;
+        case CommandType::SetRenderTarget: {
+            const auto *cmd = static_cast<const CmdSetRenderTarget *>(payload);
+            CHECK(cmd->RenderTargetView == 0x40 && cmd->DepthStencilView == 0x80);
+            break;
+        }
+        case CommandType::ClearRenderTargetView: {
+            const auto *cmd = static_cast<const CmdClearRenderTargetView *>(payload);
+            const float color[4] = {0.1f, 0.2f, 0.3f, 1.0f};
+            CHECK(cmd->RenderTargetView == 0x40 && std::memcmp(cmd->Color, color, sizeof(color)) == 0);
+            break;
+        }
+        case CommandType::ClearDepthStencilView: {
+            const auto *cmd = static_cast<const CmdClearDepthStencilView *>(payload);
+            CHECK(cmd->DepthStencilView == 0x80 && cmd->Flags == 3 && cmd->Depth == 1.0f && cmd->Stencil == 7);
+            break;
+        }
+        case CommandType::TransitionBarrier: {
+            const auto *cmd = static_cast<const CmdTransitionBarrier *>(payload);
+            CHECK(cmd->Resource == &gTexture && cmd->StateBefore == 0x4 && cmd->StateAfter == 0x80);
+            CHECK(cmd->Subresource == 5);
+            break;
+        }
+        case CommandType::AliasingBarrier: {
+            const auto *cmd = static_cast<const CmdAliasingBarrier *>(payload);
+            CHECK(cmd->ResourceBefore == &gBuffer && cmd->ResourceAfter == &gTexture);
+            break;
+        }
+        case CommandType::CopyBufferRegion: {
+            const auto *cmd = static_cast<const CmdCopyBufferRegion *>(payload);
+            CHECK(cmd->DestinationBuffer == &gBuffer && cmd->DestinationOffset == 64);
+            CHECK(cmd->SourceBuffer == &gUpload && cmd->SourceOffset == 128 && cmd->NumBytes == 256);
+            break;
+        }
+        case CommandType::DrawIndexedInstanced: {
+            const auto *cmd = static_cast<const CmdDrawIndexedInstanced *>(payload);
+            CHECK(cmd->IndexCountPerInstance == 36 && cmd->InstanceCount == 2 && cmd->StartIndexLocation == 6);
+            CHECK(cmd->BaseVertexLocation == -3 && cmd->StartInstanceLocation == 1);
+            break;
+        }
+        default:
+            CHECK(false);
+            break;
+        }
+        ++index;
+    });
+    return index;
+}
+
+// 包头与参数都按 8 字节对齐，包的大小之和等于命令流的字节数
+void CheckPacketLayout(const CommandStream &stream)
+{
+    size_t offset = 0;
+    uint32 count = 0;
+    while (offset < stream.ByteSize())
+    {
+        const auto *header = reinterpret_cast<const CommandPacketHeader *>(stream.Data() + offset);
+        CHECK(reinterpret_cast<std::uintptr_t>(header) % CommandStream::PacketAlignment == 0);
+        CHECK(header->Size % CommandStream::PacketAlignment == 0);
+        CHECK(header->Size > sizeof(CommandPacketHeader));
+        CHECK(header->Reserved == 0);
+        offset += header->Size;
+        ++count;
+    }
+    CHECK(offset == stream.ByteSize());
+    CHECK(count == stream.CommandCount());
+}
+
+void TestRoundTrip()
+{
+    CommandStream stream;
+    EncodeAll(stream);
+    CHECK(stream.CommandCount() == static_cast<uint32>(CommandType::Count));
+    CHECK(VerifyAll(stream) == static_cast<uint32>(CommandType::Count));
+    CheckPacketLayout(stream);
+
+    stream.ForEach([](CommandType, const void *payload) {
+        CHECK(reinterpret_cast<std::uintptr_t>(payload) % CommandStream::PacketAlignment == 0);
+    });
+}
+
+// 写满初始的内存后自动扩容，已写入的命令不变；Reset 保留扩容后的内存，再次写入同样多的命令时不再分配
+void TestGrowthAcrossReset()
+{
+    CommandStream stream(0);
+    const int repeat = 100;
+    for (int i = 0; i < repeat; ++i)
+        EncodeAll(stream);
+    CHECK(stream.CommandCount() == repeat * static_cast<uint32>(CommandType::Count));
+    CheckPacketLayout(stream);
+
+    uint32 draws = 0;
+    stream.ForEach([&draws](CommandType type, const void *) { draws += type == CommandType::DrawIndexedInstanced; });
+    CHECK(draws == repeat);
+
+    const size_t byteSize = stream.ByteSize();
+    const std::uint8_t *data = stream.Data();
+    stream.Reset();
+    CHECK(stream.ByteSize() == 0 && stream.CommandCount() == 0);
+    uint32 visited = 0;
+    stream.ForEach([&visited](CommandType, const void *) { ++visited; });
+    CHECK(visited == 0);
+
+    for (int i = 0; i < repeat; ++i)
+        EncodeAll(stream);
+    CHECK(stream.Data() == data);
+    CHECK(stream.ByteSize() == byteSize);
+
+    // Reset 之后旧的命令不会残留
+    stream.Reset();
+    EncodeAll(stream);
+    CHECK(VerifyAll(stream) == static_cast<uint32>(CommandType::Count));
+}
+
+// 绘制之前设置好全部绑定
+void BindAll(CommandStream &stream)
+{
+    stream.SetGraphicsRootSignature(&gRootSignature);
+    stream.SetPipelineState(&gPipelineState);
+    stream.SetVertexBuffer(0, 0x20000, 4096, 32);
+    stream.SetIndexBuffer(0x30000, 1024, 57);
+    stream.SetPrimitiveTopology(4);
+    stream.SetRenderTarget(0x40, 0x80);
+}
+
+bool Contains(const std::string &text, const char *part)
+{
+    return text.find(part) != std::string::npos;
+}
+
+void TestNullBackendValidation()
+{
+    // 合法的命令流：统计绘制、实例与索引数
+    {
+        CommandStream stream;
+        BindAll(stream);
+        stream.DrawIndexedInstanced(36, 1, 0, 0, 0);
+        stream.DrawIndexedInstanced(6, 4, 36, 8, 0);
+
+        NullCommandBackend backend;
+        backend.Execute(stream);
+        const NullCommandBackend::Statistics &stats = backend.GetStatistics();
+        CHECK(stats.ErrorCount == 0 && backend.GetFirstError().empty());
+        CHECK(stats.DrawCount == 2 && stats.InstanceCount == 5 && stats.IndexCount == 36 + 24);
+        CHECK(backend.GetCommandCount(CommandType::DrawIndexedInstanced) == 2);
+        CHECK(stats.ByteSize == stream.ByteSize());
+    }
+
+    // 缺少根签名、顶点缓冲区或渲染目标的绘制
+    struct Case
+    {
+        bool RootSignature;
+        bool VertexBuffer;
+        bool RenderTarget;
+        const char *Error;
+    };
+    const Case cases[] = {{false, true, true, "no root signature"},
+                          {true, false, true, "no vertex buffer"},
+                          {true, true, false, "no render target"}};
+    for (const Case &c : cases)
+    {
+        CommandStream stream;
+        if (c.RootSignature)
+            stream.SetGraphicsRootSignature(&gRootSignature);
+        if (c.VertexBuffer)
+            stream.SetVertexBuffer(0, 0x20000, 4096, 32);
+        stream.SetIndexBuffer(0x30000, 1024, 57);
+        stream.SetPrimitiveTopology(4);
+        if (c.RenderTarget)
+            stream.SetRenderTarget(0x40, 0);
+        stream.DrawIndexedInstanced(3, 1, 0, 0, 0);
+        stream.DrawIndexedInstanced(3, 1, 3, 0, 0);
+
+        NullCommandBackend backend;
+        backend.Execute(stream);
+        CHECK(backend.GetStatistics().ErrorCount == 2);
+        CHECK(Contains(backend.GetFirstError(), c.Error));
+        // 出错的绘制同样计数
+        CHECK(backend.GetStatistics().DrawCount == 2 && backend.GetStatistics().IndexCount == 6);
+    }
+
+    // 绑定状态不会延续到下一个命令流
+    {
+        CommandStream bind, draw;
+        BindAll(bind);
+        draw.DrawIndexedInstanced(3, 1, 0, 0, 0);
+        NullCommandBackend backend;
+        backend.Execute(bind);
+        backend.Execute(draw);
+        CHECK(backend.GetStatistics().ErrorCount == 1);
+    }
+
+    // 屏障的 StateBefore 与资源当前的状态不符
+    {
+        NullCommandBackend backend;
+        backend.SetResourceState(&gTexture, 0x4);
+        CommandStream stream;
+        stream.TransitionBarrier(&gTexture, 0x80, 0x400);
+        backend.Execute(stream);
+        CHECK(backend.GetStatistics().ErrorCount == 1);
+        CHECK(Contains(backend.GetFirstError(), "does not match"));
+        // 出错之后与 GPU 一样按 StateAfter 继续
+        uint32 state = 0;
+        CHECK(backend.GetResourceState(&gTexture, 0, state) && state == 0x400);
+
+        // 前后状态相同的屏障与空资源，都不改变记录的状态
+        backend.ResetStatistics();
+        stream.Reset();
+        stream.TransitionBarrier(&gTexture, 0x4, 0x4);
+        stream.TransitionBarrier(nullptr, 0x4, 0x80);
+        backend.Execute(stream);
+        CHECK(backend.GetStatistics().ErrorCount == 2);
+
+        // 状态相符的屏障之后，资源处于 StateAfter
+        backend.ResetStatistics();
+        stream.Reset();
+        stream.TransitionBarrier(&gTexture, 0x400, 0x80);
+        stream.TransitionBarrier(&gTexture, 0x80, 0x4);
+        backend.Execute(stream);
+        CHECK(backend.GetStatistics().ErrorCount == 0);
+        CHECK(backend.GetResourceState(&gTexture, 0, state) && state == 0x4);
+    }
+}
+
+// 连续的屏障合并为一次调用，超过 MaxBarriersPerBatch 个时拆成多次
+void TestBarrierBatches()
+{
+    std::vector<int> resources(40);
+    CommandStream stream;
+    stream.TransitionBarrier(&gTexture, 0x4, 0x80);
+    stream.AliasingBarrier(nullptr, &gBuffer);
+    BindAll(stream);
+    for (int &resource : resources)
+        stream.TransitionBarrier(&resource, 0x0, 0x400);
+    stream.CopyBufferRegion(&gBuffer, 0, &gUpload, 0, 16);
+    stream.TransitionBarrier(&gTexture, 0x80, 0x4);
+
+    NullCommandBackend backend;
+    backend.Execute(stream);
+    const uint32 limit = CommandStream::MaxBarriersPerBatch;
+    CHECK(backend.GetStatistics().ErrorCount == 0);
+    CHECK(backend.GetStatistics().BarrierBatchCount == 1 + (resources.size() + limit - 1) / limit + 1);
+}
+
+// 以虚函数逐条记录命令的接口，相当于直接调用 ID3D12GraphicsCommandList
+class CommandRecorder
+{
+  public:
+    virtual ~CommandRecorder() = default;
+    virtual void SetPipelineState(void *pipelineState) = 0;
+    virtual void SetGraphicsRootConstantBufferView(uint32 rootParameterIndex, uint64 bufferLocation) = 0;
+    virtual void SetVertexBuffer(uint32 slot, uint64 bufferLocation, uint32 sizeInBytes, uint32 strideInBytes) = 0;
+    virtual void SetIndexBuffer(uint64 bufferLocation, uint32 sizeInBytes, uint32 format) = 0;
+    virtual void DrawIndexedInstanced(uint32 indexCountPerInstance, uint32 instanceCount, uint32 startIndexLocation,
+                                      std::int32_t baseVertexLocation, uint32 startInstanceLocation) = 0;
+};
+
+// 只累加参数，使调用不会被优化掉
+class ChecksumRecorder : public CommandRecorder
+{
+  public:
+    void SetPipelineState(void *pipelineState) override
+    {
+        Checksum += reinterpret_cast<std::uintptr_t>(pipelineState);
+    }
+    void SetGraphicsRootConstantBufferView(uint32 rootParameterIndex, uint64 bufferLocation) override
+    {
+        Checksum += rootParameterIndex + bufferLocation;
+    }
+    void SetVertexBuffer(uint32 slot, uint64 bufferLocation, uint32 sizeInBytes, uint32 strideInBytes) override
+    {
+        Checksum += slot + bufferLocation + sizeInBytes + strideInBytes;
+    }
+    void SetIndexBuffer(uint64 bufferLocation, uint32 sizeInBytes, uint32 format) override
+    {
+        Checksum += bufferLocation + sizeInBytes + format;
+    }
+    void DrawIndexedInstanced(uint32 indexCountPerInstance, uint32 instanceCount, uint32 startIndexLocation,
+                              std::int32_t baseVertexLocation, uint32 startInstanceLocation) override
+    {
+        Checksum += indexCountPerInstance + instanceCount + startIndexLocation + baseVertexLocation +
+                    startInstanceLocation;
+    }
+
+    uint64 Checksum = 0;
+};
+
+// 与 ChecksumRecorder 相同，只用来阻止编译器把虚函数调用去虚化
+class OtherRecorder : public ChecksumRecorder
+{
+  public:
+    void SetPipelineState(void *pipelineState) override
+    {
+        Checksum ^= reinterpret_cast<std::uintptr_t>(pipelineState);
+    }
+};
+
+// 每帧记录 objectCount 个物体：与示例的 DrawRenderItems 相同，每个物体 5 条命令
+void BenchmarkEncoding()
+{
+    const uint32 objectCount = 2000;
+    const int frames = 200;
+    const uint64 operations = static_cast<uint64>(objectCount) * 5 * frames;
+
+    CommandStream stream;
+    uint64 bytes = 0;
+    Benchmark("CommandStream encode (5 commands per object)", operations, [&]() {
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            stream.Reset();
+            for (uint32 i = 0; i < objectCount; ++i)
+            {
+                stream.SetPipelineState(&gPipelineState);
+                stream.SetVertexBuffer(0, 0x20000 + i * 64, 4096, 32);
+                stream.SetIndexBuffer(0x30000 + i * 64, 1024, 57);
+                stream.SetGraphicsRootConstantBufferView(0, 0x10000 + i * 256);
+                stream.DrawIndexedInstanced(36, 1, i * 36, 0, 0);
+            }
+            bytes += stream.ByteSize();
+        }
+    });
+    CHECK(stream.CommandCount() == objectCount * 5);
+
+    // 运行时才决定使用哪个实现，调用只能通过虚函数表
+    static volatile bool useOther = false;
+    std::unique_ptr<CommandRecorder> recorder;
+    if (useOther)
+        recorder = std::make_unique<OtherRecorder>();
+    else
+        recorder = std::make_unique<ChecksumRecorder>();
+
+    Benchmark("Virtual-dispatch recorder (5 calls per object)", operations, [&]() {
+        for (int frame = 0; frame < frames; ++frame)
+        {
+            for (uint32 i = 0; i < objectCount; ++i)
+            {
+                recorder->SetPipelineState(&gPipelineState);
+                recorder->SetVertexBuffer(0, 0x20000 + i * 64, 4096, 32);
+                recorder->SetIndexBuffer(0x30000 + i * 64, 1024, 57);
+                recorder->SetGraphicsRootConstantBufferView(0, 0x10000 + i * 256);
+                recorder->DrawIndexedInstanced(36, 1, i * 36, 0, 0);
+            }
+        }
+    });
+
+    // 编码之后回放仍需逐条访问，这里用 NullCommandBackend 衡量校验与计数的开销
+    NullCommandBackend backend;
+    Benchmark("NullCommandBackend execute", static_cast<uint64>(objectCount) * 5, [&]() { backend.Execute(stream); });
+
+    std::printf("[benchmark] %.1f bytes per command, checksum %llu\n",
+                static_cast<double>(bytes) / static_cast<double>(operations),
+                static_cast<unsigned long long>(static_cast<ChecksumRecorder *>(recorder.get())->Checksum));
+}
+} // namespace
+
+int main()
+{
+    TestRoundTrip();
+    TestGrowthAcrossReset();
+    TestNullBackendValidation();
+    TestBarrierBatches();
+    BenchmarkEncoding();
+    return CheckResult();
+}
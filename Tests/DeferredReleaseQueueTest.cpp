@@ -0,0 +1,116 @@
+#include "Check.h"
+#include "DeferredReleaseQueue.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace
+{
+using uint64 = std::uint64_t;
+
+// 模拟的命令队列围栏：CPU 每帧 Signal 一个新值，GPU 落后若干帧才完成
+struct SimulatedFence
+{
+    uint64 Submitted = 0;
+    uint64 Completed = 0;
+
+    uint64 Signal()
+    {
+        return ++Submitted;
+    }
+
+    void GpuCompleteUpTo(uint64 value)
+    {
+        Completed = value < Submitted ? value : Submitted;
+    }
+};
+
+// 析构时计数，用来代替 GPU 资源
+struct TrackedResource
+{
+    explicit TrackedResource(int &destroyed) : Destroyed(destroyed)
+    {
+    }
+    ~TrackedResource()
+    {
+        ++Destroyed;
+    }
+    int &Destroyed;
+};
+
+void TestResourcesOutliveTheirFence()
+{
+    SimulatedFence fence;
+    int destroyed = 0;
+    {
+        DeferredReleaseQueue<std::unique_ptr<TrackedResource>> queue;
+
+        // 三帧，每帧替换一个资源，旧的资源以本帧的围栏值入队
+        for (int frame = 0; frame < 3; ++frame)
+        {
+            const uint64 fenceValue = fence.Signal();
+            queue.Enqueue(fenceValue, std::make_unique<TrackedResource>(destroyed));
+            queue.Enqueue(fenceValue, std::make_unique<TrackedResource>(destroyed));
+        }
+        CHECK(queue.Size() == 6);
+        CHECK(queue.OldestFenceValue() == 1);
+
+        // GPU 还没有完成任何一帧
+        CHECK(queue.Release(fence.Completed) == 0);
+        CHECK(destroyed == 0);
+
+        fence.GpuCompleteUpTo(1);
+        CHECK(queue.Release(fence.Completed) == 2);
+        CHECK(destroyed == 2);
+        CHECK(queue.OldestFenceValue() == 2);
+
+        // 重复调用不会多释放
+        CHECK(queue.Release(fence.Completed) == 0);
+
+        fence.GpuCompleteUpTo(3);
+        CHECK(queue.Release(fence.Completed) == 4);
+        CHECK(destroyed == 6);
+        CHECK(queue.Empty());
+        CHECK(queue.OldestFenceValue() == 0);
+
+        // 退出前还未完成的对象由 ReleaseAll（或析构）释放
+        queue.Enqueue(fence.Signal(), std::make_unique<TrackedResource>(destroyed));
+        CHECK(queue.ReleaseAll() == 1);
+        CHECK(destroyed == 7);
+    }
+    CHECK(destroyed == 7);
+}
+
+void TestCallbacks()
+{
+    SimulatedFence fence;
+    DeferredReleaseQueue<std::function<void()>> queue;
+    std::vector<uint64> calls;
+
+    queue.Enqueue(fence.Signal(), [&calls]() { calls.push_back(1); });
+    // 空的 std::function 被跳过，不会抛出 bad_function_call
+    queue.Enqueue(fence.Signal(), std::function<void()>());
+    // 释放过程中可以追加新的对象，它要等下一次 Release
+    queue.Enqueue(fence.Signal(), [&]() {
+        calls.push_back(3);
+        queue.Enqueue(fence.Signal(), [&calls]() { calls.push_back(4); });
+    });
+
+    fence.GpuCompleteUpTo(3);
+    CHECK(queue.Release(fence.Completed) == 3);
+    CHECK(calls.size() == 2 && calls[0] == 1 && calls[1] == 3);
+    CHECK(queue.Size() == 1);
+    CHECK(queue.OldestFenceValue() == 4);
+
+    fence.GpuCompleteUpTo(4);
+    CHECK(queue.Release(fence.Completed) == 1);
+    CHECK(calls.size() == 3 && calls[2] == 4);
+}
+} // namespace
+
+int main()
+{
+    TestResourcesOutliveTheirFence();
+    TestCallbacks();
+    return CheckResult();
+}
@@ -0,0 +1,160 @@
+#include "Check.h"
+#include "DescriptorAllocator.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+using uint32 = DescriptorAllocator::uint32;
+using uint64 = DescriptorAllocator::uint64;
+
+struct Range
+{
+    uint32 Index;
+    uint32 Count;
+};
+
+bool NoOverlap(std::vector<Range> ranges, uint32 persistentCapacity)
+{
+    std::sort(ranges.begin(), ranges.end(), [](const Range &a, const Range &b) { return a.Index < b.Index; });
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        if (ranges[i].Index + ranges[i].Count > persistentCapacity)
+            return false;
+        if (i > 0 && ranges[i - 1].Index + ranges[i - 1].Count > ranges[i].Index)
+            return false;
+    }
+    return true;
+}
+
+void TestPersistent()
+{
+    DescriptorAllocator allocator(256, 64);
+    CHECK(allocator.Capacity() == 256);
+    CHECK(allocator.GetStatistics().PersistentCapacity == 192);
+
+    const uint32 a = allocator.Allocate(100);
+    const uint32 b = allocator.Allocate(60);
+    CHECK(a != DescriptorAllocator::InvalidIndex && b != DescriptorAllocator::InvalidIndex);
+    CHECK(NoOverlap({{a, 100}, {b, 60}}, 192));
+    CHECK(allocator.GetStatistics().PersistentUsed == 160);
+
+    // 剩余 32 个，不够 33 个连续的描述符
+    CHECK(allocator.Allocate(33) == DescriptorAllocator::InvalidIndex);
+    CHECK(allocator.GetStatistics().FailedAllocations == 1);
+    const uint32 c = allocator.Allocate(32);
+    CHECK(c != DescriptorAllocator::InvalidIndex);
+
+    // 释放要等 GPU 到达围栏值，在此之前空间不能重新分配
+    allocator.Free(a, 100, 5);
+    CHECK(allocator.GetStatistics().PendingFree == 100);
+    CHECK(allocator.Allocate(1) == DescriptorAllocator::InvalidIndex);
+    allocator.ReleaseCompleted(4);
+    CHECK(allocator.Allocate(1) == DescriptorAllocator::InvalidIndex);
+    allocator.ReleaseCompleted(5);
+    CHECK(allocator.GetStatistics().PendingFree == 0);
+    CHECK(allocator.GetStatistics().PersistentUsed == 92);
+
+    // 跨越 64 位字边界的连续区间
+    const uint32 d = allocator.Allocate(100);
+    CHECK(d == a);
+    CHECK(allocator.GetStatistics().PersistentPeak == 192);
+}
+
+void TestTransient()
+{
+    const uint32 persistent = 16;
+    const uint32 transient = 12;
+    DescriptorAllocator allocator(persistent + transient, transient);
+
+    // 每帧分配 4 个，最多 3 帧同时在 GPU 上排队
+    uint64 fence = 0;
+    for (int frame = 0; frame < 50; ++frame)
+    {
+        if (fence >= 3)
+            allocator.ReleaseCompleted(fence - 2);
+        for (int i = 0; i < 4; ++i)
+        {
+            const uint32 index = allocator.AllocateTransient();
+            // 临时描述符位于常驻描述符之后
+            CHECK(index >= persistent && index < persistent + transient);
+        }
+        allocator.RetireFrame(++fence);
+    }
+    CHECK(allocator.GetStatistics().FailedAllocations == 0);
+    CHECK(allocator.GetStatistics().TransientPeak <= transient);
+
+    // GPU 没有跟上时，临时区间用完就分配失败，而不是覆盖仍在使用的描述符
+    DescriptorAllocator stalled(persistent + transient, transient);
+    for (int frame = 0; frame < 3; ++frame)
+    {
+        for (int i = 0; i < 4; ++i)
+            CHECK(stalled.AllocateTransient() != DescriptorAllocator::InvalidIndex);
+        stalled.RetireFrame(frame + 1);
+    }
+    CHECK(stalled.AllocateTransient() == DescriptorAllocator::InvalidIndex);
+    stalled.ReleaseCompleted(1);
+    CHECK(stalled.AllocateTransient() != DescriptorAllocator::InvalidIndex);
+}
+
+// 随机的分配与延迟释放，检查区间互不重叠，并打印每次操作的平均耗时
+void StressPersistent()
+{
+    const uint32 capacity = 1 << 16;
+    DescriptorAllocator allocator(capacity, 0);
+    std::mt19937 random(7);
+    std::vector<Range> live;
+    uint64 fence = 0;
+    uint32 liveCount = 0;
+
+    const unsigned operations = 400000;
+    Benchmark("DescriptorAllocator allocate/free", operations, [&]() {
+        for (unsigned step = 0; step < operations; ++step)
+        {
+            // 模拟每 64 次操作提交一帧，GPU 落后两帧
+            if (step % 64 == 0)
+            {
+                ++fence;
+                if (fence > 2)
+                    allocator.ReleaseCompleted(fence - 2);
+            }
+
+            if (live.empty() || (random() % 3 != 0 && liveCount < capacity * 3 / 4))
+            {
+                const uint32 count = random() % 8 == 0 ? 1 + random() % 64 : 1;
+                const uint32 index = allocator.Allocate(count);
+                if (index != DescriptorAllocator::InvalidIndex)
+                {
+                    live.push_back({index, count});
+                    liveCount += count;
+                }
+            }
+            else
+            {
+                const size_t i = random() % live.size();
+                allocator.Free(live[i].Index, live[i].Count, fence);
+                liveCount -= live[i].Count;
+                live[i] = live.back();
+                live.pop_back();
+            }
+        }
+    });
+
+    CHECK(NoOverlap(live, capacity));
+    allocator.ReleaseCompleted(fence);
+    const DescriptorAllocator::Statistics &stats = allocator.GetStatistics();
+    CHECK(stats.PersistentUsed == liveCount);
+    CHECK(stats.PendingFree == 0);
+    std::printf("[benchmark] %zu live ranges, %u descriptors, peak %u, %u failed allocations\n", live.size(),
+                liveCount, stats.PersistentPeak, stats.FailedAllocations);
+}
+} // namespace
+
+int main()
+{
+    TestPersistent();
+    TestTransient();
+    StressPersistent();
+    return CheckResult();
+}
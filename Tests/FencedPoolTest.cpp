@@ -0,0 +1,130 @@
+#include "Check.h"
+#include "FencedPool.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace
+{
+// 代替命令分配器：记录它被创建的序号
+struct PooledObject
+{
+    int Id = 0;
+};
+
+void TestReuseAfterFence()
+{
+    FencedPool<PooledObject> pool;
+    int created = 0;
+    auto create = [&created]() {
+        auto object = std::make_unique<PooledObject>();
+        object->Id = created++;
+        return object;
+    };
+
+    bool reused = true;
+    PooledObject *a = pool.Acquire(0, create, reused);
+    CHECK(!reused);
+    PooledObject *b = pool.Acquire(0, create, reused);
+    CHECK(!reused);
+    CHECK(a != b);
+    CHECK(pool.Size() == 2);
+    CHECK(pool.InUse() == 2);
+
+    pool.Retire(a, 1);
+    pool.Retire(b, 2);
+    CHECK(pool.InUse() == 0);
+
+    // GPU 尚未完成围栏 1，不能复用，只能新建
+    PooledObject *c = pool.Acquire(0, create, reused);
+    CHECK(!reused);
+    CHECK(c != a && c != b);
+    CHECK(pool.Size() == 3);
+
+    // 围栏 1 完成后复用最早归还的 a，b 仍然不可用
+    PooledObject *d = pool.Acquire(1, create, reused);
+    CHECK(reused);
+    CHECK(d == a);
+    PooledObject *e = pool.Acquire(1, create, reused);
+    CHECK(!reused);
+    CHECK(e != b);
+    CHECK(pool.Size() == 4);
+
+    PooledObject *f = pool.Acquire(2, create, reused);
+    CHECK(reused);
+    CHECK(f == b);
+    CHECK(pool.PeakInUse() == 4);
+
+    pool.Retire(c, 3);
+    pool.Retire(d, 3);
+    pool.Retire(e, 3);
+    pool.Retire(f, 3);
+    pool.ResetPeak();
+    CHECK(pool.PeakInUse() == 0);
+}
+
+// 稳定状态下每帧使用的对象数固定，池的大小只取决于 GPU 落后的帧数
+void TestSteadyStateSize()
+{
+    FencedPool<PooledObject> pool;
+    auto create = []() { return std::make_unique<PooledObject>(); };
+
+    const std::uint64_t framesInFlight = 3;
+    const int objectsPerFrame = 4;
+    std::uint64_t completed = 0;
+    for (std::uint64_t frame = 1; frame <= 100; ++frame)
+    {
+        if (frame > framesInFlight)
+            completed = frame - framesInFlight;
+
+        std::vector<PooledObject *> used;
+        bool reused = false;
+        for (int i = 0; i < objectsPerFrame; ++i)
+            used.push_back(pool.Acquire(completed, create, reused));
+        for (PooledObject *object : used)
+            pool.Retire(object, frame);
+    }
+    CHECK(pool.Size() == framesInFlight * objectsPerFrame);
+    CHECK(pool.InUse() == 0);
+}
+
+void TestConcurrentAcquire()
+{
+    FencedPool<PooledObject> pool;
+    std::atomic<int> created{0};
+    auto create = [&created]() {
+        ++created;
+        return std::make_unique<PooledObject>();
+    };
+
+    const int threadCount = 4;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadCount; ++t)
+    {
+        threads.emplace_back([&pool, &create]() {
+            for (std::uint64_t i = 1; i <= 1000; ++i)
+            {
+                bool reused = false;
+                // 各线程的进度不同，用所有线程都会用到的最大围栏值，保证归还的对象总是可以复用
+                PooledObject *object = pool.Acquire(1000, create, reused);
+                pool.Retire(object, i);
+            }
+        });
+    }
+    for (auto &thread : threads)
+        thread.join();
+
+    CHECK(pool.InUse() == 0);
+    CHECK(pool.Size() == static_cast<size_t>(created.load()));
+    CHECK(pool.Size() <= threadCount);
+}
+} // namespace
+
+int main()
+{
+    TestReuseAfterFence();
+    TestSteadyStateSize();
+    TestConcurrentAcquire();
+    return CheckResult();
+}
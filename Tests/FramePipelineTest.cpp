@@ -0,0 +1,82 @@
+#include "Check.h"
+#include "FramePipeline.h"
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+using Owner = FramePipeline::Owner;
+
+void TestOwnership()
+{
+    FramePipeline pipeline(2);
+    CHECK(pipeline.GetOwner(0) == Owner::Free && pipeline.GetOwner(1) == Owner::Free);
+
+    pipeline.BeginSimulation([](FramePipeline::uint32, FramePipeline::uint64) {});
+    CHECK(pipeline.PendingFrames() == 1);
+    pipeline.WaitIdle();
+    CHECK(pipeline.GetOwner(0) == Owner::Ready);
+
+    const FramePipeline::uint32 slot = pipeline.AcquireForRender();
+    CHECK(slot == 0 && pipeline.GetOwner(0) == Owner::Render);
+    CHECK(pipeline.PendingFrames() == 0);
+    pipeline.ReleaseFromRender(slot);
+    CHECK(pipeline.GetOwner(0) == Owner::Free);
+
+    // 模拟中抛出的异常在 AcquireForRender 中重新抛出，槽位回到空闲状态
+    pipeline.BeginSimulation([](FramePipeline::uint32, FramePipeline::uint64) { throw std::runtime_error("update"); });
+    CHECK_THROWS(pipeline.AcquireForRender(), std::runtime_error);
+    CHECK(pipeline.GetOwner(1) == Owner::Free);
+    CHECK(pipeline.PendingFrames() == 0);
+}
+
+// 按 D3DApp 的方式驱动流水线：进入帧循环之前开始第一帧的模拟，之后每一帧先取得本帧、再开始下一帧。
+// 每一帧的模拟只开始一次，并且看到的是开始它时的计时器（这里用 Tick 的次数代替）
+void TestFrameLoop()
+{
+    const int frameCount = 100;
+    FramePipeline pipeline(3);
+    std::vector<int> simulatedTicks(frameCount + 1, -1);
+    std::vector<int> simulations(frameCount + 1, 0);
+    int tick = 0;
+
+    auto beginSimulation = [&]() {
+        CHECK(pipeline.PendingFrames() == 0);
+        const int timer = tick;
+        pipeline.BeginSimulation([&, timer](FramePipeline::uint32, FramePipeline::uint64 frame) {
+            simulatedTicks[frame] = timer;
+            ++simulations[frame];
+        });
+    };
+
+    beginSimulation();
+    for (int frame = 0; frame < frameCount; ++frame)
+    {
+        ++tick;
+        CHECK(pipeline.PendingFrames() == 1);
+        const FramePipeline::uint32 slot = pipeline.AcquireForRender();
+        beginSimulation();
+        // 渲染与下一帧的模拟使用不同的槽位
+        CHECK(pipeline.GetOwner(slot) == Owner::Render);
+        pipeline.ReleaseFromRender(slot);
+    }
+    pipeline.WaitIdle();
+
+    for (int frame = 0; frame <= frameCount; ++frame)
+    {
+        CHECK(simulations[frame] == 1);
+        CHECK(simulatedTicks[frame] == frame);
+    }
+
+    const FramePipeline::Statistics stats = pipeline.GetStatistics();
+    CHECK(stats.SimulatedFrames == frameCount + 1);
+    CHECK(stats.RenderedFrames == frameCount);
+}
+} // namespace
+
+int main()
+{
+    TestOwnership();
+    TestFrameLoop();
+    return CheckResult();
+}
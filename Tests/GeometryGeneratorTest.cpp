@@ -0,0 +1,60 @@
+#include "Check.h"
+#include "GeometryGenerator.h"
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+using uint16 = GeometryGenerator::uint16;
+using uint32 = GeometryGenerator::uint32;
+
+void TestCopyIndices()
+{
+    // 长度不是 8 的倍数，SIMD 与标量两条路径都会用到；包含 16 位平移前后的边界值
+    GeometryGenerator::MeshData mesh;
+    mesh.Indices32 = {0, 1, 32767, 32768, 32769, 65534, 65535, 7, 8, 40000, 3};
+    CHECK(mesh.IndexByteSize() == 2);
+
+    std::vector<uint16> indices16(mesh.Indices32.size());
+    mesh.CopyIndices(indices16.data());
+    CHECK(std::vector<uint32>(indices16.begin(), indices16.end()) == mesh.Indices32);
+    CHECK(mesh.GetIndices16() == indices16);
+
+    std::vector<uint32> indices32 = {9};
+    mesh.AppendIndices(indices32);
+    CHECK(indices32.size() == mesh.Indices32.size() + 1);
+    CHECK(std::vector<uint32>(indices32.begin() + 1, indices32.end()) == mesh.Indices32);
+
+    GeometryGenerator::MeshData empty;
+    CHECK(empty.IndexByteSize() == 2 && empty.GetIndices16().empty());
+}
+
+// 索引超出 16 位时抛出异常，并且不改变调用者的数据
+void TestOutOfRange()
+{
+    GeometryGenerator::MeshData mesh;
+    mesh.Indices32 = {0, 1, 2, 3, 4, 5, 6, 7, 8, 65536};
+    CHECK(mesh.IndexByteSize() == 4);
+
+    std::vector<uint16> dst(mesh.Indices32.size(), 0xabcd);
+    CHECK_THROWS(mesh.CopyIndices(dst.data()), std::out_of_range);
+    CHECK(dst == std::vector<uint16>(mesh.Indices32.size(), 0xabcd));
+
+    std::vector<uint16> indices = {5, 6};
+    CHECK_THROWS(mesh.AppendIndices(indices), std::out_of_range);
+    CHECK(indices == std::vector<uint16>({5, 6}));
+    CHECK_THROWS(mesh.GetIndices16(), std::out_of_range);
+
+    // 32 位索引不受影响
+    std::vector<uint32> indices32;
+    mesh.AppendIndices(indices32);
+    CHECK(indices32 == mesh.Indices32);
+}
+} // namespace
+
+int main()
+{
+    TestCopyIndices();
+    TestOutOfRange();
+    return CheckResult();
+}
@@ -0,0 +1,137 @@
+#include "Check.h"
+#include "HeadlessFrameLoop.h"
+#include <string>
+#include <vector>
+
+namespace
+{
+// 运行帧循环，返回每一帧 Update 收到的时间差（包括预热帧）
+std::vector<double> RunFrames(const HeadlessFrameLoop::Options &options, const FrameTimeSource &timeSource,
+                              FrameTimingLog &log)
+{
+    std::vector<double> deltas;
+    HeadlessFrameLoop::Stages stages;
+    stages.Update = [&deltas](double deltaTime) { deltas.push_back(deltaTime); };
+    log = HeadlessFrameLoop::Run(options, timeSource, stages);
+    return deltas;
+}
+
+void TestParse()
+{
+    FrameTimeSource source(0.5);
+    std::string error;
+    CHECK(!source.IsRecorded());
+    CHECK(source.DeltaTime(7) == 0.5);
+
+    CHECK(source.Parse("# recorded\n0.01\n\n0.02\r\n0.03\n", error));
+    CHECK(source.RecordedCount() == 3);
+    CHECK(source.DeltaTime(1) == 0.02);
+    // 用完之后从头循环
+    CHECK(source.DeltaTime(4) == 0.02);
+
+    // 含有 delta_time 列的表头
+    CHECK(source.Parse("frame,delta_time,update_ms\n0, 0.25, 1\n1,0.5,1\n", error));
+    CHECK(source.RecordedCount() == 2 && source.DeltaTime(0) == 0.25);
+
+    // 失败时保持原来的设置
+    CHECK(!source.Parse("frame,update_ms\n0,1\n", error));
+    CHECK(!error.empty());
+    CHECK(!source.Parse("0.1\n-1\n", error));
+    CHECK(!source.Parse("# nothing\n", error));
+    CHECK(source.RecordedCount() == 2);
+}
+
+void TestParseArguments()
+{
+    HeadlessFrameLoop::Options options;
+    std::string error;
+    CHECK(HeadlessFrameLoop::ParseArguments(
+        {L"--headless", L"--frames", L"20", L"--warmup", L"5", L"--dt", L"0.02", L"--timings", L"out.csv"}, options,
+        error));
+    CHECK(options.Enabled && options.FrameCount == 20 && options.WarmupFrames == 5);
+    CHECK(options.FixedDeltaTime == 0.02 && options.TimingFile == L"out.csv");
+
+    CHECK(!HeadlessFrameLoop::ParseArguments({L"--frames"}, options, error));
+    CHECK(!HeadlessFrameLoop::ParseArguments({L"--frames", L"1.5"}, options, error));
+    CHECK(!HeadlessFrameLoop::ParseArguments({L"--fast"}, options, error));
+    CHECK(!error.empty());
+}
+
+// 计时帧从时间差序列的第 0 项开始，与预热帧数无关
+void TestWarmupDoesNotShiftDeltaTimes()
+{
+    FrameTimeSource source;
+    std::string error;
+    CHECK(source.Parse("0.1\n0.2\n0.3\n0.4\n0.5\n", error));
+
+    HeadlessFrameLoop::Options options;
+    options.WarmupFrames = 2;
+    options.FrameCount = 4;
+    FrameTimingLog log;
+    const std::vector<double> deltas = RunFrames(options, source, log);
+
+    CHECK(deltas == std::vector<double>({0.1, 0.2, 0.1, 0.2, 0.3, 0.4}));
+    CHECK(log.Frames().size() == 4);
+    for (size_t i = 0; i < log.Frames().size(); ++i)
+    {
+        CHECK(log.Frames()[i].Frame == i);
+        CHECK(log.Frames()[i].DeltaTime == source.DeltaTime(i));
+    }
+
+    options.WarmupFrames = 0;
+    FrameTimingLog unwarmed;
+    RunFrames(options, source, unwarmed);
+    for (size_t i = 0; i < log.Frames().size(); ++i)
+        CHECK(unwarmed.Frames()[i].DeltaTime == log.Frames()[i].DeltaTime);
+}
+
+// 写出的记录作为时间差文件重放，每一帧（包括预热帧）的时间差都与录制时相同
+void TestReplay()
+{
+    FrameTimeSource recorded;
+    std::string error;
+    CHECK(recorded.Parse("0.016\n0.033\n0.0171\n0.05\n0.02\n0.018\n0.0169\n", error));
+
+    HeadlessFrameLoop::Options options;
+    options.WarmupFrames = 3;
+    options.FrameCount = 10;
+    FrameTimingLog log;
+    const std::vector<double> original = RunFrames(options, recorded, log);
+
+    FrameTimeSource replay;
+    CHECK(replay.Parse(log.ToCsv(), error));
+    CHECK(replay.RecordedCount() == options.FrameCount);
+    FrameTimingLog replayLog;
+    CHECK(RunFrames(options, replay, replayLog) == original);
+}
+
+void TestSummary()
+{
+    FrameTimingLog log;
+    CHECK(log.Summarize(&FrameTiming::FrameMs).Max == 0.0);
+
+    for (int i = 1; i <= 100; ++i)
+    {
+        FrameTiming timing;
+        timing.Frame = i - 1;
+        timing.FrameMs = i;
+        log.Add(timing);
+    }
+    const FrameTimingLog::Summary summary = log.Summarize(&FrameTiming::FrameMs);
+    CHECK(summary.Mean == 50.5);
+    CHECK(summary.Median == 50.0);
+    CHECK(summary.P95 == 95.0);
+    CHECK(summary.P99 == 99.0);
+    CHECK(summary.Max == 100.0);
+}
+} // namespace
+
+int main()
+{
+    TestParse();
+    TestParseArguments();
+    TestWarmupDoesNotShiftDeltaTimes();
+    TestReplay();
+    TestSummary();
+    return CheckResult();
+}
@@ -0,0 +1,239 @@
+#include "Check.h"
+#include "IndexBufferBuilder.h"
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+using uint16 = IndexBufferBuilder::uint16;
+using uint32 = IndexBufferBuilder::uint32;
+
+// 按 Ranges() 还原子网格绘制时实际访问的顶点（索引加上 BaseVertexLocation）
+std::vector<std::int64_t> Resolve(const IndexBufferBuilder &builder, uint32 submesh)
+{
+    std::vector<std::int64_t> vertices;
+    const IndexBufferBuilder::Submesh &s = builder.GetSubmesh(submesh);
+    for (uint32 r = s.FirstRange; r < s.FirstRange + s.RangeCount; ++r)
+    {
+        const IndexBufferBuilder::Range &range = builder.Ranges()[r];
+        for (uint32 k = 0; k < range.IndexCount; ++k)
+        {
+            const uint32 index = builder.IndexByteSize() == 2 ? builder.Indices16()[range.StartIndexLocation + k]
+                                                              : builder.Indices32()[range.StartIndexLocation + k];
+            vertices.push_back(static_cast<std::int64_t>(index) + range.BaseVertexLocation);
+        }
+    }
+    return vertices;
+}
+
+std::vector<std::int64_t> Expected(const std::vector<uint32> &indices, std::int32_t baseVertexLocation)
+{
+    std::vector<std::int64_t> vertices;
+    for (uint32 index : indices)
+        vertices.push_back(static_cast<std::int64_t>(index) + baseVertexLocation);
+    return vertices;
+}
+
+// 以 stride 为间隔、跨度逐渐增大的三角形列表
+std::vector<uint32> MakeStrip(uint32 first, uint32 triangleCount, uint32 stride)
+{
+    std::vector<uint32> indices;
+    for (uint32 t = 0; t < triangleCount; ++t)
+    {
+        const uint32 v = first + t * stride;
+        indices.insert(indices.end(), {v, v + 1, v + 2});
+    }
+    return indices;
+}
+
+void TestWidthSelection()
+{
+    // 索引本身很大，但子网格内的跨度很小：减去最小值后仍可使用 16 位索引
+    const std::vector<uint32> small = {0, 1, 2, 2, 1, 3};
+    const std::vector<uint32> offset = {100000, 100002, 100001, 165535, 100000, 100001};
+    IndexBufferBuilder builder;
+    const uint32 a = builder.AddSubmesh(small, 10);
+    const uint32 b = builder.AddSubmesh(offset, -5);
+    const uint32 empty = builder.AddSubmesh(nullptr, 0, 7);
+    builder.Build();
+
+    CHECK(builder.IndexByteSize() == 2);
+    CHECK(builder.SubmeshCount() == 3);
+    CHECK(builder.Indices16().size() == small.size() + offset.size());
+    CHECK(builder.DataByteSize() == builder.Indices16().size() * sizeof(uint16));
+    CHECK(builder.Data() == builder.Indices16().data());
+    CHECK(builder.GetSubmesh(b).RangeCount == 1);
+    CHECK(builder.Ranges()[builder.GetSubmesh(b).FirstRange].BaseVertexLocation == 100000 - 5);
+    CHECK(Resolve(builder, a) == Expected(small, 10));
+    CHECK(Resolve(builder, b) == Expected(offset, -5));
+    CHECK(builder.GetSubmesh(empty).RangeCount == 1 && Resolve(builder, empty).empty());
+
+    // 跨度超过 65535 且不允许拆分：整个缓冲区改用 32 位索引
+    IndexBufferBuilder noSplit(false);
+    noSplit.AddSubmesh(small, 10);
+    const uint32 wide = noSplit.AddSubmesh(MakeStrip(0, 100, 1000), 3);
+    noSplit.Build();
+    CHECK(noSplit.IndexByteSize() == 4);
+    CHECK(noSplit.DataByteSize() == (small.size() + 300) * sizeof(uint32));
+    CHECK(noSplit.Data() == noSplit.Indices32().data());
+    CHECK(Resolve(noSplit, 0) == Expected(small, 10));
+    CHECK(Resolve(noSplit, wide) == Expected(MakeStrip(0, 100, 1000), 3));
+
+    // 单个三角形的跨度就超出 16 位时，即使允许拆分也只能使用 32 位索引
+    IndexBufferBuilder bigTriangle;
+    bigTriangle.AddSubmesh(std::vector<uint32>{0, 1, 70000});
+    bigTriangle.Build();
+    CHECK(bigTriangle.IndexByteSize() == 4);
+
+    // 不是三角形列表的子网格不能拆分
+    IndexBufferBuilder notTriangles;
+    notTriangles.AddSubmesh(std::vector<uint32>{0, 1, 2, 70000});
+    notTriangles.Build();
+    CHECK(notTriangles.IndexByteSize() == 4);
+}
+
+void TestSplitting()
+{
+    // 跨度约 299000：拆成若干段，每段的跨度都不超过 65535，三角形的顺序与内容不变
+    const std::vector<uint32> indices = MakeStrip(5, 300, 1000);
+    IndexBufferBuilder builder;
+    const uint32 small = builder.AddSubmesh(std::vector<uint32>{3, 4, 5}, 1);
+    const uint32 wide = builder.AddSubmesh(indices, 20);
+    builder.Build();
+
+    CHECK(builder.IndexByteSize() == 2);
+    const IndexBufferBuilder::Submesh &submesh = builder.GetSubmesh(wide);
+    CHECK(submesh.RangeCount >= 5);
+    CHECK(builder.GetSubmesh(small).RangeCount == 1);
+    for (uint32 r = submesh.FirstRange; r < submesh.FirstRange + submesh.RangeCount; ++r)
+    {
+        const IndexBufferBuilder::Range &range = builder.Ranges()[r];
+        CHECK(range.IndexCount % 3 == 0);
+        auto minmax = std::minmax_element(builder.Indices16().begin() + range.StartIndexLocation,
+                                          builder.Indices16().begin() + range.StartIndexLocation + range.IndexCount);
+        CHECK(*minmax.first == 0);
+    }
+    CHECK(Resolve(builder, wide) == Expected(indices, 20));
+    CHECK(Resolve(builder, small) == Expected({3, 4, 5}, 1));
+
+    // 继续添加子网格后重新生成：有一个子网格放不下时全部回到 32 位
+    const uint32 big = builder.AddSubmesh(std::vector<uint32>{0, 1, 80000});
+    builder.Build();
+    CHECK(builder.IndexByteSize() == 4);
+    CHECK(builder.GetSubmesh(wide).RangeCount == 1);
+    CHECK(Resolve(builder, wide) == Expected(indices, 20));
+    CHECK(Resolve(builder, big) == Expected({0, 1, 80000}, 0));
+}
+
+// 与 Encode 相同的变长整数，用来构造损坏的输入
+void PutVarint(std::vector<std::uint8_t> &bytes, std::uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        bytes.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    bytes.push_back(static_cast<std::uint8_t>(value));
+}
+
+void TestCodecRoundTrip()
+{
+    // 规则网格：每个索引大约 1 字节
+    std::vector<uint32> grid;
+    const uint32 n = 64;
+    for (uint32 i = 0; i + 1 < n; ++i)
+    {
+        for (uint32 j = 0; j + 1 < n; ++j)
+        {
+            const uint32 v = i * n + j;
+            grid.insert(grid.end(), {v, v + 1, v + n, v + n, v + 1, v + n + 1});
+        }
+    }
+    std::vector<std::uint8_t> encoded;
+    IndexCodec::Encode(grid.data(), grid.size(), encoded);
+    CHECK(encoded.size() < grid.size() * 5 / 4);
+
+    std::vector<uint32> decoded(grid.size());
+    CHECK(IndexCodec::Decode(encoded.data(), encoded.size(), decoded.data(), decoded.size()));
+    CHECK(decoded == grid);
+
+    std::vector<uint16> grid16(grid.begin(), grid.end());
+    std::vector<std::uint8_t> encoded16;
+    IndexCodec::Encode(grid16.data(), grid16.size(), encoded16);
+    CHECK(encoded16 == encoded);
+    std::vector<uint16> decoded16(grid16.size());
+    CHECK(IndexCodec::Decode(encoded16.data(), encoded16.size(), decoded16.data(), decoded16.size()));
+    CHECK(decoded16 == grid16);
+
+    // 任意两个 32 位索引之差都能还原，包括需要 5 个字节的差值
+    const std::vector<uint32> extremes = {0, UINT32_MAX, 1, UINT32_MAX, 0, 0x80000000u, 0x7fffffffu, 12345, 0};
+    std::vector<std::uint8_t> extremeBytes;
+    IndexCodec::Encode(extremes.data(), extremes.size(), extremeBytes);
+    std::vector<uint32> extremeDecoded(extremes.size());
+    CHECK(IndexCodec::Decode(extremeBytes.data(), extremeBytes.size(), extremeDecoded.data(), extremes.size()));
+    CHECK(extremeDecoded == extremes);
+
+    // 编码结果追加在已有内容之后
+    std::vector<std::uint8_t> appended = {0xaa};
+    IndexCodec::Encode(grid.data(), 6, appended);
+    CHECK(appended[0] == 0xaa && appended.size() > 1);
+}
+
+void TestCodecCorruption()
+{
+    const std::vector<uint32> indices = {0, 1, 2, 2, 1, 70000};
+    std::vector<std::uint8_t> good;
+    IndexCodec::Encode(indices.data(), indices.size(), good);
+    std::vector<uint32> out(indices.size());
+
+    // 截断、多余的字节与数量不符
+    CHECK(!IndexCodec::Decode(good.data(), good.size() - 1, out.data(), out.size()));
+    std::vector<std::uint8_t> extra = good;
+    extra.push_back(0);
+    CHECK(!IndexCodec::Decode(extra.data(), extra.size(), out.data(), out.size()));
+    CHECK(!IndexCodec::Decode(good.data(), good.size(), out.data(), out.size() + 1));
+    CHECK(IndexCodec::Decode(good.data(), 0, out.data(), 0));
+
+    // 16 位输出时索引超出 65535
+    std::vector<uint16> out16(indices.size());
+    CHECK(!IndexCodec::Decode(good.data(), good.size(), out16.data(), out16.size()));
+
+    // 第 5 个字节只能使用低 4 位：0x0f 是 zigzag 后的 0xffffffff，即差值 -2^31
+    std::vector<std::uint8_t> bytes;
+    PutVarint(bytes, 0xffffffffu);
+    uint32 one = 0;
+    CHECK(bytes.size() == 5 && bytes[4] == 0x0f);
+    CHECK(IndexCodec::Decode(bytes.data(), bytes.size(), &one, 1) && one == 0x80000000u);
+    for (std::uint8_t high : {0x1f, 0x2f, 0x4f, 0x7f})
+    {
+        bytes[4] = high;
+        CHECK(!IndexCodec::Decode(bytes.data(), bytes.size(), &one, 1));
+    }
+    // 超过 5 个字节的变长整数
+    bytes.clear();
+    PutVarint(bytes, std::uint64_t(1) << 35);
+    CHECK(bytes.size() == 6);
+    CHECK(!IndexCodec::Decode(bytes.data(), bytes.size(), &one, 1));
+    const std::vector<std::uint8_t> unterminated = {0x80, 0x80, 0x80, 0x80, 0x80, 0x00};
+    CHECK(!IndexCodec::Decode(unterminated.data(), unterminated.size(), &one, 1));
+
+    // 逐字节翻转：解码不越界读取，失败或成功都不会写出超过 indexCount 个索引
+    for (size_t i = 0; i < good.size(); ++i)
+    {
+        bytes = good;
+        bytes[i] ^= 0xc3;
+        std::vector<uint32> guarded(indices.size() + 1, 0xdeadbeef);
+        IndexCodec::Decode(bytes.data(), bytes.size(), guarded.data(), indices.size());
+        CHECK(guarded.back() == 0xdeadbeef);
+    }
+}
+} // namespace
+
+int main()
+{
+    TestWidthSelection();
+    TestSplitting();
+    TestCodecRoundTrip();
+    TestCodecCorruption();
+    return CheckResult();
+}
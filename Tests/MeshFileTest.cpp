@@ -0,0 +1,283 @@
+#include "Check.h"
+#include "MeshFile.h"
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+namespace fs = std::filesystem;
+
+struct Vertex
+{
+    XMFLOAT3 Position;
+    std::uint32_t Color;
+};
+
+struct Fixture
+{
+    std::vector<Vertex> Vertices;
+    std::vector<XMFLOAT2> TexCoords;
+    std::vector<std::uint16_t> Indices16;
+    std::vector<std::uint32_t> Indices32;
+    MeshFileWriter Writer;
+
+    Fixture()
+    {
+        for (std::uint32_t i = 0; i < 37; ++i)
+        {
+            Vertices.push_back({XMFLOAT3(static_cast<float>(i), 2.0f * i, -1.0f * i), 0xff000000u | i});
+            TexCoords.push_back(XMFLOAT2(i / 37.0f, 1.0f - i / 37.0f));
+        }
+        for (std::uint16_t i = 0; i < 30; ++i)
+            Indices16.push_back(static_cast<std::uint16_t>((i * 7) % 37));
+        for (std::uint32_t i = 0; i < 9; ++i)
+            Indices32.push_back(70000u + i);
+
+        // 两个顶点流的长度不是 16 的倍数，后面的数据段需要补齐对齐
+        Writer.AddVertexStream("position", Vertices);
+        Writer.AddVertexStream("texcoord", TexCoords);
+        Writer.AddIndexBuffer("small", Indices16.data(), static_cast<std::uint32_t>(Indices16.size()));
+        Writer.AddIndexBuffer("large", Indices32.data(), static_cast<std::uint32_t>(Indices32.size()));
+        Writer.AddSubmesh("box", 0, 0, 12, 0, 0, BoundingBox(XMFLOAT3(0.0f, 0.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+        Writer.AddSubmesh("sphere", 0, 0, 18, 12, 5,
+                          BoundingBox(XMFLOAT3(4.0f, 0.0f, 0.0f), XMFLOAT3(2.0f, 0.5f, 1.0f)));
+        Writer.AddSubmesh("below", 1, 1, 6, 3, -2,
+                          BoundingBox(XMFLOAT3(0.0f, -3.0f, 0.0f), XMFLOAT3(1.0f, 1.0f, 1.0f)));
+    }
+};
+
+bool Equals(Span<const std::uint8_t> data, const void *expected, size_t size)
+{
+    return data.size() == size && (size == 0 || std::memcmp(data.data(), expected, size) == 0);
+}
+
+bool Near(float a, float b)
+{
+    return std::abs(a - b) < 1e-5f;
+}
+
+void CheckContents(const MeshFile &mesh, const Fixture &fixture)
+{
+    CHECK(mesh.Version() == MeshFile::CurrentVersion);
+
+    const auto &streams = mesh.VertexStreams();
+    CHECK(streams.size() == 2);
+    CHECK(streams[0].Name == "position" && streams[0].ByteStride == sizeof(Vertex) && streams[0].VertexCount == 37);
+    CHECK(Equals(streams[0].Data, fixture.Vertices.data(), fixture.Vertices.size() * sizeof(Vertex)));
+    CHECK(streams[1].Name == "texcoord" && streams[1].ByteStride == sizeof(XMFLOAT2));
+    CHECK(Equals(streams[1].Data, fixture.TexCoords.data(), fixture.TexCoords.size() * sizeof(XMFLOAT2)));
+
+    const auto &indexBuffers = mesh.IndexBuffers();
+    CHECK(indexBuffers.size() == 2);
+    CHECK(indexBuffers[0].Name == "small" && indexBuffers[0].IndexByteSize == 2 && indexBuffers[0].IndexCount == 30);
+    CHECK(std::memcmp(indexBuffers[0].Indices16().data(), fixture.Indices16.data(), 30 * sizeof(std::uint16_t)) == 0);
+    CHECK(indexBuffers[1].Name == "large" && indexBuffers[1].IndexByteSize == 4);
+    CHECK(indexBuffers[1].Indices32().size() == 9 && indexBuffers[1].Indices32()[8] == 70008u);
+
+    // 数据段可以直接交给上传代码
+    for (const auto &stream : streams)
+        CHECK(reinterpret_cast<std::uintptr_t>(stream.Data.data()) % MeshFile::DataAlignment == 0);
+    for (const auto &indexBuffer : indexBuffers)
+        CHECK(reinterpret_cast<std::uintptr_t>(indexBuffer.Data.data()) % MeshFile::DataAlignment == 0);
+
+    CHECK(mesh.Submeshes().size() == 3);
+    const MeshFile::Submesh *sphere = mesh.FindSubmesh("sphere");
+    CHECK(sphere != nullptr);
+    if (sphere != nullptr)
+    {
+        CHECK(sphere->VertexStream == 0 && sphere->IndexBuffer == 0);
+        CHECK(sphere->IndexCount == 18 && sphere->StartIndexLocation == 12 && sphere->BaseVertexLocation == 5);
+        CHECK(sphere->Bounds.Center.x == 4.0f && sphere->Bounds.Extents.y == 0.5f);
+    }
+    const MeshFile::Submesh *below = mesh.FindSubmesh("below");
+    CHECK(below != nullptr && below->IndexBuffer == 1 && below->BaseVertexLocation == -2);
+    CHECK(mesh.FindSubmesh("missing") == nullptr);
+
+    // 整体包围盒为 x ∈ [-1, 6]、y ∈ [-4, 1]、z ∈ [-1, 1]
+    const BoundingBox &bounds = mesh.Bounds();
+    CHECK(Near(bounds.Center.x, 2.5f) && Near(bounds.Center.y, -1.5f) && Near(bounds.Center.z, 0.0f));
+    CHECK(Near(bounds.Extents.x, 3.5f) && Near(bounds.Extents.y, 2.5f) && Near(bounds.Extents.z, 1.0f));
+}
+
+void TestRoundTrip()
+{
+    Fixture fixture;
+    const std::vector<std::uint8_t> bytes = fixture.Writer.Serialize();
+    CHECK(fixture.Writer.Serialize() == bytes);
+
+    MeshFile parsed;
+    CHECK(parsed.Parse(Span<const std::uint8_t>(bytes.data(), bytes.size())));
+    CheckContents(parsed, fixture);
+
+    // 写入文件之后映射打开
+    const fs::path file = fs::temp_directory_path() / "MeshFileTest.mesh";
+    CHECK(fixture.Writer.Write(file.wstring()));
+    CHECK(fs::file_size(file) == bytes.size());
+    MeshFile mapped;
+    CHECK(mapped.Open(file.wstring()));
+    CheckContents(mapped, fixture);
+    mapped.Close();
+    CHECK(mapped.Submeshes().empty() && mapped.FindSubmesh("box") == nullptr);
+
+    // 截断的文件与文件头中的大小不一致
+    std::ofstream(file, std::ios::binary | std::ios::trunc)
+        .write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size() - 1));
+    CHECK(!mapped.Open(file.wstring()));
+    CHECK(!mapped.Error().empty());
+    fs::remove(file);
+
+    CHECK(!mapped.Open(file.wstring()));
+    CHECK(!mapped.Error().empty());
+
+    // 空的网格文件
+    MeshFileWriter empty;
+    const std::vector<std::uint8_t> emptyBytes = empty.Serialize();
+    CHECK(emptyBytes.size() == sizeof(MeshFileHeader));
+    CHECK(parsed.Parse(Span<const std::uint8_t>(emptyBytes.data(), emptyBytes.size())));
+    CHECK(parsed.VertexStreams().empty() && parsed.Submeshes().empty());
+}
+
+// 在序列化结果的 offset 处写入 value
+template <typename T>
+void Patch(std::vector<std::uint8_t> &bytes, size_t offset, T value)
+{
+    std::memcpy(bytes.data() + offset, &value, sizeof(T));
+}
+
+bool Parse(MeshFile &mesh, const std::vector<std::uint8_t> &bytes)
+{
+    return mesh.Parse(Span<const std::uint8_t>(bytes.data(), bytes.size()));
+}
+
+void TestCorruption()
+{
+    Fixture fixture;
+    const std::vector<std::uint8_t> good = fixture.Writer.Serialize();
+    const size_t vertexTable = sizeof(MeshFileHeader);
+    const size_t indexTable = vertexTable + 2 * sizeof(MeshFileVertexStream);
+    const size_t submeshTable = indexTable + 2 * sizeof(MeshFileIndexBuffer);
+
+    MeshFile mesh;
+    std::vector<std::uint8_t> bytes = good;
+    Patch(bytes, offsetof(MeshFileHeader, Magic), std::uint32_t(0x12345678));
+    CHECK(!Parse(mesh, bytes));
+    CHECK(!mesh.Error().empty());
+
+    bytes = good;
+    Patch(bytes, offsetof(MeshFileHeader, Version), MeshFile::CurrentVersion + 1);
+    CHECK(!Parse(mesh, bytes));
+    Patch(bytes, offsetof(MeshFileHeader, Version), std::uint32_t(0));
+    CHECK(!Parse(mesh, bytes));
+
+    bytes = good;
+    Patch(bytes, offsetof(MeshFileHeader, HeaderSize), std::uint32_t(sizeof(MeshFileHeader) - 4));
+    CHECK(!Parse(mesh, bytes));
+
+    // 截断
+    bytes.assign(good.begin(), good.end() - 1);
+    CHECK(!Parse(mesh, bytes));
+    bytes.assign(good.begin(), good.begin() + sizeof(MeshFileHeader) - 1);
+    CHECK(!Parse(mesh, bytes));
+
+    // 表的项数使表越过文件末尾，包括乘法会溢出 32 位的项数
+    bytes = good;
+    Patch(bytes, offsetof(MeshFileHeader, SubmeshCount), std::uint32_t(1000));
+    CHECK(!Parse(mesh, bytes));
+    Patch(bytes, offsetof(MeshFileHeader, SubmeshCount), std::uint32_t(0xffffffff));
+    CHECK(!Parse(mesh, bytes));
+    bytes = good;
+    Patch(bytes, offsetof(MeshFileHeader, StringTableSize), std::uint32_t(0xfffffff0));
+    CHECK(!Parse(mesh, bytes));
+
+    // 数据段越界、未对齐或大小与项数不符
+    bytes = good;
+    Patch(bytes, vertexTable + offsetof(MeshFileVertexStream, DataOffset), std::uint64_t(good.size()));
+    CHECK(!Parse(mesh, bytes));
+    Patch(bytes, vertexTable + offsetof(MeshFileVertexStream, DataOffset), ~std::uint64_t(15));
+    CHECK(!Parse(mesh, bytes));
+    bytes = good;
+    std::uint64_t dataOffset = 0;
+    std::memcpy(&dataOffset, good.data() + vertexTable + offsetof(MeshFileVertexStream, DataOffset), 8);
+    Patch(bytes, vertexTable + offsetof(MeshFileVertexStream, DataOffset), dataOffset + 4);
+    CHECK(!Parse(mesh, bytes));
+    bytes = good;
+    Patch(bytes, vertexTable + offsetof(MeshFileVertexStream, VertexCount), std::uint32_t(38));
+    CHECK(!Parse(mesh, bytes));
+    bytes = good;
+    Patch(bytes, indexTable + offsetof(MeshFileIndexBuffer, DataSize), ~std::uint64_t(0));
+    CHECK(!Parse(mesh, bytes));
+    bytes = good;
+    Patch(bytes, indexTable + offsetof(MeshFileIndexBuffer, IndexByteSize), std::uint32_t(1));
+    CHECK(!Parse(mesh, bytes));
+
+    // 名称越界或没有结尾的 '\0'
+    bytes = good;
+    Patch(bytes, vertexTable + offsetof(MeshFileVertexStream, NameOffset), std::uint32_t(0x7fffffff));
+    CHECK(!Parse(mesh, bytes));
+    bytes = good;
+    std::uint32_t stringTableSize = 0;
+    std::memcpy(&stringTableSize, good.data() + offsetof(MeshFileHeader, StringTableSize), 4);
+    bytes[submeshTable + 3 * sizeof(MeshFileSubmesh) + stringTableSize - 1] = 'x';
+    CHECK(!Parse(mesh, bytes));
+
+    // 子网格引用不存在的缓冲区，或索引范围超出索引缓冲区
+    const size_t sphere = submeshTable + sizeof(MeshFileSubmesh);
+    bytes = good;
+    Patch(bytes, sphere + offsetof(MeshFileSubmesh, IndexBuffer), std::uint32_t(2));
+    CHECK(!Parse(mesh, bytes));
+    bytes = good;
+    Patch(bytes, sphere + offsetof(MeshFileSubmesh, VertexStream), std::uint32_t(5));
+    CHECK(!Parse(mesh, bytes));
+    bytes = good;
+    Patch(bytes, sphere + offsetof(MeshFileSubmesh, StartIndexLocation), std::uint32_t(13));
+    CHECK(!Parse(mesh, bytes));
+    Patch(bytes, sphere + offsetof(MeshFileSubmesh, StartIndexLocation), std::uint32_t(0xfffffff0));
+    CHECK(!Parse(mesh, bytes));
+
+    // 失败之后不保留之前解析的结果
+    CHECK(mesh.VertexStreams().empty() && mesh.IndexBuffers().empty() && mesh.Submeshes().empty());
+    CHECK(Parse(mesh, good));
+    CheckContents(mesh, fixture);
+
+    // 逐字节翻转：无论哪个字节损坏，解析成功时所有视图都位于文件之内
+    size_t parsed = 0;
+    for (size_t i = 0; i < good.size(); ++i)
+    {
+        bytes = good;
+        bytes[i] ^= 0xa5;
+        if (!Parse(mesh, bytes))
+            continue;
+        ++parsed;
+
+        const std::uint8_t *end = bytes.data() + bytes.size();
+        for (const auto &stream : mesh.VertexStreams())
+            CHECK(stream.Data.data() >= bytes.data() && stream.Data.data() + stream.Data.size() <= end);
+        for (const auto &indexBuffer : mesh.IndexBuffers())
+            CHECK(indexBuffer.Data.data() >= bytes.data() &&
+                  indexBuffer.Data.data() + indexBuffer.Data.size() <= end);
+        for (const auto &submesh : mesh.Submeshes())
+        {
+            CHECK(submesh.Name.data() >= reinterpret_cast<const char *>(bytes.data()) &&
+                  submesh.Name.data() + submesh.Name.size() < reinterpret_cast<const char *>(end));
+            CHECK(submesh.IndexBuffer < mesh.IndexBuffers().size() &&
+                  static_cast<std::uint64_t>(submesh.StartIndexLocation) + submesh.IndexCount <=
+                      mesh.IndexBuffers()[submesh.IndexBuffer].IndexCount);
+        }
+    }
+    // 数据段与包围盒中的字节损坏不会被 Parse 发现
+    CHECK(parsed > 0);
+}
+} // namespace
+
+int main()
+{
+    TestRoundTrip();
+    TestCorruption();
+    return CheckResult();
+}
@@ -0,0 +1,167 @@
+#include "Check.h"
+#include "MeshletBuilder.h"
+#include <algorithm>
+#include <array>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+using uint32 = std::uint32_t;
+using Triangle = std::array<uint32, 3>;
+
+// 旋转三角形使最小的索引在前，保持环绕方向不变
+Triangle Canonical(uint32 i0, uint32 i1, uint32 i2)
+{
+    if (i1 < i0 && i1 < i2)
+        return {i1, i2, i0};
+    if (i2 < i0 && i2 < i1)
+        return {i2, i0, i1};
+    return {i0, i1, i2};
+}
+
+std::vector<Triangle> SortedTriangles(const std::vector<uint32> &indices)
+{
+    std::vector<Triangle> triangles;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        triangles.push_back(Canonical(indices[i], indices[i + 1], indices[i + 2]));
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+XMVECTOR PositionOf(const GeometryGenerator::MeshData &mesh, uint32 index)
+{
+    return XMLoadFloat3(&mesh.Vertices[index].Position);
+}
+
+// 上限、三角形覆盖与包围球
+void CheckMeshlets(const GeometryGenerator::MeshData &mesh, const MeshletData &meshlets)
+{
+    CHECK(!meshlets.Meshlets.empty());
+    CHECK(meshlets.CullData.size() == meshlets.Meshlets.size());
+
+    std::vector<uint32> indices;
+    for (uint32 m = 0; m < meshlets.Meshlets.size(); ++m)
+    {
+        const Meshlet &meshlet = meshlets.Meshlets[m];
+        CHECK(meshlet.VertexCount > 0 && meshlet.VertexCount <= MeshletBuilder::MaxVertexLimit);
+        CHECK(meshlet.PrimitiveCount > 0 && meshlet.PrimitiveCount <= MeshletBuilder::MaxPrimitiveLimit);
+
+        // 局部索引不超出簇内的顶点数
+        for (uint32 i = 0; i < meshlet.PrimitiveCount; ++i)
+        {
+            uint32 i0, i1, i2;
+            MeshletBuilder::UnpackTriangle(meshlets.PrimitiveIndices[meshlet.PrimitiveOffset + i], i0, i1, i2);
+            CHECK(i0 < meshlet.VertexCount && i1 < meshlet.VertexCount && i2 < meshlet.VertexCount);
+        }
+
+        const XMFLOAT4 &sphere = meshlets.CullData[m].BoundingSphere;
+        const XMVECTOR center = XMVectorSet(sphere.x, sphere.y, sphere.z, 0.0f);
+        for (uint32 i = 0; i < meshlet.VertexCount; ++i)
+        {
+            const uint32 vertex = meshlets.UniqueVertexIndices[meshlet.VertexOffset + i];
+            const float distance = XMVectorGetX(XMVector3Length(PositionOf(mesh, vertex) - center));
+            CHECK(distance <= sphere.w * 1.0001f + 1e-5f);
+        }
+
+        meshlets.AppendIndices(m, indices);
+    }
+
+    // 每个三角形恰好出现一次，并且环绕方向不变
+    CHECK(indices.size() == mesh.Indices32.size());
+    CHECK(SortedTriangles(indices) == SortedTriangles(mesh.Indices32));
+}
+
+// 被判定为背向的簇，其中每个三角形都确实背向观察点
+uint32 CheckBackfacing(const GeometryGenerator::MeshData &mesh, const MeshletData &meshlets, const XMFLOAT3 &eye)
+{
+    uint32 culled = 0;
+    std::vector<uint32> indices;
+    for (uint32 m = 0; m < meshlets.Meshlets.size(); ++m)
+    {
+        if (!MeshletCuller::IsBackfacing(meshlets.CullData[m], eye))
+            continue;
+        ++culled;
+
+        indices.clear();
+        meshlets.AppendIndices(m, indices);
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            const XMVECTOR p0 = PositionOf(mesh, indices[i]);
+            const XMVECTOR normal =
+                XMVector3Cross(PositionOf(mesh, indices[i + 1]) - p0, PositionOf(mesh, indices[i + 2]) - p0);
+            CHECK(XMVectorGetX(XMVector3Dot(normal, p0 - XMLoadFloat3(&eye))) >= 0.0f);
+        }
+    }
+    return culled;
+}
+
+void TestGrid()
+{
+    GeometryGenerator generator;
+    const GeometryGenerator::MeshData grid = generator.CreateGrid(20.0f, 20.0f, 60, 60);
+    const MeshletData meshlets = MeshletBuilder().Build(grid);
+    CheckMeshlets(grid, meshlets);
+
+    // 平面网格的法线锥退化为一条直线：从下方看全部背向，从上方看全部可见。
+    // 视锥体从观察点沿 +z 张开到足以容纳整个网格
+    const auto total = static_cast<uint32>(meshlets.Meshlets.size());
+    std::vector<uint32> visible;
+    const XMFLOAT3 below(0.0f, -10.0f, -100.0f);
+    const BoundingFrustum fromBelow(below, XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), 100.0f, -100.0f, 100.0f, -100.0f, 0.1f,
+                                    1000.0f);
+    MeshletCuller::Stats stats = MeshletCuller::Cull(meshlets, fromBelow, below, visible);
+    CHECK(stats.Total == total);
+    CHECK(stats.FrustumCulled == 0);
+    CHECK(stats.BackfaceCulled == total);
+    CHECK(stats.Visible == 0 && visible.empty());
+    CHECK(CheckBackfacing(grid, meshlets, below) == total);
+
+    const XMFLOAT3 above(0.0f, 10.0f, -100.0f);
+    const BoundingFrustum fromAbove(above, XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f), 100.0f, -100.0f, 100.0f, -100.0f, 0.1f,
+                                    1000.0f);
+    stats = MeshletCuller::Cull(meshlets, fromAbove, above, visible);
+    CHECK(stats.BackfaceCulled == 0);
+    CHECK(stats.Visible == total && visible.size() == total);
+}
+
+void TestSphere()
+{
+    GeometryGenerator generator;
+    const GeometryGenerator::MeshData sphere = generator.CreateSphere(1.0f, 40, 40);
+    const MeshletData meshlets = MeshletBuilder().Build(sphere);
+    CheckMeshlets(sphere, meshlets);
+
+    // 远处的观察点只能看到朝向它的一侧：背面的簇被剔除，且剔除总是保守的。
+    // 球体按纬度带生成索引，赤道附近的簇绕满一整圈、法线锥无法剔除，靠近两极的簇法线集中，可以剔除
+    const auto total = static_cast<uint32>(meshlets.Meshlets.size());
+    for (const XMFLOAT3 &eye : {XMFLOAT3(0.0f, 10.0f, 0.0f), XMFLOAT3(0.0f, -10.0f, 0.0f), XMFLOAT3(3.0f, 4.0f, -5.0f)})
+    {
+        const uint32 culled = CheckBackfacing(sphere, meshlets, eye);
+        CHECK(culled > 0 && culled < total);
+    }
+
+    // 簇的上限更小时同样成立
+    const MeshletData small = MeshletBuilder(16, 20).Build(sphere);
+    CheckMeshlets(sphere, small);
+    for (const Meshlet &meshlet : small.Meshlets)
+        CHECK(meshlet.VertexCount <= 16 && meshlet.PrimitiveCount <= 20);
+    CHECK(small.Meshlets.size() > meshlets.Meshlets.size());
+}
+
+void TestPackTriangle()
+{
+    uint32 i0, i1, i2;
+    MeshletBuilder::UnpackTriangle(MeshletBuilder::PackTriangle(1023, 0, 517), i0, i1, i2);
+    CHECK(i0 == 1023 && i1 == 0 && i2 == 517);
+}
+} // namespace
+
+int main()
+{
+    TestGrid();
+    TestSphere();
+    TestPackTriangle();
+    return CheckResult();
+}
@@ -0,0 +1,172 @@
+#include "Check.h"
+#include "PipelineStateCache.h"
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace
+{
+using uint64 = PipelineStateCache::uint64;
+
+const uint64 RootSignatureHash = 0x1234567890abcdefull;
+
+// 与示例中的不透明物体 PSO 相同的描述。着色器字节码与输入布局放在调用者提供的存储中，
+// 以便用不同地址上的同样内容重新构造同一个描述
+struct PipelineStorage
+{
+    std::vector<std::uint8_t> VS = std::vector<std::uint8_t>(64, 0x11);
+    std::vector<std::uint8_t> PS = std::vector<std::uint8_t>(96, 0x22);
+    std::vector<D3D12_INPUT_ELEMENT_DESC> InputLayout = {
+        {"POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0},
+        {"NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D12_INPUT_CLASSIFICATION_PER_VERTEX_DATA, 0}};
+};
+
+D3D12_GRAPHICS_PIPELINE_STATE_DESC MakeDesc(const PipelineStorage &storage)
+{
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = {};
+    desc.InputLayout = {storage.InputLayout.data(), (UINT)storage.InputLayout.size()};
+    desc.VS = {storage.VS.data(), storage.VS.size()};
+    desc.PS = {storage.PS.data(), storage.PS.size()};
+    desc.RasterizerState = CD3DX12_RASTERIZER_DESC(D3D12_DEFAULT);
+    desc.BlendState = CD3DX12_BLEND_DESC(D3D12_DEFAULT);
+    desc.DepthStencilState = CD3DX12_DEPTH_STENCIL_DESC(D3D12_DEFAULT);
+    desc.SampleMask = UINT_MAX;
+    desc.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_TRIANGLE;
+    desc.NumRenderTargets = 1;
+    desc.RTVFormats[0] = DXGI_FORMAT_R8G8B8A8_UNORM;
+    desc.SampleDesc.Count = 1;
+    desc.SampleDesc.Quality = 0;
+    desc.DSVFormat = DXGI_FORMAT_D24_UNORM_S8_UINT;
+    return desc;
+}
+
+// 键只取决于描述的内容：字节码与输入布局换到别的地址、根签名指针与 CachedPSO 不同都不影响键
+void TestStableKey()
+{
+    PipelineStorage storage;
+    const uint64 key = PipelineStateCache::HashGraphicsPipeline(MakeDesc(storage), RootSignatureHash);
+    CHECK(key == PipelineStateCache::HashGraphicsPipeline(MakeDesc(storage), RootSignatureHash));
+
+    PipelineStorage copy;
+    CHECK(copy.VS.data() != storage.VS.data() && copy.InputLayout.data() != storage.InputLayout.data());
+    D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = MakeDesc(copy);
+    CHECK(PipelineStateCache::HashGraphicsPipeline(desc, RootSignatureHash) == key);
+
+    // 语义名字符串按内容哈希
+    std::vector<std::string> names = {"POSITION", "NORMAL"};
+    copy.InputLayout[0].SemanticName = names[0].c_str();
+    copy.InputLayout[1].SemanticName = names[1].c_str();
+    CHECK(PipelineStateCache::HashGraphicsPipeline(MakeDesc(copy), RootSignatureHash) == key);
+
+    desc.pRootSignature = reinterpret_cast<ID3D12RootSignature *>(&desc);
+    static const std::uint8_t cachedBlob[16] = {};
+    desc.CachedPSO = {cachedBlob, sizeof(cachedBlob)};
+    CHECK(PipelineStateCache::HashGraphicsPipeline(desc, RootSignatureHash) == key);
+
+    // 超出 NumRenderTargets 的格式没有意义
+    desc = MakeDesc(storage);
+    desc.RTVFormats[1] = DXGI_FORMAT_R16G16B16A16_FLOAT;
+    desc.RTVFormats[7] = DXGI_FORMAT_R32_FLOAT;
+    CHECK(PipelineStateCache::HashGraphicsPipeline(desc, RootSignatureHash) == key);
+}
+
+// 任何一个状态字段改变，键都随之改变，并且各不相同
+void TestEveryFieldChangesKey()
+{
+    PipelineStorage storage;
+    const std::uint8_t otherShader[64] = {0x11, 0x12};
+    const D3D12_SO_DECLARATION_ENTRY soEntry = {0, "POSITION", 0, 0, 3, 0};
+    const UINT soStride = 12;
+
+    using Mutation = std::function<void(D3D12_GRAPHICS_PIPELINE_STATE_DESC &, PipelineStorage &)>;
+    const std::vector<Mutation> mutations = {
+        // 着色器的内容与长度
+        [](auto &, auto &s) { s.VS[10] ^= 1; },
+        [](auto &, auto &s) { s.PS.pop_back(); },
+        [&](auto &d, auto &) { d.DS = {otherShader, sizeof(otherShader)}; },
+        [&](auto &d, auto &) { d.HS = {otherShader, sizeof(otherShader)}; },
+        [&](auto &d, auto &) { d.GS = {otherShader, sizeof(otherShader)}; },
+        [&](auto &d, auto &) { d.StreamOutput = {&soEntry, 1, &soStride, 1, 0}; },
+        // 混合状态
+        [](auto &d, auto &) { d.BlendState.AlphaToCoverageEnable = TRUE; },
+        [](auto &d, auto &) { d.BlendState.IndependentBlendEnable = TRUE; },
+        [](auto &d, auto &) { d.BlendState.RenderTarget[0].BlendEnable = TRUE; },
+        [](auto &d, auto &) { d.BlendState.RenderTarget[0].SrcBlend = D3D12_BLEND_SRC_ALPHA; },
+        [](auto &d, auto &) { d.BlendState.RenderTarget[0].DestBlend = D3D12_BLEND_INV_SRC_ALPHA; },
+        [](auto &d, auto &) { d.BlendState.RenderTarget[0].BlendOpAlpha = D3D12_BLEND_OP_MAX; },
+        [](auto &d, auto &) { d.BlendState.RenderTarget[0].LogicOpEnable = TRUE; },
+        [](auto &d, auto &) { d.BlendState.RenderTarget[0].RenderTargetWriteMask = 0; },
+        [](auto &d, auto &) { d.BlendState.RenderTarget[3].RenderTargetWriteMask = 1; },
+        [](auto &d, auto &) { d.SampleMask = 1; },
+        // 光栅化状态
+        [](auto &d, auto &) { d.RasterizerState.FillMode = D3D12_FILL_MODE_WIREFRAME; },
+        [](auto &d, auto &) { d.RasterizerState.CullMode = D3D12_CULL_MODE_NONE; },
+        [](auto &d, auto &) { d.RasterizerState.FrontCounterClockwise = TRUE; },
+        [](auto &d, auto &) { d.RasterizerState.DepthBias = 100; },
+        [](auto &d, auto &) { d.RasterizerState.SlopeScaledDepthBias = 1.0f; },
+        [](auto &d, auto &) { d.RasterizerState.DepthClipEnable = FALSE; },
+        [](auto &d, auto &) { d.RasterizerState.MultisampleEnable = TRUE; },
+        [](auto &d, auto &) { d.RasterizerState.DepthBiasClamp = 0.5f; },
+        [](auto &d, auto &) { d.RasterizerState.AntialiasedLineEnable = TRUE; },
+        [](auto &d, auto &) { d.RasterizerState.ForcedSampleCount = 4; },
+        [](auto &d, auto &) { d.RasterizerState.ConservativeRaster = D3D12_CONSERVATIVE_RASTERIZATION_MODE_ON; },
+        // 深度/模板状态
+        [](auto &d, auto &) { d.DepthStencilState.DepthEnable = FALSE; },
+        [](auto &d, auto &) { d.DepthStencilState.DepthWriteMask = D3D12_DEPTH_WRITE_MASK_ZERO; },
+        [](auto &d, auto &) { d.DepthStencilState.DepthFunc = D3D12_COMPARISON_FUNC_LESS_EQUAL; },
+        [](auto &d, auto &) { d.DepthStencilState.StencilEnable = TRUE; },
+        [](auto &d, auto &) { d.DepthStencilState.StencilReadMask = 0x0f; },
+        [](auto &d, auto &) { d.DepthStencilState.StencilWriteMask = 0xf0; },
+        [](auto &d, auto &) { d.DepthStencilState.FrontFace.StencilPassOp = D3D12_STENCIL_OP_REPLACE; },
+        [](auto &d, auto &) { d.DepthStencilState.BackFace.StencilFunc = D3D12_COMPARISON_FUNC_EQUAL; },
+        // 输入布局
+        [](auto &, auto &s) { s.InputLayout[1].SemanticName = "TEXCOORD"; },
+        [](auto &, auto &s) { s.InputLayout[1].SemanticIndex = 1; },
+        [](auto &, auto &s) { s.InputLayout[1].Format = DXGI_FORMAT_R16G16B16A16_FLOAT; },
+        [](auto &, auto &s) { s.InputLayout[1].InputSlot = 1; },
+        [](auto &, auto &s) { s.InputLayout[1].AlignedByteOffset = 16; },
+        [](auto &, auto &s) { s.InputLayout[1].InputSlotClass = D3D12_INPUT_CLASSIFICATION_PER_INSTANCE_DATA; },
+        [](auto &, auto &s) { s.InputLayout.pop_back(); },
+        // 其余字段
+        [](auto &d, auto &) { d.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFF; },
+        [](auto &d, auto &) { d.PrimitiveTopologyType = D3D12_PRIMITIVE_TOPOLOGY_TYPE_LINE; },
+        [](auto &d, auto &) { d.NumRenderTargets = 2; },
+        [](auto &d, auto &) { d.RTVFormats[0] = DXGI_FORMAT_R16G16B16A16_FLOAT; },
+        [](auto &d, auto &) { d.DSVFormat = DXGI_FORMAT_D32_FLOAT; },
+        [](auto &d, auto &) { d.SampleDesc.Count = 4; },
+        [](auto &d, auto &) { d.SampleDesc.Quality = 1; },
+        [](auto &d, auto &) { d.NodeMask = 1; },
+        [](auto &d, auto &) { d.Flags = D3D12_PIPELINE_STATE_FLAG_TOOL_DEBUG; },
+    };
+
+    std::set<uint64> keys;
+    keys.insert(PipelineStateCache::HashGraphicsPipeline(MakeDesc(storage), RootSignatureHash));
+    keys.insert(PipelineStateCache::HashGraphicsPipeline(MakeDesc(storage), RootSignatureHash + 1));
+    CHECK(keys.size() == 2);
+
+    for (size_t i = 0; i < mutations.size(); ++i)
+    {
+        PipelineStorage mutated;
+        D3D12_GRAPHICS_PIPELINE_STATE_DESC desc = MakeDesc(mutated);
+        mutations[i](desc, mutated);
+        // 修改了存储的变更需要重新构造描述，并保留对描述本身的修改
+        const D3D12_GRAPHICS_PIPELINE_STATE_DESC rebuilt = MakeDesc(mutated);
+        desc.VS = rebuilt.VS;
+        desc.PS = rebuilt.PS;
+        desc.InputLayout = rebuilt.InputLayout;
+
+        const bool inserted = keys.insert(PipelineStateCache::HashGraphicsPipeline(desc, RootSignatureHash)).second;
+        if (!inserted)
+            std::fprintf(stderr, "mutation %zu did not change the key\n", i);
+        CHECK(inserted);
+    }
+}
+} // namespace
+
+int main()
+{
+    TestStableKey();
+    TestEveryFieldChangesKey();
+    return CheckResult();
+}
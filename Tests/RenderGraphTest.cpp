@@ -0,0 +1,207 @@
+#include "Check.h"
+#include "NullCommandBackend.h"
+#include "RenderGraph.h"
+
+namespace
+{
+using uint32 = RenderGraph::uint32;
+
+// D3D12_RESOURCE_STATES 中用到的几个值
+const uint32 StatePresent = 0x0;
+const uint32 StateRenderTarget = 0x4;
+const uint32 StateUnorderedAccess = 0x8;
+const uint32 StateNonPixelShaderResource = 0x40;
+const uint32 StatePixelShaderResource = 0x80;
+const uint32 StateCopySource = 0x800;
+
+const RenderGraph::uint64 MB = 1024 * 1024;
+
+// 物理资源只作为屏障中的指针使用，不会被解引用
+int gBackBuffer, gTexture, gTransientA, gTransientB, gTransientC;
+
+RenderGraph::TransientDesc Transient(RenderGraph::uint64 size, uint32 initialState)
+{
+    RenderGraph::TransientDesc desc;
+    desc.Size = size;
+    desc.InitialState = initialState;
+    return desc;
+}
+
+// 统计命令流中的转换屏障，并检查没有 StateBefore 与 StateAfter 相同的转换
+uint32 CountTransitions(const CommandStream &stream, bool &hasNoOp)
+{
+    uint32 count = 0;
+    hasNoOp = false;
+    stream.ForEach([&](CommandType type, const void *payload) {
+        if (type != CommandType::TransitionBarrier)
+            return;
+        const auto *barrier = static_cast<const CmdTransitionBarrier *>(payload);
+        hasNoOp = hasNoOp || barrier->StateBefore == barrier->StateAfter;
+        ++count;
+    });
+    return count;
+}
+
+// 导入资源的初始状态已经包含了后续读取的全部状态时，不需要任何转换
+void TestImportedReadStateIsSatisfied()
+{
+    RenderGraph graph;
+    auto texture = graph.ImportResource("Texture", StatePixelShaderResource | StateNonPixelShaderResource,
+                                        StatePixelShaderResource | StateNonPixelShaderResource);
+    auto pixel = graph.AddPass("Pixel", nullptr);
+    graph.Read(pixel, texture, StatePixelShaderResource);
+    graph.SetSideEffect(pixel);
+    auto compute = graph.AddPass("Compute", nullptr);
+    graph.Read(compute, texture, StateNonPixelShaderResource);
+    graph.SetSideEffect(compute);
+    graph.Compile();
+
+    CHECK(graph.GetStatistics().BarrierCount == 0);
+    CHECK(graph.GetStatistics().BarrierBatchCount == 0);
+
+    // 初始状态只包含其中一部分时，转换一次到并集，且不会出现前后状态相同的转换
+    RenderGraph partial;
+    auto partialTexture = partial.ImportResource("Texture", StatePixelShaderResource, StatePixelShaderResource);
+    auto first = partial.AddPass("Pixel", nullptr);
+    partial.Read(first, partialTexture, StatePixelShaderResource);
+    partial.SetSideEffect(first);
+    auto second = partial.AddPass("Compute", nullptr);
+    partial.Read(second, partialTexture, StateNonPixelShaderResource);
+    partial.SetSideEffect(second);
+    partial.Compile();
+    partial.SetPhysicalResource(partialTexture, &gTexture);
+
+    CommandStream stream;
+    partial.Execute(stream);
+    bool hasNoOp = false;
+    // PSR -> PSR|NPSR，最后再转换回 PSR
+    CHECK(CountTransitions(stream, hasNoOp) == 2);
+    CHECK(!hasNoOp);
+}
+
+// 典型的一帧：场景画到临时纹理，后处理读取它写入后台缓冲区
+void TestBarrierCountsAndCulling()
+{
+    RenderGraph graph;
+    auto backBuffer = graph.ImportResource("BackBuffer", StatePresent, StatePresent);
+    auto scene = graph.CreateTransient("Scene", Transient(8 * MB, StateRenderTarget));
+    auto unused = graph.CreateTransient("Unused", Transient(4 * MB, StateRenderTarget));
+
+    auto scenePass = graph.AddPass("Scene", nullptr);
+    graph.Write(scenePass, scene, StateRenderTarget);
+    // 结果没有被任何 Pass 读取，应被剔除
+    auto debugPass = graph.AddPass("Debug", nullptr);
+    graph.Write(debugPass, unused, StateRenderTarget);
+    auto postPass = graph.AddPass("Post", nullptr);
+    graph.Read(postPass, scene, StatePixelShaderResource);
+    graph.Write(postPass, backBuffer, StateRenderTarget);
+    graph.Compile();
+
+    const RenderGraph::Statistics &stats = graph.GetStatistics();
+    CHECK(stats.PassCount == 3);
+    CHECK(stats.CulledPassCount == 1);
+    CHECK(graph.IsCulled(debugPass));
+    CHECK(!graph.IsCulled(scenePass) && !graph.IsCulled(postPass));
+    CHECK(graph.GetTransientOffset(unused) == RenderGraph::InvalidOffset);
+
+    // Post 之前：Scene RT -> PSR，BackBuffer PRESENT -> RT；
+    // 最后：Scene PSR -> RT（回到初始状态），BackBuffer RT -> PRESENT
+    CHECK(stats.BarrierCount == 4);
+    CHECK(stats.AliasingBarrierCount == 0);
+    CHECK(stats.BarrierBatchCount == 2);
+    CHECK(stats.TransientBytes == 8 * MB);
+    CHECK(stats.TransientHeapSize == 8 * MB);
+}
+
+// 生命周期不重叠的临时资源共用内存，峰值内存小于各自独占的总和
+void TestTransientAliasing()
+{
+    RenderGraph graph;
+    auto backBuffer = graph.ImportResource("BackBuffer", StatePresent, StatePresent);
+    auto a = graph.CreateTransient("A", Transient(4 * MB, StateRenderTarget));
+    auto b = graph.CreateTransient("B", Transient(4 * MB, StateUnorderedAccess));
+    auto c = graph.CreateTransient("C", Transient(2 * MB, StateRenderTarget));
+
+    auto passA = graph.AddPass("WriteA", nullptr);
+    graph.Write(passA, a, StateRenderTarget);
+    auto passB = graph.AddPass("AToB", nullptr);
+    graph.Read(passB, a, StateNonPixelShaderResource);
+    graph.Write(passB, b, StateUnorderedAccess);
+    auto passC = graph.AddPass("BToC", nullptr);
+    graph.Read(passC, b, StateNonPixelShaderResource);
+    graph.Write(passC, c, StateRenderTarget);
+    auto present = graph.AddPass("Present", nullptr);
+    graph.Read(present, c, StatePixelShaderResource);
+    graph.Write(present, backBuffer, StateRenderTarget);
+    graph.Compile();
+
+    const RenderGraph::Statistics &stats = graph.GetStatistics();
+    CHECK(stats.CulledPassCount == 0);
+    CHECK(stats.TransientBytes == 10 * MB);
+    // A 与 B 的生命周期重叠，C 可以复用 A 的内存
+    CHECK(stats.TransientHeapSize == 8 * MB);
+    CHECK(graph.GetTransientOffset(a) != graph.GetTransientOffset(b));
+    CHECK(graph.GetTransientOffset(c) == graph.GetTransientOffset(a));
+    // A 与 C 共用内存，每帧都要在第一次使用前插入别名屏障
+    CHECK(stats.AliasingBarrierCount == 2);
+
+    graph.SetPhysicalResource(backBuffer, &gBackBuffer);
+    graph.SetPhysicalResource(a, &gTransientA);
+    graph.SetPhysicalResource(b, &gTransientB);
+    graph.SetPhysicalResource(c, &gTransientC);
+
+    // 编译结果重复执行多帧，后端记住的状态与每一帧第一个屏障的 StateBefore 一致
+    NullCommandBackend backend;
+    backend.SetResourceState(&gTransientA, StateRenderTarget);
+    backend.SetResourceState(&gTransientB, StateUnorderedAccess);
+    backend.SetResourceState(&gTransientC, StateRenderTarget);
+    for (int frame = 0; frame < 3; ++frame)
+    {
+        CommandStream stream;
+        graph.Execute(stream);
+        backend.Execute(stream);
+
+        bool hasNoOp = false;
+        CHECK(CountTransitions(stream, hasNoOp) == stats.BarrierCount - stats.AliasingBarrierCount);
+        CHECK(!hasNoOp);
+    }
+    CHECK(backend.GetStatistics().ErrorCount == 0);
+    if (backend.GetStatistics().ErrorCount != 0)
+        std::fprintf(stderr, "%s\n", backend.GetFirstError().c_str());
+
+    // 每一帧结束时临时资源都回到初始状态，导入资源回到最终状态
+    uint32 state = ~0u;
+    CHECK(backend.GetResourceState(&gTransientA, CommandStream::AllSubresources, state) && state == StateRenderTarget);
+    CHECK(backend.GetResourceState(&gTransientB, CommandStream::AllSubresources, state) &&
+          state == StateUnorderedAccess);
+    CHECK(backend.GetResourceState(&gTransientC, CommandStream::AllSubresources, state) && state == StateRenderTarget);
+    CHECK(backend.GetResourceState(&gBackBuffer, CommandStream::AllSubresources, state) && state == StatePresent);
+}
+
+// 连续读取同一资源的不同只读状态时只转换一次
+void TestReadStatesAreMerged()
+{
+    RenderGraph graph;
+    auto texture = graph.ImportResource("Texture", StateCopySource, StateCopySource);
+    auto first = graph.AddPass("Pixel", nullptr);
+    graph.Read(first, texture, StatePixelShaderResource);
+    graph.SetSideEffect(first);
+    auto second = graph.AddPass("Compute", nullptr);
+    graph.Read(second, texture, StateNonPixelShaderResource);
+    graph.SetSideEffect(second);
+    graph.Compile();
+
+    // COPY_SOURCE -> PSR|NPSR，最后再转换回 COPY_SOURCE
+    CHECK(graph.GetStatistics().BarrierCount == 2);
+    CHECK(graph.GetStatistics().BarrierBatchCount == 2);
+}
+} // namespace
+
+int main()
+{
+    TestImportedReadStateIsSatisfied();
+    TestBarrierCountsAndCulling();
+    TestTransientAliasing();
+    TestReadStatesAreMerged();
+    return CheckResult();
+}
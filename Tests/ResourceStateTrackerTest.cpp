@@ -0,0 +1,160 @@
+#include "Check.h"
+#include "NullCommandBackend.h"
+#include "ResourceStateTracker.h"
+
+namespace
+{
+using uint32 = std::uint32_t;
+
+// D3D12_RESOURCE_STATES 中用到的几个值
+const uint32 StateCommon = 0x0;
+const uint32 StateRenderTarget = 0x4;
+const uint32 StatePixelShaderResource = 0x80;
+const uint32 StateCopyDest = 0x400;
+const uint32 StateCopySource = 0x800;
+
+const uint32 All = CommandStream::AllSubresources;
+
+int gTexture, gBuffer;
+
+uint32 CountTransitions(const CommandStream &stream)
+{
+    uint32 count = 0;
+    stream.ForEach([&count](CommandType type, const void *) {
+        if (type == CommandType::TransitionBarrier)
+            ++count;
+    });
+    return count;
+}
+
+// 先逐个转换子资源，再转换整个资源：整个资源原先的状态不能残留下来
+void TestBackendSubresourceThenWhole()
+{
+    // 已知子资源数：整个资源的状态展开为逐个子资源的状态
+    {
+        NullCommandBackend backend;
+        backend.SetResourceState(&gTexture, StateCommon, 2);
+
+        CommandStream stream;
+        stream.TransitionBarrier(&gTexture, StateCommon, StateCopyDest, 0);
+        stream.TransitionBarrier(&gTexture, StateCommon, StateCopyDest, 1);
+        stream.TransitionBarrier(&gTexture, StateCopyDest, StateCopySource);
+        backend.Execute(stream);
+        CHECK(backend.GetStatistics().ErrorCount == 0);
+
+        uint32 state = ~0u;
+        CHECK(backend.GetResourceState(&gTexture, All, state) && state == StateCopySource);
+        CHECK(backend.GetResourceState(&gTexture, 1, state) && state == StateCopySource);
+    }
+
+    // 只转换了一个子资源就转换整个资源，另一个子资源仍处于 COMMON，应当报错
+    {
+        NullCommandBackend backend;
+        backend.SetResourceState(&gTexture, StateCommon, 2);
+
+        CommandStream stream;
+        stream.TransitionBarrier(&gTexture, StateCommon, StateCopyDest, 0);
+        stream.TransitionBarrier(&gTexture, StateCopyDest, StateCopySource);
+        backend.Execute(stream);
+        CHECK(backend.GetStatistics().ErrorCount == 1);
+    }
+
+    // 未知子资源数：只能丢弃整个资源的状态，不会误报
+    {
+        NullCommandBackend backend;
+        backend.SetResourceState(&gTexture, StateCommon);
+
+        CommandStream stream;
+        stream.TransitionBarrier(&gTexture, StateCommon, StateCopyDest, 0);
+        stream.TransitionBarrier(&gTexture, StateCommon, StateCopyDest, 1);
+        stream.TransitionBarrier(&gTexture, StateCopyDest, StateCopySource);
+        backend.Execute(stream);
+        CHECK(backend.GetStatistics().ErrorCount == 0);
+
+        // 子资源的状态与记录不符时照常报错
+        CommandStream wrong;
+        wrong.TransitionBarrier(&gTexture, StateCopyDest, StateCommon, 1);
+        backend.Execute(wrong);
+        CHECK(backend.GetStatistics().ErrorCount == 1);
+    }
+}
+
+void TestBackendRemembersStatesAcrossStreams()
+{
+    NullCommandBackend backend;
+
+    // 从未见过的资源以第一个屏障的 StateBefore 为准
+    CommandStream first;
+    first.TransitionBarrier(&gBuffer, StateCopyDest, StatePixelShaderResource);
+    backend.Execute(first);
+    CHECK(backend.GetStatistics().ErrorCount == 0);
+
+    CommandStream second;
+    second.TransitionBarrier(&gBuffer, StateCopyDest, StateCommon);
+    backend.Execute(second);
+    CHECK(backend.GetStatistics().ErrorCount == 1);
+
+    // 前后状态相同的转换是错误
+    backend.ResetStatistics();
+    CommandStream noOp;
+    noOp.TransitionBarrier(&gBuffer, StateCommon, StateCommon);
+    backend.Execute(noOp);
+    CHECK(backend.GetStatistics().ErrorCount == 1);
+}
+
+// 跟踪器生成的屏障交给后端校验，并检查多余的转换被消除
+void TestTrackerElidesRedundantTransitions()
+{
+    ResourceStateMap states;
+    states.Register(&gTexture, 2, StateCommon);
+    states.Register(&gBuffer, 1, StatePixelShaderResource);
+
+    NullCommandBackend backend;
+    backend.SetResourceState(&gTexture, StateCommon, 2);
+    backend.SetResourceState(&gBuffer, StatePixelShaderResource, 1);
+
+    ResourceStateTracker tracker(states);
+    CommandStream prologue;
+    CommandStream stream;
+
+    // 已经处于目标状态
+    tracker.TransitionResource(&gBuffer, StatePixelShaderResource);
+    // A -> B -> A 的往返被整个消除
+    tracker.TransitionResource(&gTexture, StateRenderTarget);
+    tracker.FlushBarriers(stream);
+    tracker.TransitionResource(&gTexture, StateCopyDest);
+    tracker.TransitionResource(&gTexture, StateRenderTarget);
+    CHECK(tracker.FlushBarriers(stream) == 0);
+
+    // 逐个子资源转换，再转换整个资源
+    tracker.TransitionResource(&gTexture, StateCopySource, 0);
+    tracker.TransitionResource(&gTexture, StateCopySource, 1);
+    tracker.FlushBarriers(stream);
+    tracker.TransitionResource(&gTexture, StatePixelShaderResource);
+    tracker.FlushBarriers(stream);
+
+    tracker.ResolvePendingBarriers(prologue);
+    backend.Execute(prologue);
+    backend.Execute(stream);
+    CHECK(backend.GetStatistics().ErrorCount == 0);
+    if (backend.GetStatistics().ErrorCount != 0)
+        std::fprintf(stderr, "%s\n", backend.GetFirstError().c_str());
+
+    const ResourceStateTracker::Statistics &stats = tracker.GetStatistics();
+    CHECK(stats.RequestedTransitions == 7);
+    CHECK(stats.ElidedTransitions > 0);
+    CHECK(CountTransitions(prologue) + CountTransitions(stream) == stats.FlushedBarriers + stats.ResolvedBarriers);
+
+    uint32 state = ~0u;
+    CHECK(states.GetState(&gTexture, 0, state) && state == StatePixelShaderResource);
+    CHECK(states.GetState(&gBuffer, 0, state) && state == StatePixelShaderResource);
+}
+} // namespace
+
+int main()
+{
+    TestBackendSubresourceThenWhole();
+    TestBackendRemembersStatesAcrossStreams();
+    TestTrackerElidesRedundantTransitions();
+    return CheckResult();
+}
@@ -0,0 +1,225 @@
+#include "Check.h"
+#include "Hash.h"
+#include "ShaderCache.h"
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+namespace fs = std::filesystem;
+
+std::string ReadText(const fs::path &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+void WriteText(const fs::path &path, const std::string &text)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << text;
+}
+
+// 代替 d3dcompiler 的桩编译器：字节码就是读到的源文件内容。
+// 源文件中的 "#include <文件名>" 行按主文件所在目录读取被包含的文件；以 "error" 开头的源文件编译失败
+class StubCompiler : public ShaderCompiler
+{
+  public:
+    ShaderCompileResult Compile(const ShaderCompileRequest &request) override
+    {
+        ++Calls;
+        ShaderCompileResult result;
+        const fs::path path(request.FileName);
+        const std::string source = ReadText(path);
+        result.Dependencies.push_back({path.wstring(), Hasher::Hash(source.data(), source.size())});
+
+        std::string output = source;
+        const std::string directive = "#include ";
+        if (source.compare(0, directive.size(), directive) == 0)
+        {
+            const fs::path includePath = path.parent_path() / source.substr(directive.size(), source.find('\n') -
+                                                                                                   directive.size());
+            const std::string include = ReadText(includePath);
+            result.Dependencies.push_back({includePath.wstring(), Hasher::Hash(include.data(), include.size())});
+            output += include;
+        }
+
+        // 模拟编译期间编辑器保存了文件
+        if (AfterRead)
+            AfterRead();
+
+        if (source.compare(0, 5, "error") == 0)
+        {
+            result.Errors = "syntax error";
+            return result;
+        }
+        result.Bytecode.assign(output.begin(), output.end());
+        result.Succeeded = true;
+        return result;
+    }
+
+    std::uint64_t Version() const override
+    {
+        return 1;
+    }
+
+    std::atomic<int> Calls{0};
+    std::function<void()> AfterRead;
+};
+
+std::string ToString(const std::vector<std::uint8_t> &bytes)
+{
+    return std::string(bytes.begin(), bytes.end());
+}
+
+struct TempDirectory
+{
+    fs::path Path = fs::temp_directory_path() / "ShaderCacheTest";
+
+    TempDirectory()
+    {
+        fs::remove_all(Path);
+        fs::create_directories(Path / "src");
+    }
+
+    ~TempDirectory()
+    {
+        fs::remove_all(Path);
+    }
+};
+
+ShaderCompileRequest MakeRequest(const fs::path &file)
+{
+    ShaderCompileRequest request;
+    request.FileName = file.wstring();
+    request.EntryPoint = "VS";
+    request.Target = "vs_5_1";
+    return request;
+}
+
+void TestHitAndInvalidation()
+{
+    TempDirectory temp;
+    const fs::path shader = temp.Path / "src" / "color.hlsl";
+    const fs::path include = temp.Path / "src" / "common.hlsli";
+    WriteText(shader, "#include common.hlsli\nmain");
+    WriteText(include, "v1");
+
+    StubCompiler compiler;
+    {
+        ShaderCache cache((temp.Path / "cache").wstring(), compiler);
+        ShaderCompileResult result = cache.GetOrCompile(MakeRequest(shader));
+        CHECK(result.Succeeded);
+        CHECK(ToString(result.Bytecode) == "#include common.hlsli\nmainv1");
+        CHECK(result.Dependencies.size() == 2);
+
+        // 命中时返回与编译时相同的依赖
+        result = cache.GetOrCompile(MakeRequest(shader));
+        CHECK(result.Succeeded);
+        CHECK(result.Dependencies.size() == 2);
+        CHECK(compiler.Calls == 1);
+
+        // 被包含的文件改变也使条目失效
+        WriteText(include, "v2");
+        result = cache.GetOrCompile(MakeRequest(shader));
+        CHECK(ToString(result.Bytecode) == "#include common.hlsli\nmainv2");
+        CHECK(compiler.Calls == 2);
+        CHECK(cache.GetStatistics().StaleEntries == 1);
+
+        // 失败的编译不写入缓存
+        const fs::path broken = temp.Path / "src" / "broken.hlsl";
+        WriteText(broken, "error");
+        CHECK(!cache.GetOrCompile(MakeRequest(broken)).Succeeded);
+        CHECK(!cache.GetOrCompile(MakeRequest(broken)).Succeeded);
+        CHECK(compiler.Calls == 4);
+    }
+
+    // 索引保存在磁盘上，新的缓存直接命中
+    ShaderCache cache((temp.Path / "cache").wstring(), compiler);
+    const ShaderCompileResult result = cache.GetOrCompile(MakeRequest(shader));
+    CHECK(ToString(result.Bytecode) == "#include common.hlsli\nmainv2");
+    CHECK(compiler.Calls == 4);
+    CHECK(cache.GetStatistics().Hits == 1);
+}
+
+void TestSourceChangedDuringCompile()
+{
+    TempDirectory temp;
+    const fs::path shader = temp.Path / "src" / "color.hlsl";
+    WriteText(shader, "v1");
+
+    StubCompiler compiler;
+    ShaderCache cache((temp.Path / "cache").wstring(), compiler);
+
+    // 编译器读到 v1 之后文件被改成 v2：字节码对应 v1，条目必须记录 v1 的哈希
+    compiler.AfterRead = [&shader]() { WriteText(shader, "v2"); };
+    ShaderCompileResult result = cache.GetOrCompile(MakeRequest(shader));
+    CHECK(ToString(result.Bytecode) == "v1");
+    CHECK(result.Dependencies.size() == 1 && result.Dependencies[0].ContentHash == Hasher::Hash("v1", 2));
+
+    // 下一次查找发现内容已经不同，重新编译而不是返回 v1 的字节码
+    compiler.AfterRead = nullptr;
+    result = cache.GetOrCompile(MakeRequest(shader));
+    CHECK(ToString(result.Bytecode) == "v2");
+    CHECK(compiler.Calls == 2);
+}
+
+// 多个缓存（相当于多个进程）共用同一个目录，在各自的线程中同时编译同样的请求并保存索引：
+// 每次写入都使用各自的临时文件，所有编译都成功，目录中不留下临时文件，之后的缓存能直接命中
+void TestConcurrentWriters()
+{
+    TempDirectory temp;
+    std::vector<fs::path> shaders;
+    for (int i = 0; i < 4; ++i)
+    {
+        shaders.push_back(temp.Path / "src" / ("shader" + std::to_string(i) + ".hlsl"));
+        WriteText(shaders.back(), "main" + std::to_string(i));
+    }
+
+    StubCompiler compiler;
+    const std::wstring directory = (temp.Path / "cache").wstring();
+    std::atomic<bool> start{false};
+    std::atomic<int> failures{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 8; ++t)
+    {
+        threads.emplace_back([&]() {
+            ShaderCache cache(directory, compiler);
+            while (!start)
+                std::this_thread::yield();
+            for (const fs::path &shader : shaders)
+            {
+                if (!cache.GetOrCompile(MakeRequest(shader)).Succeeded)
+                    ++failures;
+            }
+        });
+    }
+    start = true;
+    for (std::thread &thread : threads)
+        thread.join();
+    CHECK(failures == 0);
+
+    for (const auto &item : fs::directory_iterator(temp.Path / "cache"))
+        CHECK(item.path().extension() != ".tmp");
+
+    const int calls = compiler.Calls;
+    ShaderCache cache(directory, compiler);
+    for (size_t i = 0; i < shaders.size(); ++i)
+        CHECK(ToString(cache.GetOrCompile(MakeRequest(shaders[i])).Bytecode) == "main" + std::to_string(i));
+    CHECK(compiler.Calls == calls);
+}
+} // namespace
+
+int main()
+{
+    TestHitAndInvalidation();
+    TestSourceChangedDuringCompile();
+    TestConcurrentWriters();
+    return CheckResult();
+}
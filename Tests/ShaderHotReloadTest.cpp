@@ -0,0 +1,268 @@
+#include "Check.h"
+#include "Hash.h"
+#include "ShaderHotReload.h"
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+namespace fs = std::filesystem;
+
+const fs::path gDirectory = fs::temp_directory_path() / "ShaderHotReloadTest";
+
+// 写入文件，并把修改时间向后推，保证 FileWatcher 在文件系统时间精度较粗时也能看到变化
+void WriteSource(const std::string &name, const std::string &text)
+{
+    static int generation = 0;
+    const fs::path path = gDirectory / name;
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << text;
+    fs::last_write_time(path, fs::last_write_time(path) + std::chrono::seconds(++generation));
+}
+
+// 代替 d3dcompiler 的桩编译器：字节码为源文件内容加上入口点，"#include <文件名>" 行被展开，
+// 以 // 开头的行（注释）不进入字节码，含有 error 的源文件编译失败
+class StubCompiler : public ShaderCompiler
+{
+  public:
+    ShaderCompileResult Compile(const ShaderCompileRequest &request) override
+    {
+        ++Calls;
+        ShaderCompileResult result;
+        std::string output;
+        if (!Read(fs::path(request.FileName), output, result.Dependencies))
+        {
+            result.Errors = "cannot open the source";
+            return result;
+        }
+        if (output.find("error") != std::string::npos)
+        {
+            result.Errors = "syntax error";
+            return result;
+        }
+        output += request.EntryPoint;
+        result.Bytecode.assign(output.begin(), output.end());
+        result.Succeeded = true;
+        return result;
+    }
+
+    std::uint64_t Version() const override
+    {
+        return 1;
+    }
+
+    std::atomic<int> Calls{0};
+
+  private:
+    static bool Read(const fs::path &path, std::string &output, std::vector<ShaderDependency> &dependencies)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+            return false;
+        const std::string source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        dependencies.push_back({path.wstring(), Hasher::Hash(source.data(), source.size())});
+
+        size_t begin = 0;
+        while (begin < source.size())
+        {
+            size_t end = source.find('\n', begin);
+            end = end == std::string::npos ? source.size() : end + 1;
+            const std::string line = source.substr(begin, end - begin);
+            begin = end;
+
+            if (line.compare(0, 9, "#include ") == 0)
+            {
+                if (!Read(path.parent_path() / line.substr(9, line.find('\n') - 9), output, dependencies))
+                    return false;
+            }
+            else if (line.compare(0, 2, "//") != 0)
+            {
+                output += line;
+            }
+        }
+        return true;
+    }
+};
+
+ShaderCompileRequest MakeRequest(const std::string &file, const std::string &entryPoint)
+{
+    ShaderCompileRequest request;
+    request.FileName = (gDirectory / file).wstring();
+    request.EntryPoint = entryPoint;
+    request.Target = entryPoint == "VS" ? "vs_5_1" : "ps_5_1";
+    return request;
+}
+
+// 记录管线当前使用的字节码（提交之后才改变）与创建的次数
+struct PipelineState
+{
+    std::string Current;
+    std::atomic<int> Builds{0};
+};
+
+ShaderHotReload::PipelineBuilder MakeBuilder(PipelineState &state)
+{
+    return [&state](const std::vector<ShaderHotReload::Bytecode> &shaders) -> ShaderHotReload::Commit {
+        ++state.Builds;
+        std::string inputs;
+        for (const ShaderHotReload::Bytecode &bytecode : shaders)
+            inputs += std::string(bytecode->begin(), bytecode->end()) + "|";
+        if (inputs.find("throw") != std::string::npos)
+            throw std::runtime_error("cannot create the pipeline state");
+        return [&state, inputs]() { state.Current = inputs; };
+    };
+}
+
+struct Fixture
+{
+    Fixture()
+    {
+        fs::remove_all(gDirectory);
+        fs::create_directories(gDirectory);
+    }
+
+    ~Fixture()
+    {
+        fs::remove_all(gDirectory);
+    }
+};
+
+// 检查文件并等待这一轮重新编译结束，返回换入的管线数量
+ShaderHotReload::uint32 Step(ShaderHotReload &reload)
+{
+    reload.CheckForChanges();
+    reload.WaitIdle();
+    return reload.ApplyPendingChanges();
+}
+
+void TestDependencies()
+{
+    Fixture fixture;
+    WriteSource("common.hlsli", "float common;\n");
+    WriteSource("a.hlsl", "#include common.hlsli\nA\n");
+    WriteSource("b.hlsl", "B\n");
+
+    StubCompiler compiler;
+    ShaderCache cache((gDirectory / "cache").wstring(), compiler);
+    ThreadPool threadPool(2);
+    ShaderHotReload reload(cache, threadPool, std::chrono::milliseconds(0));
+
+    const std::vector<ShaderHotReload::uint32> shaders =
+        reload.AddShaders({MakeRequest("a.hlsl", "VS"), MakeRequest("a.hlsl", "PS"), MakeRequest("b.hlsl", "PS")});
+    PipelineState first;
+    PipelineState second;
+    reload.AddPipeline({shaders[0], shaders[2]}, MakeBuilder(first));
+    reload.AddPipeline({shaders[1]}, MakeBuilder(second));
+
+    CHECK(Step(reload) == 0);
+
+    // 只重新创建用到了改变的着色器的管线，并且在提交之前管线保持不变
+    WriteSource("b.hlsl", "B2\n");
+    reload.CheckForChanges();
+    reload.WaitIdle();
+    CHECK(first.Builds == 1 && second.Builds == 0);
+    CHECK(first.Current.empty());
+    CHECK(reload.ApplyPendingChanges() == 1);
+    CHECK(first.Current == "float common;\nA\nVS|B2\nPS|");
+
+    // 被包含的文件只改了注释：重新编译，但字节码不变，不创建管线
+    const int calls = compiler.Calls;
+    WriteSource("common.hlsli", "// comment\nfloat common;\n");
+    CHECK(Step(reload) == 0);
+    CHECK(compiler.Calls - calls == 2);
+
+    WriteSource("common.hlsli", "float common2;\n");
+    CHECK(Step(reload) == 2);
+    CHECK(second.Current == "float common2;\nA\nPS|");
+
+    // 新加入的 #include 也被监视
+    WriteSource("extra.hlsli", "X\n");
+    WriteSource("b.hlsl", "#include extra.hlsli\nB3\n");
+    CHECK(Step(reload) == 1);
+    WriteSource("extra.hlsli", "X2\n");
+    CHECK(Step(reload) == 1);
+    CHECK(first.Current == "float common2;\nA\nVS|X2\nB3\nPS|");
+    CHECK(reload.TakeErrors().empty());
+}
+
+// 顶点着色器的改动与像素着色器的语法错误同时发生：修好像素着色器之后，管线必须同时用上新的顶点着色器
+void TestSkippedChangeIsNotLost()
+{
+    Fixture fixture;
+    WriteSource("vs.hlsl", "v1\n");
+    WriteSource("ps.hlsl", "p1\n");
+
+    StubCompiler compiler;
+    ShaderCache cache((gDirectory / "cache").wstring(), compiler);
+    ThreadPool threadPool(2);
+    ShaderHotReload reload(cache, threadPool, std::chrono::milliseconds(0));
+
+    const std::vector<ShaderHotReload::uint32> shaders =
+        reload.AddShaders({MakeRequest("vs.hlsl", "VS"), MakeRequest("ps.hlsl", "PS")});
+    PipelineState pipeline;
+    reload.AddPipeline(shaders, MakeBuilder(pipeline));
+
+    WriteSource("vs.hlsl", "v2\n");
+    WriteSource("ps.hlsl", "p1 error\n");
+    CHECK(Step(reload) == 0);
+    CHECK(reload.TakeErrors().size() == 1);
+    CHECK(pipeline.Builds == 0);
+
+    // 像素着色器改回原样，它的字节码与上次创建管线时相同，但顶点着色器已经不同
+    WriteSource("ps.hlsl", "p1\n");
+    CHECK(Step(reload) == 1);
+    CHECK(pipeline.Current == "v2\nVS|p1\nPS|");
+
+    // 创建失败的改动同样会在下一轮重试
+    WriteSource("vs.hlsl", "v3\n");
+    WriteSource("ps.hlsl", "throw\n");
+    CHECK(Step(reload) == 0);
+    CHECK(reload.TakeErrors().size() == 1);
+    WriteSource("ps.hlsl", "p3\n");
+    CHECK(Step(reload) == 1);
+    CHECK(pipeline.Current == "v3\nVS|p3\nPS|");
+
+    // 已经用上的字节码不会再次触发创建
+    const int builds = pipeline.Builds;
+    WriteSource("ps.hlsl", "// comment\np3\n");
+    CHECK(Step(reload) == 0);
+    CHECK(pipeline.Builds == builds);
+    CHECK(reload.TakeErrors().empty());
+}
+
+void TestMissingFile()
+{
+    Fixture fixture;
+    StubCompiler compiler;
+    ShaderCache cache((gDirectory / "cache").wstring(), compiler);
+    ThreadPool threadPool(2);
+    ShaderHotReload reload(cache, threadPool, std::chrono::milliseconds(0));
+
+    // 启动时不存在的着色器在文件被创建之后编译，用它的管线随之创建
+    const std::vector<ShaderHotReload::uint32> shaders = reload.AddShaders({MakeRequest("late.hlsl", "PS")});
+    PipelineState pipeline;
+    reload.AddPipeline(shaders, MakeBuilder(pipeline));
+    CHECK(Step(reload) == 0);
+
+    WriteSource("late.hlsl", "L\n");
+    CHECK(Step(reload) == 1);
+    CHECK(pipeline.Current == "L\nPS|");
+
+    fs::remove(gDirectory / "late.hlsl");
+    CHECK(Step(reload) == 0);
+    CHECK(reload.TakeErrors().size() == 1);
+    CHECK(pipeline.Current == "L\nPS|");
+}
+} // namespace
+
+int main()
+{
+    TestDependencies();
+    TestSkippedChangeIsNotLost();
+    TestMissingFile();
+    return CheckResult();
+}
@@ -0,0 +1,154 @@
+#include "Check.h"
+#include "StagingArena.h"
+#include <utility>
+#include <vector>
+
+namespace
+{
+using uint64 = StagingArena::uint64;
+
+const uint64 Invalid = StagingArena::InvalidOffset;
+
+// 对齐产生的空隙计入已用空间，随所在的批次一起释放
+void TestAlignment()
+{
+    StagingArena arena(256);
+    CHECK(arena.Allocate(3, 1) == 0);
+    CHECK(arena.Allocate(8, 16) == 16);
+    CHECK(arena.UsedBytes() == 24 && arena.PendingBytes() == 24);
+    CHECK(arena.Allocate(1, 64) == 64);
+    CHECK(arena.Allocate(5, 4) == 68);
+    CHECK(arena.UsedBytes() == 73);
+
+    // 对齐之后放不下时失败，已用空间不变
+    CHECK(arena.Allocate(200, 128) == Invalid);
+    CHECK(arena.UsedBytes() == 73);
+
+    // 空的与超过容量的分配总是失败
+    CHECK(arena.Allocate(0, 16) == Invalid);
+    CHECK(arena.Allocate(257, 1) == Invalid);
+
+    arena.Retire(1);
+    CHECK(arena.PendingBytes() == 0);
+    arena.Release(1);
+    CHECK(arena.UsedBytes() == 0);
+
+    // 全部释放后从头开始分配
+    CHECK(arena.Allocate(256, 256) == 0);
+    CHECK(arena.Allocate(1, 1) == Invalid);
+}
+
+// 只有围栏完成的批次才会释放，且按提交顺序释放
+void TestFenceGatedRelease()
+{
+    StagingArena arena(100);
+    CHECK(arena.Allocate(40, 1) == 0);
+    arena.Retire(5);
+    CHECK(arena.Allocate(40, 1) == 40);
+    arena.Retire(6);
+    CHECK(arena.Allocate(30, 1) == Invalid);
+
+    // 没有待回收的空间时 Retire 不产生新的批次
+    arena.Retire(7);
+
+    arena.Release(4);
+    CHECK(arena.UsedBytes() == 80);
+    CHECK(arena.Allocate(30, 1) == Invalid);
+
+    arena.Release(5);
+    CHECK(arena.UsedBytes() == 40);
+    // 末尾剩余 20 字节，放不下时回绕到已释放的开头
+    CHECK(arena.Allocate(30, 1) == 0);
+    CHECK(arena.UsedBytes() == 90);
+    CHECK(arena.PendingBytes() == 50);
+
+    // 回绕后的空闲空间只有 [30, 40)
+    CHECK(arena.Allocate(11, 1) == Invalid);
+    CHECK(arena.Allocate(10, 1) == 30);
+    CHECK(arena.Allocate(1, 1) == Invalid);
+    CHECK(arena.UsedBytes() == 100);
+    arena.Retire(8);
+
+    // 围栏 6 完成只释放第二批；第三批（含回绕浪费的末尾 20 字节）要等到围栏 8
+    arena.Release(6);
+    CHECK(arena.UsedBytes() == 60);
+    CHECK(arena.Allocate(40, 1) == 40);
+    arena.Retire(9);
+    arena.Release(9);
+    CHECK(arena.UsedBytes() == 0 && arena.PendingBytes() == 0);
+}
+
+// 大小与对齐各不相同的分配反复回绕：返回的区间对齐、互不重叠且不越界，释放后已用空间归零
+void TestWrapAround()
+{
+    const uint64 capacity = 1000;
+    StagingArena arena(capacity);
+
+    struct Batch
+    {
+        uint64 Fence;
+        uint64 Begin;
+        uint64 End;
+    };
+    uint64 live[capacity] = {};
+    std::vector<Batch> batches;
+    std::vector<std::pair<uint64, uint64>> current;
+    uint64 fence = 0;
+    uint64 wraps = 0;
+    uint64 lastOffset = 0;
+
+    for (uint64 i = 0; i < 5000; ++i)
+    {
+        const uint64 size = 1 + (i * 37) % 97;
+        const uint64 alignment = uint64(1) << (i % 5);
+        const uint64 offset = arena.Allocate(size, alignment);
+        if (offset != Invalid)
+        {
+            CHECK(offset % alignment == 0);
+            CHECK(offset + size <= capacity);
+            for (uint64 b = offset; b < offset + size; ++b)
+                CHECK(live[b]++ == 0);
+            current.emplace_back(offset, offset + size);
+            wraps += offset < lastOffset;
+            lastOffset = offset;
+        }
+
+        // 每 4 次分配提交一次，GPU 落后两次提交
+        if (i % 4 == 3)
+        {
+            arena.Retire(++fence);
+            for (const auto &range : current)
+                batches.push_back({fence, range.first, range.second});
+            current.clear();
+
+            if (fence > 2)
+            {
+                const uint64 completed = fence - 2;
+                arena.Release(completed);
+                for (const Batch &batch : batches)
+                {
+                    if (batch.Fence == completed)
+                    {
+                        for (uint64 b = batch.Begin; b < batch.End; ++b)
+                            --live[b];
+                    }
+                }
+            }
+        }
+        CHECK(arena.UsedBytes() <= capacity);
+    }
+    CHECK(wraps > 10);
+
+    arena.Retire(++fence);
+    arena.Release(fence);
+    CHECK(arena.UsedBytes() == 0 && arena.PendingBytes() == 0);
+}
+} // namespace
+
+int main()
+{
+    TestAlignment();
+    TestFenceGatedRelease();
+    TestWrapAround();
+    return CheckResult();
+}
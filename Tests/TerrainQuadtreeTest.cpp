@@ -0,0 +1,251 @@
+#include "Check.h"
+#include "TerrainQuadtree.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <unordered_map>
+
+using namespace DirectX;
+
+namespace
+{
+using uint32 = TerrainQuadtree::uint32;
+
+TerrainSettings MakeSettings()
+{
+    TerrainSettings settings;
+    settings.RootChunkSize = 64.0f;
+    settings.ChunkResolution = 9;
+    settings.MaxLevel = 5;
+    settings.ViewDistance = 200.0f;
+    settings.MaxResidentChunks = 4096;
+    settings.MaxInFlightRequests = 64;
+    return settings;
+}
+
+// 与 ShapesApp 相同的投影：60° 视场角、720 像素高的视口
+const float ProjectionScale = 720.0f / (2.0f * std::tan(0.5f * 1.0471976f));
+
+// 观察点到块包围盒的距离，与 TerrainQuadtree::Select 的计算相同
+float BoxDistance(const TerrainChunk &chunk, const XMFLOAT3 &eye)
+{
+    float half = 0.5f * chunk.Size;
+    float dx = std::max(std::abs(eye.x - chunk.Origin.x) - half, 0.0f);
+    float dz = std::max(std::abs(eye.z - chunk.Origin.z) - half, 0.0f);
+    float dy = std::max({chunk.MinHeight - eye.y, eye.y - chunk.MaxHeight, 0.0f});
+    return std::max(std::sqrt(dx * dx + dy * dy + dz * dz), 1e-3f);
+}
+
+bool NeedsRefinement(const TerrainChunk &chunk, const XMFLOAT3 &eye, const TerrainSettings &settings)
+{
+    return chunk.GeometricError * ProjectionScale > settings.PixelErrorThreshold * BoxDistance(chunk, eye);
+}
+
+// 同步模式下反复 Update，直到不再生成新的块
+void Settle(TerrainQuadtree &terrain, const XMFLOAT3 &eye)
+{
+    for (int i = 0; i < 100; ++i)
+    {
+        const TerrainQuadtree::uint64 generated = terrain.GetStats().GeneratedTotal;
+        terrain.Update(eye, ProjectionScale);
+        if (terrain.GetStats().GeneratedTotal == generated)
+            return;
+    }
+    CHECK(false);
+}
+
+// 把选出的块按最细一级的单元展开，返回单元坐标到块级别的映射
+std::unordered_map<std::uint64_t, uint32> Rasterize(const TerrainQuadtree &terrain, const TerrainSettings &settings,
+                                                    bool &overlap)
+{
+    std::unordered_map<std::uint64_t, uint32> cells;
+    overlap = false;
+    for (const TerrainChunk *chunk : terrain.SelectedChunks())
+    {
+        const std::int32_t span = 1 << (settings.MaxLevel - chunk->Key.Level);
+        for (std::int32_t z = 0; z < span; ++z)
+        {
+            for (std::int32_t x = 0; x < span; ++x)
+            {
+                TerrainChunkKey cell;
+                cell.X = chunk->Key.X * span + x;
+                cell.Z = chunk->Key.Z * span + z;
+                overlap |= !cells.emplace(cell.Pack(), chunk->Key.Level).second;
+            }
+        }
+    }
+    return cells;
+}
+
+// 与 key 所在区域的四条边外侧相邻的单元中最细的级别
+uint32 FinestNeighbourLevel(const std::unordered_map<std::uint64_t, uint32> &cells, const TerrainChunkKey &key,
+                            const TerrainSettings &settings)
+{
+    const std::int32_t span = 1 << (settings.MaxLevel - key.Level);
+    const std::int32_t x0 = key.X * span;
+    const std::int32_t z0 = key.Z * span;
+    uint32 finest = 0;
+    for (std::int32_t i = 0; i < span; ++i)
+    {
+        const std::int32_t neighbours[4][2] = {
+            {x0 - 1, z0 + i}, {x0 + span, z0 + i}, {x0 + i, z0 - 1}, {x0 + i, z0 + span}};
+        for (const auto &n : neighbours)
+        {
+            TerrainChunkKey cell;
+            cell.X = n[0];
+            cell.Z = n[1];
+            auto it = cells.find(cell.Pack());
+            if (it != cells.end())
+                finest = std::max(finest, it->second);
+        }
+    }
+    return finest;
+}
+
+// 每个选出的块都满足误差阈值（或已是最细一级）；它的父块不满足阈值，或者父块的邻居比父块细两级以上，
+// 为了平衡而被细分：选出的正是满足这两个条件的最粗糙级别
+void TestScreenSpaceErrorSelection()
+{
+    const TerrainSettings settings = MakeSettings();
+    HillsHeightField field;
+    TerrainQuadtree terrain(field, settings, nullptr);
+
+    const XMFLOAT3 eye(10.0f, 40.0f, -20.0f);
+    Settle(terrain, eye);
+
+    bool overlap = false;
+    const auto cells = Rasterize(terrain, settings, overlap);
+    CHECK(!overlap);
+
+    const auto &selected = terrain.SelectedChunks();
+    CHECK(!selected.empty());
+    uint32 minLevel = settings.MaxLevel;
+    uint32 maxLevel = 0;
+    for (const TerrainChunk *chunk : selected)
+    {
+        minLevel = std::min(minLevel, chunk->Key.Level);
+        maxLevel = std::max(maxLevel, chunk->Key.Level);
+        CHECK(chunk->Key.Level == settings.MaxLevel || !NeedsRefinement(*chunk, eye, settings));
+
+        if (chunk->Key.Level > 0)
+        {
+            TerrainChunkKey parent;
+            parent.Level = chunk->Key.Level - 1;
+            parent.X = chunk->Key.X >> 1;
+            parent.Z = chunk->Key.Z >> 1;
+            CHECK(NeedsRefinement(*terrain.GenerateChunk(parent), eye, settings) ||
+                  FinestNeighbourLevel(cells, parent, settings) >= parent.Level + 2);
+        }
+    }
+    // 近处细分、远处粗糙
+    CHECK(minLevel < maxLevel);
+
+    // 选出的块拼满所有参与选择的根块
+    size_t roots = 0;
+    for (std::int32_t z = -10; z <= 10; ++z)
+    {
+        for (std::int32_t x = -10; x <= 10; ++x)
+        {
+            const float size = settings.RootChunkSize;
+            float dx = std::max(std::abs(eye.x - (x + 0.5f) * size) - 0.5f * size, 0.0f);
+            float dz = std::max(std::abs(eye.z - (z + 0.5f) * size) - 0.5f * size, 0.0f);
+            if (std::sqrt(dx * dx + dz * dz) <= settings.ViewDistance)
+                ++roots;
+        }
+    }
+    CHECK(cells.size() == roots << (2 * settings.MaxLevel));
+
+    // 抬高观察点后误差在屏幕上变小，选出的块更少
+    const size_t nearCount = selected.size();
+    Settle(terrain, XMFLOAT3(eye.x, 400.0f, eye.z));
+    CHECK(terrain.SelectedChunks().size() < nearCount);
+}
+
+// 平地上的一座陡峭山峰：山峰所在的块误差很大，周围的块误差为 0
+class PeakHeightField : public HeightField
+{
+  public:
+    float Height(float x, float z) const override
+    {
+        const float dx = x - 100.0f;
+        const float dz = z - 40.0f;
+        return 30.0f * std::exp(-(dx * dx + dz * dz) / 50.0f);
+    }
+
+    XMFLOAT3 Normal(float x, float z) const override
+    {
+        const float h = Height(x, z);
+        XMFLOAT3 n(h * (x - 100.0f) / 25.0f, 1.0f, h * (z - 40.0f) / 25.0f);
+        XMStoreFloat3(&n, XMVector3Normalize(XMLoadFloat3(&n)));
+        return n;
+    }
+};
+
+// 相邻的块级别相差不超过 1，裙边只需遮挡一级之间的裂缝。误差在空间上变化剧烈时（例如平地上的山峰），
+// 只按屏幕空间误差选择会出现相差多级的邻居
+void TestNeighbourLevels()
+{
+    TerrainSettings settings = MakeSettings();
+    settings.MaxResidentChunks = 16384;
+    HillsHeightField hills;
+    PeakHeightField peak;
+
+    for (const HeightField *field : {static_cast<const HeightField *>(&hills), static_cast<const HeightField *>(&peak)})
+    {
+        TerrainQuadtree terrain(*field, settings, nullptr);
+        for (int i = 0; i < 6; ++i)
+        {
+            const XMFLOAT3 eye(i * 97.3f - 200.0f, static_cast<float>((i % 3) * (i % 3)) * 8.0f + 2.0f,
+                               i * -63.1f + 150.0f);
+            Settle(terrain, eye);
+            bool overlap = false;
+            const auto cells = Rasterize(terrain, settings, overlap);
+            CHECK(!overlap);
+
+            for (const TerrainChunk *chunk : terrain.SelectedChunks())
+                CHECK(FinestNeighbourLevel(cells, chunk->Key, settings) <= chunk->Key.Level + 1);
+        }
+    }
+}
+
+// 观察点持续移动时，驻留的块数始终不超过上限，离开视野的块被淘汰
+void TestResidentBudget()
+{
+    TerrainSettings settings = MakeSettings();
+    settings.MaxResidentChunks = 256;
+    settings.MaxInFlightRequests = 8;
+    HillsHeightField field;
+    ThreadPool threadPool(2);
+
+    for (ThreadPool *pool : {static_cast<ThreadPool *>(nullptr), &threadPool})
+    {
+        TerrainQuadtree terrain(field, settings, pool);
+        for (int frame = 0; frame < 400; ++frame)
+        {
+            terrain.Update(XMFLOAT3(frame * 8.0f, 10.0f, frame * 3.0f), ProjectionScale);
+            const TerrainQuadtree::Stats &stats = terrain.GetStats();
+            CHECK(stats.ResidentChunks <= settings.MaxResidentChunks);
+            CHECK(stats.InFlightRequests <= settings.MaxInFlightRequests);
+            CHECK(stats.SelectedChunks > 0 || frame == 0);
+
+            // 后台生成的块在下一帧之前完成，使两种模式每帧生成的块数相同
+            terrain.WaitForPendingChunks();
+            CHECK(terrain.GetStats().ResidentChunks <= settings.MaxResidentChunks);
+        }
+
+        const TerrainQuadtree::Stats &stats = terrain.GetStats();
+        CHECK(stats.ResidentChunks == settings.MaxResidentChunks);
+        CHECK(stats.EvictedTotal > 0);
+        CHECK(stats.GeneratedTotal == stats.ResidentChunks + stats.EvictedTotal);
+    }
+}
+} // namespace
+
+int main()
+{
+    TestScreenSpaceErrorSelection();
+    TestNeighbourLevels();
+    TestResidentBudget();
+    return CheckResult();
+}
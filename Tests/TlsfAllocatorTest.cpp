@@ -0,0 +1,169 @@
+#include "Check.h"
+#include "TlsfAllocator.h"
+#include <algorithm>
+#include <random>
+#include <vector>
+
+namespace
+{
+using uint64 = TlsfAllocator::uint64;
+
+// 已分配的区间互不重叠，且都在容量范围内
+bool NoOverlap(std::vector<TlsfAllocator::Allocation> allocations, uint64 capacity)
+{
+    std::sort(allocations.begin(), allocations.end(),
+              [](const TlsfAllocator::Allocation &a, const TlsfAllocator::Allocation &b) { return a.Offset < b.Offset; });
+    for (size_t i = 0; i < allocations.size(); ++i)
+    {
+        if (allocations[i].Offset + allocations[i].Size > capacity)
+            return false;
+        if (i > 0 && allocations[i - 1].Offset + allocations[i - 1].Size > allocations[i].Offset)
+            return false;
+    }
+    return true;
+}
+
+void TestBasic()
+{
+    TlsfAllocator allocator(1 << 20, 256);
+    CHECK(allocator.Capacity() == (1 << 20));
+    CHECK(allocator.IsEmpty());
+
+    // 大小向上取整到 granularity
+    TlsfAllocator::Allocation a = allocator.Allocate(100, 256);
+    CHECK(a.IsValid());
+    CHECK(a.Size == 256);
+    CHECK(a.Offset % 256 == 0);
+
+    // 对齐大于 granularity 时偏移量也要满足对齐
+    TlsfAllocator::Allocation b = allocator.Allocate(4096, 65536);
+    CHECK(b.IsValid());
+    CHECK(b.Offset % 65536 == 0);
+    CHECK(allocator.AllocationCount() == 2);
+    CHECK(allocator.UsedBytes() == a.Size + b.Size);
+    CHECK(NoOverlap({a, b}, allocator.Capacity()));
+
+    allocator.Free(a);
+    allocator.Free(b);
+    CHECK(allocator.IsEmpty());
+    CHECK(allocator.UsedBytes() == 0);
+}
+
+void TestExhaustionAndCoalescing()
+{
+    const uint64 capacity = 64 * 1024;
+    TlsfAllocator allocator(capacity, 1024);
+
+    std::vector<TlsfAllocator::Allocation> allocations;
+    for (int i = 0; i < 64; ++i)
+    {
+        allocations.push_back(allocator.Allocate(1024, 1024));
+        CHECK(allocations.back().IsValid());
+    }
+    CHECK(allocator.UsedBytes() == capacity);
+    CHECK(!allocator.Allocate(1024, 1024).IsValid());
+
+    // 隔一个释放一个：空闲总量为一半，但最大的空闲块只有 1 KB
+    for (size_t i = 0; i < allocations.size(); i += 2)
+        allocator.Free(allocations[i]);
+    TlsfAllocator::Statistics stats = allocator.GetStatistics();
+    CHECK(stats.FreeBytes == capacity / 2);
+    CHECK(stats.LargestFreeBlock == 1024);
+    CHECK(stats.FreeBlockCount == 32);
+    CHECK(stats.Fragmentation() > 0.9f);
+    CHECK(!allocator.Allocate(2048, 1024).IsValid());
+
+    // 全部释放后与相邻的空闲块合并，重新连成一整块
+    for (size_t i = 1; i < allocations.size(); i += 2)
+        allocator.Free(allocations[i]);
+    stats = allocator.GetStatistics();
+    CHECK(stats.FreeBlockCount == 1);
+    CHECK(stats.LargestFreeBlock == capacity);
+    CHECK(stats.Fragmentation() == 0.0f);
+    CHECK(allocator.Allocate(capacity, 1024).IsValid());
+}
+
+void TestRandomized()
+{
+    const uint64 capacity = 256ull << 20;
+    TlsfAllocator allocator(capacity, 256);
+    std::mt19937 random(1234);
+    std::vector<TlsfAllocator::Allocation> live;
+
+    for (int step = 0; step < 20000; ++step)
+    {
+        if (live.empty() || random() % 3 != 0)
+        {
+            const uint64 size = 1 + random() % (1 << 20);
+            const uint64 alignment = 256ull << (random() % 9);
+            TlsfAllocator::Allocation allocation = allocator.Allocate(size, alignment);
+            if (allocation.IsValid())
+            {
+                CHECK(allocation.Offset % alignment == 0);
+                CHECK(allocation.Size >= size);
+                live.push_back(allocation);
+            }
+        }
+        else
+        {
+            const size_t index = random() % live.size();
+            allocator.Free(live[index]);
+            live[index] = live.back();
+            live.pop_back();
+        }
+
+        if (step % 1000 == 0)
+            CHECK(NoOverlap(live, capacity));
+    }
+
+    uint64 used = 0;
+    for (const auto &allocation : live)
+        used += allocation.Size;
+    CHECK(allocator.UsedBytes() == used);
+    CHECK(NoOverlap(live, capacity));
+
+    for (const auto &allocation : live)
+        allocator.Free(allocation);
+    CHECK(allocator.IsEmpty());
+    CHECK(allocator.GetStatistics().FreeBlockCount == 1);
+}
+
+void BenchmarkAllocateFree()
+{
+    TlsfAllocator allocator(1ull << 32, 256);
+    std::mt19937 random(42);
+    std::vector<TlsfAllocator::Allocation> live;
+    live.reserve(4096);
+
+    const unsigned operations = 1000000;
+    Benchmark("TlsfAllocator allocate/free (4096 live)", operations, [&]() {
+        for (unsigned i = 0; i < operations; ++i)
+        {
+            if (live.size() < 4096)
+            {
+                live.push_back(allocator.Allocate(256 + random() % (256 * 1024), 256));
+            }
+            else
+            {
+                const size_t index = random() % live.size();
+                allocator.Free(live[index]);
+                live[index] = live.back();
+                live.pop_back();
+            }
+        }
+    });
+
+    const TlsfAllocator::Statistics stats = allocator.GetStatistics();
+    std::printf("[benchmark] %u live allocations, fragmentation %.3f\n", stats.AllocationCount,
+                stats.Fragmentation());
+}
+} // namespace
+
+int main()
+{
+    TestBasic();
+    TestExhaustionAndCoalescing();
+    TestRandomized();
+    BenchmarkAllocateFree();
+    return CheckResult();
+}
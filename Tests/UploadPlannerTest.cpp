@@ -0,0 +1,162 @@
+#include "Check.h"
+#include "NullCommandBackend.h"
+#include "UploadPlanner.h"
+#include <vector>
+
+namespace
+{
+using uint32 = UploadPlanner::uint32;
+using uint64 = UploadPlanner::uint64;
+
+// D3D12_RESOURCE_STATES 中用到的几个值
+const uint32 StateCommon = 0x0;
+const uint32 StateVertexAndConstantBuffer = 0x1;
+const uint32 StateIndexBuffer = 0x2;
+const uint32 StateCopyDest = 0x400;
+const uint32 StateGenericRead = 0xac3;
+
+int gVertexBuffer, gIndexBuffer, gConstantBuffer, gStaging;
+
+UploadPlanner::Upload MakeUpload(void *destination, uint64 destinationOffset, uint64 sourceOffset, uint64 byteSize,
+                                 uint32 stateBefore, uint32 stateAfter)
+{
+    UploadPlanner::Upload upload;
+    upload.Destination = destination;
+    upload.DestinationOffset = destinationOffset;
+    upload.Source = &gStaging;
+    upload.SourceOffset = sourceOffset;
+    upload.ByteSize = byteSize;
+    upload.StateBefore = stateBefore;
+    upload.StateAfter = stateAfter;
+    return upload;
+}
+
+// 按 UploadBatch::Record 的顺序执行两个命令流
+void Execute(NullCommandBackend &backend, const CommandStream &prologue, const CommandStream &commands)
+{
+    backend.Execute(prologue);
+    backend.Execute(commands);
+}
+
+// 每次上传都对应一条复制命令，参数原样保留
+void TestCopies()
+{
+    const std::vector<UploadPlanner::Upload> uploads = {
+        MakeUpload(&gVertexBuffer, 0, 0, 256, StateCommon, StateVertexAndConstantBuffer),
+        MakeUpload(&gIndexBuffer, 0, 256, 64, StateCommon, StateIndexBuffer),
+        MakeUpload(&gVertexBuffer, 256, 320, 128, StateCommon, StateVertexAndConstantBuffer)};
+
+    ResourceStateMap states;
+    CommandStream prologue, commands;
+    UploadPlanner::Record(uploads, states, prologue, commands);
+
+    size_t copy = 0;
+    commands.ForEach([&](CommandType type, const void *payload) {
+        if (type != CommandType::CopyBufferRegion)
+            return;
+        const auto *cmd = static_cast<const CmdCopyBufferRegion *>(payload);
+        CHECK(copy < uploads.size());
+        if (copy >= uploads.size())
+            return;
+        const UploadPlanner::Upload &upload = uploads[copy++];
+        CHECK(cmd->DestinationBuffer == upload.Destination && cmd->SourceBuffer == upload.Source);
+        CHECK(cmd->DestinationOffset == upload.DestinationOffset && cmd->SourceOffset == upload.SourceOffset);
+        CHECK(cmd->NumBytes == upload.ByteSize);
+    });
+    CHECK(copy == uploads.size());
+
+    // 复制命令执行时目标资源已处于 COPY_DEST，结束后处于各自的 StateAfter
+    NullCommandBackend backend;
+    Execute(backend, prologue, commands);
+    const NullCommandBackend::Statistics &stats = backend.GetStatistics();
+    CHECK(stats.ErrorCount == 0);
+    CHECK(backend.GetCommandCount(CommandType::CopyBufferRegion) == 3);
+
+    uint32 state = 0;
+    CHECK(backend.GetResourceState(&gVertexBuffer, 0, state) && state == StateVertexAndConstantBuffer);
+    CHECK(backend.GetResourceState(&gIndexBuffer, 0, state) && state == StateIndexBuffer);
+    CHECK(states.GetState(&gVertexBuffer, 0, state) && state == StateVertexAndConstantBuffer);
+    CHECK(states.GetState(&gIndexBuffer, 0, state) && state == StateIndexBuffer);
+
+    // 空的一批不产生任何命令
+    CommandStream emptyPrologue, emptyCommands;
+    UploadPlanner::Record({}, states, emptyPrologue, emptyCommands);
+    CHECK(emptyPrologue.CommandCount() == 0 && emptyCommands.CommandCount() == 0);
+}
+
+// 每个资源只转换一次，复制之前与之后的屏障各自合并为一次 ResourceBarrier 调用
+void TestBatchedBarriers()
+{
+    std::vector<UploadPlanner::Upload> uploads;
+    for (uint32 i = 0; i < 4; ++i)
+    {
+        uploads.push_back(MakeUpload(&gVertexBuffer, i * 64, i * 64, 64, StateCommon, StateGenericRead));
+        uploads.push_back(MakeUpload(&gIndexBuffer, i * 16, 256 + i * 16, 16, StateCommon, StateIndexBuffer));
+    }
+
+    ResourceStateMap states;
+    CommandStream prologue, commands;
+    UploadPlanner::Record(uploads, states, prologue, commands);
+
+    NullCommandBackend backend;
+    Execute(backend, prologue, commands);
+    const NullCommandBackend::Statistics &stats = backend.GetStatistics();
+    CHECK(stats.ErrorCount == 0);
+    CHECK(backend.GetCommandCount(CommandType::CopyBufferRegion) == uploads.size());
+    CHECK(backend.GetCommandCount(CommandType::TransitionBarrier) == 4);
+    CHECK(stats.BarrierBatchCount == 2);
+
+    // 复制之前的屏障都在 prologue 中，复制之后的屏障在所有复制命令之后
+    CHECK(prologue.CommandCount() == 2);
+    bool copied = false;
+    bool barrierBeforeCopy = false;
+    commands.ForEach([&](CommandType type, const void *) {
+        copied |= type == CommandType::CopyBufferRegion;
+        barrierBeforeCopy |= type == CommandType::TransitionBarrier && !copied;
+    });
+    CHECK(!barrierBeforeCopy);
+}
+
+// 已处于 COPY_DEST 或最终状态就是 COPY_DEST 的资源不插入对应的屏障；
+// 同一资源以第一次登记的 StateBefore 为准，之后的 StateBefore 不产生额外的屏障
+void TestElidedBarriers()
+{
+    const std::vector<UploadPlanner::Upload> uploads = {
+        MakeUpload(&gVertexBuffer, 0, 0, 64, StateCopyDest, StateGenericRead),
+        MakeUpload(&gIndexBuffer, 0, 64, 64, StateCommon, StateCopyDest),
+        MakeUpload(&gIndexBuffer, 64, 128, 64, StateGenericRead, StateCopyDest),
+        MakeUpload(&gConstantBuffer, 0, 192, 64, StateCopyDest, StateCopyDest)};
+
+    ResourceStateMap states;
+    CommandStream prologue, commands;
+    UploadPlanner::Record(uploads, states, prologue, commands);
+    CHECK(prologue.CommandCount() == 1);
+
+    NullCommandBackend backend;
+    backend.SetResourceState(&gVertexBuffer, StateCopyDest);
+    backend.SetResourceState(&gIndexBuffer, StateCommon);
+    backend.SetResourceState(&gConstantBuffer, StateCopyDest);
+    Execute(backend, prologue, commands);
+    CHECK(backend.GetStatistics().ErrorCount == 0);
+    CHECK(backend.GetCommandCount(CommandType::TransitionBarrier) == 2);
+
+    // states 中已有的状态优先于 StateBefore：上一批结束时资源已处于 GENERIC_READ
+    CommandStream nextPrologue, nextCommands;
+    UploadPlanner::Record({MakeUpload(&gVertexBuffer, 0, 0, 64, StateCommon, StateGenericRead)}, states,
+                          nextPrologue, nextCommands);
+    backend.ResetStatistics();
+    Execute(backend, nextPrologue, nextCommands);
+    CHECK(backend.GetStatistics().ErrorCount == 0);
+    CHECK(backend.GetStatistics().BarrierBatchCount == 2);
+    uint32 state = 0;
+    CHECK(backend.GetResourceState(&gVertexBuffer, 0, state) && state == StateGenericRead);
+}
+} // namespace
+
+int main()
+{
+    TestCopies();
+    TestBatchedBarriers();
+    TestElidedBarriers();
+    return CheckResult();
+}
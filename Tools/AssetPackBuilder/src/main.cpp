@@ -0,0 +1,79 @@
+// 把一个目录打包为资源包（见 Common/AssetPack.h）
+//
+//   AssetPackBuilder <资源目录> <输出文件> [--store]
+//
+// 默认尝试以 LZ4 块格式压缩每个资源，--store 表示全部按原样保存。资源名为相对于资源目录的路径，
+// 例如 Shaders 目录打包之后，运行时用 "color.hlsl" 查找；打包上一级目录则用 "Shaders/color.hlsl"。
+// 输出文件不应放在资源目录中，否则下一次打包时会把旧的资源包也打包进去。
+
+#include "AssetPack.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+
+int main(int argc, char *argv[])
+{
+    bool compress = true;
+    bool extraArguments = false;
+    const char *input = nullptr;
+    const char *output = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--store") == 0)
+            compress = false;
+        else if (input == nullptr)
+            input = argv[i];
+        else if (output == nullptr)
+            output = argv[i];
+        else
+            extraArguments = true;
+    }
+    if (input == nullptr || output == nullptr || extraArguments)
+    {
+        std::fprintf(stderr, "usage: AssetPackBuilder <asset directory> <output file> [--store]\n");
+        return 2;
+    }
+
+    AssetPackWriter writer;
+    std::string error;
+    if (!writer.AddDirectory(std::filesystem::path(input).wstring(), compress, error))
+    {
+        std::fprintf(stderr, "error: %s\n", error.c_str());
+        return 1;
+    }
+
+    // 生成之后立即解析一遍并读回每个资源，保证写出的文件可以被运行时读取
+    std::vector<std::uint8_t> bytes = writer.Serialize();
+    AssetPack pack;
+    if (!pack.Parse(bytes))
+    {
+        std::fprintf(stderr, "error: the generated pack is invalid: %s\n", pack.Error().c_str());
+        return 1;
+    }
+
+    std::uint64_t totalSize = 0;
+    std::size_t compressedCount = 0;
+    std::vector<std::uint8_t> contents;
+    for (const AssetPack::Asset &asset : pack.Assets())
+    {
+        if (pack.Find(asset.Name) != &asset || !pack.Read(asset, contents) || contents.size() != asset.Size)
+        {
+            std::fprintf(stderr, "error: cannot read back %.*s\n", static_cast<int>(asset.Name.size()),
+                         asset.Name.data());
+            return 1;
+        }
+        totalSize += asset.Size;
+        if (asset.Method != AssetPack::Compression::None)
+            ++compressedCount;
+    }
+
+    if (!writer.Write(std::filesystem::path(output).wstring()))
+    {
+        std::fprintf(stderr, "error: cannot write %s\n", output);
+        return 1;
+    }
+
+    std::printf("%zu assets (%zu compressed), %llu bytes -> %zu bytes\n", pack.Assets().size(), compressedCount,
+                static_cast<unsigned long long>(totalSize), bytes.size());
+    return 0;
+}
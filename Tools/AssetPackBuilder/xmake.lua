@@ -0,0 +1,15 @@
+-- 资源包生成工具，只依赖 Common 中与平台无关的几个文件，不需要复制 Shaders 文件夹，所以不使用 BuildProject
+target("AssetPackBuilder")
+    set_kind("binary")
+    set_languages("cxx20")
+    add_defines("NOMINMAX", "UNICODE")
+    add_files("./src/**.cpp", "../../Common/AssetPack.cpp", "../../Common/Lz4Block.cpp", "../../Common/MappedFile.cpp")
+    add_includedirs("../../Common/")
+    if is_mode("release") then
+        set_optimize("aggressive")
+    else
+        set_optimize("none")
+    end
+    if is_plat("windows") then
+        add_cxflags("/EHsc", "/utf-8", {force = true})
+    end
@@ -81,3 +81,4 @@ includes("02_Drawing_in_Direct3D-Box")
 includes("03_Drawing_in_Direct3D_Part_II-Shapes")
 includes("04_Drawing_in_Direct3D_Part_II-LandAndWaves")
 includes("05_Lighting-LitWaves")
+includes("Tools/AssetPackBuilder")